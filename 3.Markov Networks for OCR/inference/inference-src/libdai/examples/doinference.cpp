@@ -17,11 +17,13 @@ using namespace std;
 
 
 int main( int argc, char *argv[] ) {
-    if ( argc != 3 ) {
-        cout << "Usage: " << argv[0] << " <filename.fg> [map|pd]" << endl << endl;
+    if ( argc != 3 && argc != 4 ) {
+        cout << "Usage: " << argv[0] << " <filename.fg> [map|pd] [<messages>]" << endl << endl;
         cout << "Reads factor graph <filename.fg> and runs" << endl;
         cout << "map: Junction tree MAP" << endl;
-        cout << "pd : LBP and posterior decoding" << endl << endl;
+        cout << "pd : LBP and posterior decoding" << endl;
+        cout << "For pd, LBP starts from the messages in file <messages> (if it exists)" << endl;
+        cout << "and writes its messages to it afterwards, for use by the next run" << endl << endl;
         return 1;
     } else {
         // Redirect cerr to inf.log
@@ -76,8 +78,20 @@ int main( int argc, char *argv[] ) {
             BP bp(fg, opts("updates",string("SEQMAX"))("logdomain",true));
             // Initialize belief propagation algorithm
             bp.init();
+            // Start from the messages of a previous run on a similar factor graph, if available
+            if( argc == 4 ) {
+                ifstream msgfile( argv[3] );
+                if( msgfile.is_open() ) {
+                    BPMessages msgs;
+                    msgfile >> msgs;
+                    cerr << "Imported " << bp.importMessages( msgs ) << " of " << fg.nrEdges() << " messages" << endl;
+                }
+            }
             // Run belief propagation algorithm
             bp.run();
+            // Save the messages for the next run
+            if( argc == 4 )
+                bp.exportMessages().WriteToFile( argv[3] );
 
             // Report variable marginals for fg, calculated by the belief propagation algorithm
             cerr << "LBP posterior decoding (highest prob assignment in marginal):" << endl;
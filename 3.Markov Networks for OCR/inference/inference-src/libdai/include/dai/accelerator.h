@@ -0,0 +1,97 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+/// \file
+/// \brief Defines class Accelerator, which accelerates the convergence of fixed-point iterations
+
+
+#ifndef __defined_libdai_accelerator_h
+#define __defined_libdai_accelerator_h
+
+
+#include <vector>
+#include <dai/util.h>
+#include <dai/enum.h>
+
+
+namespace dai {
+
+
+/// Accelerates the convergence of a fixed-point iteration \f$ x \leftarrow G(x) \f$ on a vector of reals
+/** In each iteration, the caller calculates the plain update \f$ g = G(x) \f$ of the current iterate \a x
+ *  and passes both to step(), which replaces \a g by the next iterate. The methods are:
+ *  - NONE: the next iterate is \a g (plain fixed-point iteration);
+ *  - ANDERSON: Anderson mixing [\ref WaN11] with a window of the last \a window iterations: with the
+ *    residuals \f$ f_k = g_k - x_k \f$, the differences \f$ \Delta F \f$ and \f$ \Delta G \f$ of successive
+ *    residuals and updates in the window, and the coefficients \f$ \gamma \f$ that minimize
+ *    \f$ \| f_k - \Delta F \gamma \|_2 \f$, the next iterate is \f$ g_k - \Delta G \gamma \f$.
+ *
+ *  As a safeguard, if the norm of the residual grows in an iteration, the history is cleared and the next
+ *  iterate is the damped update \f$ x_k + f_k / 2 \f$. If \a nonnegative is \c true (e.g., for
+ *  messages or beliefs in the linear domain), an accelerated iterate with negative entries is rejected in
+ *  favor of \a g, and the history is cleared. Entries of \a x or \a g that are not finite (e.g., logarithms of
+ *  zeros) are not mixed: the next iterate takes them from \a g.
+ */
+class Accelerator {
+    public:
+        /// Enumeration of acceleration methods
+        DAI_ENUM(Method,NONE,ANDERSON);
+
+    private:
+        /// The acceleration method
+        Method _method;
+        /// Maximum number of differences kept by Anderson mixing
+        size_t _window;
+        /// Whether the iterates should be nonnegative
+        bool _nonnegative;
+        /// Differences of the residuals of successive iterations (at most \a _window, in a circular buffer)
+        std::vector<std::vector<Real> > _df;
+        /// Differences of the updates of successive iterations (at most \a _window, in a circular buffer)
+        std::vector<std::vector<Real> > _dg;
+        /// Position in \a _df and \a _dg of the next difference
+        size_t _next;
+        /// Residual of the previous iteration (empty before the first iteration)
+        std::vector<Real> _lastF;
+        /// Update of the previous iteration
+        std::vector<Real> _lastG;
+        /// Norm of the residual of the previous iteration
+        Real _lastNorm;
+        /// Number of times that the history has been cleared by the safeguards
+        size_t _nrRestarts;
+
+    public:
+        /// Constructs an Accelerator with method \a method and window \a window for iterates that are \a nonnegative
+        Accelerator( Method method = Method::NONE, size_t window = 5, bool nonnegative = false );
+
+        /// Returns the acceleration method
+        Method method() const { return _method; }
+
+        /// Returns the maximum number of differences kept by Anderson mixing
+        size_t window() const { return _window; }
+
+        /// Returns the number of times that the history has been cleared by the safeguards
+        size_t nrRestarts() const { return _nrRestarts; }
+
+        /// Clears the history, e.g., when the fixed-point iteration is restarted
+        void reset();
+
+        /// Replaces the plain update \a g of the current iterate \a x by the next iterate
+        /** \pre \a x and \a g have the same size, which should be the same in all iterations since the last reset()
+         */
+        void step( const std::vector<Real> &x, std::vector<Real> &g );
+
+    private:
+        /// Clears the differences
+        void clearHistory();
+};
+
+
+} // end of namespace dai
+
+
+#endif
@@ -27,6 +27,7 @@
 #include <dai/emalg.h>
 #ifdef DAI_WITH_BP
     #include <dai/bp.h>
+    #include <dai/batchbp.h>
 #endif
 #ifdef DAI_WITH_FBP
     #include <dai/fbp.h>
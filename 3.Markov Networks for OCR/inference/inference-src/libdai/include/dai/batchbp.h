@@ -0,0 +1,199 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+/// \file
+/// \brief Defines class BatchBP, which runs Belief Propagation on a batch of factor graphs with the same structure
+
+
+#ifndef __defined_libdai_batchbp_h
+#define __defined_libdai_batchbp_h
+
+
+#include <string>
+#include <vector>
+#include <dai/factorgraph.h>
+#include <dai/properties.h>
+#include <dai/enum.h>
+#include <dai/index.h>
+
+
+namespace dai {
+
+
+/// Runs (loopy) Belief Propagation on a batch of factor graphs that have the same structure
+/** The factor graphs (the \a instances) should have the same variables and factors with the same
+ *  variables, in the same order; only the values of the factors may differ, as for the word graphs
+ *  of words of the same length in OCR. Instead of running a BP object for each instance, BatchBP
+ *  runs the update schedule once for all instances.
+ *
+ *  The factor values and the messages of all instances are stored in structure-of-arrays layout,
+ *  with the instance index innermost: value \a s of factor (or message) \a k of instance \a n is
+ *  stored at position (\a offset[\a k] + \a s) * \a N + \a n, where \a N is the number of instances.
+ *  The innermost loops of the message calculation run over the instances, reading and writing
+ *  consecutive memory, so that they can be vectorized even if the messages have few states.
+ *
+ *  An instance has converged when none of its messages changes by more than \a tol in an iteration
+ *  (as for BP with \a convergence == RESIDUALS). Converged instances are moved behind the instances
+ *  that have not converged yet, so that the following iterations only process the latter, which are
+ *  kept contiguous. The messages are calculated in the linear domain, and the update schedules PARALL
+ *  and SEQFIX are supported; for each instance, the results are the same as those of BP with
+ *  \a logdomain == \c false and \a convergence == RESIDUALS (up to rounding errors).
+ */
+class BatchBP {
+    public:
+        /// Parameters for BatchBP
+        struct Properties {
+            /// Enumeration of possible update schedules
+            /** The following update schedules have been defined:
+             *  - PARALL parallel updates
+             *  - SEQFIX sequential updates, factor by factor
+             */
+            DAI_ENUM(UpdateType,SEQFIX,PARALL);
+
+            /// Enumeration of inference variants
+            /** There are two inference variants:
+             *  - SUMPROD Sum-Product
+             *  - MAXPROD Max-Product (equivalent to Min-Sum)
+             */
+            DAI_ENUM(InfType,SUMPROD,MAXPROD);
+
+            /// Verbosity (amount of output sent to stderr)
+            size_t verbose;
+
+            /// Maximum number of iterations
+            size_t maxiter;
+
+            /// Tolerance for convergence test
+            Real tol;
+
+            /// Damping constant (0.0 means no damping, 1.0 is maximum damping)
+            Real damping;
+
+            /// Message update schedule
+            UpdateType updates;
+
+            /// Inference variant
+            InfType inference;
+        } props;
+
+    private:
+        /// The first instance, which defines the structure of all instances
+        FactorGraph _fg;
+        /// Number of instances
+        size_t _nrInstances;
+        /// For each factor, the position of its first value in \a _factors (divided by the number of instances)
+        std::vector<size_t> _factorOffsets;
+        /// Values of the factors of all instances
+        std::vector<Real> _factors;
+        /// For each factor, the number of its first edge (the edges are numbered factor by factor)
+        std::vector<size_t> _edgeOffsets;
+        /// For each edge, the position of its first message value in \a _messages and \a _newMessages (divided by the number of instances)
+        std::vector<size_t> _messageOffsets;
+        /// Values of the messages of all instances
+        std::vector<Real> _messages;
+        /// Values of the updated messages of all instances
+        std::vector<Real> _newMessages;
+        /// For each edge, the state of its variable in each joint state of its factor
+        std::vector<IndexTable> _indices;
+        /// The instance at each position (the instances that have not converged come first)
+        std::vector<size_t> _instances;
+        /// The position of each instance
+        std::vector<size_t> _positions;
+        /// Number of instances that have not converged yet
+        size_t _nrActive;
+        /// Number of iterations of each instance
+        std::vector<size_t> _iters;
+        /// Maximum change of the messages of each instance in its last iteration
+        std::vector<Real> _maxDiffs;
+        /// Maximum change of the messages at each position in the current iteration
+        std::vector<Real> _changes;
+        /// Products of the incoming messages of the variables of a factor, for each position
+        std::vector<Real> _products;
+        /// Product of a factor value and incoming messages, for each position
+        std::vector<Real> _values;
+
+    public:
+    /// \name Constructors/destructors
+    //@{
+        /// Construct from the instances \a fgs and PropertySet \a opts
+        /** \param fgs Factor graphs with the same structure.
+         *  \param opts Parameters @see Properties
+         *  \throw INCOMPATIBLE_FACTORGRAPHS if the factor graphs do not have the same structure
+         */
+        BatchBP( const std::vector<FactorGraph> &fgs, const PropertySet &opts );
+    //@}
+
+    /// \name Queries
+    //@{
+        /// Returns the first instance, which defines the structure of all instances
+        const FactorGraph& fg() const { return _fg; }
+
+        /// Returns the number of instances
+        size_t nrInstances() const { return _nrInstances; }
+
+        /// Returns the number of instances that have not converged yet
+        size_t nrActive() const { return _nrActive; }
+
+        /// Returns the \a I 'th factor of instance \a n
+        Factor factor( size_t n, size_t I ) const;
+
+        /// Returns the belief of the \a i 'th variable of instance \a n
+        Factor beliefV( size_t n, size_t i ) const;
+
+        /// Returns the belief of the \a I 'th factor of instance \a n
+        Factor beliefF( size_t n, size_t I ) const;
+
+        /// Returns the logarithm of the (approximated) partition sum of instance \a n
+        Real logZ( size_t n ) const;
+
+        /// Returns the number of iterations of instance \a n
+        size_t Iterations( size_t n ) const { return _iters[n]; }
+
+        /// Returns the maximum change of the messages of instance \a n in its last iteration
+        Real maxDiff( size_t n ) const { return _maxDiffs[n]; }
+
+        /// Returns a string that identifies the algorithm and its parameters
+        std::string identify() const { return "BatchBP" + printProperties(); }
+    //@}
+
+    /// \name Inference
+    //@{
+        /// Resets all messages of all instances to ones
+        void init();
+
+        /// Runs BP on all instances that have not converged, until they converge or reach \a maxiter iterations
+        /** \return The maximum over all instances of the change of the messages in their last iteration
+         */
+        Real run();
+
+        /// Sets parameters of this algorithm
+        void setProperties( const PropertySet &opts );
+
+        /// Returns parameters of this algorithm
+        PropertySet getProperties() const;
+
+        /// Returns parameters of this algorithm formatted as a string
+        std::string printProperties() const;
+    //@}
+
+    private:
+        /// Returns the number of the edge between variable \a i and its \a _I 'th neighbor
+        size_t edge( size_t i, size_t _I ) const { return _edgeOffsets[_fg.nbV(i)[_I]] + _fg.nbV(i)[_I].dual; }
+        /// Calculates the updated messages from factor \a I to all its neighbors, for the instances that have not converged
+        void calcNewMessages( size_t I );
+        /// Replaces the messages from factor \a I by the updated messages and records the changes, for the instances that have not converged
+        void updateMessages( size_t I );
+        /// Swaps the factors, messages and results of the instances at positions \a a and \a b
+        void swapPositions( size_t a, size_t b );
+};
+
+
+} // end of namespace dai
+
+
+#endif
@@ -295,6 +295,23 @@ class BipartiteGraph {
         /// Returns true if the graph is a tree, i.e., if it is singly connected and connected.
         bool isTree() const;
 
+        /// Calculates a Reverse Cuthill-McKee ordering of the nodes, which numbers neighboring nodes close together
+        /** The nodes of both types are ordered together: each connected component is searched breadth-first
+         *  from a pseudo-peripheral node, visiting the unvisited neighbors of a node in order of increasing
+         *  degree, and the resulting order is reversed [\ref CuM69]. On return, \a order1 [\a k] is the node of
+         *  type 1 which comes \a k 'th in the new order, and similarly for \a order2 and the nodes of type 2.
+         */
+        void orderRCM( std::vector<size_t>& order1, std::vector<size_t>& order2 ) const;
+
+        /// Calculates an ordering of the nodes by recursive bisection
+        /** The nodes of both types are ordered together: they are split into two halves by a breadth-first
+         *  search from a pseudo-peripheral node, the first half of the visited nodes forming one part and the
+         *  rest the other part; the parts are split recursively in the same way until they contain at most
+         *  \a leafSize nodes. Neighboring nodes thus end up in the same part at as many levels as possible.
+         *  \a order1 and \a order2 are as in orderRCM().
+         */
+        void orderBisection( std::vector<size_t>& order1, std::vector<size_t>& order2, size_t leafSize = 32 ) const;
+
         /// Comparison operator which returns true if two graphs are identical
         /** \note Two graphs are called identical if they have the same number of nodes
          *  of both types and the same edges (i.e., \a x has an edge between nodes
@@ -16,15 +16,84 @@
 
 
 #include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+#include <algorithm>
 #include <dai/daialg.h>
 #include <dai/factorgraph.h>
+#include <dai/sparsefactor.h>
+#include <dai/pairwisefactor.h>
+#include <dai/logfactor.h>
 #include <dai/properties.h>
 #include <dai/enum.h>
+#include <dai/threadpool.h>
+#include <dai/indexedheap.h>
+#include <dai/accelerator.h>
+#include <boost/shared_ptr.hpp>
 
 
 namespace dai {
 
 
+/// Stores BP messages, keyed by the label of the variable and the labels of the variables of the factor of each edge
+/** The messages exported by BP::exportMessages() for one factor graph can be imported by BP::importMessages()
+ *  into a BP object for a different factor graph that has some edges in common with it (i.e., a variable with
+ *  the same label that is connected to a factor with the same variables). The messages of these edges then
+ *  start at the values of the first, which usually saves iterations if the factors are similar ("warm start").
+ *  The messages are stored normalized and in the linear domain, independently of \a logdomain.
+ *
+ *  A BPMessages object can be written to and read from a stream or a file, in the following text format:
+ *  the number of messages, followed by one line for each message, containing the label of the variable,
+ *  the number of variables of the factor, their labels, the number of values of the message and the values.
+ *  Lines at the start of the file that begin with a '#' are ignored.
+ */
+class BPMessages {
+    public:
+        /// Type of the keys: the label of the variable and the labels of the variables of the factor (in increasing order)
+        typedef std::pair<size_t, std::vector<size_t> > Key;
+
+    private:
+        /// The messages
+        std::map<Key, Prob> _messages;
+
+    public:
+        /// Returns the key of the message from the factor with variables \a factorVars to variable \a v
+        static Key key( const Var &v, const VarSet &factorVars );
+
+        /// Returns the number of messages
+        size_t size() const { return _messages.size(); }
+
+        /// Removes all messages
+        void clear() { _messages.clear(); }
+
+        /// Sets the message from the factor with variables \a factorVars to variable \a v to \a p
+        void set( const Var &v, const VarSet &factorVars, const Prob &p ) { _messages[key( v, factorVars )] = p; }
+
+        /// Returns a pointer to the message from the factor with variables \a factorVars to variable \a v, or \c NULL if there is no such message
+        const Prob* get( const Var &v, const VarSet &factorVars ) const;
+
+        /// Reads the messages from a file
+        /** \throw CANNOT_READ_FILE if the file cannot be opened
+         *  \throw INVALID_MESSAGES_FILE if the file is not valid
+         */
+        void ReadFromFile( const char *filename );
+
+        /// Writes the messages to a file
+        /** \throw CANNOT_WRITE_FILE if the file cannot be written
+         */
+        void WriteToFile( const char *filename, size_t precision=15 ) const;
+
+        /// Writes the messages to an output stream
+        friend std::ostream& operator<< ( std::ostream& os, const BPMessages& msgs );
+
+        /// Reads the messages from an input stream
+        /** \throw INVALID_MESSAGES_FILE if the input stream is not valid
+         */
+        friend std::istream& operator>> ( std::istream& is, BPMessages& msgs );
+};
+
+
 /// Approximate inference algorithm "(Loopy) Belief Propagation"
 /** The Loopy Belief Propagation algorithm uses message passing
  *  to approximate marginal probability distributions ("beliefs") for variables
@@ -54,32 +123,119 @@ namespace dai {
  *
  *  \note There are two implementations, an optimized one (the default) which caches IndexFor objects,
  *  and a slower, less complicated one which is easier to maintain/understand. The slower one can be 
- *  enabled by defining DAI_BP_FAST as false in the source file.
+ *  enabled by defining DAI_BP_FAST as false in the source file. The cached indices are IndexTable objects,
+ *  of which the representation is chosen by \a edgeindex: COMPACT (the default) stores the entries in the
+ *  narrowest integer type that fits (usually a single byte), FULL stores them as \c size_t, and STRIDED
+ *  stores nothing and calculates the entries on the fly. indexBytes() reports the memory they use.
+ *
+ *  The messages from a factor to all its neighbors are calculated together by calcNewMessages(), in a single
+ *  pass over the factor table: for each joint state, the products of the factor value and the incoming
+ *  messages of all but one of the neighbors are obtained from prefix and suffix products, and the products
+ *  of the messages into each neighbor (except the message from the factor itself) are calculated only once.
+ *  This reduces the cost of calculating the messages of a factor with \a d variables from
+ *  <em>O</em>(<em>d</em><sup>2</sup>) to <em>O</em>(<em>d</em>) passes over its table. Except for SEQRND,
+ *  all update schedules calculate the new messages factor by factor.
+ *
+ *  Factors of which the fraction of nonzero values is at most \a maxdensity are also stored as
+ *  SparseFactor objects; the messages sent by these factors are calculated by iterating over
+ *  the nonzero values only, which yields exactly the same messages at a fraction of the cost.
+ *
+ *  If \a parametric is \c true, pairwise factors are also stored as PairwiseFactor objects. Those that are
+ *  constant off the diagonal (such as Potts factors) send their messages in <em>O</em>(<em>k</em>) instead of
+ *  <em>O</em>(<em>k</em><sup>2</sup>) operations for variables with \a k states, and so do truncated linear
+ *  and truncated quadratic factors for max-product (by distance transforms [\ref FeH06]). The messages
+ *  are the same up to rounding errors. Testing convergence on the beliefs calculates the factor beliefs,
+ *  which still costs <em>O</em>(<em>k</em><sup>2</sup>), so this is best combined with \a convergence == RESIDUALS.
+ *
+ *  If \a nthreads > 1, the new messages of parallel updates (PARALL) are calculated and applied
+ *  by a ThreadPool of \a nthreads threads, and for all update schedules the beliefs are compared
+ *  with those of the previous iteration in parallel. The variables and factors are partitioned into
+ *  consecutive blocks of approximately equal work, measured by the sizes of the factor tables.
+ *  Because each message is calculated exactly as with a single thread, the results are identical.
+ *
+ *  Relaxed maximum-residual updates (PARMAX) let \a nthreads threads perform maximum-residual updates
+ *  simultaneously. The residuals are kept in a MultiQueue [\ref RSD15] of 2 \a nthreads heaps; each thread
+ *  repeatedly updates the message with the larger residual of the tops of two randomly chosen heaps
+ *  and recalculates the messages that depend on it. The messages into each variable are protected by a
+ *  mutex. Each pass consists of as many message updates as there are edges, after which the beliefs are
+ *  compared with those of the previous pass, as for SEQMAX. With a single thread, there is a single heap,
+ *  and PARMAX yields the same results as SEQMAX; with several threads, the order of the updates (and
+ *  hence the results, within the tolerance) depends on the timing of the threads.
+ *
+ *  Splash updates (SPLASH) [\ref GLG09] keep the residual of each variable, the largest residual of its
+ *  incoming messages, in a priority queue. A splash is grown around the variable with the largest residual
+ *  by breadth-first search, up to \a splashsize variables, leaving out variables of which the residual is at
+ *  most \a tol (i.e., of which the incoming messages have converged); the messages into these variables are then
+ *  updated from the leaves towards the root and back, which propagates information through the splash in
+ *  a single sweep (exactly, if the splash is a tree). Afterwards, the messages sent by the factors around
+ *  the splash and the residuals of their variables are recalculated. With \a nthreads > 1, each step
+ *  grows up to \a nthreads splashes around the variables with the largest residuals, which neither update
+ *  nor read the messages of each other's variables, and updates them in parallel; the results depend on
+ *  \a nthreads, but not on the timing of the threads. As for SEQMAX, each pass consists of at least as
+ *  many message updates as there are edges.
+ *
+ *  If \a freezetol > 0, the sweeps of SEQFIX and PARALL updates skip the edges of which the messages have
+ *  converged. An edge becomes dormant when the residual of its message has been at most \a freezetol in
+ *  \a freezesweeps successive sweeps, and is woken when a message into another variable of its factor changes
+ *  by more than \a freezetol. A sweep only visits the factors that have edges that are not dormant, so once
+ *  most messages have converged, its cost is proportional to the number of active edges. Because a dormant
+ *  message may be off by about \a freezetol, \a freezetol should not be larger than \a tol; with \a convergence
+ *  == RESIDUALS, only the changes of the active messages are compared with \a tol (with BELIEFS, all beliefs
+ *  are still compared after each sweep). The sweeps are done by a single thread, also if \a nthreads > 1.
+ *  nrDormantEdges() returns the number of dormant edges.
+ *
+ *  If \a acceleration == ANDERSON, the sweeps of SEQFIX and PARALL updates are regarded as a fixed-point
+ *  iteration on the vector of all messages, which is accelerated by Anderson mixing (see Accelerator): after
+ *  each sweep, the messages are replaced by a combination of the messages before and after the last
+ *  \a accelwindow sweeps, and normalized; when the residual grows, the accelerator falls back to a damped
+ *  update. The convergence criteria still compare the plain updates with \a tol, so BP converges to the same
+ *  fixed point. This mostly pays off for models on which BP converges slowly (or oscillates), and may take a
+ *  few more iterations on models on which it converges in a handful of iterations. Acceleration is ignored
+ *  by the other update schedules, and freezing is disabled while accelerating, because the accelerated
+ *  sweeps change all messages.
+ *
+ *  The edges are numbered in the order of the sequential update schedule (factor by factor), and the
+ *  values of all old and new messages are stored contiguously in two flat arrays in this order, so that
+ *  a sweep over the edges reads memory sequentially instead of following a pointer for each message.
+ *
+ *  By default (\a convergence == BELIEFS), BP has converged when no variable or factor belief changes
+ *  by more than \a tol in an iteration, which requires calculating all beliefs after each iteration
+ *  and storing those of the previous one. With \a convergence == RESIDUALS, BP has converged when no
+ *  message changes by more than \a tol in an iteration; the changes are recorded while the messages
+ *  are updated, and the old beliefs are not stored. At a fixed point of the messages, the beliefs are
+ *  fixed as well, so both criteria lead to the same results (up to the tolerance).
  */
 class BP : public DAIAlgFG {
     protected:
         /// Type used for index cache
-        typedef std::vector<size_t> ind_t;
-        /// Type used for storing edge properties
-        struct EdgeProp {
-            /// Index cached for this edge
-            ind_t  index;
-            /// Old message living on this edge
-            Prob   message;
-            /// New message living on this edge
-            Prob   newMessage;
-            /// Residual for this edge
-            Real   residual;
-        };
-        /// Stores all edge properties
-        std::vector<std::vector<EdgeProp> > _edges;
-        /// Type of lookup table (only used for maximum-residual BP)
-        typedef std::multimap<Real, std::pair<std::size_t, std::size_t> > LutType;
-        /// Lookup table (only used for maximum-residual BP)
-        std::vector<std::vector<LutType::iterator> > _edge2lut;
-        /// Lookup table (only used for maximum-residual BP)
-        LutType _lut;
-        /// Maximum difference between variable beliefs encountered so far
+        typedef IndexTable ind_t;
+        /// For each variable, the position in \a _varEdges of the edge to its first neighbor (the last entry is nrEdges())
+        std::vector<size_t> _varEdgeOffsets;
+        /// The number of the edge between each variable \a i and its \a _I 'th neighbor, at position \a _varEdgeOffsets[i] + \a _I
+        std::vector<size_t> _varEdges;
+        /// The variable and the neighbor index of each edge (the edges are numbered in the order of the sequential update schedule)
+        std::vector<Edge> _edgeList;
+        /// For each edge, the position of its message values in \a _messages and \a _newMessages (the last entry is the total number of values)
+        std::vector<size_t> _messageOffsets;
+        /// Values of the old messages of all edges
+        std::vector<Real> _messages;
+        /// Values of the new messages of all edges
+        std::vector<Real> _newMessages;
+        /// Residual of each edge
+        std::vector<Real> _residuals;
+        /// Index cached for each edge
+        std::vector<ind_t> _indices;
+        /// Plan for looping over the factor of each edge, indexing into its variable (only for factors with at most three variables)
+        std::vector<boost::shared_ptr<const ContractionPlan> > _plans;
+        /// Type of the keys of the residual queue: the residual and the number of the update that set it
+        /** Of several edges with the same residual, the one whose residual was set last has the highest priority.
+         */
+        typedef std::pair<Real, size_t> ResidualKey;
+        /// Priority queue of the residuals of all edges, of which the items are the edge numbers (only used for maximum-residual BP)
+        IndexedHeap<ResidualKey> _residualQueue;
+        /// Number of residuals that have been set (only used for maximum-residual BP)
+        size_t _nrResidualUpdates;
+        /// Maximum difference between beliefs (or messages, if \a props.convergence == RESIDUALS) encountered so far
         Real _maxdiff;
         /// Number of iterations needed
         size_t _iters;
@@ -89,8 +245,50 @@ class BP : public DAIAlgFG {
         std::vector<Factor> _oldBeliefsV;
         /// Stores factor beliefs of previous iteration
         std::vector<Factor> _oldBeliefsF;
+        /// Largest change of the message of each edge in the current iteration (only if \a props.convergence == RESIDUALS)
+        std::vector<Real> _changes;
         /// Stores the update schedule
         std::vector<Edge> _updateSeq;
+        /// Stores sparse copies of the factors of which the density is at most \a props.maxdensity
+        std::vector<SparseFactor> _sparseFactors;
+        /// Specifies for each factor whether its sparse copy is used for calculating messages
+        std::vector<bool> _useSparse;
+        /// Stores parametric copies of the pairwise factors (only if \a props.parametric == \c true, otherwise of kind DENSE)
+        std::vector<PairwiseFactor> _pairwiseFactors;
+        /// Stores the logarithms of the factors (only if \a props.logdomain == \c true)
+        std::vector<LogFactor> _logFactors;
+        /// Threads used if \a props.nthreads > 1 (created by run(), not shared with copies)
+        boost::shared_ptr<ThreadPool> _threadPool;
+        /// Heaps of residuals and mutexes used by relaxed maximum-residual BP
+        struct ResidualMultiQueue;
+        /// Relaxed priority queue of the residuals (only used for relaxed maximum-residual BP, created by run(), not shared with copies)
+        boost::shared_ptr<ResidualMultiQueue> _multiQueue;
+        /// Partition of the variables over the threads (see partitionWork())
+        std::vector<size_t> _varParts;
+        /// Partition of the factors over the threads (see partitionWork())
+        std::vector<size_t> _factorParts;
+        /// Variables of the splashes that are updated simultaneously, in breadth-first order (only used for splash BP)
+        std::vector<std::vector<size_t> > _splashes;
+        /// For each variable, the number of the last splash that contains it (only used for splash BP)
+        std::vector<size_t> _splashVars;
+        /// For each variable, the number of the first splash of the last batch of splashes that reads its incoming messages (only used for splash BP)
+        std::vector<size_t> _splashReads;
+        /// Number of splashes grown so far (only used for splash BP)
+        size_t _nrSplashes;
+        /// For each edge, the number of successive sweeps in which its residual was at most \a props.freezetol, up to \a props.freezesweeps, which means that the edge is dormant (only used if freezing())
+        std::vector<size_t> _quietSweeps;
+        /// For each factor, the number of its edges that are not dormant (only used if freezing())
+        std::vector<size_t> _nrActiveEdges;
+        /// The factors with edges that are not dormant, which are visited by the next sweep (only used if freezing())
+        std::vector<size_t> _activeFactors;
+        /// Specifies for each factor whether it is in \a _activeFactors (only used if freezing())
+        std::vector<bool> _factorQueued;
+        /// Number of dormant edges (only used if freezing())
+        size_t _nrDormantEdges;
+        /// Accelerates the sweeps (only used if accelerating())
+        Accelerator _accelerator;
+        /// The messages before the current sweep (only used if accelerating())
+        std::vector<Real> _previousMessages;
 
     public:
         /// Parameters for BP
@@ -101,8 +299,10 @@ class BP : public DAIAlgFG {
              *  - SEQFIX sequential updates using a fixed sequence
              *  - SEQRND sequential updates using a random sequence
              *  - SEQMAX maximum-residual updates [\ref EMK06]
+             *  - PARMAX relaxed maximum-residual updates by \a nthreads threads
+             *  - SPLASH splash updates [\ref GLG09]
              */
-            DAI_ENUM(UpdateType,SEQFIX,SEQRND,SEQMAX,PARALL);
+            DAI_ENUM(UpdateType,SEQFIX,SEQRND,SEQMAX,PARALL,PARMAX,SPLASH);
 
             /// Enumeration of inference variants
             /** There are two inference variants:
@@ -111,6 +311,14 @@ class BP : public DAIAlgFG {
              */
             DAI_ENUM(InfType,SUMPROD,MAXPROD);
 
+            /// Enumeration of convergence criteria
+            /** There are two convergence criteria:
+             *  - BELIEFS the maximum difference between the beliefs of successive iterations
+             *  - RESIDUALS the maximum change of the messages in an iteration (for SEQMAX, PARMAX and
+             *    SPLASH, also the maximum residual of the messages that have not been updated yet)
+             */
+            DAI_ENUM(ConvergenceType,BELIEFS,RESIDUALS);
+
             /// Verbosity (amount of output sent to stderr)
             size_t verbose;
 
@@ -134,6 +342,36 @@ class BP : public DAIAlgFG {
 
             /// Inference variant
             InfType inference;
+
+            /// Maximum fraction of nonzero values of factors that are treated as sparse (0.0 means that no factors are treated as sparse)
+            Real maxdensity;
+
+            /// Whether pairwise factors of a parametric form (see PairwiseFactor) send their messages in linear time
+            bool parametric;
+
+            /// Number of threads used for parallel updates and for comparing beliefs (1 means no multithreading)
+            size_t nthreads;
+
+            /// Representation of the cached indices of the edges (see IndexTable)
+            IndexTable::Type edgeindex;
+
+            /// Convergence criterion that is compared with \a tol
+            ConvergenceType convergence;
+
+            /// Maximum number of variables of a splash (only for SPLASH updates)
+            size_t splashsize;
+
+            /// Residual up to which messages are considered converged, so that their edges can become dormant (0.0 means no freezing; only for SEQFIX and PARALL updates)
+            Real freezetol;
+
+            /// Number of successive sweeps in which the residual of an edge should be at most \a freezetol before the edge becomes dormant
+            size_t freezesweeps;
+
+            /// Acceleration method of the sweeps (only for SEQFIX and PARALL updates)
+            Accelerator::Method acceleration;
+
+            /// Number of previous sweeps that are combined by ANDERSON acceleration
+            size_t accelwindow;
         } props;
 
         /// Specifies whether the history of message updates should be recorded
@@ -143,37 +381,60 @@ class BP : public DAIAlgFG {
     /// \name Constructors/destructors
     //@{
         /// Default constructor
-        BP() : DAIAlgFG(), _edges(), _edge2lut(), _lut(), _maxdiff(0.0), _iters(0U), _sentMessages(), _oldBeliefsV(), _oldBeliefsF(), _updateSeq(), props(), recordSentMessages(false) {}
+        BP() : DAIAlgFG(), _varEdgeOffsets(), _varEdges(), _edgeList(), _messageOffsets(), _messages(), _newMessages(), _residuals(), _indices(), _plans(), _residualQueue(), _nrResidualUpdates(0), _maxdiff(0.0), _iters(0U), _sentMessages(), _oldBeliefsV(), _oldBeliefsF(), _changes(), _updateSeq(), _sparseFactors(), _useSparse(), _pairwiseFactors(), _logFactors(), _threadPool(), _multiQueue(), _varParts(), _factorParts(), _splashes(), _splashVars(), _splashReads(), _nrSplashes(0), _quietSweeps(), _nrActiveEdges(), _activeFactors(), _factorQueued(), _nrDormantEdges(0), _accelerator(), _previousMessages(), props(), recordSentMessages(false) {}
 
         /// Construct from FactorGraph \a fg and PropertySet \a opts
         /** \param fg Factor graph.
          *  \param opts Parameters @see Properties
          */
-        BP( const FactorGraph & fg, const PropertySet &opts ) : DAIAlgFG(fg), _edges(), _maxdiff(0.0), _iters(0U), _sentMessages(), _oldBeliefsV(), _oldBeliefsF(), _updateSeq(), props(), recordSentMessages(false) {
+        BP( const FactorGraph & fg, const PropertySet &opts ) : DAIAlgFG(fg), _varEdgeOffsets(), _varEdges(), _edgeList(), _messageOffsets(), _messages(), _newMessages(), _residuals(), _indices(), _plans(), _residualQueue(), _nrResidualUpdates(0), _maxdiff(0.0), _iters(0U), _sentMessages(), _oldBeliefsV(), _oldBeliefsF(), _changes(), _updateSeq(), _sparseFactors(), _useSparse(), _pairwiseFactors(), _logFactors(), _threadPool(), _multiQueue(), _varParts(), _factorParts(), _splashes(), _splashVars(), _splashReads(), _nrSplashes(0), _quietSweeps(), _nrActiveEdges(), _activeFactors(), _factorQueued(), _nrDormantEdges(0), _accelerator(), _previousMessages(), props(), recordSentMessages(false) {
             setProperties( opts );
             construct();
         }
 
         /// Copy constructor
-        BP( const BP &x ) : DAIAlgFG(x), _edges(x._edges), _edge2lut(x._edge2lut), _lut(x._lut), _maxdiff(x._maxdiff), _iters(x._iters), _sentMessages(x._sentMessages), _oldBeliefsV(x._oldBeliefsV), _oldBeliefsF(x._oldBeliefsF), _updateSeq(x._updateSeq), props(x.props), recordSentMessages(x.recordSentMessages) {
-            for( LutType::iterator l = _lut.begin(); l != _lut.end(); ++l )
-                _edge2lut[l->second.first][l->second.second] = l;
-        }
+        BP( const BP &x ) : DAIAlgFG(x), _varEdgeOffsets(x._varEdgeOffsets), _varEdges(x._varEdges), _edgeList(x._edgeList), _messageOffsets(x._messageOffsets), _messages(x._messages), _newMessages(x._newMessages), _residuals(x._residuals), _indices(x._indices), _plans(x._plans), _residualQueue(x._residualQueue), _nrResidualUpdates(x._nrResidualUpdates), _maxdiff(x._maxdiff), _iters(x._iters), _sentMessages(x._sentMessages), _oldBeliefsV(x._oldBeliefsV), _oldBeliefsF(x._oldBeliefsF), _changes(x._changes), _updateSeq(x._updateSeq), _sparseFactors(x._sparseFactors), _useSparse(x._useSparse), _pairwiseFactors(x._pairwiseFactors), _logFactors(x._logFactors), _threadPool(), _multiQueue(), _varParts(), _factorParts(), _splashes(), _splashVars(), _splashReads(), _nrSplashes(0), _quietSweeps(x._quietSweeps), _nrActiveEdges(x._nrActiveEdges), _activeFactors(x._activeFactors), _factorQueued(x._factorQueued), _nrDormantEdges(x._nrDormantEdges), _accelerator(x._accelerator), _previousMessages(x._previousMessages), props(x.props), recordSentMessages(x.recordSentMessages) {}
 
         /// Assignment operator
         BP& operator=( const BP &x ) {
             if( this != &x ) {
                 DAIAlgFG::operator=( x );
-                _edges = x._edges;
-                _lut = x._lut;
-                for( LutType::iterator l = _lut.begin(); l != _lut.end(); ++l )
-                    _edge2lut[l->second.first][l->second.second] = l;
+                _varEdgeOffsets = x._varEdgeOffsets;
+                _varEdges = x._varEdges;
+                _edgeList = x._edgeList;
+                _messageOffsets = x._messageOffsets;
+                _messages = x._messages;
+                _newMessages = x._newMessages;
+                _residuals = x._residuals;
+                _indices = x._indices;
+                _plans = x._plans;
+                _residualQueue = x._residualQueue;
+                _nrResidualUpdates = x._nrResidualUpdates;
                 _maxdiff = x._maxdiff;
                 _iters = x._iters;
                 _sentMessages = x._sentMessages;
                 _oldBeliefsV = x._oldBeliefsV;
                 _oldBeliefsF = x._oldBeliefsF;
+                _changes = x._changes;
                 _updateSeq = x._updateSeq;
+                _sparseFactors = x._sparseFactors;
+                _useSparse = x._useSparse;
+                _pairwiseFactors = x._pairwiseFactors;
+                _logFactors = x._logFactors;
+                _varParts.clear();
+                _factorParts.clear();
+                _splashes.clear();
+                _splashVars.clear();
+                _splashReads.clear();
+                _nrSplashes = 0;
+                _quietSweeps = x._quietSweeps;
+                _nrActiveEdges = x._nrActiveEdges;
+                _activeFactors = x._activeFactors;
+                _factorQueued = x._factorQueued;
+                _nrDormantEdges = x._nrDormantEdges;
+                _accelerator = x._accelerator;
+                _previousMessages = x._previousMessages;
+                _multiQueue.reset();
                 props = x.props;
                 recordSentMessages = x.recordSentMessages;
             }
@@ -215,25 +476,80 @@ class BP : public DAIAlgFG {
 
         /// Clears history of which messages have been updated
         void clearSentMessages() { _sentMessages.clear(); }
+
+        /// Returns the number of dormant edges, of which the messages are not recalculated (see \a freezetol)
+        size_t nrDormantEdges() const { return freezing() ? _nrDormantEdges : 0; }
+
+        /// Returns the number of bytes used by the cached indices of the edges
+        /** With \a edgeindex == FULL, this would be the total number of entries times <tt>sizeof(size_t)</tt>.
+         */
+        size_t indexBytes() const;
+
+        /// Returns the current messages, keyed by the labels of their variables and factors
+        BPMessages exportMessages() const;
+
+        /// Sets the messages of all edges for which \a msgs contains a message with the right number of values
+        /** The other messages are not changed. If convergence is tested on the beliefs, the beliefs
+         *  are recalculated from the imported messages.
+         *  \pre Should be called after init(), which resets all messages to uniform ones
+         *  \return The number of messages that have been set
+         */
+        size_t importMessages( const BPMessages &msgs );
+    //@}
+
+    /// \name Backup/restore mechanism for factors
+    //@{
+        /// Set the content of the \a I 'th factor and make a backup of its old content if \a backup == \c true
+        /** Also updates the sparse and logarithmic copies of the factor.
+         */
+        virtual void setFactor( size_t I, const Factor &newFactor, bool backup = false ) {
+            DAIAlgFG::setFactor( I, newFactor, backup );
+            if( I < _useSparse.size() )
+                updateFactorCopies( I );
+        }
     //@}
 
     protected:
-        /// Returns constant reference to message from the \a _I 'th neighbor of variable \a i to variable \a i
-        const Prob & message(size_t i, size_t _I) const { return _edges[i][_I].message; }
-        /// Returns reference to message from the \a _I 'th neighbor of variable \a i to variable \a i
-        Prob & message(size_t i, size_t _I) { return _edges[i][_I].message; }
-        /// Returns constant reference to updated message from the \a _I 'th neighbor of variable \a i to variable \a i
-        const Prob & newMessage(size_t i, size_t _I) const { return _edges[i][_I].newMessage; }
-        /// Returns reference to updated message from the \a _I 'th neighbor of variable \a i to variable \a i
-        Prob & newMessage(size_t i, size_t _I) { return _edges[i][_I].newMessage; }
+        /// Returns the number of the edge between variable \a i and its \a _I 'th neighbor
+        size_t edge(size_t i, size_t _I) const { return _varEdges[_varEdgeOffsets[i] + _I]; }
+        /// Returns pointer to the values of the message of edge \a e
+        const Real * messageValues(size_t e) const { return &(_messages[_messageOffsets[e]]); }
+        /// Returns pointer to the values of the message of edge \a e
+        Real * messageValues(size_t e) { return &(_messages[_messageOffsets[e]]); }
+        /// Returns pointer to the values of the updated message of edge \a e
+        const Real * newMessageValues(size_t e) const { return &(_newMessages[_messageOffsets[e]]); }
+        /// Returns pointer to the values of the updated message of edge \a e
+        Real * newMessageValues(size_t e) { return &(_newMessages[_messageOffsets[e]]); }
+        /// Returns (a copy of) the message from the \a _I 'th neighbor of variable \a i to variable \a i
+        const Prob message(size_t i, size_t _I) const {
+            size_t e = edge(i,_I);
+            return Prob( messageValues(e), messageValues(e) + var(i).states(), var(i).states() );
+        }
+        /// Sets the message from the \a _I 'th neighbor of variable \a i to variable \a i to \a p
+        void setMessage(size_t i, size_t _I, const Prob &p) {
+            DAI_DEBASSERT( p.size() == var(i).states() );
+            std::copy( p.begin(), p.end(), messageValues( edge(i,_I) ) );
+        }
+        /// Returns (a copy of) the updated message from the \a _I 'th neighbor of variable \a i to variable \a i
+        const Prob newMessage(size_t i, size_t _I) const {
+            size_t e = edge(i,_I);
+            return Prob( newMessageValues(e), newMessageValues(e) + var(i).states(), var(i).states() );
+        }
+        /// Sets the updated message from the \a _I 'th neighbor of variable \a i to variable \a i to \a p
+        void setNewMessage(size_t i, size_t _I, const Prob &p) {
+            DAI_DEBASSERT( p.size() == var(i).states() );
+            std::copy( p.begin(), p.end(), newMessageValues( edge(i,_I) ) );
+        }
         /// Returns constant reference to cached index for the edge between variable \a i and its \a _I 'th neighbor
-        const ind_t & index(size_t i, size_t _I) const { return _edges[i][_I].index; }
+        const ind_t & index(size_t i, size_t _I) const { return _indices[edge(i,_I)]; }
         /// Returns reference to cached index for the edge between variable \a i and its \a _I 'th neighbor
-        ind_t & index(size_t i, size_t _I) { return _edges[i][_I].index; }
+        ind_t & index(size_t i, size_t _I) { return _indices[edge(i,_I)]; }
         /// Returns constant reference to residual for the edge between variable \a i and its \a _I 'th neighbor
-        const Real & residual(size_t i, size_t _I) const { return _edges[i][_I].residual; }
+        const Real & residual(size_t i, size_t _I) const { return _residuals[edge(i,_I)]; }
         /// Returns reference to residual for the edge between variable \a i and its \a _I 'th neighbor
-        Real & residual(size_t i, size_t _I) { return _edges[i][_I].residual; }
+        Real & residual(size_t i, size_t _I) { return _residuals[edge(i,_I)]; }
+        /// Returns the maximum absolute difference between the updated and the old message of edge \a e
+        Real messageResidual(size_t e) const;
 
         /// Calculate the product of factor \a I and the incoming messages
         /** If \a without_i == \c true, the message coming from variable \a i is omitted from the product
@@ -242,6 +558,12 @@ class BP : public DAIAlgFG {
         virtual Prob calcIncomingMessageProduct( size_t I, bool without_i, size_t i ) const;
         /// Calculate the updated message from the \a _I 'th neighbor of variable \a i to variable \a i
         virtual void calcNewMessage( size_t i, size_t _I );
+        /// Calculate the updated messages from factor \a I to all its neighbors
+        /** If \a without_i == \c true, the message to variable \a i is not calculated.
+         *  \note Subclasses that change calcNewMessage() or calcIncomingMessageProduct() should override this
+         *  function (e.g., by calculating the messages one by one with calcNewMessage()).
+         */
+        virtual void calcNewMessages( size_t I, bool without_i, size_t i );
         /// Replace the "old" message from the \a _I 'th neighbor of variable \a i to variable \a i by the "new" (updated) message
         void updateMessage( size_t i, size_t _I );
         /// Set the residual (difference between new and old message) for the edge between variable \a i and its \a _I 'th neighbor to \a r
@@ -255,6 +577,70 @@ class BP : public DAIAlgFG {
             p = calcIncomingMessageProduct( I, false, 0 );
         }
 
+        /// Updates the sparse copy of factor \a I (depending on its density), its parametric copy (if \a props.parametric == \c true) and its logarithm (if \a props.logdomain == \c true)
+        void updateFactorCopies( size_t I );
+        /// Calculates the updated message from the \a _I 'th neighbor of variable \a i to variable \a i, using the sparse copy of the factor
+        Prob calcNewMessageSparse( size_t i, size_t _I ) const;
+        /// Returns \c true if the messages of factor \a I are calculated from its parametric copy
+        bool usePairwise( size_t I ) const { return _pairwiseFactors[I].fast( props.inference == Properties::InfType::SUMPROD ); }
+        /// Calculates the updated message from the \a _I 'th neighbor of variable \a i to variable \a i, using the parametric copy of the factor
+        Prob calcNewMessagePairwise( size_t i, size_t _I ) const;
+
+        /// Job that executes a phase of an iteration of run() for the variables and factors of a thread
+        struct ParallelJob;
+        /// Creates the threads and partitions the variables and factors over them (only if \a props.nthreads > 1)
+        void prepareThreads();
+        /// Calculates the beliefs, compares them with those of the previous iteration and returns the maximum difference
+        Real updateOldBeliefs();
+        /// Returns the maximum change of the messages in the current iteration and resets the changes (only if \a props.convergence == RESIDUALS)
+        /** For maximum-residual schedules, also takes the residuals of the messages that are pending into account.
+         */
+        Real updateMessageChanges();
+        /// Creates the relaxed priority queue and calculates all messages and residuals (first pass of relaxed maximum-residual BP)
+        void initMultiQueue();
+        /// Performs the share of thread \a t of the message updates of a pass of relaxed maximum-residual BP
+        void updateRelaxedMaxResidual( size_t t );
+        /// Sets the residual of variable \a i to the maximum residual of its incoming messages (only used for splash BP)
+        void updateVarResidual( size_t i );
+        /// Returns whether variable \a j can be added to splash \a s, i.e., whether no other splash of the batch starting at splash \a first reads or updates its messages
+        bool splashAvailable( size_t j, size_t first, size_t s ) const;
+        /// Grows at most \a nr splashes that do not interfere with each other, around the variables with the largest residuals
+        void growSplashes( size_t nr );
+        /// Updates the messages into the variables of \a splash, first towards its root and then away from it
+        void updateSplash( const std::vector<size_t> &splash );
+        /// Recalculates the messages sent by the factors neighboring the splashes, and the residuals of their variables
+        void updateSplashResiduals();
+        /// Returns \c true if the sweeps are accelerated (\a props.acceleration != NONE with SEQFIX or PARALL updates)
+        bool accelerating() const {
+            return props.acceleration != Accelerator::Method::NONE && (props.updates == Properties::UpdateType::SEQFIX || props.updates == Properties::UpdateType::PARALL);
+        }
+        /// Restarts the acceleration of the sweeps
+        void initAcceleration();
+        /// Replaces the messages after a sweep by the accelerated ones, and normalizes them
+        void accelerateSweep();
+        /// Returns \c true if edges of which the messages have converged are frozen (\a props.freezetol > 0 with SEQFIX or PARALL updates, without acceleration)
+        bool freezing() const {
+            return props.freezetol > 0.0 && !accelerating() && (props.updates == Properties::UpdateType::SEQFIX || props.updates == Properties::UpdateType::PARALL);
+        }
+        /// Makes all edges active if freezing(), and otherwise removes the bookkeeping of the dormant edges
+        void initFreezing();
+        /// Performs a sweep of SEQFIX or PARALL updates over the edges that are not dormant and returns the largest change of their messages (only if \a props.convergence == RESIDUALS)
+        Real updateActiveEdges();
+        /// Updates the message of the edge \a e, which is not dormant, and returns its change (only if \a props.convergence == RESIDUALS)
+        /** If the residual of the message is larger than \a props.freezetol, the edges that depend on it are woken,
+         *  otherwise the edge becomes dormant if this is the \a props.freezesweeps 'th such sweep in a row.
+         */
+        Real updateActiveEdge( size_t e );
+        /// Wakes the edge \a e of factor \a I, and resets its number of sweeps with small residuals
+        void wakeEdge( size_t e, size_t I );
+        /// Appends factor \a I to the factors visited by the next sweep, if it has edges that are not dormant and has not been appended yet
+        void queueFactor( size_t I ) {
+            if( _nrActiveEdges[I] > 0 && !_factorQueued[I] ) {
+                _factorQueued[I] = true;
+                _activeFactors.push_back( I );
+            }
+        }
+
         /// Helper function for constructors
         virtual void construct();
 };
@@ -20,6 +20,7 @@
 #include <dai/factorgraph.h>
 #include <dai/regiongraph.h>
 #include <dai/properties.h>
+#include <dai/pool.h>
 
 
 namespace dai {
@@ -183,6 +184,19 @@ class InfAlg {
         /// Returns parameters of this inference algorithm formatted as a string in the format "[key1=val1,key2=val2,...,keyn=valn]".
         virtual std::string printProperties() const = 0;
     //@}
+
+    /// \name Memory management
+    //@{
+        /// Returns the pool that recycles the memory of the temporary factors and messages created by run()
+        /** Implementations of run() make it the current pool by constructing a MemoryPool::Scope,
+         *  so that their iterations do not allocate heap memory once the pool has warmed up.
+         */
+        MemoryPool& memoryPool() const { return _pool; }
+    //@}
+
+    private:
+        /// Pool for the temporaries created by run() (copies of an InfAlg get their own, empty pool)
+        mutable MemoryPool _pool;
 };
 
 
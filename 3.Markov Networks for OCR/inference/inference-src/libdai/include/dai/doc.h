@@ -767,6 +767,12 @@
  */
 
 /** \page bibliography Bibliography
+ *  \anchor CuM69 \ref CuM69
+ *  E. Cuthill and J. McKee (1969):
+ *  "Reducing the Bandwidth of Sparse Symmetric Matrices",
+ *  <em>Proceedings of the 24th National Conference of the ACM</em>, pp. 157-172,
+ *  http://dx.doi.org/10.1145/800195.805928
+ *
  *  \anchor EaG09 \ref EaG09
  *  F. Eaton and Z. Ghahramani (2009):
  *  "Choosing a Variable to Clamp",
@@ -779,6 +785,18 @@
  *  <em>Proceedings of the 22nd Annual Conference on Uncertainty in Artificial Intelligence (UAI-06)</em>,
  *  http://uai.sis.pitt.edu/papers/06/UAI2006_0091.pdf
  *
+ *  \anchor FeH06 \ref FeH06
+ *  P. F. Felzenszwalb and D. P. Huttenlocher (2006):
+ *  "Efficient Belief Propagation for Early Vision",
+ *  <em>International Journal of Computer Vision</em> 70(1):41-54,
+ *  http://dx.doi.org/10.1007/s11263-006-7899-4
+ *
+ *  \anchor GLG09 \ref GLG09
+ *  J. Gonzalez and Y. Low and C. Guestrin (2009):
+ *  "Residual Splash for Optimally Parallelizing Belief Propagation",
+ *  <em>Proceedings of the Twelfth International Conference on Artificial Intelligence and Statistics (AISTATS 2009)</em> 5:177-184,
+ *  http://jmlr.csail.mit.edu/proceedings/papers/v5/gonzalez09a/gonzalez09a.pdf
+ *
  *  \anchor HAK03 \ref HAK03
  *  T. Heskes and C. A. Albers and H. J. Kappen (2003):
  *  "Approximate Inference and Constrained Optimization",
@@ -832,12 +850,23 @@
  *  <em>Journal of Statistical Mechanics: Theory and Experiment</em> 2005(10)-P10011,
  *  http://stacks.iop.org/1742-5468/2005/P10011
  *
+ *  \anchor RSD15 \ref RSD15
+ *  H. Rihani and P. Sanders and R. Dementiev (2015):
+ *  "MultiQueues: Simple Relaxed Concurrent Priority Queues",
+ *  <em>Proceedings of the 27th ACM Symposium on Parallelism in Algorithms and Architectures (SPAA '15)</em> pp. 80-82
+ *
  *  \anchor StW99 \ref StW99
  *  A. Steger and N. C. Wormald (1999):
  *  "Generating Random Regular Graphs Quickly",
  *  <em>Combinatorics, Probability and Computing</em> Vol 8, Issue 4, pp. 377-396,
  *  http://www.math.uwaterloo.ca/~nwormald/papers/randgen.pdf
  *
+ *  \anchor WaN11 \ref WaN11
+ *  H. F. Walker and P. Ni (2011):
+ *  "Anderson Acceleration for Fixed-Point Iterations",
+ *  <em>SIAM Journal on Numerical Analysis</em> 49(4):1715-1735,
+ *  http://dx.doi.org/10.1137/10078356X
+ *
  *  \anchor WiH03 \ref WiH03
  *  W. Wiegerinck and T. Heskes (2003):
  *  "Fractional Belief Propagation",
@@ -90,9 +90,11 @@ class Exception : public std::runtime_error {
                    INVALID_FACTORGRAPH_FILE,
                    INVALID_EVIDENCE_FILE,
                    INVALID_EMALG_FILE,
+                   INVALID_MESSAGES_FILE,
                    NOT_NORMALIZABLE,
                    MULTIPLE_UNDO,
                    FACTORGRAPH_NOT_CONNECTED,
+                   INCOMPATIBLE_FACTORGRAPHS,
                    INTERNAL_ERROR,
                    RUNTIME_ERROR,
                    OUT_OF_MEMORY,
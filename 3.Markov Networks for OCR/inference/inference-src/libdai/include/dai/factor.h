@@ -59,6 +59,146 @@ class TFactor {
         /// Stores the factor values
         TProb<T> _p;
 
+        /// Kernel for ContractionPlan::run() that stores the result of a binary operation on two tables
+        /** Sets <tt>r[i+j] = op( a[ia+j*sa], b[ib+j*sb] )</tt> for <tt>j < n</tt>.
+         */
+        template<typename binOp> struct BinaryOpKernel {
+            /// Result table
+            T *r;
+            /// Table of left operand
+            const T *a;
+            /// Table of right operand
+            const T *b;
+            /// Binary operation
+            binOp op;
+
+            /// Processes one run of the innermost loop
+            void operator()( size_t i, size_t ia, size_t ib, size_t n, size_t sa, size_t sb ) {
+                T *ri = r + i;
+                const T *ai = a + ia;
+                const T *bi = b + ib;
+                if( sa == 1 && sb == 1 ) {
+                    for( size_t j = 0; j < n; j++ )
+                        ri[j] = op( ai[j], bi[j] );
+                } else if( sa == 1 && sb == 0 ) {
+                    const T y = *bi;
+                    for( size_t j = 0; j < n; j++ )
+                        ri[j] = op( ai[j], y );
+                } else if( sa == 0 && sb == 1 ) {
+                    const T x = *ai;
+                    for( size_t j = 0; j < n; j++ )
+                        ri[j] = op( x, bi[j] );
+                } else {
+                    for( size_t j = 0; j < n; j++ )
+                        ri[j] = op( ai[j * sa], bi[j * sb] );
+                }
+            }
+        };
+
+        /// Kernel for ContractionPlan::run() that accumulates a table into a smaller table
+        /** Sets <tt>r[ib+j*sb] = acc( a[ia+j*sa], r[ib+j*sb] )</tt> for <tt>j < n</tt>, in increasing order of \a j.
+         */
+        template<typename accOp> struct AccumulateKernel {
+            /// Result table
+            T *r;
+            /// Table that is accumulated
+            const T *a;
+            /// Accumulation operation
+            accOp acc;
+
+            /// Processes one run of the innermost loop
+            void operator()( size_t, size_t ia, size_t ib, size_t n, size_t sa, size_t sb ) {
+                const T *ai = a + ia;
+                T *ri = r + ib;
+                if( sa == 1 && sb == 0 ) {
+                    T x = *ri;
+                    for( size_t j = 0; j < n; j++ )
+                        x = acc( ai[j], x );
+                    *ri = x;
+                } else if( sa == 1 && sb == 1 ) {
+                    for( size_t j = 0; j < n; j++ )
+                        ri[j] = acc( ai[j], ri[j] );
+                } else {
+                    for( size_t j = 0; j < n; j++ )
+                        ri[j * sb] = acc( ai[j * sa], ri[j * sb] );
+                }
+            }
+        };
+
+        /// Kernel for MultiContractionPlan::run() that accumulates the product of several tables into a smaller table
+        /** Index set 0 corresponds with the result table, index set <tt>k+1</tt> with <tt>tables[k]</tt>.
+         *  For each run, the product of the tables is stored in \a buf, which is then accumulated into \a r
+         *  in increasing order of the linear index.
+         */
+        template<typename accOp> struct ProductAccumulateKernel {
+            /// Result table
+            T *r;
+            /// Tables that are multiplied
+            std::vector<const T*, PoolAllocator<const T*> > tables;
+            /// Buffer that holds the product for a single run of the innermost loop
+            T *buf;
+            /// Accumulation operation
+            accOp acc;
+
+            /// Processes one run of the innermost loop
+            void operator()( size_t, const size_t *idx, size_t n, const size_t *strides ) {
+                for( size_t k = 0; k < tables.size(); k++ ) {
+                    const T *t = tables[k] + idx[k+1];
+                    size_t s = strides[k+1];
+                    if( k == 0 ) {
+                        for( size_t j = 0; j < n; j++ )
+                            buf[j] = t[j * s];
+                    } else if( s == 1 ) {
+                        for( size_t j = 0; j < n; j++ )
+                            buf[j] *= t[j];
+                    } else if( s == 0 ) {
+                        const T y = *t;
+                        for( size_t j = 0; j < n; j++ )
+                            buf[j] *= y;
+                    } else {
+                        for( size_t j = 0; j < n; j++ )
+                            buf[j] *= t[j * s];
+                    }
+                }
+                T *ri = r + idx[0];
+                if( strides[0] == 0 ) {
+                    T x = *ri;
+                    for( size_t j = 0; j < n; j++ )
+                        x = acc( buf[j], x );
+                    *ri = x;
+                } else {
+                    for( size_t j = 0; j < n; j++ )
+                        ri[j * strides[0]] = acc( buf[j], ri[j * strides[0]] );
+                }
+            }
+        };
+
+        /// Accumulates the product of \c *this and \a others onto \a vars using \a acc, without storing the product
+        template<typename accOp> TFactor<T> productAccumulate( const std::vector<const TFactor<T>*> &others, const VarSet &vars, accOp acc ) const;
+
+        /// Kernel for ContractionPlan::run() that copies part of a table
+        /** Sets <tt>r[i+j] = b[ib+j*sb]</tt> for <tt>j < n</tt>.
+         */
+        struct CopyKernel {
+            /// Result table
+            T *r;
+            /// Source table
+            const T *b;
+
+            /// Processes one run of the innermost loop
+            void operator()( size_t i, size_t, size_t ib, size_t n, size_t, size_t sb ) {
+                T *ri = r + i;
+                const T *bi = b + ib;
+                if( sb == 1 ) {
+                    for( size_t j = 0; j < n; j++ )
+                        ri[j] = bi[j];
+                } else {
+                    for( size_t j = 0; j < n; j++ )
+                        ri[j] = bi[j * sb];
+                }
+            }
+        };
+
     public:
     /// \name Constructors and destructors
     //@{
@@ -105,7 +245,7 @@ class TFactor {
 
         /// Constructs factor depending on variables in \a vars, permuting the values given in \a p accordingly
         TFactor( const std::vector<Var> &vars, const std::vector<T> &p ) : _vs(vars.begin(), vars.end(), vars.size()), _p(p.size()) {
-            BigInt nrStates = 1;
+            FastBigInt nrStates = 1;
             for( size_t i = 0; i < vars.size(); i++ )
                 nrStates *= vars[i].states();
             DAI_ASSERT( nrStates == p.size() );
@@ -342,18 +482,17 @@ class TFactor {
         template<typename binOp> TFactor<T>& binaryOp( const TFactor<T> &g, binOp op ) {
             if( _vs == g._vs ) // optimize special case
                 _p.pwBinaryOp( g._p, op );
-            else {
+            else if( _vs >> g._vs ) { // no need to copy *this if the variables do not change
+                boost::shared_ptr<const ContractionPlan> plan = ContractionPlan::get( _vs, _vs, g._vs );
+                BinaryOpKernel<binOp> kernel = { &(_p.p()[0]), &(_p.p()[0]), &(g._p.p()[0]), op };
+                plan->run( kernel );
+            } else {
                 TFactor<T> f(*this); // make a copy
                 _vs |= g._vs;
-                size_t N = BigInt_size_t( _vs.nrStates() );
-
-                IndexFor i_f( f._vs, _vs );
-                IndexFor i_g( g._vs, _vs );
-
-                _p.p().clear();
-                _p.p().reserve( N );
-                for( size_t i = 0; i < N; i++, ++i_f, ++i_g )
-                    _p.p().push_back( op( f._p[i_f], g._p[i_g] ) );
+                boost::shared_ptr<const ContractionPlan> plan = ContractionPlan::get( _vs, f._vs, g._vs );
+                _p.p().resize( plan->size() );
+                BinaryOpKernel<binOp> kernel = { &(_p.p()[0]), &(f._p.p()[0]), &(g._p.p()[0]), op };
+                plan->run( kernel );
             }
             return *this;
         }
@@ -403,15 +542,10 @@ class TFactor {
                 result._p = _p.pwBinaryTr( g._p, op );
             } else {
                 result._vs = _vs | g._vs;
-                size_t N = BigInt_size_t( result._vs.nrStates() );
-
-                IndexFor i_f( _vs, result.vars() );
-                IndexFor i_g( g._vs, result.vars() );
-
-                result._p.p().clear();
-                result._p.p().reserve( N );
-                for( size_t i = 0; i < N; i++, ++i_f, ++i_g )
-                    result._p.p().push_back( op( _p[i_f], g[i_g] ) );
+                boost::shared_ptr<const ContractionPlan> plan = ContractionPlan::get( result._vs, _vs, g._vs );
+                result._p.p().resize( plan->size() );
+                BinaryOpKernel<binOp> kernel = { &(result._p.p()[0]), &(_p.p()[0]), &(g._p.p()[0]), op };
+                plan->run( kernel );
             }
             return result;
         }
@@ -488,6 +622,40 @@ class TFactor {
 
         /// Returns max-marginal on \a vars, obtained by maximizing all variables except those in \a vars, and normalizing the result if \a normed == \c true
         TFactor<T> maxMarginal(const VarSet &vars, bool normed=true) const;
+
+        /// Returns marginal on \a vars of the product of \c *this and the factors in \a others, normalizing the result if \a normed == \c true
+        /** This yields the same result as multiplying \c *this with all factors in \a others (in that order) and
+         *  calling marginal() on the product, but the product is computed on the fly, in small blocks,
+         *  instead of being stored in a (potentially large) temporary factor.
+         */
+        TFactor<T> productMarginal( const std::vector<const TFactor<T>*> &others, const VarSet &vars, bool normed=true ) const {
+            TFactor<T> res = productAccumulate( others, vars, std::plus<T>() );
+            if( normed )
+                res.normalize( NORMPROB );
+            return res;
+        }
+
+        /// Returns marginal on \a vars of the product of \c *this and \a g, normalizing the result if \a normed == \c true
+        TFactor<T> productMarginal( const TFactor<T> &g, const VarSet &vars, bool normed=true ) const {
+            return productMarginal( std::vector<const TFactor<T>*>( 1, &g ), vars, normed );
+        }
+
+        /// Returns max-marginal on \a vars of the product of \c *this and the factors in \a others, normalizing the result if \a normed == \c true
+        /** This yields the same result as multiplying \c *this with all factors in \a others (in that order) and
+         *  calling maxMarginal() on the product, but the product is computed on the fly, in small blocks,
+         *  instead of being stored in a (potentially large) temporary factor.
+         */
+        TFactor<T> productMaxMarginal( const std::vector<const TFactor<T>*> &others, const VarSet &vars, bool normed=true ) const {
+            TFactor<T> res = productAccumulate( others, vars, fo_max<T>() );
+            if( normed )
+                res.normalize( NORMPROB );
+            return res;
+        }
+
+        /// Returns max-marginal on \a vars of the product of \c *this and \a g, normalizing the result if \a normed == \c true
+        TFactor<T> productMaxMarginal( const TFactor<T> &g, const VarSet &vars, bool normed=true ) const {
+            return productMaxMarginal( std::vector<const TFactor<T>*>( 1, &g ), vars, normed );
+        }
     //@}
 };
 
@@ -497,12 +665,22 @@ template<typename T> TFactor<T> TFactor<T>::slice( const VarSet& vars, size_t va
     VarSet varsrem = _vs / vars;
     TFactor<T> result( varsrem, T(0) );
 
-    // OPTIMIZE ME
-    IndexFor i_vars (vars, _vs);
-    IndexFor i_varsrem (varsrem, _vs);
-    for( size_t i = 0; i < nrStates(); i++, ++i_vars, ++i_varsrem )
-        if( (size_t)i_vars == varsState )
-            result.set( i_varsrem, _p[i] );
+    // calculate the linear index in *this of the state of vars
+    size_t offset = 0;
+    size_t stride = 1;
+    VarSet::const_iterator v = vars.begin();
+    for( VarSet::const_iterator w = _vs.begin(); w != _vs.end(); ++w ) {
+        if( v != vars.end() && *v == *w ) {
+            offset += (varsState % w->states()) * stride;
+            varsState /= w->states();
+            ++v;
+        }
+        stride *= w->states();
+    }
+
+    boost::shared_ptr<const ContractionPlan> plan = ContractionPlan::get( varsrem, varsrem, _vs );
+    CopyKernel kernel = { &(result._p.p()[0]), &(_p.p()[0]) };
+    plan->run( kernel, 0, offset );
 
     return result;
 }
@@ -513,9 +691,9 @@ template<typename T> TFactor<T> TFactor<T>::marginal(const VarSet &vars, bool no
 
     TFactor<T> res( res_vars, 0.0 );
 
-    IndexFor i_res( res_vars, _vs );
-    for( size_t i = 0; i < _p.size(); i++, ++i_res )
-        res.set( i_res, res[i_res] + _p[i] );
+    boost::shared_ptr<const ContractionPlan> plan = ContractionPlan::get( _vs, _vs, res_vars );
+    AccumulateKernel<std::plus<T> > kernel = { &(res._p.p()[0]), &(_p.p()[0]), std::plus<T>() };
+    plan->run( kernel );
 
     if( normed )
         res.normalize( NORMPROB );
@@ -529,10 +707,9 @@ template<typename T> TFactor<T> TFactor<T>::maxMarginal(const VarSet &vars, bool
 
     TFactor<T> res( res_vars, 0.0 );
 
-    IndexFor i_res( res_vars, _vs );
-    for( size_t i = 0; i < _p.size(); i++, ++i_res )
-        if( _p[i] > res._p[i_res] )
-            res.set( i_res, _p[i] );
+    boost::shared_ptr<const ContractionPlan> plan = ContractionPlan::get( _vs, _vs, res_vars );
+    AccumulateKernel<fo_max<T> > kernel = { &(res._p.p()[0]), &(_p.p()[0]), fo_max<T>() };
+    plan->run( kernel );
 
     if( normed )
         res.normalize( NORMPROB );
@@ -541,6 +718,34 @@ template<typename T> TFactor<T> TFactor<T>::maxMarginal(const VarSet &vars, bool
 }
 
 
+template<typename T> template<typename accOp> TFactor<T> TFactor<T>::productAccumulate( const std::vector<const TFactor<T>*> &others, const VarSet &vars, accOp acc ) const {
+    VarSet prod_vars = _vs;
+    for( size_t k = 0; k < others.size(); k++ )
+        prod_vars |= others[k]->_vs;
+    VarSet res_vars = vars & prod_vars;
+
+    TFactor<T> res( res_vars, 0.0 );
+
+    MultiContractionPlan::IndexSets indexVars;
+    indexVars.reserve( others.size() + 2 );
+    indexVars.push_back( res_vars );
+    indexVars.push_back( _vs );
+    for( size_t k = 0; k < others.size(); k++ )
+        indexVars.push_back( others[k]->_vs );
+    MultiContractionPlan plan( prod_vars, indexVars );
+
+    std::vector<T, PoolAllocator<T> > buf( plan.maxRun() );
+    ProductAccumulateKernel<accOp> kernel = { &(res._p.p()[0]), std::vector<const T*, PoolAllocator<const T*> >(), &(buf[0]), acc };
+    kernel.tables.reserve( others.size() + 1 );
+    kernel.tables.push_back( &(_p.p()[0]) );
+    for( size_t k = 0; k < others.size(); k++ )
+        kernel.tables.push_back( &(others[k]->_p.p()[0]) );
+    plan.run( kernel );
+
+    return res;
+}
+
+
 template<typename T> T TFactor<T>::strength( const Var &i, const Var &j ) const {
     DAI_DEBASSERT( _vs.contains( i ) );
     DAI_DEBASSERT( _vs.contains( j ) );
@@ -665,6 +870,24 @@ Factor createFactorExpGauss( const VarSet &vs, Real beta );
 Factor createFactorPotts( const Var &x1, const Var &x2, Real J );
 
 
+/// Returns a pairwise truncated linear factor \f$ \exp( -\min( \lambda |x_1 - x_2|, \tau ) ) \f$
+/** \param x1 First variable
+ *  \param x2 Second variable (should have the same number of states as \a x1)
+ *  \param lambda Slope
+ *  \param tau Truncation
+ */
+Factor createFactorTruncatedLinear( const Var &x1, const Var &x2, Real lambda, Real tau );
+
+
+/// Returns a pairwise truncated quadratic factor \f$ \exp( -\min( \lambda (x_1 - x_2)^2, \tau ) ) \f$
+/** \param x1 First variable
+ *  \param x2 Second variable (should have the same number of states as \a x1)
+ *  \param lambda Slope
+ *  \param tau Truncation
+ */
+Factor createFactorTruncatedQuadratic( const Var &x1, const Var &x2, Real lambda, Real tau );
+
+
 /// Returns a Kronecker delta point mass
 /** \param v Variable
  *  \param state The state of \a v that should get value 1
@@ -287,6 +287,17 @@ class FactorGraph {
          *  and keeps the current one constant, contrary to clamp()
          */
         FactorGraph clamped( size_t i, size_t x ) const;
+
+        /// Returns a copy of \c *this, where the variables and factors have been renumbered
+        /** The \a k 'th variable of the result is var( \a varOrder [\a k] ) and the \a k 'th factor is
+         *  factor( \a facOrder [\a k] ). The variables keep their labels, so results of inference on the
+         *  renumbered graph can be reported in terms of the original variables, e.g., by findVar() or
+         *  \a varOrder. Numbering neighboring variables and factors close together, as done by
+         *  BipartiteGraph::orderRCM() and BipartiteGraph::orderBisection() applied to bipGraph(), improves
+         *  the memory locality of message passing algorithms on large graphs.
+         *  \note Backups of factors are not copied.
+         */
+        FactorGraph reordered( const std::vector<size_t>& varOrder, const std::vector<size_t>& facOrder ) const;
     //@}
 
     /// \name Operations
@@ -79,6 +79,15 @@ class FBP : public BP {
         virtual FBP* construct( const FactorGraph &fg, const PropertySet &opts ) const { return new FBP( fg, opts ); }
         virtual std::string name() const { return "FBP"; }
         virtual Real logZ() const;
+        /// Sets parameters of this algorithm
+        /** \a parametric is ignored, because the parametric message updates of BP do not take the weights into
+         *  account, and so is \a freezetol, because the messages of a factor also depend on the messages it sends itself.
+         */
+        virtual void setProperties( const PropertySet &opts ) {
+            BP::setProperties( opts );
+            props.parametric = false;
+            props.freezetol = 0.0;
+        }
     //@}
 
     /// \name FBP accessors/mutators for weights
@@ -107,6 +116,13 @@ class FBP : public BP {
         // Calculate the updated message from the \a _I 'th neighbor of variable \a i to variable \a i
         virtual void calcNewMessage( size_t i, size_t _I );
 
+        /// Calculate the updated messages from factor \a I to all its neighbors (except variable \a i if \a without_i == \c true) one by one
+        virtual void calcNewMessages( size_t I, bool without_i, size_t i ) {
+            bforeach( const Neighbor &j, nbF(I) )
+                if( !(without_i && (j == i)) )
+                    calcNewMessage( j, j.dual );
+        }
+
         // Calculates unnormalized belief of factor \a I
         virtual void calcBeliefF( size_t I, Prob &p ) const {
             p = calcIncomingMessageProduct( I, false, 0 );
@@ -21,6 +21,7 @@
 #include <string>
 #include <dai/daialg.h>
 #include <dai/regiongraph.h>
+#include <dai/logfactor.h>
 #include <dai/enum.h>
 #include <dai/properties.h>
 
@@ -85,6 +86,9 @@ class HAK : public DAIAlgRG {
 
             /// Depth of loops (only relevant for \a clusters == \c ClustersType::LOOP)
             size_t loopdepth;
+
+            /// Whether updates should be done in the logarithmic domain or not
+            bool logdomain;
         } props;
 
     public:
@@ -144,6 +148,17 @@ class HAK : public DAIAlgRG {
     private:
         /// Helper function for constructors
         void construct();
+        /// Performs the single-loop updates of the \a beta 'th inner region and its neighboring outer regions
+        /** \tparam F Factor or LogFactor
+         *  \param Qa outer region beliefs
+         *  \param Qb inner region beliefs
+         *  \param mab messages from outer to inner regions
+         *  \param mba messages from inner to outer regions
+         *  \param ors outer region factors
+         *  \return \c false if NaNs were encountered
+         */
+        template<class F, class ORVec>
+        bool updateInnerRegion( size_t beta, std::vector<F> &Qa, std::vector<F> &Qb, std::vector<std::vector<F> > &mab, std::vector<std::vector<F> > &mba, const ORVec &ors );
         /// Recursive procedure for finding clusters of variables containing loops of length at most \a length
         /** \param fg the factor graph
          *  \param allcl the clusters found so far
@@ -7,7 +7,7 @@
 
 
 /// \file
-/// \brief Defines the IndexFor, multifor, Permute and State classes, which all deal with indexing multi-dimensional arrays
+/// \brief Defines the IndexFor, ContractionPlan, MultiContractionPlan, IndexMap, IndexTable, multifor, Permute, State and FlatState classes, which all deal with indexing multi-dimensional arrays
 
 
 #ifndef __defined_libdai_index_h
@@ -17,7 +17,11 @@
 #include <vector>
 #include <algorithm>
 #include <map>
+#include <boost/shared_ptr.hpp>
+#include <boost/cstdint.hpp>
 #include <dai/varset.h>
+#include <dai/pool.h>
+#include <dai/enum.h>
 
 
 namespace dai {
@@ -40,10 +44,9 @@ namespace dai {
  *  and <tt>(size_t)i</tt> equals the linear index of the corresponding
  *  state of \a indexVars, where the variables in \a indexVars that are
  *  not in \a forVars assume their zero'th value.
- *  \idea Optimize all indices as follows: keep a cache of all (or only
- *  relatively small) indices that have been computed (use a hash). Then,
- *  instead of computing on the fly, use the precomputed ones. Here the
- *  labels of the variables don't matter, but the ranges of the variables do.
+ *
+ *  \see ContractionPlan, which describes the same loop by a few nested loops with constant strides
+ *  and caches these descriptions, for use in performance critical code.
  */
 class IndexFor {
     private:
@@ -130,6 +133,319 @@ class IndexFor {
 };
 
 
+/// Describes a loop over all joint states of a VarSet as a few nested loops with constant strides.
+/** A ContractionPlan is constructed from three VarSets: \a forVars, and two index sets \a indexVarsA and \a indexVarsB.
+ *  It describes the loop over all joint states of \a forVars, and, for each of these states, the linear
+ *  indices of the corresponding states of \a indexVarsA and \a indexVarsB (where variables that are not
+ *  in \a forVars assume their zero'th value), similar to an IndexFor object.
+ *
+ *  Instead of incrementing a state counter for each of the variables, consecutive variables
+ *  that have compatible strides in both index sets are merged into a single dimension, and
+ *  dimensions of a single state are dropped. The resulting dimensions are iterated over by
+ *  run(), which calls a kernel for each run of the innermost dimension. Because the innermost
+ *  dimension corresponds with the smallest label in \a forVars, its stride in an index set
+ *  is usually 0 (broadcast) or 1 (contiguous), so that the kernels can use tight loops.
+ *
+ *  Constructing a plan has a cost comparable to constructing an IndexFor object; therefore, plans are
+ *  cached by get() in a least-recently-used cache keyed by the VarSets (labels and numbers of states).
+ *  This is used by TFactor<> for products, marginals and slices.
+ *  \see MultiContractionPlan
+ */
+class ContractionPlan {
+    public:
+        /// Describes one dimension of the nested loops
+        struct Dim {
+            /// Number of iterations
+            size_t range;
+            /// Stride in index set A
+            size_t strideA;
+            /// Stride in index set B
+            size_t strideB;
+        };
+
+    private:
+        /// The dimensions, innermost first
+        std::vector<Dim> _dims;
+        /// Total number of joint states of forVars
+        size_t _size;
+
+    public:
+        /// Default constructor
+        ContractionPlan() : _dims(), _size(1) {}
+
+        /// Construct plan for looping over the joint states of \a forVars, indexing into \a indexVarsA and \a indexVarsB
+        ContractionPlan( const VarSet &forVars, const VarSet &indexVarsA, const VarSet &indexVarsB );
+
+        /// Returns the number of joint states of forVars
+        size_t size() const { return _size; }
+
+        /// Returns the dimensions of the nested loops (innermost first)
+        const std::vector<Dim>& dims() const { return _dims; }
+
+        /// Executes the nested loops
+        /** For each run of the innermost dimension, <tt>kernel( i, a, b, n, sa, sb )</tt> is called,
+         *  which should process the \a n consecutive joint states of forVars with linear indices \a i, ..., \a i + \a n - 1;
+         *  the corresponding linear indices into index set A are \a a, \a a + \a sa, ..., \a a + (\a n - 1) \a sa
+         *  and similarly for index set B.
+         *
+         *  Plans with at most three dimensions (which includes all plans for factors that depend on at most
+         *  three variables) are executed by fixed-depth nested loops, which the compiler can unroll and
+         *  inline the kernel into; other plans are executed by runNested().
+         *  \param kernel Function object that is called for each run
+         *  \param offsetA Offset that is added to all linear indices into index set A
+         *  \param offsetB Offset that is added to all linear indices into index set B
+         */
+        template<typename Kernel> void run( Kernel &kernel, size_t offsetA = 0, size_t offsetB = 0 ) const {
+            switch( _dims.size() ) {
+                case 0:
+                    kernel( 0, offsetA, offsetB, 1, 0, 0 );
+                    break;
+                case 1:
+                    kernel( 0, offsetA, offsetB, _dims[0].range, _dims[0].strideA, _dims[0].strideB );
+                    break;
+                case 2:
+                    run2( kernel, offsetA, offsetB );
+                    break;
+                case 3:
+                    run3( kernel, offsetA, offsetB );
+                    break;
+                default:
+                    runNested( kernel, offsetA, offsetB );
+            }
+        }
+
+        /// Executes the nested loops for any number of dimensions
+        /** Has the same effect as run(), but keeps track of the state of the loops in an array,
+         *  so that it handles any number of dimensions.
+         */
+        template<typename Kernel> void runNested( Kernel &kernel, size_t offsetA = 0, size_t offsetB = 0 ) const {
+            size_t nrDims = _dims.size();
+            if( nrDims == 0 ) {
+                kernel( 0, offsetA, offsetB, 1, 0, 0 );
+                return;
+            }
+            const Dim &inner = _dims[0];
+            // after dropping dimensions of range 1, there are at most 8 * sizeof(size_t) dimensions
+            size_t state[8 * sizeof(size_t)];
+            for( size_t d = 1; d < nrDims; d++ )
+                state[d] = 0;
+            size_t a = offsetA, b = offsetB;
+            for( size_t i = 0; i < _size; i += inner.range ) {
+                kernel( i, a, b, inner.range, inner.strideA, inner.strideB );
+                for( size_t d = 1; d < nrDims; d++ ) {
+                    const Dim &dim = _dims[d];
+                    a += dim.strideA;
+                    b += dim.strideB;
+                    if( ++state[d] < dim.range )
+                        break;
+                    a -= dim.strideA * dim.range;
+                    b -= dim.strideB * dim.range;
+                    state[d] = 0;
+                }
+            }
+        }
+
+    private:
+        /// Executes the nested loops of a plan with two dimensions
+        template<typename Kernel> void run2( Kernel &kernel, size_t offsetA, size_t offsetB ) const {
+            const Dim d0 = _dims[0], d1 = _dims[1];
+            size_t i = 0;
+            for( size_t x1 = 0; x1 < d1.range; x1++, i += d0.range )
+                kernel( i, offsetA + x1 * d1.strideA, offsetB + x1 * d1.strideB, d0.range, d0.strideA, d0.strideB );
+        }
+
+        /// Executes the nested loops of a plan with three dimensions
+        template<typename Kernel> void run3( Kernel &kernel, size_t offsetA, size_t offsetB ) const {
+            const Dim d0 = _dims[0], d1 = _dims[1], d2 = _dims[2];
+            size_t i = 0;
+            for( size_t x2 = 0; x2 < d2.range; x2++ ) {
+                size_t a = offsetA + x2 * d2.strideA, b = offsetB + x2 * d2.strideB;
+                for( size_t x1 = 0; x1 < d1.range; x1++, i += d0.range, a += d1.strideA, b += d1.strideB )
+                    kernel( i, a, b, d0.range, d0.strideA, d0.strideB );
+            }
+        }
+
+    public:
+        /// Returns a (cached) plan for looping over the joint states of \a forVars, indexing into \a indexVarsA and \a indexVarsB
+        static boost::shared_ptr<const ContractionPlan> get( const VarSet &forVars, const VarSet &indexVarsA, const VarSet &indexVarsB );
+
+        /// Sets the maximum number of plans that get() keeps in its cache (0 disables caching)
+        static void setCacheSize( size_t maxPlans );
+
+        /// Returns the maximum number of plans that get() keeps in its cache
+        static size_t cacheSize();
+
+        /// Returns the number of plans currently in the cache
+        static size_t nrCached();
+};
+
+
+/// Describes a loop over all joint states of a VarSet, indexing simultaneously into an arbitrary number of index sets
+/** A MultiContractionPlan generalizes ContractionPlan to more than two index sets. It is used by
+ *  productMarginal() and productMaxMarginal() for multiplying several factors and marginalizing
+ *  the product in a single pass. In contrast with ContractionPlan, plans are not cached; instead,
+ *  their memory is drawn from the current MemoryPool.
+ */
+class MultiContractionPlan {
+    public:
+        /// Type of the vectors of indices and index sets (which draw their memory from the current MemoryPool)
+        typedef std::vector<size_t, PoolAllocator<size_t> > Indices;
+        /// Type of the vector of index sets
+        typedef std::vector<VarSet, PoolAllocator<VarSet> > IndexSets;
+
+    private:
+        /// Number of iterations for each dimension, innermost first
+        Indices _ranges;
+        /// Strides for each dimension and each index set (the stride of index set \a k in dimension \a d is <tt>_strides[d * nrIndexSets() + k]</tt>)
+        Indices _strides;
+        /// Number of index sets
+        size_t _nrIndexSets;
+        /// Total number of joint states of forVars
+        size_t _size;
+
+    public:
+        /// Construct plan for looping over the joint states of \a forVars, indexing into each of the \a indexVars
+        MultiContractionPlan( const VarSet &forVars, const IndexSets &indexVars );
+
+        /// Returns the number of joint states of forVars
+        size_t size() const { return _size; }
+
+        /// Returns the number of index sets
+        size_t nrIndexSets() const { return _nrIndexSets; }
+
+        /// Returns the largest number of iterations of the innermost dimension
+        size_t maxRun() const { return _ranges.empty() ? 1 : _ranges[0]; }
+
+        /// Executes the nested loops
+        /** For each run of the innermost dimension, <tt>kernel( i, idx, n, strides )</tt> is called,
+         *  which should process the \a n consecutive joint states of forVars with linear indices \a i, ..., \a i + \a n - 1;
+         *  the corresponding linear indices into index set \a k are <tt>idx[k]</tt>, <tt>idx[k] + strides[k]</tt>, ...,
+         *  <tt>idx[k] + (n - 1) strides[k]</tt>.
+         */
+        template<typename Kernel> void run( Kernel &kernel ) const {
+            size_t nrDims = _ranges.size();
+            Indices idx( _nrIndexSets, 0 );
+            if( nrDims == 0 ) {
+                Indices zero( _nrIndexSets, 0 );
+                kernel( 0, &(idx[0]), 1, &(zero[0]) );
+                return;
+            }
+            Indices state( nrDims, 0 );
+            const size_t *inner = &(_strides[0]);
+            for( size_t i = 0; i < _size; i += _ranges[0] ) {
+                kernel( i, &(idx[0]), _ranges[0], inner );
+                for( size_t d = 1; d < nrDims; d++ ) {
+                    const size_t *strides = &(_strides[d * _nrIndexSets]);
+                    if( ++state[d] < _ranges[d] ) {
+                        for( size_t k = 0; k < _nrIndexSets; k++ )
+                            idx[k] += strides[k];
+                        break;
+                    }
+                    for( size_t k = 0; k < _nrIndexSets; k++ )
+                        idx[k] -= strides[k] * (_ranges[d] - 1);
+                    state[d] = 0;
+                }
+            }
+        }
+};
+
+
+/// Maps linear indices of joint states of one VarSet to linear indices of the corresponding joint states of another VarSet
+/** An IndexMap constructed from \a from and \a to converts the linear index of a joint state of the
+ *  variables in \a from into the linear index of the joint state of the variables in \a to, where
+ *  variables in \a from that are not in \a to are ignored and variables in \a to that are not in
+ *  \a from assume their zero'th value. In contrast with IndexFor, which loops over all joint states,
+ *  an IndexMap converts individual linear indices; it is used by TSparseFactor<> to look up the
+ *  entries corresponding to its nonzero values.
+ */
+class IndexMap {
+    private:
+        /// Number of states of the variables in \a from (the trailing variables that are not in \a to are omitted)
+        std::vector<size_t> _ranges;
+        /// Strides in \a to of the variables in \a from (0 for variables not in \a to)
+        std::vector<size_t> _strides;
+
+    public:
+        /// Default constructor
+        IndexMap() : _ranges(), _strides() {}
+
+        /// Construct map from linear indices of joint states of \a from to linear indices of joint states of \a to
+        IndexMap( const VarSet &from, const VarSet &to );
+
+        /// Returns the linear index in \a to corresponding with linear index \a i in \a from
+        size_t operator()( size_t i ) const {
+            size_t result = 0;
+            for( size_t d = 0; d < _ranges.size(); d++ ) {
+                result += (i % _ranges[d]) * _strides[d];
+                i /= _ranges[d];
+            }
+            return result;
+        }
+};
+
+
+/// Stores, for each linear index of a joint state of a VarSet, the state of one variable in that joint state
+/** An IndexTable constructed from \a v and \a vs contains the same values as an IndexFor( \a v, \a vs ) that
+ *  loops over all joint states of \a vs, but it can be indexed directly. There are three representations:
+ *  - FULL stores each entry as a \c size_t;
+ *  - COMPACT stores each entry in the narrowest unsigned integer type (of 8, 16 or 32 bits, or a \c size_t)
+ *    that can hold the states of \a v, e.g., a single byte for variables with at most 256 states;
+ *  - STRIDED stores nothing; each entry is calculated from the stride of \a v in \a vs, which costs a
+ *    division and a modulo operation per lookup.
+ */
+class IndexTable {
+    public:
+        /// Enumeration of the representations of an IndexTable
+        DAI_ENUM(Type,FULL,COMPACT,STRIDED);
+
+    private:
+        /// Number of entries
+        size_t _size;
+        /// Number of states of the variable (1 if it is not in the VarSet)
+        size_t _states;
+        /// Stride of the variable in the VarSet
+        size_t _stride;
+        /// Entries stored as 8-bit integers (if nonempty)
+        std::vector<boost::uint8_t> _entries8;
+        /// Entries stored as 16-bit integers (if nonempty)
+        std::vector<boost::uint16_t> _entries16;
+        /// Entries stored as 32-bit integers (if nonempty)
+        std::vector<boost::uint32_t> _entries32;
+        /// Entries stored as \c size_t (if nonempty)
+        std::vector<size_t> _entries;
+
+    public:
+        /// Default constructor
+        IndexTable() : _size(0), _states(1), _stride(1), _entries8(), _entries16(), _entries32(), _entries() {}
+
+        /// Construct table of the states of \a v in the joint states of \a vs, using representation \a type
+        IndexTable( const Var &v, const VarSet &vs, Type type = Type::COMPACT );
+
+        /// Returns the number of entries (the number of joint states of the VarSet)
+        size_t size() const { return _size; }
+
+        /// Returns the state of the variable in the joint state of the VarSet with linear index \a r
+        size_t operator[]( size_t r ) const {
+            DAI_DEBASSERT( r < _size );
+            if( !_entries8.empty() )
+                return _entries8[r];
+            else if( !_entries16.empty() )
+                return _entries16[r];
+            else if( !_entries32.empty() )
+                return _entries32[r];
+            else if( !_entries.empty() )
+                return _entries[r];
+            else
+                return (r / _stride) % _states;
+        }
+
+        /// Returns the number of bytes used for storing the entries
+        size_t bytes() const {
+            return _entries8.size() * sizeof(boost::uint8_t) + _entries16.size() * sizeof(boost::uint16_t) + _entries32.size() * sizeof(boost::uint32_t) + _entries.size() * sizeof(size_t);
+        }
+};
+
+
 /// Tool for calculating permutations of linear indices of multi-dimensional arrays.
 /** \note This is mainly useful for converting indices into multi-dimensional arrays 
  *  corresponding to joint states of variables to and from the canonical ordering used in libDAI.
@@ -344,6 +660,9 @@ class multifor {
  *
  *  \note A State is very similar to a dai::multifor, but tailored for Var 's and VarSet 's.
  *
+ *  \note The linear state is stored as a FastBigInt, so that it uses 64-bit arithmetic unless the number of
+ *  joint states does not fit in 64 bits. FlatState offers the same iteration interface without the map.
+ *
  *  \see dai::calcLinearState(), dai::calcState()
  *
  *  \idea Make the State class a more prominent part of libDAI (and document it clearly, explaining the concept of state); 
@@ -355,31 +674,42 @@ class State {
         typedef std::map<Var, size_t> states_type;
 
         /// Current state (represented linearly)
-        BigInt                        state;
+        FastBigInt                    state;
+
+        /// Whether the current state is valid
+        bool                          validState;
 
         /// Current state (represented as a map)
         states_type                   states;
 
+        /// Sets the state of the variables in \a vs to the joint state with linear state \a linearState
+        void init( const VarSet &vs, FastBigInt linearState ) {
+            state = linearState;
+            validState = true;
+            states.clear();
+            for( VarSet::const_iterator v = vs.begin(); v != vs.end(); v++ ) {
+                states[*v] = (size_t)(linearState % v->states());
+                linearState /= v->states();
+            }
+            DAI_ASSERT( linearState == 0 );
+        }
+
     public:
         /// Default constructor
-        State() : state(0), states() {}
+        State() : state(0), validState(true), states() {}
 
         /// Construct from VarSet \a vs and corresponding linear state \a linearState
-        State( const VarSet &vs, BigInt linearState=0 ) : state(linearState), states() {
-            if( linearState == 0 )
-                for( VarSet::const_iterator v = vs.begin(); v != vs.end(); v++ )
-                    states[*v] = 0;
-            else {
-                for( VarSet::const_iterator v = vs.begin(); v != vs.end(); v++ ) {
-                    states[*v] = BigInt_size_t( linearState % v->states() );
-                    linearState /= v->states();
-                }
-                DAI_ASSERT( linearState == 0 );
-            }
+        State( const VarSet &vs, size_t linearState=0 ) : state(0), validState(true), states() {
+            init( vs, linearState );
+        }
+
+        /// Construct from VarSet \a vs and corresponding linear state \a linearState
+        State( const VarSet &vs, const BigInt &linearState ) : state(0), validState(true), states() {
+            init( vs, FastBigInt( linearState ) );
         }
 
         /// Construct from a std::map<Var, size_t>
-        State( const std::map<Var, size_t> &s ) : state(0), states() {
+        State( const std::map<Var, size_t> &s ) : state(0), validState(true), states() {
             insert( s.begin(), s.end() );
         }
 
@@ -425,13 +755,16 @@ class State {
         }
 
         /// Return linear state of variables in \a vs, assuming that variables that are not in \c *this are in state 0
-        BigInt operator() ( const VarSet &vs ) const {
-            BigInt vs_state = 0;
-            BigInt prod = 1;
+        FastBigInt operator() ( const VarSet &vs ) const {
+            FastBigInt vs_state = 0;
+            FastBigInt prod = 1;
             for( VarSet::const_iterator v = vs.begin(); v != vs.end(); v++ ) {
                 states_type::const_iterator entry = states.find( *v );
-                if( entry != states.end() )
-                    vs_state += entry->second * prod;
+                if( entry != states.end() ) {
+                    FastBigInt term = prod;
+                    term *= entry->second;
+                    vs_state += term;
+                }
                 prod *= v->states();
             }
             return vs_state;
@@ -440,7 +773,7 @@ class State {
         /// Increments the current state (prefix)
         void operator++( ) {
             if( valid() ) {
-                state++;
+                ++state;
                 states_type::iterator entry = states.begin();
                 while( entry != states.end() ) {
                     if( ++(entry->second) < entry->first.states() )
@@ -449,7 +782,7 @@ class State {
                     entry++;
                 }
                 if( entry == states.end() )
-                    state = -1;
+                    validState = false;
             }
         }
 
@@ -460,18 +793,129 @@ class State {
 
         /// Returns \c true if the current state is valid
         bool valid() const {
-            return( state >= 0 );
+            return validState;
         }
 
         /// Resets the current state (to the joint state represented by linear state 0)
         void reset() {
             state = 0;
+            validState = true;
             for( states_type::iterator s = states.begin(); s != states.end(); s++ )
                 s->second = 0;
         }
 };
 
 
+/// Makes it easy to iterate over all possible joint states of variables within a VarSet, without using a std::map
+/** A FlatState offers the same iteration interface as State, but stores the states of the variables in an
+ *  array (in the order of the VarSet) and the linear state in a \c size_t. Incrementing a FlatState and
+ *  looking up the state of a variable therefore involves neither map operations nor arbitrary precision
+ *  arithmetic. A FlatState can only be used for VarSets whose number of joint states fits in a \c size_t.
+ *
+ *  \code
+ *  VarSet vars( x0, x1 );
+ *  for( FlatState S(vars); S.valid(); S++ ) {
+ *      cout << "Linear state: " << (size_t)S << ", x0 = " << S(x0) << ", x1 = " << S(x1) << endl;
+ *  }
+ *  \endcode
+ */
+class FlatState {
+    private:
+        /// The variables
+        VarSet _vars;
+        /// Current states of the variables (in the order of _vars)
+        std::vector<size_t> _states;
+        /// Current linear state
+        size_t _state;
+        /// Whether the current state is valid
+        bool _valid;
+
+    public:
+        /// Default constructor
+        FlatState() : _vars(), _states(), _state(0), _valid(true) {}
+
+        /// Construct from VarSet \a vs and corresponding linear state \a linearState
+        FlatState( const VarSet &vs, size_t linearState=0 ) : _vars(vs), _states(vs.size(), 0), _state(linearState), _valid(true) {
+            DAI_ASSERT( linearState < BigInt_size_t( vs.nrStates() ) );
+            size_t k = 0;
+            for( VarSet::const_iterator v = vs.begin(); v != vs.end(); v++, k++ ) {
+                _states[k] = linearState % v->states();
+                linearState /= v->states();
+            }
+        }
+
+        /// Return current linear state
+        operator size_t() const {
+            DAI_ASSERT( valid() );
+            return _state;
+        }
+
+        /// Returns the variables
+        const VarSet& vars() const { return _vars; }
+
+        /// Returns current state of the \a k 'th variable of vars()
+        size_t operator[]( size_t k ) const {
+            DAI_DEBASSERT( k < _states.size() );
+            return _states[k];
+        }
+
+        /// Return current state of variable \a v, or 0 if \a v is not in vars()
+        size_t operator() ( const Var &v ) const {
+            VarSet::const_iterator it = std::lower_bound( _vars.begin(), _vars.end(), v );
+            if( it == _vars.end() || *it != v )
+                return 0;
+            else
+                return _states[it - _vars.begin()];
+        }
+
+        /// Return linear state of variables in \a vs, assuming that variables that are not in vars() are in state 0
+        size_t operator() ( const VarSet &vs ) const {
+            size_t vs_state = 0;
+            size_t prod = 1;
+            VarSet::const_iterator w = _vars.begin();
+            for( VarSet::const_iterator v = vs.begin(); v != vs.end(); v++ ) {
+                while( w != _vars.end() && *w < *v )
+                    w++;
+                if( w != _vars.end() && *w == *v )
+                    vs_state += _states[w - _vars.begin()] * prod;
+                prod *= v->states();
+            }
+            return vs_state;
+        }
+
+        /// Increments the current state (prefix)
+        void operator++( ) {
+            if( valid() ) {
+                _state++;
+                size_t k = 0;
+                for( VarSet::const_iterator v = _vars.begin(); v != _vars.end(); v++, k++ ) {
+                    if( ++_states[k] < v->states() )
+                        return;
+                    _states[k] = 0;
+                }
+                _valid = false;
+            }
+        }
+
+        /// Increments the current state (postfix)
+        void operator++( int ) {
+            operator++();
+        }
+
+        /// Returns \c true if the current state is valid
+        bool valid() const {
+            return _valid;
+        }
+
+        /// Resets the current state (to the joint state represented by linear state 0)
+        void reset() {
+            _state = 0;
+            _valid = true;
+            std::fill( _states.begin(), _states.end(), 0 );
+        }
+};
+
+
 } // end of namespace dai
 
 
@@ -0,0 +1,173 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+/// \file
+/// \brief Defines the IndexedHeap<> class, a priority queue of a fixed set of items whose keys can be changed
+
+
+#ifndef __defined_libdai_indexedheap_h
+#define __defined_libdai_indexedheap_h
+
+
+#include <cstddef>
+#include <vector>
+#include <functional>
+#include <dai/exceptions.h>
+
+
+namespace dai {
+
+
+/// Represents a priority queue of the items 0, 1, ..., size()-1, each of which has a key that can be changed
+/** An IndexedHeap is a <em>D</em>-ary max-heap that is stored in flat arrays: the items in heap order,
+ *  the position of each item in the heap, and the key of each item. Because the position of each item
+ *  is known, its key can be increased or decreased in place by set(), which moves the item up or down
+ *  the heap in O(log size()) time without allocating memory. top() returns the item with the largest
+ *  key in constant time. A branching factor of 4 (the default) yields a shallow heap whose children
+ *  are adjacent in memory, which is usually faster than a binary heap.
+ *
+ *  If several items have equal keys, it is unspecified which of them is returned by top(); a strict
+ *  order can be obtained by adding a tie-breaker to the keys (e.g., using <tt>std::pair</tt>).
+ *
+ *  \tparam Key Type of the keys.
+ *  \tparam D Branching factor (at least 2).
+ *  \tparam Compare Strict weak ordering of the keys; top() returns an item whose key is not less than any other key.
+ */
+template <typename Key, size_t D = 4, typename Compare = std::less<Key> >
+class IndexedHeap {
+    private:
+        /// Key of each item
+        std::vector<Key> _keys;
+        /// Items in heap order (the children of the item at position \a p are at positions <em>D p</em> + 1, ..., <em>D p</em> + <em>D</em>)
+        std::vector<size_t> _heap;
+        /// Position of each item in \a _heap
+        std::vector<size_t> _pos;
+        /// Comparison of keys
+        Compare _comp;
+
+        /// Places \a item at position \a p of the heap
+        void place( size_t item, size_t p ) {
+            _heap[p] = item;
+            _pos[item] = p;
+        }
+
+        /// Moves \a item, which is at position \a p, up the heap until its parent has a key that is not less than its own
+        void siftUp( size_t item, size_t p ) {
+            while( p > 0 ) {
+                size_t parent = (p - 1) / D;
+                if( !_comp( _keys[_heap[parent]], _keys[item] ) )
+                    break;
+                place( _heap[parent], p );
+                p = parent;
+            }
+            place( item, p );
+        }
+
+        /// Moves \a item, which is at position \a p, down the heap until none of its children has a larger key
+        void siftDown( size_t item, size_t p ) {
+            size_t n = _heap.size();
+            while( true ) {
+                size_t first = D * p + 1;
+                if( first >= n )
+                    break;
+                size_t last = first + D < n ? first + D : n;
+                size_t best = first;
+                for( size_t c = first + 1; c < last; c++ )
+                    if( _comp( _keys[_heap[best]], _keys[_heap[c]] ) )
+                        best = c;
+                if( !_comp( _keys[item], _keys[_heap[best]] ) )
+                    break;
+                place( _heap[best], p );
+                p = best;
+            }
+            place( item, p );
+        }
+
+    public:
+    /// \name Constructors and destructors
+    //@{
+        /// Constructs an empty heap
+        IndexedHeap( const Compare &comp = Compare() ) : _keys(), _heap(), _pos(), _comp(comp) {}
+
+        /// Constructs a heap of the items 0, 1, ..., \a n - 1, which all have key \a key
+        explicit IndexedHeap( size_t n, const Key &key = Key(), const Compare &comp = Compare() ) : _keys(), _heap(), _pos(), _comp(comp) {
+            assign( n, key );
+        }
+    //@}
+
+    /// \name Queries
+    //@{
+        /// Returns the number of items
+        size_t size() const { return _heap.size(); }
+
+        /// Returns \c true if there are no items
+        bool empty() const { return _heap.empty(); }
+
+        /// Returns an item with the largest key
+        size_t top() const {
+            DAI_DEBASSERT( !empty() );
+            return _heap[0];
+        }
+
+        /// Returns the largest key
+        const Key& topKey() const { return _keys[top()]; }
+
+        /// Returns the key of \a item
+        const Key& key( size_t item ) const {
+            DAI_DEBASSERT( item < size() );
+            return _keys[item];
+        }
+
+        /// Returns \c true if the items are in heap order (used for testing)
+        bool isHeap() const {
+            for( size_t p = 1; p < _heap.size(); p++ )
+                if( _comp( _keys[_heap[(p - 1) / D]], _keys[_heap[p]] ) )
+                    return false;
+            for( size_t p = 0; p < _heap.size(); p++ )
+                if( _pos[_heap[p]] != p )
+                    return false;
+            return true;
+        }
+    //@}
+
+    /// \name Operations
+    //@{
+        /// Replaces the contents by the items 0, 1, ..., \a n - 1, which all have key \a key
+        void assign( size_t n, const Key &key = Key() ) {
+            _keys.assign( n, key );
+            _heap.resize( n );
+            _pos.resize( n );
+            for( size_t item = 0; item < n; item++ )
+                place( item, item );
+        }
+
+        /// Removes all items
+        void clear() {
+            _keys.clear();
+            _heap.clear();
+            _pos.clear();
+        }
+
+        /// Changes the key of \a item into \a key and restores the heap order
+        void set( size_t item, const Key &key ) {
+            DAI_DEBASSERT( item < size() );
+            bool up = _comp( _keys[item], key );
+            _keys[item] = key;
+            if( up )
+                siftUp( item, _pos[item] );
+            else
+                siftDown( item, _pos[item] );
+        }
+    //@}
+};
+
+
+} // end of namespace dai
+
+
+#endif
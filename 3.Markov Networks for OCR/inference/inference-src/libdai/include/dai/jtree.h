@@ -20,6 +20,8 @@
 #include <dai/varset.h>
 #include <dai/regiongraph.h>
 #include <dai/factorgraph.h>
+#include <dai/sparsefactor.h>
+#include <dai/logfactor.h>
 #include <dai/clustergraph.h>
 #include <dai/weightedgraph.h>
 #include <dai/enum.h>
@@ -37,6 +39,16 @@ namespace dai {
  *  There are two variants, the sum-product algorithm (corresponding to 
  *  finite temperature) and the max-product algorithm (corresponding to 
  *  zero temperature).
+ *
+ *  Cliques of which the fraction of nonzero values (of the product of the factors
+ *  assigned to it) is at most \a maxdensity are represented by SparseFactor objects
+ *  while running the algorithm, which saves time and memory for models with many zeros
+ *  (for example, models with deterministic factors). The resulting beliefs are stored as
+ *  ordinary factors.
+ *
+ *  If \a logdomain is \c true, the cliques, separators and messages are represented by LogFactor
+ *  objects while running the algorithm, which prevents underflow for large cliques with small
+ *  values. In that case, \a maxdensity is ignored.
  */
 class JTree : public DAIAlgRG {
     private:
@@ -46,6 +58,24 @@ class JTree : public DAIAlgRG {
         /// Stores the logarithm of the partition sum
         Real _logZ;
 
+        /// Stores the sparse outer region beliefs while running (only for outer regions for which \a _useSparse is \c true)
+        std::vector<SparseFactor> _sparseQa;
+
+        /// Specifies for each outer region whether it is represented by a sparse factor while running
+        std::vector<bool> _useSparse;
+
+        /// Incoming messages of an outer region (kept to reuse its memory in runShaferShenoy())
+        std::vector<const Factor*> _msgs;
+
+        /// Log-domain outer region beliefs while running (only if \a props.logdomain == \c true)
+        std::vector<LogFactor> _logQa;
+
+        /// Log-domain inner region beliefs while running HUGIN (only if \a props.logdomain == \c true)
+        std::vector<LogFactor> _logQb;
+
+        /// Log-domain messages while running Shafer-Shenoy (only if \a props.logdomain == \c true)
+        std::vector<std::vector<LogFactor> > _logMes;
+
     public:
         /// The junction tree (stored as a rooted tree)
         RootedTree RTree;
@@ -98,13 +128,19 @@ class JTree : public DAIAlgRG {
 
             /// Maximum memory to use in bytes (0 means unlimited)
             size_t maxmem;
+
+            /// Maximum fraction of nonzero values of cliques that are represented sparsely (0.0 means that no cliques are represented sparsely)
+            Real maxdensity;
+
+            /// Whether updates should be done in the logarithmic domain or not
+            bool logdomain;
         } props;
 
     public:
     /// \name Constructors/destructors
     //@{
         /// Default constructor
-        JTree() : DAIAlgRG(), _mes(), _logZ(), RTree(), Qa(), Qb(), props() {}
+        JTree() : DAIAlgRG(), _mes(), _logZ(), _sparseQa(), _useSparse(), _msgs(), _logQa(), _logQb(), _logMes(), RTree(), Qa(), Qb(), props() {}
 
         /// Construct from FactorGraph \a fg and PropertySet \a opts
         /** \param fg factor graph
@@ -191,6 +227,22 @@ class JTree : public DAIAlgRG {
          */
         Factor calcMarginal( const VarSet& vs );
     //@}
+
+    private:
+        /// Creates sparse outer region beliefs from the outer region factors of which the density is at most \a props.maxdensity
+        void initQa();
+        /// Converts the sparse outer region beliefs into ordinary factors
+        void finishQa();
+        /// Returns the (max-)marginal of outer region belief \a alpha on \a vs, normalized if \a normed == \c true
+        Factor marginalQa( size_t alpha, const VarSet &vs, bool normed ) const;
+        /// Returns the (max-)marginal on \a vs of the product of outer region factor \a alpha and the factors in \a msgs, normalized if \a normed == \c true
+        Factor productMarginalOR( size_t alpha, const std::vector<const Factor*> &msgs, const VarSet &vs, bool normed ) const;
+        /// Returns the (max-)marginal of log-factor \a f on \a vs, normalized if \a normed == \c true
+        LogFactor marginalLog( const LogFactor &f, const VarSet &vs, bool normed ) const;
+        /// Runs junction tree algorithm using HUGIN updates in the logarithmic domain
+        void runHUGINLog();
+        /// Runs junction tree algorithm using Shafer-Shenoy updates in the logarithmic domain
+        void runShaferShenoyLog();
 };
 
 
@@ -0,0 +1,303 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+/// \file
+/// \brief Defines TLogFactor<> and LogFactor classes which represent factors by the logarithms of their values.
+
+
+#ifndef __defined_libdai_logfactor_h
+#define __defined_libdai_logfactor_h
+
+
+#include <iostream>
+#include <cmath>
+#include <functional>
+#include <dai/factor.h>
+#include <dai/index.h>
+#include <dai/varset.h>
+#include <dai/util.h>
+
+
+namespace dai {
+
+
+/// Function object that subtracts logarithms, where subtracting the logarithm of zero yields the logarithm of zero
+/** This is the log-domain counterpart of fo_divides0.
+ */
+template<typename T> struct fo_logdivides0 : public std::binary_function<T, T, T> {
+    /// Returns (\a y == -inf ? -inf : (\a x - \a y))
+    T operator()( const T &x, const T &y ) const {
+        if( y == -INFINITY )
+            return -INFINITY;
+        else
+            return x - y;
+    }
+};
+
+
+/// Represents a (probability) factor by the logarithms of its values.
+/** A TLogFactor<T> represents the same mathematical object as a TFactor<T>, but it stores the
+ *  natural logarithm of each value (the log-potential) instead of the value itself. Zero values
+ *  are represented by -inf. Products and quotients of factors become sums and differences of
+ *  log-potentials, powers become multiplications, and marginals are calculated with a numerically
+ *  stable log-sum-exp: for each joint state of the result, the maximum log-potential is subtracted
+ *  before exponentiating. Max-marginals do not need any exponentiation at all.
+ *
+ *  Normalization subtracts the logarithm of the sum of the values, so normalized log-factors
+ *  correspond with normalized probability factors.
+ *
+ *  \tparam T Should be a floating point type.
+ */
+template <typename T>
+class TLogFactor {
+    private:
+        /// Stores the variables on which the factor depends and the logarithms of the values
+        TFactor<T> _logf;
+
+        /// Kernel for ContractionPlan::run() that maximizes a table into a smaller table
+        struct MaxKernel {
+            /// Result table
+            T *r;
+            /// Table that is maximized
+            const T *a;
+
+            /// Processes one run of the innermost loop
+            void operator()( size_t, size_t ia, size_t ib, size_t n, size_t sa, size_t sb ) {
+                for( size_t j = 0; j < n; j++ )
+                    if( a[ia + j * sa] > r[ib + j * sb] )
+                        r[ib + j * sb] = a[ia + j * sa];
+            }
+        };
+
+        /// Kernel for ContractionPlan::run() that sums the exponentials of a table, shifted by \a m, into a smaller table
+        /** Adds <tt>exp( a[ia+j*sa] - m[ib+j*sb] )</tt> to <tt>r[ib+j*sb]</tt> for <tt>j < n</tt>; values equal to -inf are skipped.
+         */
+        struct SumExpKernel {
+            /// Result table
+            T *r;
+            /// Table that is summed
+            const T *a;
+            /// Shifts (the maximum of the values that are summed into each entry of \a r)
+            const T *m;
+
+            /// Processes one run of the innermost loop
+            void operator()( size_t, size_t ia, size_t ib, size_t n, size_t sa, size_t sb ) {
+                for( size_t j = 0; j < n; j++ ) {
+                    T x = a[ia + j * sa];
+                    if( x != -INFINITY )
+                        r[ib + j * sb] += std::exp( x - m[ib + j * sb] );
+                }
+            }
+        };
+
+    public:
+    /// \name Constructors and destructors
+    //@{
+        /// Constructs factor depending on no variables with log-value \a logp
+        TLogFactor( T logp = 0 ) : _logf( logp ) {}
+
+        /// Constructs factor depending on variables in \a vars with all log-values set to \a logp
+        explicit TLogFactor( const VarSet &vars, T logp = 0 ) : _logf( vars, logp ) {}
+
+        /// Constructs factor from the dense factor \a f by taking the logarithm of its values
+        explicit TLogFactor( const TFactor<T> &f ) : _logf( f ) {
+            _logf.takeLog();
+        }
+
+        /// Constructs factor depending on variables in \a vars with log-values \a logp
+        /** \pre \a logp.size() == \a vars.nrStates()
+         */
+        TLogFactor( const VarSet &vars, const TProb<T> &logp ) : _logf( vars, logp ) {}
+    //@}
+
+    /// \name Conversion
+    //@{
+        /// Returns the dense factor with the same values (i.e., the exponentials of the log-values)
+        TFactor<T> toFactor() const {
+            TFactor<T> f( _logf );
+            f.takeExp();
+            return f;
+        }
+    //@}
+
+    /// \name Get/set individual entries
+    //@{
+        /// Sets \a i 'th log-value
+        void set( size_t i, T logval ) { _logf.set( i, logval ); }
+
+        /// Gets \a i 'th log-value
+        T get( size_t i ) const { return _logf[i]; }
+
+        /// Returns a copy of the \a i 'th log-value
+        T operator[]( size_t i ) const { return _logf[i]; }
+    //@}
+
+    /// \name Queries
+    //@{
+        /// Returns constant reference to the log-values
+        const TProb<T>& logp() const { return _logf.p(); }
+
+        /// Returns constant reference to variable set (i.e., the variables on which the factor depends)
+        const VarSet& vars() const { return _logf.vars(); }
+
+        /// Returns the number of possible joint states of the variables on which the factor depends, \f$\prod_{l\in L} S_l\f$
+        size_t nrStates() const { return _logf.nrStates(); }
+
+        /// Returns maximum log-value
+        T max() const { return _logf.max(); }
+
+        /// Returns the logarithm of the sum of the values, calculated as a stable log-sum-exp
+        T logSumExp() const {
+            T m = max();
+            if( m == -INFINITY )
+                return -INFINITY;
+            T s = 0;
+            for( size_t i = 0; i < nrStates(); i++ )
+                if( _logf[i] != -INFINITY )
+                    s += std::exp( _logf[i] - m );
+            return m + std::log( s );
+        }
+
+        /// Returns \c true if one or more log-values are NaN
+        bool hasNaNs() const { return _logf.hasNaNs(); }
+
+        /// Comparison
+        bool operator==( const TLogFactor<T> &y ) const { return _logf == y._logf; }
+    //@}
+
+    /// \name Unary transformations
+    //@{
+        /// Normalizes factor such that the values sum to one, and returns the logarithm of the normalization constant
+        /** \throw NOT_NORMALIZABLE if all values are zero
+         */
+        T normalize() {
+            T logZ = logSumExp();
+            if( logZ == -INFINITY )
+                DAI_THROW(NOT_NORMALIZABLE);
+            _logf -= logZ;
+            return logZ;
+        }
+
+        /// Returns normalized copy of \c *this
+        TLogFactor<T> normalized() const {
+            TLogFactor<T> x( *this );
+            x.normalize();
+            return x;
+        }
+    //@}
+
+    /// \name Operations with scalars
+    //@{
+        /// Raises values to the power \a x (i.e., multiplies log-values by \a x)
+        TLogFactor<T>& operator^= (T x) {
+            if( x == (T)0 )
+                _logf.fill( 0 );
+            else
+                _logf *= x;
+            return *this;
+        }
+
+        /// Returns result of raising values to the power \a x
+        TLogFactor<T> operator^ (T x) const {
+            TLogFactor<T> result( *this );
+            result ^= x;
+            return result;
+        }
+    //@}
+
+    /// \name Operations with other factors
+    //@{
+        /// Multiplies \c *this with \a g (i.e., adds the log-values)
+        /** The resulting factor depends on the union of the variables of \c *this and \a g.
+         */
+        TLogFactor<T>& operator*= (const TLogFactor<T> &g) {
+            _logf += g._logf;
+            return *this;
+        }
+
+        /// Divides \c *this by \a g, where division by zero yields zero
+        TLogFactor<T>& operator/= (const TLogFactor<T> &g) {
+            _logf.binaryOp( g._logf, fo_logdivides0<T>() );
+            return *this;
+        }
+
+        /// Returns product of \c *this with \a g
+        TLogFactor<T> operator* (const TLogFactor<T> &g) const {
+            TLogFactor<T> result( *this );
+            result *= g;
+            return result;
+        }
+
+        /// Returns quotient of \c *this and \a g, where division by zero yields zero
+        TLogFactor<T> operator/ (const TLogFactor<T> &g) const {
+            TLogFactor<T> result( *this );
+            result /= g;
+            return result;
+        }
+    //@}
+
+    /// \name Miscellaneous operations
+    //@{
+        /// Returns a slice of \c *this, where the subset \a vars is in state \a varsState
+        /** \see TFactor<T>::slice()
+         */
+        TLogFactor<T> slice( const VarSet &vars, size_t varsState ) const {
+            TLogFactor<T> result;
+            result._logf = _logf.slice( vars, varsState );
+            return result;
+        }
+
+        /// Returns marginal on \a vars, obtained by summing out all variables except those in \a vars, and normalizing the result if \a normed == \c true
+        /** The sum over the values of each joint state of \a vars is calculated as a log-sum-exp,
+         *  relative to the maximum log-value of that joint state.
+         */
+        TLogFactor<T> marginal( const VarSet &vars, bool normed = true ) const {
+            TLogFactor<T> res = maxMarginal( vars, false );
+            TFactor<T> s( res.vars(), (T)0 );
+            boost::shared_ptr<const ContractionPlan> plan = ContractionPlan::get( this->vars(), this->vars(), res.vars() );
+            SumExpKernel kernel = { &(s.p().p()[0]), &(_logf.p().p()[0]), &(res._logf.p().p()[0]) };
+            plan->run( kernel );
+            for( size_t i = 0; i < res.nrStates(); i++ )
+                if( res[i] != -INFINITY )
+                    res.set( i, res[i] + std::log( s[i] ) );
+            if( normed )
+                res.normalize();
+            return res;
+        }
+
+        /// Returns max-marginal on \a vars, obtained by maximizing all variables except those in \a vars, and normalizing the result if \a normed == \c true
+        TLogFactor<T> maxMarginal( const VarSet &vars, bool normed = true ) const {
+            TLogFactor<T> res( vars & this->vars(), -INFINITY );
+            boost::shared_ptr<const ContractionPlan> plan = ContractionPlan::get( this->vars(), this->vars(), res.vars() );
+            MaxKernel kernel = { &(res._logf.p().p()[0]), &(_logf.p().p()[0]) };
+            plan->run( kernel );
+            if( normed )
+                res.normalize();
+            return res;
+        }
+    //@}
+};
+
+
+/// Writes a log-factor to an output stream
+/** \relates TLogFactor
+ */
+template<typename T> std::ostream& operator<< (std::ostream& os, const TLogFactor<T>& f) {
+    os << "(" << f.vars() << ", log " << f.logp() << ")";
+    return os;
+}
+
+
+/// Represents a log-factor with values of type dai::Real.
+typedef TLogFactor<Real> LogFactor;
+
+
+} // end of namespace dai
+
+
+#endif
@@ -19,6 +19,7 @@
 #include <dai/daialg.h>
 #include <dai/factorgraph.h>
 #include <dai/properties.h>
+#include <dai/accelerator.h>
 
 
 namespace dai {
@@ -33,6 +34,11 @@ namespace dai {
  *    \f[ b_i^{\mathrm{new}}(x_i) \propto \prod_{I\in N_i} \left( \sum_{x_{N_I \setminus \{i\}}} f_I(x_I) \prod_{j \in N_I \setminus \{i\}} b_j(x_j) \right) \f]
  *  for hard-spin mean field.
  *  These update equations are performed for all variables until convergence.
+ *
+ *  If \a acceleration == ANDERSON, the sweeps over the variables are regarded as a fixed-point iteration on the
+ *  vector of all beliefs, which is accelerated by an Accelerator with window \a accelwindow: after each sweep,
+ *  the beliefs are replaced by the accelerated ones and normalized. The convergence criterion still compares
+ *  the changes of the beliefs in the sweep with \a tol.
  */
 class MF : public DAIAlgFG {
     private:
@@ -69,6 +75,12 @@ class MF : public DAIAlgFG {
 
             /// How to update the messages/beliefs
             UpdateType updates;
+
+            /// Acceleration method of the sweeps
+            Accelerator::Method acceleration;
+
+            /// Number of previous sweeps that are combined by ANDERSON acceleration
+            size_t accelwindow;
         } props;
 
     public:
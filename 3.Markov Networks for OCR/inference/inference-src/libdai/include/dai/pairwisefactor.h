@@ -0,0 +1,159 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+/// \file
+/// \brief Defines class PairwiseFactor, which represents parametric pairwise factors (Potts, truncated linear/quadratic)
+
+
+#ifndef __defined_libdai_pairwisefactor_h
+#define __defined_libdai_pairwisefactor_h
+
+
+#include <iostream>
+#include <vector>
+#include <dai/factor.h>
+#include <dai/enum.h>
+
+
+namespace dai {
+
+
+/// Represents a pairwise factor with a parametric form, for which messages can be calculated in linear time
+/** A PairwiseFactor depends on two variables \f$x_1, x_2\f$ with the same number of states \a k and
+ *  has one of the following forms:
+ *  - DIAGONAL: \f$ f(x_1,x_2) = c \f$ if \f$x_1 \neq x_2\f$ and \f$ f(x,x) = d_x \f$ (constant off the
+ *    diagonal, arbitrary on the diagonal). Potts factors (constant \f$d_x\f$) and binary Ising factors
+ *    have this form.
+ *  - TRUNCLINEAR: \f$ f(x_1,x_2) = \exp( a - \min( \lambda |x_1 - x_2|, \tau ) ) \f$
+ *  - TRUNCQUADRATIC: \f$ f(x_1,x_2) = \exp( a - \min( \lambda (x_1 - x_2)^2, \tau ) ) \f$
+ *
+ *  The form is detected from the values of an ordinary Factor; factors that have none of these forms
+ *  are of kind DENSE. A message \f$ m(x_1) = \sum_{x_2} f(x_1,x_2) h(x_2) \f$ (or the maximum instead of
+ *  the sum) costs <em>O</em>(<em>k</em>) instead of <em>O</em>(<em>k</em><sup>2</sup>) operations:
+ *  - for DIAGONAL factors, \f$ m(x) = c \sum_{y \neq x} h(y) + d_x h(x) \f$ and the max-product
+ *    message is the maximum of \f$ d_x h(x) \f$ and \a c times the largest (or, at the argmax of \a h,
+ *    the second largest) value of \a h;
+ *  - for the truncated forms, max-product messages are calculated by distance transforms [\ref FeH06]:
+ *    two passes for the linear form and the lower envelope of parabolas for the quadratic form, after which
+ *    the truncation is applied by taking the maximum with \f$ e^{-\tau} \max_y h(y) \f$.
+ *
+ *  Sum-product messages of the truncated forms have no such shortcut; fast() tells whether the messages
+ *  of a factor can be calculated in linear time. All forms are symmetric, so the same function yields the
+ *  messages to both variables.
+ */
+class PairwiseFactor {
+    public:
+        /// Enumeration of the parametric forms
+        DAI_ENUM(Kind,DENSE,DIAGONAL,TRUNCLINEAR,TRUNCQUADRATIC);
+
+    private:
+        /// The form of the factor
+        Kind _kind;
+        /// Number of states of each variable
+        size_t _states;
+        /// Value off the diagonal (DIAGONAL only)
+        Real _offDiagonal;
+        /// Values on the diagonal (DIAGONAL only)
+        std::vector<Real> _diagonal;
+        /// Logarithm \a a of the value on the diagonal (truncated forms only)
+        Real _logScale;
+        /// Slope \f$\lambda\f$ (truncated forms only)
+        Real _slope;
+        /// Truncation \f$\tau\f$ (truncated forms only)
+        Real _truncation;
+
+    public:
+    /// \name Constructors
+    //@{
+        /// Constructs a DENSE factor without variables
+        PairwiseFactor() : _kind(Kind::DENSE), _states(0), _offDiagonal(0.0), _diagonal(), _logScale(0.0), _slope(0.0), _truncation(0.0) {}
+
+        /// Detects the form of \a f
+        /** The values off the diagonal of a DIAGONAL factor, and the values at the same distance from the
+         *  diagonal of a truncated factor, should be identical. The logarithms of the values of a truncated
+         *  factor may deviate by \a tol times (1 + their absolute value) from the parametric form.
+         */
+        PairwiseFactor( const Factor &f, Real tol = 1e-9 );
+
+        /// Constructs a DIAGONAL factor with value \a offDiagonal off the diagonal and values \a diagonal on the diagonal
+        PairwiseFactor( Real offDiagonal, const std::vector<Real> &diagonal ) : _kind(Kind::DIAGONAL), _states(diagonal.size()), _offDiagonal(offDiagonal), _diagonal(diagonal), _logScale(0.0), _slope(0.0), _truncation(0.0) {}
+
+        /// Constructs a truncated factor of kind \a kind (TRUNCLINEAR or TRUNCQUADRATIC) on variables with \a states states
+        PairwiseFactor( Kind kind, size_t states, Real logScale, Real slope, Real truncation );
+    //@}
+
+    /// \name Queries
+    //@{
+        /// Returns the form of the factor
+        Kind kind() const { return _kind; }
+
+        /// Returns the number of states of each variable
+        size_t states() const { return _states; }
+
+        /// Returns the value off the diagonal (DIAGONAL only)
+        Real offDiagonal() const { return _offDiagonal; }
+
+        /// Returns the values on the diagonal (DIAGONAL only)
+        const std::vector<Real>& diagonal() const { return _diagonal; }
+
+        /// Returns the logarithm \a a of the value on the diagonal (truncated forms only)
+        Real logScale() const { return _logScale; }
+
+        /// Returns the slope \f$\lambda\f$ (truncated forms only)
+        Real slope() const { return _slope; }
+
+        /// Returns the truncation \f$\tau\f$ (truncated forms only)
+        Real truncation() const { return _truncation; }
+
+        /// Returns the value of the factor for the states \a x1 and \a x2
+        Real operator()( size_t x1, size_t x2 ) const;
+
+        /// Returns \c true if messages can be calculated in linear time, for sum-product if \a sumprod is \c true and for max-product otherwise
+        bool fast( bool sumprod ) const {
+            if( _kind == Kind::DIAGONAL )
+                return true;
+            else if( _kind == Kind::DENSE )
+                return false;
+            else
+                return !sumprod;
+        }
+
+        /// Returns an ordinary Factor on the variables \a vs, which should consist of two variables with states() states
+        Factor toFactor( const VarSet &vs ) const;
+    //@}
+
+    /// \name Messages
+    //@{
+        /// Calculates the unnormalized message \a m from the incoming message \a h
+        /** \f$ m(x) = \sum_y f(x,y) h(y) \f$ if \a sumprod is \c true, \f$ m(x) = \max_y f(x,y) h(y) \f$ otherwise.
+         *  \a h and \a m should have states() values and should not overlap.
+         *  \pre fast( \a sumprod ) is \c true
+         */
+        void message( const Real *h, Real *m, bool sumprod ) const;
+
+        /// Calculates the logarithm of the unnormalized message \a lm from the logarithm of the incoming message \a lh
+        /** The log-domain counterpart of message(); values of -inf in \a lh represent zeros.
+         *  \pre fast( \a sumprod ) is \c true
+         */
+        void logMessage( const Real *lh, Real *lm, bool sumprod ) const;
+    //@}
+
+    private:
+        /// Calculates the log-domain max-product message of a truncated factor
+        void logMaxMessageTruncated( const Real *lh, Real *lm ) const;
+};
+
+
+/// Writes a PairwiseFactor to an output stream
+std::ostream& operator<< ( std::ostream& os, const PairwiseFactor& f );
+
+
+} // end of namespace dai
+
+
+#endif
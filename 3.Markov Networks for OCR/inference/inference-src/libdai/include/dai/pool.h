@@ -0,0 +1,187 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+/// \file
+/// \brief Defines the MemoryPool and PoolAllocator<> classes, which recycle the heap memory of temporary vectors, sets and factors
+
+
+#ifndef __defined_libdai_pool_h
+#define __defined_libdai_pool_h
+
+
+#include <cstddef>
+#include <new>
+
+
+namespace dai {
+
+
+/// Recycles the heap memory used by SmallVector<> (and hence by TProb<>, TFactor<> and VarSet) and by containers that use a PoolAllocator<>
+/** The inner loops of inference algorithms construct and destroy many temporary factors and
+ *  messages. Each InfAlg owns a MemoryPool, and InfAlg::run() implementations make it the current
+ *  pool of the calling thread by constructing a MemoryPool::Scope. While a pool is current, the
+ *  heap memory allocated by SmallVector<> is drawn from that pool, and when it is released again,
+ *  it is kept in the pool (in a free list per size class, where the sizes are powers of two)
+ *  instead of being returned to the system. After the first iteration, all temporaries are
+ *  therefore served from the free lists, and further iterations do not allocate heap memory.
+ *
+ *  Each block remembers the pool it was drawn from, so memory can safely be released after another
+ *  pool has become current, or after its pool has been destroyed (e.g., a belief calculated by
+ *  run() that is used afterwards): a destroyed pool frees its cached blocks immediately and its
+ *  remaining blocks when they are released.
+ *
+ *  \note A pool is not thread-safe: memory drawn from a pool should be released in the thread in
+ *  which the pool is used. The current pool is a per-thread setting.
+ */
+class MemoryPool {
+    private:
+        /// Header that precedes each block of memory handed out by allocate() and allocateCurrent()
+        struct Block;
+        /// Free lists and statistics (shared with the blocks, so that it can outlive the pool)
+        struct State;
+
+        /// Free lists and statistics of this pool
+        State *_state;
+
+    public:
+    /// \name Constructors and destructors
+    //@{
+        /// Constructs an empty pool
+        MemoryPool();
+
+        /// Copy constructor (constructs a new, empty pool; the memory of \a x is not shared)
+        MemoryPool( const MemoryPool &x );
+
+        /// Assignment operator (does nothing; the memory of \a x is not shared)
+        MemoryPool& operator=( const MemoryPool & ) { return *this; }
+
+        /// Destructor (frees the cached memory; memory in use is freed when it is released)
+        ~MemoryPool();
+    //@}
+
+    /// \name Allocation
+    //@{
+        /// Returns memory for \a bytes bytes from this pool
+        void* allocate( size_t bytes );
+
+        /// Returns memory for \a bytes bytes from the current pool of this thread, or from the heap if there is no current pool
+        static void* allocateCurrent( size_t bytes );
+
+        /// Releases memory \a p that was obtained from allocate() or allocateCurrent() (does nothing if \a p == NULL)
+        static void deallocate( void *p );
+
+        /// Frees the memory that is cached by this pool
+        void release();
+    //@}
+
+    /// \name Queries
+    //@{
+        /// Returns the number of blocks that are cached for reuse
+        size_t nrCached() const;
+
+        /// Returns the number of blocks that have been handed out and not yet released
+        size_t nrUsed() const;
+
+        /// Returns the current pool of this thread (or NULL if there is none)
+        static MemoryPool* current();
+    //@}
+
+        /// Makes a pool the current pool of this thread during its lifetime
+        /** Scopes can be nested; the destructor restores the previous current pool.
+         */
+        class Scope {
+            private:
+                /// The pool that was current before construction
+                MemoryPool *_previous;
+
+                /// Copying is not allowed
+                Scope( const Scope & );
+                /// Assignment is not allowed
+                Scope& operator=( const Scope & );
+
+            public:
+                /// Makes \a pool the current pool
+                explicit Scope( MemoryPool &pool );
+
+                /// Restores the previous current pool
+                ~Scope();
+        };
+};
+
+
+/// Standard allocator that draws memory from the current MemoryPool of the thread
+/** PoolAllocator<T> can be used for temporary standard containers in the inner loops of inference
+ *  algorithms, e.g., <tt>std::vector<T, PoolAllocator<T> ></tt>, so that their memory is recycled
+ *  like that of SmallVector<>. Without a current pool, memory is allocated on the heap.
+ */
+template <typename T>
+class PoolAllocator {
+    public:
+        /// Type of the elements
+        typedef T value_type;
+        /// Pointer to an element
+        typedef T* pointer;
+        /// Constant pointer to an element
+        typedef const T* const_pointer;
+        /// Reference to an element
+        typedef T& reference;
+        /// Constant reference to an element
+        typedef const T& const_reference;
+        /// Type of sizes
+        typedef size_t size_type;
+        /// Type of differences between pointers
+        typedef std::ptrdiff_t difference_type;
+
+        /// The corresponding allocator for elements of type \a U
+        template <typename U> struct rebind {
+            /// Type of the allocator
+            typedef PoolAllocator<U> other;
+        };
+
+        /// Default constructor
+        PoolAllocator() {}
+        /// Conversion from an allocator for another type
+        template <typename U> PoolAllocator( const PoolAllocator<U> & ) {}
+
+        /// Returns the address of \a x
+        pointer address( reference x ) const { return &x; }
+        /// Returns the address of \a x
+        const_pointer address( const_reference x ) const { return &x; }
+
+        /// Returns memory for \a n elements
+        pointer allocate( size_type n, const void * = 0 ) {
+            return static_cast<pointer>( MemoryPool::allocateCurrent( n * sizeof(T) ) );
+        }
+        /// Releases the memory \a p
+        void deallocate( pointer p, size_type ) { MemoryPool::deallocate( p ); }
+
+        /// Returns the maximum number of elements that can be allocated
+        size_type max_size() const { return (size_t)(-1) / sizeof(T); }
+
+        /// Constructs a copy of \a x at \a p
+        void construct( pointer p, const T &x ) { new( p ) T( x ); }
+        /// Destructs the element at \a p
+        void destroy( pointer p ) { p->~T(); }
+};
+
+
+/// All pool allocators are equal (memory can be released through any of them)
+/** \relates PoolAllocator
+ */
+template <typename T, typename U> bool operator==( const PoolAllocator<T> &, const PoolAllocator<U> & ) { return true; }
+
+/// All pool allocators are equal (memory can be released through any of them)
+/** \relates PoolAllocator
+ */
+template <typename T, typename U> bool operator!=( const PoolAllocator<T> &, const PoolAllocator<U> & ) { return false; }
+
+
+} // end of namespace dai
+
+
+#endif
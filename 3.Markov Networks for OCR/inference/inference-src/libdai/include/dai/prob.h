@@ -22,6 +22,16 @@
 #include <functional>
 #include <dai/util.h>
 #include <dai/exceptions.h>
+#include <dai/simd.h>
+#include <dai/smallvector.h>
+
+
+#ifndef DAI_PROB_INLINE_SIZE
+/// Number of entries of a TProb<> that are stored inline, i.e., without allocating memory on the heap
+/** Can be overridden with the PROBINLINE build option (see Makefile.ALL).
+ */
+#define DAI_PROB_INLINE_SIZE 32
+#endif
 
 
 namespace dai {
@@ -182,7 +192,10 @@ template<typename T> struct fo_absdiff : public std::binary_function<T, T, T> {
 
 
 /// Represents a vector with entries of type \a T.
-/** It is simply a <tt>std::vector</tt><<em>T</em>> with an interface designed for dealing with probability mass functions.
+/** It is simply a vector with an interface designed for dealing with probability mass functions.
+ *  The most frequently used pointwise operations and reductions are implemented by the vectorized kernels in dai::simd.
+ *  The entries are stored in a SmallVector, so vectors with at most #DAI_PROB_INLINE_SIZE entries (such as most
+ *  messages and single-variable beliefs) do not allocate memory on the heap.
  *
  *  It is mainly used for representing measures on a finite outcome space, for example, the probability
  *  distribution of a discrete random variable. However, entries are not necessarily non-negative; it is also used to
@@ -194,7 +207,7 @@ template <typename T>
 class TProb {
     public:
         /// Type of data structure used for storing the values
-        typedef std::vector<T> container_type;
+        typedef SmallVector<T, DAI_PROB_INLINE_SIZE> container_type;
 
         /// Shorthand
         typedef TProb<T> this_type;
@@ -203,6 +216,11 @@ class TProb {
         /// The data structure that stores the values
         container_type _p;
 
+        /// Returns pointer to the first value (or 0 if the vector is empty)
+        T* data() { return _p.empty() ? 0 : &(_p[0]); }
+        /// Returns constant pointer to the first value (or 0 if the vector is empty)
+        const T* data() const { return _p.empty() ? 0 : &(_p[0]); }
+
     public:
     /// \name Constructors and destructors
     //@{
@@ -351,13 +369,13 @@ class TProb {
         T entropy() const { return -accumulateSum( (T)0, fo_plog0p<T>() ); }
 
         /// Returns maximum value of all entries
-        T max() const { return accumulateMax( (T)(-INFINITY), fo_id<T>(), false ); }
+        T max() const { return simd::max( data(), size() ); }
 
         /// Returns minimum value of all entries
-        T min() const { return accumulateMax( (T)INFINITY, fo_id<T>(), true ); }
+        T min() const { return simd::min( data(), size() ); }
 
         /// Returns sum of all entries
-        T sum() const { return accumulateSum( (T)0, fo_id<T>() ); }
+        T sum() const { return simd::sum( data(), size() ); }
 
         /// Return sum of absolute value of all entries
         T sumAbs() const { return accumulateSum( (T)0, fo_abs<T>() ); }
@@ -411,7 +429,7 @@ class TProb {
          */
         bool operator<( const this_type& q ) const {
             DAI_DEBASSERT( size() == q.size() );
-            return lexicographical_compare( begin(), end(), q.begin(), q.end() );
+            return std::lexicographical_compare( begin(), end(), q.begin(), q.end() );
         }
 
         /// Comparison
@@ -428,7 +446,7 @@ class TProb {
         template<typename unaryOp> this_type pwUnaryTr( unaryOp op ) const {
             this_type r;
             r._p.reserve( size() );
-            std::transform( _p.begin(), _p.end(), back_inserter( r._p ), op );
+            std::transform( _p.begin(), _p.end(), std::back_inserter( r._p ), op );
             return r;
         }
 
@@ -473,8 +491,11 @@ class TProb {
             if( Z == (T)0 ) {
                 DAI_THROW(NOT_NORMALIZABLE);
                 return *this;
-            } else
-                return pwUnaryTr( std::bind2nd( std::divides<T>(), Z ) );
+            } else {
+                this_type r( *this );
+                simd::divide( r.data(), Z, r.size() );
+                return r;
+            }
         }
     //@}
 
@@ -558,17 +579,17 @@ class TProb {
         /// Multiplies each entry with scalar \a x
         this_type& operator*= (T x) {
             if( x != 1 )
-                return pwUnaryOp( std::bind2nd( std::multiplies<T>(), x ) );
-            else
-                return *this;
+                simd::scale( data(), x, size() );
+            return *this;
         }
 
         /// Divides each entry by scalar \a x, where division by 0 yields 0
         this_type& operator/= (T x) {
+            if( x == (T)0 )
+                return fill( (T)0 );
             if( x != 1 )
-                return pwUnaryOp( std::bind2nd( fo_divides0<T>(), x ) );
-            else
-                return *this;
+                simd::divide( data(), x, size() );
+            return *this;
         }
 
         /// Raises entries to the power \a x
@@ -589,10 +610,18 @@ class TProb {
         this_type operator- (T x) const { return pwUnaryTr( std::bind2nd( std::minus<T>(), x ) ); }
 
         /// Returns product of \c *this with scalar \a x
-        this_type operator* (T x) const { return pwUnaryTr( std::bind2nd( std::multiplies<T>(), x ) ); }
+        this_type operator* (T x) const {
+            this_type r( *this );
+            simd::scale( r.data(), x, r.size() );
+            return r;
+        }
 
         /// Returns quotient of \c *this and scalar \a x, where division by 0 yields 0
-        this_type operator/ (T x) const { return pwUnaryTr( std::bind2nd( fo_divides0<T>(), x ) ); }
+        this_type operator/ (T x) const {
+            this_type r( *this );
+            r /= x;
+            return r;
+        }
 
         /// Returns \c *this raised to the power \a x
         this_type operator^ (T x) const { return pwUnaryTr( std::bind2nd( fo_pow<T>(), x ) ); }
@@ -614,7 +643,11 @@ class TProb {
         /// Pointwise addition with \a q
         /** \pre <tt>this->size() == q.size()</tt>
          */
-        this_type& operator+= (const this_type & q) { return pwBinaryOp( q, std::plus<T>() ); }
+        this_type& operator+= (const this_type & q) {
+            DAI_DEBASSERT( size() == q.size() );
+            simd::add( data(), q.data(), size() );
+            return *this;
+        }
 
         /// Pointwise subtraction of \a q
         /** \pre <tt>this->size() == q.size()</tt>
@@ -624,13 +657,21 @@ class TProb {
         /// Pointwise multiplication with \a q
         /** \pre <tt>this->size() == q.size()</tt>
          */
-        this_type& operator*= (const this_type & q) { return pwBinaryOp( q, std::multiplies<T>() ); }
+        this_type& operator*= (const this_type & q) {
+            DAI_DEBASSERT( size() == q.size() );
+            simd::mul( data(), q.data(), size() );
+            return *this;
+        }
 
         /// Pointwise division by \a q, where division by 0 yields 0
         /** \pre <tt>this->size() == q.size()</tt>
          *  \see divide(const TProb<T> &)
          */
-        this_type& operator/= (const this_type & q) { return pwBinaryOp( q, fo_divides0<T>() ); }
+        this_type& operator/= (const this_type & q) {
+            DAI_DEBASSERT( size() == q.size() );
+            simd::div0( data(), q.data(), size() );
+            return *this;
+        }
 
         /// Pointwise division by \a q, where division by 0 yields +Inf
         /** \pre <tt>this->size() == q.size()</tt>
@@ -655,14 +696,18 @@ class TProb {
             DAI_DEBASSERT( size() == q.size() );
             TProb<T> r;
             r._p.reserve( size() );
-            std::transform( _p.begin(), _p.end(), q._p.begin(), back_inserter( r._p ), op );
+            std::transform( _p.begin(), _p.end(), q._p.begin(), std::back_inserter( r._p ), op );
             return r;
         }
 
         /// Returns sum of \c *this and \a q
         /** \pre <tt>this->size() == q.size()</tt>
          */
-        this_type operator+ ( const this_type& q ) const { return pwBinaryTr( q, std::plus<T>() ); }
+        this_type operator+ ( const this_type& q ) const {
+            this_type r( *this );
+            r += q;
+            return r;
+        }
 
         /// Return \c *this minus \a q
         /** \pre <tt>this->size() == q.size()</tt>
@@ -672,13 +717,21 @@ class TProb {
         /// Return product of \c *this with \a q
         /** \pre <tt>this->size() == q.size()</tt>
          */
-        this_type operator* ( const this_type &q ) const { return pwBinaryTr( q, std::multiplies<T>() ); }
+        this_type operator* ( const this_type &q ) const {
+            this_type r( *this );
+            r *= q;
+            return r;
+        }
 
         /// Returns quotient of \c *this with \a q, where division by 0 yields 0
         /** \pre <tt>this->size() == q.size()</tt>
          *  \see divided_by(const TProb<T> &)
          */
-        this_type operator/ ( const this_type &q ) const { return pwBinaryTr( q, fo_divides0<T>() ); }
+        this_type operator/ ( const this_type &q ) const {
+            this_type r( *this );
+            r /= q;
+            return r;
+        }
 
         /// Pointwise division by \a q, where division by 0 yields +Inf
         /** \pre <tt>this->size() == q.size()</tt>
@@ -751,7 +804,11 @@ template<typename T> TProb<T> min( const TProb<T> &a, const TProb<T> &b ) {
  *  \pre <tt>this->size() == q.size()</tt>
  */
 template<typename T> TProb<T> max( const TProb<T> &a, const TProb<T> &b ) {
-    return a.pwBinaryTr( b, fo_max<T>() );
+    DAI_DEBASSERT( a.size() == b.size() );
+    TProb<T> r( a );
+    if( r.size() )
+        simd::pwMax( &(r.p()[0]), &(b.p()[0]), r.size() );
+    return r;
 }
 
 
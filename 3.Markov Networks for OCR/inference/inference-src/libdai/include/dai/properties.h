@@ -208,6 +208,9 @@ PropertySet p()("method","BP")("verbose",1)("tol",1e-9)
 
         /// Gets the value corresponding to \a key, cast to \a ValueType, converting from a string if necessary
         /** If the type of the value is already equal to \a ValueType, no conversion is done.
+         *  If \a ValueType is \c float or \c double and the value is a \c double or \c float, respectively,
+         *  it is converted to \a ValueType (so that, e.g., a tolerance specified as a \c double literal
+         *  can be used as a Real in single-precision builds).
          *  Otherwise, the type of the value should be a std::string, in which case boost::lexical_cast is
          *  used to convert this to \a ValueType.
          *  \tparam ValueType Type to which the value should be cast/converted
@@ -217,8 +220,11 @@ PropertySet p()("method","BP")("verbose",1)("tol",1e-9)
         template<typename ValueType>
         ValueType getStringAs( const PropertyKey& key ) const { 
             PropertyValue val = get(key);
+            ValueType result = ValueType();
             if( val.type() == typeid(ValueType) ) {
                 return boost::any_cast<ValueType>(val);
+            } else if( convertFloatingPoint( val, result ) ) {
+                return result;
             } else if( val.type() == typeid(std::string) ) {
                 try {
                     return boost::lexical_cast<ValueType>(getAs<std::string>(key));
@@ -248,6 +254,29 @@ PropertySet p()("method","BP")("verbose",1)("tol",1e-9)
          */
         friend std::istream& operator>> ( std::istream& is, PropertySet& ps );
     //@}
+
+    private:
+        /// Converts \a val to \c float if it is a \c double; returns whether the conversion succeeded
+        static bool convertFloatingPoint( const PropertyValue &val, float &result ) {
+            if( val.type() != typeid(double) )
+                return false;
+            result = (float)boost::any_cast<double>(val);
+            return true;
+        }
+
+        /// Converts \a val to \c double if it is a \c float; returns whether the conversion succeeded
+        static bool convertFloatingPoint( const PropertyValue &val, double &result ) {
+            if( val.type() != typeid(float) )
+                return false;
+            result = boost::any_cast<float>(val);
+            return true;
+        }
+
+        /// Does nothing and returns \c false (no conversions for types other than \c float and \c double)
+        template<typename ValueType>
+        static bool convertFloatingPoint( const PropertyValue &, ValueType & ) {
+            return false;
+        }
 };
 
 
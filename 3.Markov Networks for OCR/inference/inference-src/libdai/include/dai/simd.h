@@ -0,0 +1,170 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+/// \file
+/// \brief Defines vectorized kernels for the pointwise and reduction operations on contiguous arrays used by TProb<>
+
+
+#ifndef __defined_libdai_simd_h
+#define __defined_libdai_simd_h
+
+
+#include <cstddef>
+#include <cmath>
+
+
+namespace dai {
+
+
+/// Vectorized kernels for the most frequently used operations on TProb<> values.
+/** The kernels operate on raw contiguous arrays of \c double or \c float. On x86 processors,
+ *  the implementation is selected at runtime according to the instruction sets supported
+ *  by the CPU (SSE2, AVX2 or AVX-512); on other platforms (or with other compilers than GCC
+ *  and clang) plain scalar loops are used. Generic templates handle all other value types.
+ *
+ *  Pointwise kernels give bitwise identical results for all instruction sets. The reductions
+ *  sum() may differ in the last bits, because the order of summation depends on the vector width.
+ */
+namespace simd {
+
+
+/// Enumerates the instruction sets for which kernels are available
+/**
+ *  - SCALAR means plain C++ loops;
+ *  - SSE2 means 128-bit vectors;
+ *  - AVX2 means 256-bit vectors;
+ *  - AVX512 means 512-bit vectors (AVX-512F).
+ */
+typedef enum { SCALAR, SSE2, AVX2, AVX512 } InstructionSet;
+
+
+/// Returns the most capable instruction set supported by both the CPU and the compiler
+InstructionSet detectInstructionSet();
+
+/// Returns the instruction set that is currently used by the kernels
+InstructionSet instructionSet();
+
+/// Selects the instruction set used by the kernels
+/** If \a is is not supported, the most capable supported instruction set that is less capable than \a is is used instead.
+ *  \returns The instruction set that has actually been selected
+ */
+InstructionSet setInstructionSet( InstructionSet is );
+
+/// Returns the name of instruction set \a is
+const char* instructionSetName( InstructionSet is );
+
+
+/// \name Kernels for double
+//@{
+    /// Sets \a x[i] to \a x[i] + \a y[i] for all \a i < \a n
+    void add( double *x, const double *y, size_t n );
+    /// Sets \a x[i] to \a x[i] * \a y[i] for all \a i < \a n
+    void mul( double *x, const double *y, size_t n );
+    /// Sets \a x[i] to \a x[i] / \a y[i] for all \a i < \a n, where division by 0 yields 0
+    void div0( double *x, const double *y, size_t n );
+    /// Sets \a x[i] to the maximum of \a x[i] and \a y[i] for all \a i < \a n
+    void pwMax( double *x, const double *y, size_t n );
+    /// Multiplies \a x[i] by \a c for all \a i < \a n
+    void scale( double *x, double c, size_t n );
+    /// Divides \a x[i] by \a c for all \a i < \a n
+    void divide( double *x, double c, size_t n );
+    /// Returns the sum of \a x[i] over all \a i < \a n
+    double sum( const double *x, size_t n );
+    /// Returns the maximum of \a x[i] over all \a i < \a n (or -Inf if \a n == 0)
+    double max( const double *x, size_t n );
+    /// Returns the minimum of \a x[i] over all \a i < \a n (or +Inf if \a n == 0)
+    double min( const double *x, size_t n );
+//@}
+
+/// \name Kernels for float
+//@{
+    /// Sets \a x[i] to \a x[i] + \a y[i] for all \a i < \a n
+    void add( float *x, const float *y, size_t n );
+    /// Sets \a x[i] to \a x[i] * \a y[i] for all \a i < \a n
+    void mul( float *x, const float *y, size_t n );
+    /// Sets \a x[i] to \a x[i] / \a y[i] for all \a i < \a n, where division by 0 yields 0
+    void div0( float *x, const float *y, size_t n );
+    /// Sets \a x[i] to the maximum of \a x[i] and \a y[i] for all \a i < \a n
+    void pwMax( float *x, const float *y, size_t n );
+    /// Multiplies \a x[i] by \a c for all \a i < \a n
+    void scale( float *x, float c, size_t n );
+    /// Divides \a x[i] by \a c for all \a i < \a n
+    void divide( float *x, float c, size_t n );
+    /// Returns the sum of \a x[i] over all \a i < \a n
+    float sum( const float *x, size_t n );
+    /// Returns the maximum of \a x[i] over all \a i < \a n (or -Inf if \a n == 0)
+    float max( const float *x, size_t n );
+    /// Returns the minimum of \a x[i] over all \a i < \a n (or +Inf if \a n == 0)
+    float min( const float *x, size_t n );
+//@}
+
+/// \name Generic kernels for other value types
+//@{
+    /// Sets \a x[i] to \a x[i] + \a y[i] for all \a i < \a n
+    template<typename T> void add( T *x, const T *y, size_t n ) {
+        for( size_t i = 0; i < n; i++ )
+            x[i] += y[i];
+    }
+    /// Sets \a x[i] to \a x[i] * \a y[i] for all \a i < \a n
+    template<typename T> void mul( T *x, const T *y, size_t n ) {
+        for( size_t i = 0; i < n; i++ )
+            x[i] *= y[i];
+    }
+    /// Sets \a x[i] to \a x[i] / \a y[i] for all \a i < \a n, where division by 0 yields 0
+    template<typename T> void div0( T *x, const T *y, size_t n ) {
+        for( size_t i = 0; i < n; i++ )
+            x[i] = (y[i] == (T)0) ? (T)0 : (x[i] / y[i]);
+    }
+    /// Sets \a x[i] to the maximum of \a x[i] and \a y[i] for all \a i < \a n
+    template<typename T> void pwMax( T *x, const T *y, size_t n ) {
+        for( size_t i = 0; i < n; i++ )
+            x[i] = (x[i] > y[i]) ? x[i] : y[i];
+    }
+    /// Multiplies \a x[i] by \a c for all \a i < \a n
+    template<typename T> void scale( T *x, T c, size_t n ) {
+        for( size_t i = 0; i < n; i++ )
+            x[i] *= c;
+    }
+    /// Divides \a x[i] by \a c for all \a i < \a n
+    template<typename T> void divide( T *x, T c, size_t n ) {
+        for( size_t i = 0; i < n; i++ )
+            x[i] /= c;
+    }
+    /// Returns the sum of \a x[i] over all \a i < \a n
+    template<typename T> T sum( const T *x, size_t n ) {
+        T s = 0;
+        for( size_t i = 0; i < n; i++ )
+            s += x[i];
+        return s;
+    }
+    /// Returns the maximum of \a x[i] over all \a i < \a n (or -Inf if \a n == 0)
+    template<typename T> T max( const T *x, size_t n ) {
+        T m = (T)(-INFINITY);
+        for( size_t i = 0; i < n; i++ )
+            if( m < x[i] )
+                m = x[i];
+        return m;
+    }
+    /// Returns the minimum of \a x[i] over all \a i < \a n (or +Inf if \a n == 0)
+    template<typename T> T min( const T *x, size_t n ) {
+        T m = (T)INFINITY;
+        for( size_t i = 0; i < n; i++ )
+            if( x[i] < m )
+                m = x[i];
+        return m;
+    }
+//@}
+
+
+} // end of namespace simd
+
+
+} // end of namespace dai
+
+
+#endif
@@ -17,21 +17,28 @@
 #include <vector>
 #include <algorithm>
 #include <iostream>
+#include <dai/smallvector.h>
 
 
 namespace dai {
 
 
 /// Represents a set; the implementation is optimized for a small number of elements.
-/** SmallSet uses an ordered <tt>std::vector<</tt><em>T</em><tt>></tt> to represent a set; this is faster than
+/** SmallSet uses an ordered vector to represent a set; this is faster than
  *  using a <tt>std::set<</tt><em>T</em><tt>></tt> if the number of elements is small.
+ *  The vector is a SmallVector<> that stores up to four elements inline, so that copying
+ *  small sets (such as the variables of a pairwise factor) does not allocate memory.
  *  \tparam T Should be less-than-comparable.
  */
 template <typename T>
 class SmallSet {
+    public:
+        /// Type of the vector that stores the elements
+        typedef SmallVector<T, 4> container_type;
+
     private:
         /// The elements in this set
-        std::vector<T> _elements;
+        container_type _elements;
 
     public:
     /// \name Constructors and destructors
@@ -68,7 +75,7 @@ class SmallSet {
             _elements.reserve( sizeHint );
             _elements.insert( _elements.begin(), begin, end );
             std::sort( _elements.begin(), _elements.end() );
-            typename std::vector<T>::iterator new_end = std::unique( _elements.begin(), _elements.end() );
+            typename container_type::iterator new_end = std::unique( _elements.begin(), _elements.end() );
             _elements.erase( new_end, _elements.end() );
         }
     //@}
@@ -91,21 +98,21 @@ class SmallSet {
         /// Set-minus operator: returns all elements in \c *this, except those in \a x
         SmallSet operator/ ( const SmallSet& x ) const {
             SmallSet res;
-            std::set_difference( _elements.begin(), _elements.end(), x._elements.begin(), x._elements.end(), inserter( res._elements, res._elements.begin() ) );
+            std::set_difference( _elements.begin(), _elements.end(), x._elements.begin(), x._elements.end(), std::inserter( res._elements, res._elements.begin() ) );
             return res;
         }
 
         /// Set-union operator: returns all elements in \c *this, plus those in \a x
         SmallSet operator| ( const SmallSet& x ) const {
             SmallSet res;
-            std::set_union( _elements.begin(), _elements.end(), x._elements.begin(), x._elements.end(), inserter( res._elements, res._elements.begin() ) );
+            std::set_union( _elements.begin(), _elements.end(), x._elements.begin(), x._elements.end(), std::inserter( res._elements, res._elements.begin() ) );
             return res;
         }
 
         /// Set-intersection operator: returns all elements in \c *this that are also contained in \a x
         SmallSet operator& ( const SmallSet& x ) const {
             SmallSet res;
-            std::set_intersection( _elements.begin(), _elements.end(), x._elements.begin(), x._elements.end(), inserter( res._elements, res._elements.begin() ) );
+            std::set_intersection( _elements.begin(), _elements.end(), x._elements.begin(), x._elements.end(), std::inserter( res._elements, res._elements.begin() ) );
             return res;
         }
 
@@ -116,7 +123,7 @@ class SmallSet {
 
         /// Erases one element
         SmallSet& operator/= ( const T &t ) {
-            typename std::vector<T>::iterator pos = lower_bound( _elements.begin(), _elements.end(), t );
+            typename container_type::iterator pos = std::lower_bound( _elements.begin(), _elements.end(), t );
             if( pos != _elements.end() )
                 if( *pos == t ) // found element, delete it
                     _elements.erase( pos );
@@ -130,7 +137,7 @@ class SmallSet {
 
         /// Adds one element
         SmallSet& operator|= ( const T& t ) {
-            typename std::vector<T>::iterator pos = lower_bound( _elements.begin(), _elements.end(), t );
+            typename container_type::iterator pos = std::lower_bound( _elements.begin(), _elements.end(), t );
             if( pos == _elements.end() || *pos != t ) // insert it
                 _elements.insert( pos, t );
             return *this;
@@ -165,26 +172,26 @@ class SmallSet {
         }
 
         /// Returns number of elements
-        typename std::vector<T>::size_type size() const { return _elements.size(); }
+        typename container_type::size_type size() const { return _elements.size(); }
 
         /// Returns whether \c *this is empty
         bool empty() const { return _elements.size() == 0; }
 
         /// Returns reference to the elements
-        std::vector<T>& elements() { return _elements; }
+        container_type& elements() { return _elements; }
 
         /// Returns constant reference to the elements
-        const std::vector<T>& elements() const { return _elements; }
+        const container_type& elements() const { return _elements; }
     //@}
 
         /// Constant iterator over the elements
-        typedef typename std::vector<T>::const_iterator const_iterator;
+        typedef typename container_type::const_iterator const_iterator;
         /// Iterator over the elements
-        typedef typename std::vector<T>::iterator iterator;
+        typedef typename container_type::iterator iterator;
         /// Constant reverse iterator over the elements
-        typedef typename std::vector<T>::const_reverse_iterator const_reverse_iterator;
+        typedef typename container_type::const_reverse_iterator const_reverse_iterator;
         /// Reverse iterator over the elements
-        typedef typename std::vector<T>::reverse_iterator reverse_iterator;
+        typedef typename container_type::reverse_iterator reverse_iterator;
 
     /// \name Iterator interface
     //@{
@@ -242,7 +249,7 @@ class SmallSet {
         /// Writes a SmallSet to an output stream
         friend std::ostream& operator << ( std::ostream& os, const SmallSet& x ) {
             os << "{";
-            for( typename std::vector<T>::const_iterator it = x.begin(); it != x.end(); it++ )
+            for( typename container_type::const_iterator it = x.begin(); it != x.end(); it++ )
                 os << (it != x.begin() ? ", " : "") << *it;
             os << "}";
             return os;
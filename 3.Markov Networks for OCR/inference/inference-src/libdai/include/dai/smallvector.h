@@ -0,0 +1,288 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+/// \file
+/// \brief Defines the SmallVector<> class, a vector that stores short sequences without allocating memory on the heap
+
+
+#ifndef __defined_libdai_smallvector_h
+#define __defined_libdai_smallvector_h
+
+
+#include <cstddef>
+#include <iterator>
+#include <algorithm>
+#include <stdexcept>
+#include <dai/pool.h>
+
+
+namespace dai {
+
+
+/// Represents a vector that stores up to \a N elements inline and only allocates memory on the heap for longer sequences
+/** A SmallVector<T,N> offers the part of the <tt>std::vector</tt><<em>T</em>> interface that is used by libDAI.
+ *  As long as its size does not exceed \a N, the elements are stored in a buffer that is part of the object
+ *  itself, so that constructing, copying and destroying short vectors does not involve the memory allocator.
+ *  Longer sequences are stored in memory allocated on the heap, like <tt>std::vector</tt>. Memory that
+ *  has been allocated is kept until the object is destroyed, so assigning a vector of the same size
+ *  does not allocate either. Heap memory is obtained from the current MemoryPool of the thread, if
+ *  there is one.
+ *
+ *  \tparam T Should be a trivially copyable type (elements are copied by assignment and are not destructed).
+ *  \tparam N Number of elements that are stored inline (may be 0).
+ */
+template <typename T, size_t N>
+class SmallVector {
+    public:
+        /// Type of the elements
+        typedef T value_type;
+        /// Reference to an element
+        typedef T& reference;
+        /// Constant reference to an element
+        typedef const T& const_reference;
+        /// Pointer to an element
+        typedef T* pointer;
+        /// Constant pointer to an element
+        typedef const T* const_pointer;
+        /// Iterator over the elements
+        typedef T* iterator;
+        /// Constant iterator over the elements
+        typedef const T* const_iterator;
+        /// Reverse iterator over the elements
+        typedef std::reverse_iterator<iterator> reverse_iterator;
+        /// Constant reverse iterator over the elements
+        typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+        /// Type of sizes
+        typedef size_t size_type;
+        /// Type of differences between iterators
+        typedef std::ptrdiff_t difference_type;
+
+    private:
+        /// Points to the first element (either \a _buf or memory allocated on the heap)
+        T *_begin;
+        /// Number of elements
+        size_t _size;
+        /// Number of elements that fit in the memory pointed to by \a _begin
+        size_t _capacity;
+        /// Inline buffer
+        T _buf[N > 0 ? N : 1];
+
+        /// Returns \c true if the elements are stored in the inline buffer
+        bool isInline() const { return _begin == _buf; }
+
+        /// Makes sure that at least \a n elements fit without reallocating
+        void grow( size_t n ) {
+            if( n <= _capacity )
+                return;
+            size_t cap = std::max( n, 2 * _capacity );
+            T *p = static_cast<T *>( MemoryPool::allocateCurrent( cap * sizeof(T) ) );
+            std::copy( _begin, _begin + _size, p );
+            if( !isInline() )
+                MemoryPool::deallocate( _begin );
+            _begin = p;
+            _capacity = cap;
+        }
+
+    public:
+    /// \name Constructors and destructors
+    //@{
+        /// Constructs empty vector
+        SmallVector() : _begin(_buf), _size(0), _capacity(N) {}
+
+        /// Constructs vector of length \a n with each element set to \a x
+        explicit SmallVector( size_t n, const T &x = T() ) : _begin(_buf), _size(0), _capacity(N) {
+            resize( n, x );
+        }
+
+        /// Copy constructor
+        SmallVector( const SmallVector &x ) : _begin(_buf), _size(0), _capacity(N) {
+            grow( x._size );
+            std::copy( x._begin, x._begin + x._size, _begin );
+            _size = x._size;
+        }
+
+        /// Assignment operator (only allocates memory if \a x does not fit in the current capacity)
+        SmallVector& operator=( const SmallVector &x ) {
+            if( this != &x ) {
+                grow( x._size );
+                std::copy( x._begin, x._begin + x._size, _begin );
+                _size = x._size;
+            }
+            return *this;
+        }
+
+        /// Destructor
+        ~SmallVector() {
+            if( !isInline() )
+                MemoryPool::deallocate( _begin );
+        }
+    //@}
+
+    /// \name Iterator interface
+    //@{
+        /// Returns iterator that points to the first element
+        iterator begin() { return _begin; }
+        /// Returns constant iterator that points to the first element
+        const_iterator begin() const { return _begin; }
+        /// Returns iterator that points beyond the last element
+        iterator end() { return _begin + _size; }
+        /// Returns constant iterator that points beyond the last element
+        const_iterator end() const { return _begin + _size; }
+        /// Returns reverse iterator that points to the last element
+        reverse_iterator rbegin() { return reverse_iterator( end() ); }
+        /// Returns constant reverse iterator that points to the last element
+        const_reverse_iterator rbegin() const { return const_reverse_iterator( end() ); }
+        /// Returns reverse iterator that points beyond the first element
+        reverse_iterator rend() { return reverse_iterator( begin() ); }
+        /// Returns constant reverse iterator that points beyond the first element
+        const_reverse_iterator rend() const { return const_reverse_iterator( begin() ); }
+    //@}
+
+    /// \name Element access
+    //@{
+        /// Returns reference to \a i 'th element
+        T& operator[]( size_t i ) { return _begin[i]; }
+        /// Returns constant reference to \a i 'th element
+        const T& operator[]( size_t i ) const { return _begin[i]; }
+        /// Returns reference to \a i 'th element, checking the index
+        /** \throw std::out_of_range if \a i >= size()
+         */
+        T& at( size_t i ) {
+            if( i >= _size )
+                throw std::out_of_range( "SmallVector::at" );
+            return _begin[i];
+        }
+        /// Returns constant reference to \a i 'th element, checking the index
+        /** \throw std::out_of_range if \a i >= size()
+         */
+        const T& at( size_t i ) const {
+            if( i >= _size )
+                throw std::out_of_range( "SmallVector::at" );
+            return _begin[i];
+        }
+        /// Returns reference to first element
+        T& front() { return _begin[0]; }
+        /// Returns constant reference to first element
+        const T& front() const { return _begin[0]; }
+        /// Returns reference to last element
+        T& back() { return _begin[_size - 1]; }
+        /// Returns constant reference to last element
+        const T& back() const { return _begin[_size - 1]; }
+    //@}
+
+    /// \name Queries
+    //@{
+        /// Returns number of elements
+        size_t size() const { return _size; }
+        /// Returns \c true if there are no elements
+        bool empty() const { return _size == 0; }
+        /// Returns the number of elements that fit without reallocating
+        size_t capacity() const { return _capacity; }
+        /// Returns \c true if the elements are stored on the heap
+        bool onHeap() const { return !isInline(); }
+    //@}
+
+    /// \name Modifiers
+    //@{
+        /// Makes sure that at least \a n elements fit without reallocating
+        void reserve( size_t n ) { grow( n ); }
+
+        /// Changes the number of elements to \a n, setting new elements to \a x
+        void resize( size_t n, const T &x = T() ) {
+            grow( n );
+            if( n > _size )
+                std::fill( _begin + _size, _begin + n, x );
+            _size = n;
+        }
+
+        /// Removes all elements (but keeps the allocated memory)
+        void clear() { _size = 0; }
+
+        /// Appends \a x
+        void push_back( const T &x ) {
+            if( _size == _capacity )
+                grow( _size + 1 );
+            _begin[_size++] = x;
+        }
+
+        /// Removes the last element
+        void pop_back() { _size--; }
+
+        /// Inserts \a x before \a pos and returns an iterator that points to the inserted element
+        iterator insert( iterator pos, const T &x ) {
+            size_t offset = pos - _begin;
+            T y = x; // \a x may refer to an element
+            if( _size == _capacity )
+                grow( _size + 1 );
+            std::copy_backward( _begin + offset, _begin + _size, _begin + _size + 1 );
+            _begin[offset] = y;
+            _size++;
+            return _begin + offset;
+        }
+
+        /// Inserts the elements in the range [\a first, \a last) before \a pos
+        /** \tparam TIterator Forward iterator over instances that can be cast to \a T
+         */
+        template <typename TIterator>
+        void insert( iterator pos, TIterator first, TIterator last ) {
+            size_t offset = pos - _begin;
+            size_t n = std::distance( first, last );
+            grow( _size + n );
+            std::copy_backward( _begin + offset, _begin + _size, _begin + _size + n );
+            for( T *p = _begin + offset; first != last; ++first, ++p )
+                *p = *first;
+            _size += n;
+        }
+
+        /// Erases the element at \a pos and returns an iterator that points to the next element
+        iterator erase( iterator pos ) {
+            return erase( pos, pos + 1 );
+        }
+
+        /// Erases the elements in the range [\a first, \a last) and returns an iterator that points to the next element
+        iterator erase( iterator first, iterator last ) {
+            std::copy( last, end(), first );
+            _size -= last - first;
+            return first;
+        }
+
+        /// Replaces the elements by those in the range [\a first, \a last)
+        template <typename TIterator>
+        void assign( TIterator first, TIterator last ) {
+            clear();
+            insert( begin(), first, last );
+        }
+
+        /// Exchanges the elements of \c *this and \a x
+        void swap( SmallVector &x ) {
+            SmallVector tmp( *this );
+            *this = x;
+            x = tmp;
+        }
+    //@}
+
+    /// \name Comparison
+    //@{
+        /// Returns \c true if \c *this and \a x have the same elements
+        bool operator==( const SmallVector &x ) const {
+            return _size == x._size && std::equal( begin(), end(), x.begin() );
+        }
+        /// Returns \c true if \c *this and \a x differ
+        bool operator!=( const SmallVector &x ) const { return !(*this == x); }
+        /// Lexicographical comparison
+        bool operator<( const SmallVector &x ) const {
+            return std::lexicographical_compare( begin(), end(), x.begin(), x.end() );
+        }
+    //@}
+};
+
+
+} // end of namespace dai
+
+
+#endif
@@ -0,0 +1,457 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+/// \file
+/// \brief Defines TSparseFactor<> and SparseFactor classes which represent factors with mostly zero values.
+
+
+#ifndef __defined_libdai_sparsefactor_h
+#define __defined_libdai_sparsefactor_h
+
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <dai/factor.h>
+#include <dai/index.h>
+#include <dai/varset.h>
+#include <dai/util.h>
+
+
+namespace dai {
+
+
+/// Represents a (probability) factor that stores only its nonzero values.
+/** A TSparseFactor<T> represents the same mathematical object as a TFactor<T>, but instead of
+ *  a dense vector containing the value of each joint state, it stores the linear indices of
+ *  the joint states with nonzero value (sorted in increasing order) together with these values;
+ *  all other values are zero. This saves memory and time for factors that are mostly zero, such as
+ *  deterministic conditional probability tables and factors that are the result of clamping.
+ *
+ *  The linear indices are the same as those of TFactor<T> (see dai::calcLinearState()), and
+ *  conversion in both directions is possible. Products, marginals, max-marginals and slices
+ *  are calculated on the sparse representation directly, with costs that scale with the number of
+ *  nonzero values rather than with the number of joint states. Values that become zero are dropped.
+ *
+ *  \tparam T Should be a scalar that is castable from and to double and should support elementary arithmetic operations.
+ */
+template <typename T>
+class TSparseFactor {
+    private:
+        /// Stores the variables on which the factor depends
+        VarSet _vs;
+        /// Stores the linear indices of the nonzero values (in increasing order)
+        std::vector<size_t> _idx;
+        /// Stores the nonzero values
+        std::vector<T> _val;
+
+        /// Type of an entry (a linear index and a value)
+        typedef std::pair<size_t, T> Entry;
+
+        /// Compares entries by their linear index only
+        struct EntryLess {
+            /// Returns \c true if the linear index of \a a is smaller than that of \a b
+            bool operator()( const Entry &a, const Entry &b ) const { return a.first < b.first; }
+        };
+
+        /// Replaces the values by the nonzero values in \a entries, which should be sorted by linear index (without duplicates)
+        void assign( const std::vector<Entry> &entries ) {
+            _idx.clear();
+            _val.clear();
+            _idx.reserve( entries.size() );
+            _val.reserve( entries.size() );
+            for( size_t k = 0; k < entries.size(); k++ )
+                if( entries[k].second != (T)0 ) {
+                    _idx.push_back( entries[k].first );
+                    _val.push_back( entries[k].second );
+                }
+        }
+
+        /// Removes the values that are zero
+        void removeZeros() {
+            size_t n = 0;
+            for( size_t k = 0; k < _idx.size(); k++ )
+                if( _val[k] != (T)0 ) {
+                    _idx[n] = _idx[k];
+                    _val[n] = _val[k];
+                    n++;
+                }
+            _idx.resize( n );
+            _val.resize( n );
+        }
+
+        /// Accumulates the values onto \a vars using \a acc (which should satisfy <tt>acc(0,x) == x</tt> for nonzero \a x)
+        template<typename accOp> TSparseFactor<T> accumulate( const VarSet &vars, accOp acc ) const;
+
+    public:
+    /// \name Constructors and destructors
+    //@{
+        /// Constructs factor depending on no variables with value \a p
+        TSparseFactor( T p = 1 ) : _vs(), _idx(), _val() {
+            if( p != (T)0 ) {
+                _idx.push_back( 0 );
+                _val.push_back( p );
+            }
+        }
+
+        /// Constructs factor depending on variables in \a vars with all values set to zero
+        explicit TSparseFactor( const VarSet &vars ) : _vs(vars), _idx(), _val() {}
+
+        /// Constructs factor from the nonzero values of the dense factor \a f
+        explicit TSparseFactor( const TFactor<T> &f ) : _vs(f.vars()), _idx(), _val() {
+            size_t nnz = 0;
+            for( size_t i = 0; i < f.nrStates(); i++ )
+                if( f[i] != (T)0 )
+                    nnz++;
+            _idx.reserve( nnz );
+            _val.reserve( nnz );
+            for( size_t i = 0; i < f.nrStates(); i++ )
+                if( f[i] != (T)0 ) {
+                    _idx.push_back( i );
+                    _val.push_back( f[i] );
+                }
+        }
+
+        /// Constructs factor depending on variables in \a vars with the values \a val at the linear indices \a idx
+        /** \pre \a idx should be sorted in increasing order and \a idx.size() == \a val.size()
+         */
+        TSparseFactor( const VarSet &vars, const std::vector<size_t> &idx, const std::vector<T> &val ) : _vs(vars), _idx(idx), _val(val) {
+            DAI_ASSERT( _idx.size() == _val.size() );
+            removeZeros();
+        }
+    //@}
+
+    /// \name Conversion
+    //@{
+        /// Returns the dense factor with the same values
+        TFactor<T> toFactor() const {
+            TFactor<T> f( _vs, (T)0 );
+            for( size_t k = 0; k < _idx.size(); k++ )
+                f.set( _idx[k], _val[k] );
+            return f;
+        }
+    //@}
+
+    /// \name Get/set individual entries
+    //@{
+        /// Sets \a i 'th entry to \a val
+        void set( size_t i, T val ) {
+            DAI_DEBASSERT( i < nrStates() );
+            std::vector<size_t>::iterator it = std::lower_bound( _idx.begin(), _idx.end(), i );
+            size_t k = it - _idx.begin();
+            if( it != _idx.end() && *it == i ) {
+                if( val != (T)0 )
+                    _val[k] = val;
+                else {
+                    _idx.erase( it );
+                    _val.erase( _val.begin() + k );
+                }
+            } else if( val != (T)0 ) {
+                _idx.insert( it, i );
+                _val.insert( _val.begin() + k, val );
+            }
+        }
+
+        /// Gets \a i 'th entry
+        T get( size_t i ) const { return (*this)[i]; }
+
+        /// Returns a copy of the \a i 'th entry
+        T operator[]( size_t i ) const {
+            std::vector<size_t>::const_iterator it = std::lower_bound( _idx.begin(), _idx.end(), i );
+            if( it != _idx.end() && *it == i )
+                return _val[it - _idx.begin()];
+            else
+                return (T)0;
+        }
+    //@}
+
+    /// \name Queries
+    //@{
+        /// Returns constant reference to variable set (i.e., the variables on which the factor depends)
+        const VarSet& vars() const { return _vs; }
+
+        /// Returns the number of possible joint states of the variables on which the factor depends
+        size_t nrStates() const { return BigInt_size_t( _vs.nrStates() ); }
+
+        /// Returns the number of nonzero values
+        size_t nrNonZeros() const { return _idx.size(); }
+
+        /// Returns the fraction of the values that is nonzero
+        Real density() const { return (Real)nrNonZeros() / (Real)nrStates(); }
+
+        /// Returns the linear indices of the nonzero values (in increasing order)
+        const std::vector<size_t>& indices() const { return _idx; }
+
+        /// Returns the nonzero values (in the same order as indices())
+        const std::vector<T>& values() const { return _val; }
+
+        /// Returns sum of all values
+        T sum() const {
+            T s = 0;
+            for( size_t k = 0; k < _val.size(); k++ )
+                s += _val[k];
+            return s;
+        }
+
+        /// Returns maximum of all values
+        T max() const {
+            T m = _val.size() < nrStates() ? (T)0 : -INFINITY;
+            for( size_t k = 0; k < _val.size(); k++ )
+                if( _val[k] > m )
+                    m = _val[k];
+            return m;
+        }
+
+        /// Comparison
+        bool operator==( const TSparseFactor<T> &y ) const {
+            return (_vs == y._vs) && (_idx == y._idx) && (_val == y._val);
+        }
+    //@}
+
+    /// \name Unary operations
+    //@{
+        /// Normalizes factor such that the values sum to one
+        /** \throw NOT_NORMALIZABLE if the sum is zero
+         */
+        T normalize() {
+            T Z = sum();
+            if( Z == (T)0 )
+                DAI_THROW(NOT_NORMALIZABLE);
+            *this /= Z;
+            return Z;
+        }
+
+        /// Returns normalized copy of \c *this
+        /** \throw NOT_NORMALIZABLE if the sum is zero
+         */
+        TSparseFactor<T> normalized() const {
+            TSparseFactor<T> result( *this );
+            result.normalize();
+            return result;
+        }
+    //@}
+
+    /// \name Operations with scalars
+    //@{
+        /// Multiplies each value with scalar \a x
+        TSparseFactor<T>& operator*= (T x) {
+            if( x == (T)0 ) {
+                _idx.clear();
+                _val.clear();
+            } else
+                for( size_t k = 0; k < _val.size(); k++ )
+                    _val[k] *= x;
+            return *this;
+        }
+
+        /// Divides each value by scalar \a x
+        TSparseFactor<T>& operator/= (T x) {
+            for( size_t k = 0; k < _val.size(); k++ )
+                _val[k] /= x;
+            return *this;
+        }
+    //@}
+
+    /// \name Operations with other factors
+    //@{
+        /// Multiplies \c *this with the sparse factor \a g
+        /** The result depends on the union of the variables of both factors.
+         */
+        TSparseFactor<T>& operator*= (const TSparseFactor<T> &g);
+
+        /// Multiplies \c *this with the dense factor \a g
+        /** The result depends on the union of the variables of both factors; it is computed
+         *  most efficiently if the variables of \a g are a subset of those of \c *this.
+         */
+        TSparseFactor<T>& operator*= (const TFactor<T> &g);
+
+        /// Returns product of \c *this with the sparse factor \a g
+        TSparseFactor<T> operator* (const TSparseFactor<T> &g) const {
+            TSparseFactor<T> result( *this );
+            result *= g;
+            return result;
+        }
+
+        /// Returns product of \c *this with the dense factor \a g
+        TSparseFactor<T> operator* (const TFactor<T> &g) const {
+            TSparseFactor<T> result( *this );
+            result *= g;
+            return result;
+        }
+    //@}
+
+    /// \name Miscellaneous operations
+    //@{
+        /// Returns a slice of \c *this, where the subset \a vars is in state \a varsState
+        /** \pre \a vars sould be a subset of vars()
+         *  \pre \a varsState < vars.nrStates()
+         *  \see TFactor<T>::slice()
+         */
+        TSparseFactor<T> slice( const VarSet &vars, size_t varsState ) const {
+            DAI_ASSERT( vars << _vs );
+            VarSet varsrem = _vs / vars;
+            TSparseFactor<T> result( varsrem );
+            IndexMap toVars( _vs, vars ), toRem( _vs, varsrem );
+            // fixing the state of vars preserves the ordering of the remaining linear indices
+            for( size_t k = 0; k < _idx.size(); k++ )
+                if( toVars( _idx[k] ) == varsState ) {
+                    result._idx.push_back( toRem( _idx[k] ) );
+                    result._val.push_back( _val[k] );
+                }
+            return result;
+        }
+
+        /// Returns marginal on \a vars, obtained by summing out all variables except those in \a vars, and normalizing the result if \a normed == \c true
+        /** The values of each joint state of \a vars are summed in the same order as by TFactor<T>::marginal().
+         */
+        TSparseFactor<T> marginal( const VarSet &vars, bool normed = true ) const {
+            TSparseFactor<T> res = accumulate( vars, std::plus<T>() );
+            if( normed )
+                res.normalize();
+            return res;
+        }
+
+        /// Returns max-marginal on \a vars, obtained by maximizing all variables except those in \a vars, and normalizing the result if \a normed == \c true
+        /** \pre All values should be nonnegative
+         */
+        TSparseFactor<T> maxMarginal( const VarSet &vars, bool normed = true ) const {
+            TSparseFactor<T> res = accumulate( vars, fo_max<T>() );
+            if( normed )
+                res.normalize();
+            return res;
+        }
+    //@}
+};
+
+
+template<typename T> template<typename accOp> TSparseFactor<T> TSparseFactor<T>::accumulate( const VarSet &vars, accOp acc ) const {
+    VarSet res_vars = vars & _vs;
+    IndexMap proj( _vs, res_vars );
+
+    // sort the entries by their linear index in res_vars, keeping the original order of equal indices
+    std::vector<Entry> entries;
+    entries.reserve( _idx.size() );
+    for( size_t k = 0; k < _idx.size(); k++ )
+        entries.push_back( Entry( proj( _idx[k] ), _val[k] ) );
+    std::stable_sort( entries.begin(), entries.end(), EntryLess() );
+
+    // combine the values of equal indices
+    std::vector<Entry> combined;
+    for( size_t k = 0; k < entries.size(); k++ ) {
+        if( combined.empty() || combined.back().first != entries[k].first )
+            combined.push_back( Entry( entries[k].first, acc( (T)0, entries[k].second ) ) );
+        else
+            combined.back().second = acc( combined.back().second, entries[k].second );
+    }
+
+    TSparseFactor<T> res( res_vars );
+    res.assign( combined );
+    return res;
+}
+
+
+template<typename T> TSparseFactor<T>& TSparseFactor<T>::operator*= (const TSparseFactor<T> &g) {
+    if( g._vs << _vs ) {
+        // the result has the same nonzero pattern as *this, or a subset of it
+        IndexMap proj( _vs, g._vs );
+        for( size_t k = 0; k < _idx.size(); k++ )
+            _val[k] *= g[proj( _idx[k] )];
+        removeZeros();
+        return *this;
+    }
+
+    VarSet shared = _vs & g._vs;
+    VarSet res_vars = _vs | g._vs;
+    IndexMap fKey( _vs, shared ), gKey( g._vs, shared );
+    IndexMap fRes( _vs, res_vars ), gRes( g._vs, res_vars ), sharedRes( shared, res_vars );
+
+    // sort the entries of g by the joint state of the shared variables
+    std::vector<std::pair<size_t, size_t> > gByKey;
+    gByKey.reserve( g._idx.size() );
+    for( size_t l = 0; l < g._idx.size(); l++ )
+        gByKey.push_back( std::make_pair( gKey( g._idx[l] ), l ) );
+    std::sort( gByKey.begin(), gByKey.end() );
+
+    // join the entries of *this and g that agree on the shared variables
+    std::vector<Entry> entries;
+    for( size_t k = 0; k < _idx.size(); k++ ) {
+        size_t key = fKey( _idx[k] );
+        size_t base = fRes( _idx[k] ) - sharedRes( key );
+        std::vector<std::pair<size_t, size_t> >::const_iterator it = std::lower_bound( gByKey.begin(), gByKey.end(), std::make_pair( key, (size_t)0 ) );
+        for( ; it != gByKey.end() && it->first == key; ++it ) {
+            size_t l = it->second;
+            entries.push_back( Entry( base + gRes( g._idx[l] ), _val[k] * g._val[l] ) );
+        }
+    }
+    std::sort( entries.begin(), entries.end(), EntryLess() );
+
+    _vs = res_vars;
+    assign( entries );
+    return *this;
+}
+
+
+template<typename T> TSparseFactor<T>& TSparseFactor<T>::operator*= (const TFactor<T> &g) {
+    if( g.vars() << _vs ) {
+        // the result has the same nonzero pattern as *this, or a subset of it
+        IndexMap proj( _vs, g.vars() );
+        for( size_t k = 0; k < _idx.size(); k++ )
+            _val[k] *= g[proj( _idx[k] )];
+        removeZeros();
+        return *this;
+    }
+
+    // each nonzero value of *this is multiplied with all values of g that agree on the shared variables
+    VarSet extra = g.vars() / _vs;
+    VarSet res_vars = _vs | g.vars();
+    size_t nrExtra = BigInt_size_t( extra.nrStates() );
+    IndexMap fG( _vs, g.vars() ), extraG( extra, g.vars() );
+    IndexMap fRes( _vs, res_vars ), extraRes( extra, res_vars );
+    std::vector<size_t> extraGIdx( nrExtra ), extraResIdx( nrExtra );
+    for( size_t s = 0; s < nrExtra; s++ ) {
+        extraGIdx[s] = extraG( s );
+        extraResIdx[s] = extraRes( s );
+    }
+
+    std::vector<Entry> entries;
+    entries.reserve( _idx.size() * nrExtra );
+    for( size_t k = 0; k < _idx.size(); k++ ) {
+        size_t gBase = fG( _idx[k] );
+        size_t resBase = fRes( _idx[k] );
+        for( size_t s = 0; s < nrExtra; s++ )
+            entries.push_back( Entry( resBase + extraResIdx[s], _val[k] * g[gBase + extraGIdx[s]] ) );
+    }
+    std::sort( entries.begin(), entries.end(), EntryLess() );
+
+    _vs = res_vars;
+    assign( entries );
+    return *this;
+}
+
+
+/// Writes a sparse factor to an output stream
+/** \relates TSparseFactor
+ */
+template<typename T> std::ostream& operator<< (std::ostream& os, const TSparseFactor<T>& f) {
+    os << "(" << f.vars() << ", {";
+    for( size_t k = 0; k < f.nrNonZeros(); k++ )
+        os << (k == 0 ? "" : ", ") << f.indices()[k] << ":" << f.values()[k];
+    os << "})";
+    return os;
+}
+
+
+/// Represents a sparse factor with values of type dai::Real.
+typedef TSparseFactor<Real> SparseFactor;
+
+
+} // end of namespace dai
+
+
+#endif
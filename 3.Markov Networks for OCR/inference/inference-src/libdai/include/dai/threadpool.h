@@ -0,0 +1,158 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+/// \file
+/// \brief Defines the ThreadPool class, which executes jobs on several threads, the MutexArray class and the partitionWork() function
+
+
+#ifndef __defined_libdai_threadpool_h
+#define __defined_libdai_threadpool_h
+
+
+#include <cstddef>
+#include <vector>
+
+
+namespace dai {
+
+
+/// Pool of worker threads that execute a job in parallel
+/** A ThreadPool with \a n threads consists of the calling thread and \a n - 1 worker threads,
+ *  which are started by the constructor and wait until they are given a job. run() executes
+ *  a job in all threads simultaneously, each thread getting its own index, and returns when
+ *  all threads have finished. Jobs typically process the part of the work that partitionWork()
+ *  has assigned to their thread.
+ *
+ *  Each worker thread has its own MemoryPool, which is the current pool of that thread, so that
+ *  the temporaries of jobs are recycled as well; memory that is allocated by a job should be
+ *  released by the same job.
+ *
+ *  If libDAI was built without DAI_WITH_THREADS, no worker threads are started and run()
+ *  executes the job for each thread index in turn in the calling thread.
+ */
+class ThreadPool {
+    public:
+        /// Job that can be executed by a ThreadPool
+        class Job {
+            public:
+                /// Virtual destructor
+                virtual ~Job() {}
+
+                /// Executes the part of the job that belongs to thread \a thread
+                virtual void run( size_t thread ) = 0;
+        };
+
+    private:
+        /// Threads, synchronization primitives and memory pools of the workers
+        struct Impl;
+
+        /// Number of threads
+        size_t _nrThreads;
+        /// Implementation (NULL if there are no worker threads)
+        Impl *_impl;
+
+        /// Copying is not allowed
+        ThreadPool( const ThreadPool & );
+        /// Assignment is not allowed
+        ThreadPool& operator=( const ThreadPool & );
+
+    public:
+    /// \name Constructors and destructors
+    //@{
+        /// Constructs a pool of \a nrThreads threads (including the calling thread)
+        explicit ThreadPool( size_t nrThreads );
+
+        /// Destructor (stops the worker threads)
+        ~ThreadPool();
+    //@}
+
+    /// \name Queries
+    //@{
+        /// Returns the number of threads (including the calling thread)
+        size_t nrThreads() const { return _nrThreads; }
+
+        /// Returns \c true if libDAI was built with support for multithreading (DAI_WITH_THREADS)
+        static bool multithreaded();
+    //@}
+
+        /// Executes <tt>job.run( t )</tt> for each thread index \a t < nrThreads(), and waits until all threads have finished
+        /** The calling thread executes <tt>job.run( 0 )</tt>.
+         *  \throw Exception if a thread throws an exception; if several threads do, the exception thrown
+         *  by the thread with the smallest index is rethrown (which corresponds with the first part of the work)
+         */
+        void run( Job &job );
+};
+
+
+/// Array of mutexes, which protect parts of a data structure that is shared by the threads of a ThreadPool
+/** If libDAI was built without DAI_WITH_THREADS, locking and unlocking do nothing.
+ */
+class MutexArray {
+    private:
+        /// The mutexes
+        struct Impl;
+
+        /// Number of mutexes
+        size_t _size;
+        /// Implementation (NULL if there are no mutexes)
+        Impl *_impl;
+
+        /// Copying is not allowed
+        MutexArray( const MutexArray & );
+        /// Assignment is not allowed
+        MutexArray& operator=( const MutexArray & );
+
+    public:
+        /// Locks a mutex of a MutexArray during its lifetime
+        class ScopedLock {
+            private:
+                /// The array
+                MutexArray &_mutexes;
+                /// Index of the locked mutex
+                size_t _k;
+
+            public:
+                /// Locks mutex \a k of \a mutexes
+                ScopedLock( MutexArray &mutexes, size_t k ) : _mutexes(mutexes), _k(k) { _mutexes.lock( _k ); }
+                /// Unlocks the mutex
+                ~ScopedLock() { _mutexes.unlock( _k ); }
+        };
+
+    /// \name Constructors and destructors
+    //@{
+        /// Constructs an array of \a size mutexes
+        explicit MutexArray( size_t size = 0 );
+
+        /// Destructor
+        ~MutexArray();
+    //@}
+
+        /// Returns the number of mutexes
+        size_t size() const { return _size; }
+
+        /// Locks mutex \a k (waits until it is available)
+        void lock( size_t k );
+
+        /// Unlocks mutex \a k, which should have been locked by the calling thread
+        void unlock( size_t k );
+};
+
+
+/// Partitions a sequence of work items into \a nrParts consecutive parts of approximately equal total weight
+/** \param weights The weight (amount of work) of each item
+ *  \param nrParts The number of parts
+ *  \returns The boundaries of the parts: part \a t consists of the items with indices in
+ *  <tt>[result[t], result[t+1])</tt>; \a result has \a nrParts + 1 elements
+ */
+std::vector<size_t> partitionWork( const std::vector<size_t> &weights, size_t nrParts );
+
+
+} // end of namespace dai
+
+
+#endif
@@ -121,6 +121,13 @@ class TRWBP : public BP {
          */
         virtual Prob calcIncomingMessageProduct( size_t I, bool without_i, size_t i ) const;
 
+        /// Calculate the updated messages from factor \a I to all its neighbors (except variable \a i if \a without_i == \c true) one by one
+        virtual void calcNewMessages( size_t I, bool without_i, size_t i ) {
+            bforeach( const Neighbor &j, nbF(I) )
+                if( !(without_i && (j == i)) )
+                    calcNewMessage( j, j.dual );
+        }
+
         /// Calculates unnormalized belief of variable \a i
         virtual void calcBeliefV( size_t i, Prob &p ) const;
 
@@ -22,6 +22,7 @@
 #include <boost/foreach.hpp>
 #include <boost/functional/hash.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/cstdint.hpp>
 #include <algorithm>
 #include <cerrno>
 #include <gmpxx.h>
@@ -77,8 +78,13 @@
 namespace dai {
 
 
+#ifdef DAI_SINGLE
+/// Real number (alias for \c float, because libDAI was built with DAI_SINGLE defined)
+typedef float Real;
+#else
 /// Real number (alias for \c double, which could be changed to <tt>long double</tt> if necessary)
 typedef double Real;
+#endif
 
 /// Arbitrary precision integer number
 typedef mpz_class BigInt;
@@ -89,6 +95,191 @@ inline size_t BigInt_size_t( const BigInt &N ) {
     return N.get_ui();
 }
 
+
+/// Non-negative integer that is stored as a 64-bit integer as long as it fits, and as a BigInt otherwise
+/** Numbers of joint states (VarSet::nrStates()) and linear states (State) may exceed the range
+ *  of any built-in integer type, but in practice they nearly always fit in 64 bits. A FastBigInt
+ *  uses overflow-checked 64-bit arithmetic and only switches to a BigInt (whose arithmetic
+ *  allocates heap memory) when a result does not fit; it switches back when the value fits
+ *  again after a division.
+ */
+class FastBigInt {
+    public:
+        /// Type of the 64-bit representation
+        typedef boost::uint64_t small_type;
+
+    private:
+        /// Value (if it fits in 64 bits)
+        small_type _small;
+        /// Value (if it does not fit in 64 bits), or NULL
+        BigInt *_big;
+
+        /// Switches to the BigInt representation
+        void makeBig();
+        /// Switches to the 64-bit representation if the value fits
+        void makeSmall();
+
+    public:
+    /// \name Constructors and destructors
+    //@{
+        /// Constructs from a 64-bit integer
+        FastBigInt( small_type x = 0 ) : _small(x), _big(NULL) {}
+
+        /// Constructs from a BigInt (which should be non-negative)
+        explicit FastBigInt( const BigInt &x );
+
+        /// Copy constructor
+        FastBigInt( const FastBigInt &x ) : _small(x._small), _big(x._big ? new BigInt( *x._big ) : NULL) {}
+
+        /// Assignment operator
+        FastBigInt& operator=( const FastBigInt &x ) {
+            if( this != &x ) {
+                if( x._big ) {
+                    if( _big )
+                        *_big = *x._big;
+                    else
+                        _big = new BigInt( *x._big );
+                } else {
+                    delete _big;
+                    _big = NULL;
+                }
+                _small = x._small;
+            }
+            return *this;
+        }
+
+        /// Destructor
+        ~FastBigInt() { delete _big; }
+    //@}
+
+    /// \name Queries
+    //@{
+        /// Returns \c true if the value fits in 64 bits
+        bool isSmall() const { return _big == NULL; }
+
+        /// Returns the value, which should fit in 64 bits
+        small_type getSmall() const {
+            DAI_DEBASSERT( isSmall() );
+            return _small;
+        }
+
+        /// Returns the value as a BigInt
+        BigInt get() const;
+
+        /// Converts to a BigInt
+        operator BigInt() const { return get(); }
+
+        /// Returns -1, 0 or 1 if \c *this is smaller than, equal to or larger than \a x, respectively
+        int compare( const FastBigInt &x ) const {
+            if( !_big && !x._big )
+                return _small < x._small ? -1 : (_small > x._small ? 1 : 0);
+            else
+                return compareBig( x );
+        }
+
+        /// Implements compare() if at least one of the values does not fit in 64 bits
+        int compareBig( const FastBigInt &x ) const;
+    //@}
+
+    /// \name Arithmetic operations
+    //@{
+        /// Adds \a x
+        FastBigInt& operator+=( small_type x ) {
+            if( !_big && _small <= std::numeric_limits<small_type>::max() - x )
+                _small += x;
+            else
+                *this += FastBigInt( x ).get();
+            return *this;
+        }
+
+        /// Adds \a x
+        FastBigInt& operator+=( const FastBigInt &x ) {
+            if( x._big )
+                return *this += *x._big;
+            else
+                return *this += x._small;
+        }
+
+        /// Adds \a x
+        FastBigInt& operator+=( const BigInt &x );
+
+        /// Multiplies by \a x
+        FastBigInt& operator*=( small_type x ) {
+            if( !_big && (x == 0 || _small <= std::numeric_limits<small_type>::max() / x) )
+                _small *= x;
+            else
+                *this *= FastBigInt( x ).get();
+            return *this;
+        }
+
+        /// Multiplies by \a x
+        FastBigInt& operator*=( const FastBigInt &x ) {
+            if( x._big )
+                return *this *= *x._big;
+            else
+                return *this *= x._small;
+        }
+
+        /// Multiplies by \a x
+        FastBigInt& operator*=( const BigInt &x );
+
+        /// Divides by \a x (rounding down)
+        FastBigInt& operator/=( small_type x ) {
+            DAI_ASSERT( x != 0 );
+            if( !_big )
+                _small /= x;
+            else {
+                *_big /= FastBigInt( x ).get();
+                makeSmall();
+            }
+            return *this;
+        }
+
+        /// Returns the remainder of division by \a x
+        small_type operator%( small_type x ) const {
+            DAI_ASSERT( x != 0 );
+            if( !_big )
+                return _small % x;
+            else
+                return FastBigInt( BigInt( *_big % FastBigInt( x ).get() ) ).getSmall();
+        }
+
+        /// Increments by one (prefix)
+        FastBigInt& operator++() { return *this += (small_type)1; }
+    //@}
+
+    /// \name Comparison operators
+    //@{
+        /// Returns \c true if \a a and \a b are equal
+        friend bool operator==( const FastBigInt &a, const FastBigInt &b ) { return a.compare( b ) == 0; }
+        /// Returns \c true if \a a and \a b are not equal
+        friend bool operator!=( const FastBigInt &a, const FastBigInt &b ) { return a.compare( b ) != 0; }
+        /// Returns \c true if \a a is smaller than \a b
+        friend bool operator<( const FastBigInt &a, const FastBigInt &b ) { return a.compare( b ) < 0; }
+        /// Returns \c true if \a a is smaller than or equal to \a b
+        friend bool operator<=( const FastBigInt &a, const FastBigInt &b ) { return a.compare( b ) <= 0; }
+        /// Returns \c true if \a a is larger than \a b
+        friend bool operator>( const FastBigInt &a, const FastBigInt &b ) { return a.compare( b ) > 0; }
+        /// Returns \c true if \a a is larger than or equal to \a b
+        friend bool operator>=( const FastBigInt &a, const FastBigInt &b ) { return a.compare( b ) >= 0; }
+    //@}
+
+        /// Writes a FastBigInt to an output stream
+        friend std::ostream& operator<<( std::ostream &os, const FastBigInt &x ) {
+            if( x._big )
+                return os << *x._big;
+            else
+                return os << x._small;
+        }
+};
+
+
+/// Safe down-cast of a FastBigInt to size_t
+inline size_t BigInt_size_t( const FastBigInt &N ) {
+    DAI_ASSERT( N.isSmall() && N.getSmall() <= std::numeric_limits<std::size_t>::max() );
+    return (size_t)N.getSmall();
+}
+
 /// Returns true if argument is NAN (Not A Number)
 bool isnan( Real x );
 
@@ -126,9 +126,10 @@ class VarSet : public SmallSet<Var> {
          *  where variable \f$x_l\f$ has label \f$l\f$, and denoting by \f$S_l\f$ the
          *  number of possible values ("states") of variable \f$x_l\f$, the number of
          *  joint configurations of the variables in \f$\{x_l\}_{l\in L}\f$ is given by \f$\prod_{l\in L} S_l\f$.
+         *  The product is calculated with 64-bit arithmetic, unless it does not fit (see FastBigInt).
          */
-        BigInt nrStates() const {
-            BigInt states = 1;
+        FastBigInt nrStates() const {
+            FastBigInt states = 1;
             for( VarSet::const_iterator n = begin(); n != end(); n++ )
                 states *= n->states();
             return states;
@@ -0,0 +1,186 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+#include <cmath>
+#include <algorithm>
+#include <dai/accelerator.h>
+
+
+namespace dai {
+
+
+using namespace std;
+
+
+namespace {
+
+
+/// Relaxation factor of the damped update that is used when the history is cleared
+const Real fallbackOmega = 0.5;
+
+
+/// Returns \c true if both \a x and \a g are finite
+inline bool mixable( Real x, Real g ) {
+    return dai::abs( x ) < INFINITY && dai::abs( g ) < INFINITY;
+}
+
+
+/// Solves the symmetric positive semidefinite system \a A \a y = \a b of dimension \a m by Gaussian elimination with partial pivoting
+/** \a A is stored row by row and is overwritten. Returns \c false if the system is (numerically) singular.
+ */
+bool solve( vector<Real> &A, vector<Real> &b, size_t m, vector<Real> &y ) {
+    for( size_t k = 0; k < m; ++k ) {
+        size_t p = k;
+        for( size_t r = k + 1; r < m; ++r )
+            if( dai::abs( A[r * m + k] ) > dai::abs( A[p * m + k] ) )
+                p = r;
+        if( !(dai::abs( A[p * m + k] ) > 0.0) )
+            return false;
+        if( p != k ) {
+            for( size_t c = 0; c < m; ++c )
+                swap( A[k * m + c], A[p * m + c] );
+            swap( b[k], b[p] );
+        }
+        for( size_t r = k + 1; r < m; ++r ) {
+            Real l = A[r * m + k] / A[k * m + k];
+            for( size_t c = k; c < m; ++c )
+                A[r * m + c] -= l * A[k * m + c];
+            b[r] -= l * b[k];
+        }
+    }
+    y.assign( m, 0.0 );
+    for( size_t k = m; k-- > 0; ) {
+        Real s = b[k];
+        for( size_t c = k + 1; c < m; ++c )
+            s -= A[k * m + c] * y[c];
+        y[k] = s / A[k * m + k];
+    }
+    return true;
+}
+
+
+} // end of anonymous namespace
+
+
+Accelerator::Accelerator( Method method, size_t window, bool nonnegative ) : _method(method), _window(window), _nonnegative(nonnegative), _df(), _dg(), _next(0), _lastF(), _lastG(), _lastNorm(INFINITY), _nrRestarts(0) {
+    DAI_ASSERT( window > 0 );
+}
+
+
+void Accelerator::reset() {
+    clearHistory();
+    _lastF.clear();
+    _lastG.clear();
+    _lastNorm = INFINITY;
+}
+
+
+void Accelerator::clearHistory() {
+    _df.clear();
+    _dg.clear();
+    _next = 0;
+}
+
+
+void Accelerator::step( const std::vector<Real> &x, std::vector<Real> &g ) {
+    DAI_ASSERT( x.size() == g.size() );
+    if( _method == Method::NONE )
+        return;
+    const size_t n = x.size();
+
+    // the residual and its norm
+    vector<Real> f( n, 0.0 );
+    Real norm = 0.0;
+    for( size_t i = 0; i < n; ++i )
+        if( mixable( x[i], g[i] ) ) {
+            f[i] = g[i] - x[i];
+            norm += f[i] * f[i];
+        }
+    norm = std::sqrt( norm );
+
+    // store the differences with the previous iteration, unless the residual grew
+    bool fallback = false;
+    if( _lastF.size() == n ) {
+        if( norm > _lastNorm ) {
+            clearHistory();
+            _nrRestarts++;
+            fallback = true;
+        } else {
+            vector<Real> df( n, 0.0 ), dg( n, 0.0 );
+            for( size_t i = 0; i < n; ++i )
+                if( mixable( _lastG[i], g[i] ) ) {
+                    df[i] = f[i] - _lastF[i];
+                    dg[i] = g[i] - _lastG[i];
+                }
+            if( _df.size() < _window ) {
+                _df.push_back( df );
+                _dg.push_back( dg );
+            } else {
+                _df[_next].swap( df );
+                _dg[_next].swap( dg );
+            }
+            _next = (_next + 1) % _window;
+        }
+    } else
+        clearHistory();
+    _lastF.swap( f );
+    _lastG = g;
+    _lastNorm = norm;
+    const vector<Real> &fk = _lastF;
+
+    if( fallback ) {
+        // damped update
+        for( size_t i = 0; i < n; ++i )
+            if( mixable( x[i], g[i] ) )
+                g[i] = x[i] + fallbackOmega * fk[i];
+        return;
+    }
+
+    if( _df.empty() )
+        return;
+
+    // solve the normal equations of min_gamma |f - dF gamma|, regularized by a small multiple of the identity
+    const size_t m = _df.size();
+    vector<Real> A( m * m, 0.0 ), b( m, 0.0 ), gamma;
+    Real maxDiag = 0.0;
+    for( size_t r = 0; r < m; ++r ) {
+        for( size_t c = r; c < m; ++c ) {
+            Real s = 0.0;
+            for( size_t i = 0; i < n; ++i )
+                s += _df[r][i] * _df[c][i];
+            A[r * m + c] = A[c * m + r] = s;
+        }
+        maxDiag = std::max( maxDiag, A[r * m + r] );
+        Real s = 0.0;
+        for( size_t i = 0; i < n; ++i )
+            s += _df[r][i] * fk[i];
+        b[r] = s;
+    }
+    for( size_t r = 0; r < m; ++r )
+        A[r * m + r] += 1e-10 * maxDiag;
+    if( !solve( A, b, m, gamma ) ) {
+        clearHistory();
+        return;
+    }
+    vector<Real> next( g );
+    for( size_t r = 0; r < m; ++r )
+        for( size_t i = 0; i < n; ++i )
+            next[i] -= gamma[r] * _dg[r][i];
+
+    // reject iterates that are not finite or negative
+    for( size_t i = 0; i < n; ++i )
+        if( mixable( x[i], g[i] ) && (!(dai::abs( next[i] ) < INFINITY) || (_nonnegative && next[i] < 0.0)) ) {
+            clearHistory();
+            _nrRestarts++;
+            return;
+        }
+    g.swap( next );
+}
+
+
+} // end of namespace dai
@@ -0,0 +1,377 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <cmath>
+#include <dai/batchbp.h>
+#include <dai/util.h>
+
+
+namespace dai {
+
+
+using namespace std;
+
+
+void BatchBP::setProperties( const PropertySet &opts ) {
+    DAI_ASSERT( opts.hasKey("tol") );
+    DAI_ASSERT( opts.hasKey("updates") );
+
+    props.tol = opts.getStringAs<Real>("tol");
+    props.updates = opts.getStringAs<Properties::UpdateType>("updates");
+
+    if( opts.hasKey("maxiter") )
+        props.maxiter = opts.getStringAs<size_t>("maxiter");
+    else
+        props.maxiter = 10000;
+    if( opts.hasKey("verbose") )
+        props.verbose = opts.getStringAs<size_t>("verbose");
+    else
+        props.verbose = 0;
+    if( opts.hasKey("damping") )
+        props.damping = opts.getStringAs<Real>("damping");
+    else
+        props.damping = 0.0;
+    if( opts.hasKey("inference") )
+        props.inference = opts.getStringAs<Properties::InfType>("inference");
+    else
+        props.inference = Properties::InfType::SUMPROD;
+}
+
+
+PropertySet BatchBP::getProperties() const {
+    PropertySet opts;
+    opts.set( "tol", props.tol );
+    opts.set( "maxiter", props.maxiter );
+    opts.set( "verbose", props.verbose );
+    opts.set( "updates", props.updates );
+    opts.set( "damping", props.damping );
+    opts.set( "inference", props.inference );
+    return opts;
+}
+
+
+string BatchBP::printProperties() const {
+    stringstream s( stringstream::out );
+    s << "[";
+    s << "tol=" << props.tol << ",";
+    s << "maxiter=" << props.maxiter << ",";
+    s << "verbose=" << props.verbose << ",";
+    s << "updates=" << props.updates << ",";
+    s << "damping=" << props.damping << ",";
+    s << "inference=" << props.inference << "]";
+    return s.str();
+}
+
+
+BatchBP::BatchBP( const std::vector<FactorGraph> &fgs, const PropertySet &opts ) : props(), _fg(), _nrInstances(fgs.size()), _factorOffsets(), _factors(), _edgeOffsets(), _messageOffsets(), _messages(), _newMessages(), _indices(), _instances(), _positions(), _nrActive(0), _iters(), _maxDiffs(), _changes(), _products(), _values() {
+    DAI_ASSERT( !fgs.empty() );
+    setProperties( opts );
+    _fg = fgs[0];
+    const size_t N = _nrInstances;
+
+    // check that all instances have the same structure
+    for( size_t n = 1; n < N; ++n ) {
+        if( fgs[n].nrVars() != _fg.nrVars() || fgs[n].nrFactors() != _fg.nrFactors() )
+            DAI_THROWE(INCOMPATIBLE_FACTORGRAPHS,"Instance " + toString( n ) + " has a different number of variables or factors");
+        for( size_t i = 0; i < _fg.nrVars(); ++i )
+            if( fgs[n].var(i).label() != _fg.var(i).label() || fgs[n].var(i).states() != _fg.var(i).states() )
+                DAI_THROWE(INCOMPATIBLE_FACTORGRAPHS,"Instance " + toString( n ) + " has different variables");
+        for( size_t I = 0; I < _fg.nrFactors(); ++I )
+            if( fgs[n].factor(I).vars() != _fg.factor(I).vars() )
+                DAI_THROWE(INCOMPATIBLE_FACTORGRAPHS,"Instance " + toString( n ) + " has factors with different variables");
+    }
+
+    // store the factor values, with the instance index innermost
+    _factorOffsets.reserve( _fg.nrFactors() + 1 );
+    _factorOffsets.push_back( 0 );
+    for( size_t I = 0; I < _fg.nrFactors(); ++I )
+        _factorOffsets.push_back( _factorOffsets.back() + _fg.factor(I).nrStates() );
+    _factors.resize( _factorOffsets.back() * N );
+    for( size_t n = 0; n < N; ++n )
+        for( size_t I = 0; I < _fg.nrFactors(); ++I )
+            for( size_t s = 0; s < _fg.factor(I).nrStates(); ++s )
+                _factors[(_factorOffsets[I] + s) * N + n] = fgs[n].factor(I)[s];
+
+    // number the edges factor by factor
+    size_t maxProducts = 0;
+    _edgeOffsets.reserve( _fg.nrFactors() + 1 );
+    _edgeOffsets.push_back( 0 );
+    _messageOffsets.reserve( _fg.nrEdges() + 1 );
+    _messageOffsets.push_back( 0 );
+    _indices.reserve( _fg.nrEdges() );
+    for( size_t I = 0; I < _fg.nrFactors(); ++I ) {
+        size_t products = 0;
+        bforeach( const Neighbor &i, _fg.nbF(I) ) {
+            _messageOffsets.push_back( _messageOffsets.back() + _fg.var(i).states() );
+            _indices.push_back( IndexTable( _fg.var(i), _fg.factor(I).vars() ) );
+            products += _fg.var(i).states();
+        }
+        _edgeOffsets.push_back( _edgeOffsets.back() + _fg.nbF(I).size() );
+        maxProducts = std::max( maxProducts, products );
+    }
+    _messages.resize( _messageOffsets.back() * N );
+    _newMessages.resize( _messageOffsets.back() * N );
+    _products.resize( maxProducts * N );
+    _values.resize( N );
+    _changes.resize( N );
+
+    _instances.resize( N );
+    _positions.resize( N );
+    for( size_t n = 0; n < N; ++n )
+        _instances[n] = _positions[n] = n;
+
+    init();
+}
+
+
+void BatchBP::init() {
+    fill( _messages.begin(), _messages.end(), 1.0 );
+    fill( _newMessages.begin(), _newMessages.end(), 1.0 );
+    _nrActive = _nrInstances;
+    _iters.assign( _nrInstances, 0 );
+    _maxDiffs.assign( _nrInstances, 0.0 );
+}
+
+
+void BatchBP::calcNewMessages( size_t I ) {
+    const size_t N = _nrInstances, A = _nrActive;
+    const size_t nrStates = _fg.factor(I).nrStates();
+    const Real *f = &(_factors[_factorOffsets[I] * N]);
+    const size_t first = _edgeOffsets[I], last = _edgeOffsets[I + 1];
+
+    if( last - first == 1 ) {
+        // the message from a factor of a single variable is the factor itself
+        Real *m = &(_newMessages[_messageOffsets[first] * N]);
+        for( size_t s = 0; s < nrStates; ++s )
+            for( size_t n = 0; n < A; ++n )
+                m[s * N + n] = f[s * N + n];
+        return;
+    }
+
+    // calculate the product of the messages into each neighbor j, except the message from I
+    size_t offset = 0;
+    bforeach( const Neighbor &j, _fg.nbF(I) ) {
+        Real *p = &(_products[offset * N]);
+        size_t states = _fg.var(j).states();
+        for( size_t x = 0; x < states; ++x )
+            for( size_t n = 0; n < A; ++n )
+                p[x * N + n] = 1.0;
+        bforeach( const Neighbor &J, _fg.nbV(j) )
+            if( J != I ) {
+                const Real *m = &(_messages[_messageOffsets[edge( j, J.iter )] * N]);
+                for( size_t x = 0; x < states; ++x )
+                    for( size_t n = 0; n < A; ++n )
+                        p[x * N + n] *= m[x * N + n];
+            }
+        offset += states;
+    }
+
+    // calculate the message to each neighbor i
+    Real *v = &(_values[0]);
+    for( size_t e = first; e < last; ++e ) {
+        size_t states = _messageOffsets[e + 1] - _messageOffsets[e];
+        Real *marg = &(_newMessages[_messageOffsets[e] * N]);
+        for( size_t x = 0; x < states; ++x )
+            for( size_t n = 0; n < A; ++n )
+                marg[x * N + n] = 0.0;
+        for( size_t s = 0; s < nrStates; ++s ) {
+            const Real *fs = f + s * N;
+            for( size_t n = 0; n < A; ++n )
+                v[n] = fs[n];
+            offset = 0;
+            for( size_t e2 = first; e2 < last; ++e2 ) {
+                if( e2 != e ) {
+                    const Real *p = &(_products[(offset + _indices[e2][s]) * N]);
+                    for( size_t n = 0; n < A; ++n )
+                        v[n] *= p[n];
+                }
+                offset += _messageOffsets[e2 + 1] - _messageOffsets[e2];
+            }
+            Real *ms = marg + _indices[e][s] * N;
+            if( props.inference == Properties::InfType::SUMPROD )
+                for( size_t n = 0; n < A; ++n )
+                    ms[n] += v[n];
+            else
+                for( size_t n = 0; n < A; ++n )
+                    ms[n] = (v[n] > ms[n]) ? v[n] : ms[n];
+        }
+
+        // normalize
+        for( size_t n = 0; n < A; ++n )
+            v[n] = 0.0;
+        for( size_t x = 0; x < states; ++x )
+            for( size_t n = 0; n < A; ++n )
+                v[n] += marg[x * N + n];
+        for( size_t n = 0; n < A; ++n )
+            if( v[n] == 0.0 )
+                DAI_THROW(NOT_NORMALIZABLE);
+        for( size_t x = 0; x < states; ++x )
+            for( size_t n = 0; n < A; ++n )
+                marg[x * N + n] /= v[n];
+    }
+}
+
+
+void BatchBP::updateMessages( size_t I ) {
+    const size_t N = _nrInstances, A = _nrActive;
+    Real *c = &(_changes[0]);
+    for( size_t e = _edgeOffsets[I]; e < _edgeOffsets[I + 1]; ++e ) {
+        Real *m = &(_messages[_messageOffsets[e] * N]);
+        const Real *nm = &(_newMessages[_messageOffsets[e] * N]);
+        size_t size = (_messageOffsets[e + 1] - _messageOffsets[e]) * N;
+        for( size_t r = 0; r < size; r += N )
+            for( size_t n = 0; n < A; ++n ) {
+                Real x = nm[r + n];
+                if( props.damping != 0.0 )
+                    x = std::pow( m[r + n], props.damping ) * std::pow( x, 1.0 - props.damping );
+                Real d = dai::abs( x - m[r + n] );
+                c[n] = (c[n] > d) ? c[n] : d;
+                m[r + n] = x;
+            }
+    }
+}
+
+
+void BatchBP::swapPositions( size_t a, size_t b ) {
+    if( a == b )
+        return;
+    const size_t N = _nrInstances;
+    for( size_t r = 0; r < _factors.size(); r += N )
+        std::swap( _factors[r + a], _factors[r + b] );
+    for( size_t r = 0; r < _messages.size(); r += N ) {
+        std::swap( _messages[r + a], _messages[r + b] );
+        std::swap( _newMessages[r + a], _newMessages[r + b] );
+    }
+    std::swap( _changes[a], _changes[b] );
+    std::swap( _instances[a], _instances[b] );
+    _positions[_instances[a]] = a;
+    _positions[_instances[b]] = b;
+}
+
+
+Real BatchBP::run() {
+    if( props.verbose >= 1 )
+        cerr << "Starting " << identify() << "...";
+    if( props.verbose >= 3)
+        cerr << endl;
+
+    double tic = toc();
+
+    // do several passes over the network until all instances have converged
+    // or have reached the maximum number of iterations
+    size_t iter = 0;
+    while( _nrActive > 0 ) {
+        for( size_t p = 0; p < _nrActive; )
+            if( _iters[_instances[p]] >= props.maxiter )
+                swapPositions( p, --_nrActive );
+            else
+                ++p;
+        if( _nrActive == 0 )
+            break;
+
+        fill( _changes.begin(), _changes.begin() + _nrActive, 0.0 );
+        if( props.updates == Properties::UpdateType::PARALL ) {
+            for( size_t I = 0; I < _fg.nrFactors(); ++I )
+                calcNewMessages( I );
+            for( size_t I = 0; I < _fg.nrFactors(); ++I )
+                updateMessages( I );
+        } else {
+            for( size_t I = 0; I < _fg.nrFactors(); ++I ) {
+                calcNewMessages( I );
+                updateMessages( I );
+            }
+        }
+
+        // converged instances drop out
+        for( size_t p = 0; p < _nrActive; ) {
+            size_t n = _instances[p];
+            _iters[n]++;
+            _maxDiffs[n] = _changes[p];
+            if( _changes[p] <= props.tol )
+                swapPositions( p, --_nrActive );
+            else
+                ++p;
+        }
+
+        if( props.verbose >= 3 )
+            cerr << "BatchBP::run:  " << _nrActive << " of " << _nrInstances << " instances active after " << ++iter << " passes" << endl;
+    }
+
+    Real maxDiff = 0.0;
+    size_t nrConverged = 0;
+    for( size_t n = 0; n < _nrInstances; ++n ) {
+        maxDiff = std::max( maxDiff, _maxDiffs[n] );
+        if( _maxDiffs[n] <= props.tol )
+            nrConverged++;
+    }
+    if( props.verbose >= 1 ) {
+        if( props.verbose >= 3 )
+            cerr << "BatchBP::run:  ";
+        cerr << nrConverged << " of " << _nrInstances << " instances converged (" << toc() - tic << " seconds)." << endl;
+    }
+
+    return maxDiff;
+}
+
+
+Factor BatchBP::factor( size_t n, size_t I ) const {
+    const size_t N = _nrInstances, p = _positions[n];
+    Prob f( _fg.factor(I).nrStates() );
+    for( size_t s = 0; s < f.size(); ++s )
+        f.set( s, _factors[(_factorOffsets[I] + s) * N + p] );
+    return Factor( _fg.factor(I).vars(), f );
+}
+
+
+Factor BatchBP::beliefV( size_t n, size_t i ) const {
+    const size_t N = _nrInstances, p = _positions[n];
+    Prob b( _fg.var(i).states(), 1.0 );
+    bforeach( const Neighbor &I, _fg.nbV(i) ) {
+        const Real *m = &(_newMessages[_messageOffsets[edge( i, I.iter )] * N]);
+        for( size_t x = 0; x < b.size(); ++x )
+            b.set( x, b[x] * m[x * N + p] );
+    }
+    b.normalize();
+    return Factor( _fg.var(i), b );
+}
+
+
+Factor BatchBP::beliefF( size_t n, size_t I ) const {
+    const size_t N = _nrInstances, p = _positions[n];
+    Prob b = factor( n, I ).p();
+    for( size_t e = _edgeOffsets[I]; e < _edgeOffsets[I + 1]; ++e ) {
+        const Neighbor &j = _fg.nbF(I)[e - _edgeOffsets[I]];
+        Prob prod_j( _fg.var(j).states(), 1.0 );
+        bforeach( const Neighbor &J, _fg.nbV(j) )
+            if( J != I ) {
+                const Real *m = &(_messages[_messageOffsets[edge( j, J.iter )] * N]);
+                for( size_t x = 0; x < prod_j.size(); ++x )
+                    prod_j.set( x, prod_j[x] * m[x * N + p] );
+            }
+        for( size_t s = 0; s < b.size(); ++s )
+            b.set( s, b[s] * prod_j[_indices[e][s]] );
+    }
+    b.normalize();
+    return Factor( _fg.factor(I).vars(), b );
+}
+
+
+Real BatchBP::logZ( size_t n ) const {
+    Real sum = 0.0;
+    for( size_t i = 0; i < _fg.nrVars(); ++i )
+        sum += (1.0 - _fg.nbV(i).size()) * beliefV( n, i ).entropy();
+    for( size_t I = 0; I < _fg.nrFactors(); ++I )
+        sum -= dist( beliefF( n, I ), factor( n, I ), DISTKL );
+    return sum;
+}
+
+
+} // end of namespace dai
@@ -296,6 +296,200 @@ bool BipartiteGraph::isTree() const {
 }
 
 
+namespace {
+
+
+/// Orders the nodes of a BipartiteGraph by breadth-first searches, used by BipartiteGraph::orderRCM() and BipartiteGraph::orderBisection()
+/** The nodes of both types are treated alike: node \a n1 of type 1 is node \a n1 and node \a n2 of
+ *  type 2 is node \a nrNodes1() + \a n2. The nodes are divided into parts, and searches only visit
+ *  nodes of the same part as the node they start from.
+ */
+class NodeOrdering {
+    private:
+        /// The graph
+        const BipartiteGraph &_G;
+        /// Number of nodes of type 1
+        size_t _N1;
+        /// Part of each node
+        vector<size_t> _part;
+        /// Number of parts
+        size_t _nrParts;
+        /// Visited-stamp of each node in the current search
+        vector<size_t> _visited;
+        /// Stamp of the current search
+        size_t _stamp;
+        /// Ordered-stamp of each node in the current call of order()
+        vector<size_t> _ordered;
+        /// Stamp of the current call of order()
+        size_t _orderStamp;
+
+        /// Returns the number of neighbors of node \a u
+        size_t degree( size_t u ) const {
+            return (u < _N1) ? _G.nb1(u).size() : _G.nb2(u - _N1).size();
+        }
+
+        /// Returns the \a k 'th neighbor of node \a u
+        size_t neighbor( size_t u, size_t k ) const {
+            return (u < _N1) ? (_N1 + _G.nb1(u)[k].node) : _G.nb2(u - _N1)[k].node;
+        }
+
+        /// Searches breadth-first from node \a s, appending the visited nodes to \a result
+        /** If \a sorted == \c true, the unvisited neighbors of each node are visited in order of increasing degree.
+         *  Returns the position in \a result of the first node of the last level in \a lastLevel, and the number of levels.
+         */
+        size_t search( size_t s, bool sorted, vector<size_t> &result, size_t &lastLevel ) {
+            size_t p = _part[s];
+            ++_stamp;
+            size_t first = result.size();
+            result.push_back( s );
+            _visited[s] = _stamp;
+            size_t nrLevels = 0;
+            vector<pair<size_t, size_t> > nbs;
+            for( size_t begin = first, end = result.size(); begin != end; begin = end, end = result.size() ) {
+                lastLevel = begin;
+                nrLevels++;
+                for( size_t k = begin; k < end; k++ ) {
+                    size_t u = result[k];
+                    nbs.clear();
+                    for( size_t l = 0; l < degree( u ); l++ ) {
+                        size_t v = neighbor( u, l );
+                        if( _part[v] == p && _visited[v] != _stamp ) {
+                            _visited[v] = _stamp;
+                            nbs.push_back( make_pair( sorted ? degree( v ) : 0, v ) );
+                        }
+                    }
+                    if( sorted )
+                        stable_sort( nbs.begin(), nbs.end() );
+                    for( size_t l = 0; l < nbs.size(); l++ )
+                        result.push_back( nbs[l].second );
+                }
+            }
+            return nrLevels;
+        }
+
+        /// Returns a pseudo-peripheral node in the component of node \a s (within its part)
+        /** Repeatedly moves to a node of minimum degree in the last level of a search from the current node,
+         *  as long as that increases the number of levels [\ref CuM69].
+         */
+        size_t peripheral( size_t s ) {
+            vector<size_t> result;
+            size_t lastLevel = 0;
+            size_t nrLevels = search( s, false, result, lastLevel );
+            while( true ) {
+                size_t t = result[lastLevel];
+                for( size_t k = lastLevel + 1; k < result.size(); k++ )
+                    if( degree( result[k] ) < degree( t ) )
+                        t = result[k];
+                result.clear();
+                size_t nrLevelsT = search( t, false, result, lastLevel );
+                if( nrLevelsT <= nrLevels )
+                    return s;
+                s = t;
+                nrLevels = nrLevelsT;
+            }
+        }
+
+    public:
+        /// Constructs a NodeOrdering for \a G, with all nodes in one part
+        NodeOrdering( const BipartiteGraph &G ) : _G(G), _N1(G.nrNodes1()), _part(G.nrNodes1() + G.nrNodes2(), 0), _nrParts(1), _visited(_part.size(), 0), _stamp(0), _ordered(_part.size(), 0), _orderStamp(0) {}
+
+        /// Returns the number of nodes of type 1
+        size_t nrNodes1() const { return _N1; }
+
+        /// Returns the number of nodes (of both types)
+        size_t nrNodes() const { return _part.size(); }
+
+        /// Orders the nodes \a nodes, which should form a complete part, component by component
+        /** Each component is searched from a pseudo-peripheral node of the first node of \a nodes in that component.
+         */
+        void order( const vector<size_t> &nodes, bool sorted, vector<size_t> &result ) {
+            ++_orderStamp;
+            size_t lastLevel;
+            for( size_t k = 0; k < nodes.size(); k++ )
+                if( _ordered[nodes[k]] != _orderStamp ) {
+                    size_t first = result.size();
+                    search( peripheral( nodes[k] ), sorted, result, lastLevel );
+                    for( size_t l = first; l < result.size(); l++ )
+                        _ordered[result[l]] = _orderStamp;
+                }
+        }
+
+        /// Appends the nodes \a nodes, which should form a complete part, to \a result in recursive bisection order
+        void bisect( const vector<size_t> &nodes, size_t leafSize, vector<size_t> &result ) {
+            vector<size_t> ordered;
+            ordered.reserve( nodes.size() );
+            order( nodes, true, ordered );
+            if( ordered.size() <= leafSize ) {
+                result.insert( result.end(), ordered.begin(), ordered.end() );
+                return;
+            }
+            size_t half = ordered.size() / 2;
+            vector<size_t> first( ordered.begin(), ordered.begin() + half );
+            vector<size_t> second( ordered.begin() + half, ordered.end() );
+            ordered.clear();
+            size_t p1 = _nrParts++;
+            size_t p2 = _nrParts++;
+            for( size_t k = 0; k < first.size(); k++ )
+                _part[first[k]] = p1;
+            for( size_t k = 0; k < second.size(); k++ )
+                _part[second[k]] = p2;
+            bisect( first, leafSize, result );
+            bisect( second, leafSize, result );
+        }
+
+        /// Splits \a result, an order of all nodes, into orders of the nodes of type 1 and of type 2
+        void split( const vector<size_t> &result, vector<size_t> &order1, vector<size_t> &order2 ) const {
+            order1.clear();
+            order1.reserve( _N1 );
+            order2.clear();
+            order2.reserve( nrNodes() - _N1 );
+            for( size_t k = 0; k < result.size(); k++ )
+                if( result[k] < _N1 )
+                    order1.push_back( result[k] );
+                else
+                    order2.push_back( result[k] - _N1 );
+        }
+};
+
+
+} // end of anonymous namespace
+
+
+void BipartiteGraph::orderRCM( std::vector<size_t>& order1, std::vector<size_t>& order2 ) const {
+    NodeOrdering ordering( *this );
+    // start the search of each component from a node of small degree
+    vector<pair<size_t, size_t> > byDegree;
+    byDegree.reserve( ordering.nrNodes() );
+    for( size_t n1 = 0; n1 < nrNodes1(); n1++ )
+        byDegree.push_back( make_pair( nb1(n1).size(), n1 ) );
+    for( size_t n2 = 0; n2 < nrNodes2(); n2++ )
+        byDegree.push_back( make_pair( nb2(n2).size(), nrNodes1() + n2 ) );
+    sort( byDegree.begin(), byDegree.end() );
+    vector<size_t> nodes( byDegree.size() );
+    for( size_t k = 0; k < byDegree.size(); k++ )
+        nodes[k] = byDegree[k].second;
+
+    vector<size_t> result;
+    result.reserve( nodes.size() );
+    ordering.order( nodes, true, result );
+    reverse( result.begin(), result.end() );
+    ordering.split( result, order1, order2 );
+}
+
+
+void BipartiteGraph::orderBisection( std::vector<size_t>& order1, std::vector<size_t>& order2, size_t leafSize ) const {
+    NodeOrdering ordering( *this );
+    vector<size_t> nodes( ordering.nrNodes() );
+    for( size_t k = 0; k < nodes.size(); k++ )
+        nodes[k] = k;
+
+    vector<size_t> result;
+    result.reserve( nodes.size() );
+    ordering.bisect( nodes, std::max( leafSize, (size_t)1 ), result );
+    ordering.split( result, order1, order2 );
+}
+
+
 void BipartiteGraph::printDot( std::ostream& os ) const {
     os << "graph BipartiteGraph {" << endl;
     os << "node[shape=circle,width=0.4,fixedsize=true];" << endl;
@@ -7,10 +7,12 @@
 
 
 #include <iostream>
+#include <fstream>
 #include <sstream>
 #include <map>
 #include <set>
 #include <algorithm>
+#include <numeric>
 #include <dai/bp.h>
 #include <dai/util.h>
 #include <dai/properties.h>
@@ -26,6 +28,10 @@ using namespace std;
 /// \todo Make DAI_BP_FAST a compile-time choice, as it is a memory/speed tradeoff
 
 
+/// Maximum number of variables of factors of which the messages are calculated with fixed-depth loops (see ContractionPlan::run())
+#define DAI_BP_MAXPLANVARS 3
+
+
 void BP::setProperties( const PropertySet &opts ) {
     DAI_ASSERT( opts.hasKey("tol") );
     DAI_ASSERT( opts.hasKey("logdomain") );
@@ -55,6 +61,54 @@ void BP::setProperties( const PropertySet &opts ) {
         props.inference = opts.getStringAs<Properties::InfType>("inference");
     else
         props.inference = Properties::InfType::SUMPROD;
+    if( opts.hasKey("maxdensity") )
+        props.maxdensity = opts.getStringAs<Real>("maxdensity");
+    else
+        props.maxdensity = 0.0;
+    if( opts.hasKey("parametric") )
+        props.parametric = opts.getStringAs<bool>("parametric");
+    else
+        props.parametric = false;
+    if( opts.hasKey("nthreads") )
+        props.nthreads = opts.getStringAs<size_t>("nthreads");
+    else
+        props.nthreads = 1;
+    if( props.nthreads == 0 )
+        DAI_THROWE(MALFORMED_PROPERTY,"BP: nthreads should be at least 1");
+    if( opts.hasKey("edgeindex") )
+        props.edgeindex = opts.getStringAs<IndexTable::Type>("edgeindex");
+    else
+        props.edgeindex = IndexTable::Type::COMPACT;
+    if( opts.hasKey("convergence") )
+        props.convergence = opts.getStringAs<Properties::ConvergenceType>("convergence");
+    else
+        props.convergence = Properties::ConvergenceType::BELIEFS;
+    if( opts.hasKey("splashsize") )
+        props.splashsize = opts.getStringAs<size_t>("splashsize");
+    else
+        props.splashsize = 10;
+    if( props.splashsize == 0 )
+        DAI_THROWE(MALFORMED_PROPERTY,"BP: splashsize should be at least 1");
+    if( opts.hasKey("freezetol") )
+        props.freezetol = opts.getStringAs<Real>("freezetol");
+    else
+        props.freezetol = 0.0;
+    if( opts.hasKey("freezesweeps") )
+        props.freezesweeps = opts.getStringAs<size_t>("freezesweeps");
+    else
+        props.freezesweeps = 3;
+    if( props.freezesweeps == 0 )
+        DAI_THROWE(MALFORMED_PROPERTY,"BP: freezesweeps should be at least 1");
+    if( opts.hasKey("acceleration") )
+        props.acceleration = opts.getStringAs<Accelerator::Method>("acceleration");
+    else
+        props.acceleration = Accelerator::Method::NONE;
+    if( opts.hasKey("accelwindow") )
+        props.accelwindow = opts.getStringAs<size_t>("accelwindow");
+    else
+        props.accelwindow = 5;
+    if( props.accelwindow == 0 )
+        DAI_THROWE(MALFORMED_PROPERTY,"BP: accelwindow should be at least 1");
 }
 
 
@@ -68,6 +122,16 @@ PropertySet BP::getProperties() const {
     opts.set( "updates", props.updates );
     opts.set( "damping", props.damping );
     opts.set( "inference", props.inference );
+    opts.set( "maxdensity", props.maxdensity );
+    opts.set( "parametric", props.parametric );
+    opts.set( "nthreads", props.nthreads );
+    opts.set( "edgeindex", props.edgeindex );
+    opts.set( "convergence", props.convergence );
+    opts.set( "splashsize", props.splashsize );
+    opts.set( "freezetol", props.freezetol );
+    opts.set( "freezesweeps", props.freezesweeps );
+    opts.set( "acceleration", props.acceleration );
+    opts.set( "accelwindow", props.accelwindow );
     return opts;
 }
 
@@ -82,90 +146,252 @@ string BP::printProperties() const {
     s << "logdomain=" << props.logdomain << ",";
     s << "updates=" << props.updates << ",";
     s << "damping=" << props.damping << ",";
-    s << "inference=" << props.inference << "]";
+    s << "inference=" << props.inference << ",";
+    s << "maxdensity=" << props.maxdensity << ",";
+    s << "parametric=" << props.parametric << ",";
+    s << "nthreads=" << props.nthreads << ",";
+    s << "edgeindex=" << props.edgeindex << ",";
+    s << "convergence=" << props.convergence << ",";
+    s << "splashsize=" << props.splashsize << ",";
+    s << "freezetol=" << props.freezetol << ",";
+    s << "freezesweeps=" << props.freezesweeps << ",";
+    s << "acceleration=" << props.acceleration << ",";
+    s << "accelwindow=" << props.accelwindow << "]";
     return s.str();
 }
 
 
 void BP::construct() {
-    // create edge properties
-    _edges.clear();
-    _edges.reserve( nrVars() );
-    _edge2lut.clear();
-    if( props.updates == Properties::UpdateType::SEQMAX )
-        _edge2lut.reserve( nrVars() );
-    for( size_t i = 0; i < nrVars(); ++i ) {
-        _edges.push_back( vector<EdgeProp>() );
-        _edges[i].reserve( nbV(i).size() );
-        if( props.updates == Properties::UpdateType::SEQMAX ) {
-            _edge2lut.push_back( vector<LutType::iterator>() );
-            _edge2lut[i].reserve( nbV(i).size() );
+    // number the edges factor by factor (the order of the sequential updates)
+    _varEdgeOffsets.assign( nrVars() + 1, 0 );
+    for( size_t i = 0; i < nrVars(); ++i )
+        _varEdgeOffsets[i + 1] = _varEdgeOffsets[i] + nbV(i).size();
+    _varEdges.assign( nrEdges(), 0 );
+    _edgeList.clear();
+    _edgeList.reserve( nrEdges() );
+    _messageOffsets.clear();
+    _messageOffsets.reserve( nrEdges() + 1 );
+    _messageOffsets.push_back( 0 );
+    for( size_t I = 0; I < nrFactors(); I++ )
+        bforeach( const Neighbor &i, nbF(I) ) {
+            _varEdges[_varEdgeOffsets[i] + i.dual] = _edgeList.size();
+            _edgeList.push_back( Edge( i, i.dual ) );
+            _messageOffsets.push_back( _messageOffsets.back() + var(i).states() );
         }
-        bforeach( const Neighbor &I, nbV(i) ) {
-            EdgeProp newEP;
-            newEP.message = Prob( var(i).states() );
-            newEP.newMessage = Prob( var(i).states() );
-
-            if( DAI_BP_FAST ) {
-                newEP.index.reserve( factor(I).nrStates() );
-                for( IndexFor k( var(i), factor(I).vars() ); k.valid(); ++k )
-                    newEP.index.push_back( k );
-            }
 
-            newEP.residual = 0.0;
-            _edges[i].push_back( newEP );
-            if( props.updates == Properties::UpdateType::SEQMAX )
-                _edge2lut[i].push_back( _lut.insert( make_pair( newEP.residual, make_pair( i, _edges[i].size() - 1 ))) );
+    // create edge properties: the messages are stored contiguously and are initially uniform
+    _messages.resize( _messageOffsets.back() );
+    for( size_t e = 0; e < _edgeList.size(); ++e ) {
+        size_t states = var(_edgeList[e].first).states();
+        fill( messageValues(e), messageValues(e) + states, (Real)1 / states );
+    }
+    _newMessages = _messages;
+    _residuals.assign( nrEdges(), 0.0 );
+    _indices.clear();
+    _indices.resize( nrEdges() );
+    _plans.clear();
+    _plans.resize( nrEdges() );
+    if( DAI_BP_FAST )
+        for( size_t e = 0; e < _edgeList.size(); ++e ) {
+            size_t i = _edgeList[e].first;
+            const Factor &f = factor( nbV(i, _edgeList[e].second) );
+            _indices[e] = IndexTable( var(i), f.vars(), props.edgeindex );
+            if( f.vars().size() <= DAI_BP_MAXPLANVARS )
+                _plans[e] = ContractionPlan::get( f.vars(), f.vars(), var(i) );
         }
+    if( props.verbose >= 2 && DAI_BP_FAST ) {
+        size_t entries = 0;
+        for( size_t e = 0; e < _indices.size(); ++e )
+            entries += _indices[e].size();
+        cerr << name() << "::construct:  cached indices use " << indexBytes() << " bytes (" << entries * sizeof(size_t) - indexBytes() << " bytes saved)" << endl;
     }
 
-    // create old beliefs
+    // create residual queue
+    _residualQueue.clear();
+    _nrResidualUpdates = 0;
+    _multiQueue.reset();
+    if( props.updates == Properties::UpdateType::SEQMAX ) {
+        _residualQueue.assign( nrEdges() );
+        for( size_t i = 0; i < nrVars(); ++i )
+            bforeach( const Neighbor &I, nbV(i) )
+                updateResidual( i, I.iter, 0.0 );
+    } else if( props.updates == Properties::UpdateType::SPLASH )
+        _residualQueue.assign( nrVars() );
+
+    // create old beliefs (or message changes, which replace them if convergence is tested on the messages)
     _oldBeliefsV.clear();
-    _oldBeliefsV.reserve( nrVars() );
-    for( size_t i = 0; i < nrVars(); ++i )
-        _oldBeliefsV.push_back( Factor( var(i) ) );
     _oldBeliefsF.clear();
-    _oldBeliefsF.reserve( nrFactors() );
-    for( size_t I = 0; I < nrFactors(); ++I )
-        _oldBeliefsF.push_back( Factor( factor(I).vars() ) );
+    _changes.clear();
+    if( props.convergence == Properties::ConvergenceType::RESIDUALS )
+        _changes.assign( nrEdges(), 0.0 );
+    else {
+        _oldBeliefsV.reserve( nrVars() );
+        for( size_t i = 0; i < nrVars(); ++i )
+            _oldBeliefsV.push_back( Factor( var(i) ) );
+        _oldBeliefsF.reserve( nrFactors() );
+        for( size_t I = 0; I < nrFactors(); ++I )
+            _oldBeliefsF.push_back( Factor( factor(I).vars() ) );
+    }
     
     // create update sequence
-    _updateSeq.clear();
-    _updateSeq.reserve( nrEdges() );
+    _updateSeq = _edgeList;
+    initFreezing();
+    initAcceleration();
+
+    // create sparse, parametric and logarithmic copies of factors
+    _sparseFactors.clear();
+    _sparseFactors.resize( nrFactors() );
+    _useSparse.clear();
+    _useSparse.resize( nrFactors(), false );
+    _pairwiseFactors.clear();
+    _pairwiseFactors.resize( nrFactors() );
+    _logFactors.clear();
+    if( props.logdomain )
+        _logFactors.resize( nrFactors() );
     for( size_t I = 0; I < nrFactors(); I++ )
-        bforeach( const Neighbor &i, nbF(I) )
-            _updateSeq.push_back( Edge( i, i.dual ) );
+        updateFactorCopies( I );
+
+    // the variables and factors are partitioned over the threads by run()
+    _varParts.clear();
+    _factorParts.clear();
+}
+
+
+void BP::updateFactorCopies( size_t I ) {
+    if( props.logdomain )
+        _logFactors[I] = LogFactor( factor(I) );
+
+    _pairwiseFactors[I] = PairwiseFactor();
+    if( props.parametric && DAI_BP_FAST && factor(I).vars().size() == 2 )
+        _pairwiseFactors[I] = PairwiseFactor( factor(I) );
+
+    _useSparse[I] = false;
+    _sparseFactors[I] = SparseFactor();
+    // factors that depend on a single variable are handled separately by calcNewMessage()
+    if( props.maxdensity > 0.0 && DAI_BP_FAST && factor(I).vars().size() > 1 ) {
+        SparseFactor f( factor(I) );
+        if( f.density() <= props.maxdensity ) {
+            _sparseFactors[I] = f;
+            _useSparse[I] = true;
+        }
+    }
 }
 
 
 void BP::init() {
     Real c = props.logdomain ? 0.0 : 1.0;
-    for( size_t i = 0; i < nrVars(); ++i ) {
-        bforeach( const Neighbor &I, nbV(i) ) {
-            message( i, I.iter ).fill( c );
-            newMessage( i, I.iter ).fill( c );
-            if( props.updates == Properties::UpdateType::SEQMAX )
+    fill( _messages.begin(), _messages.end(), c );
+    fill( _newMessages.begin(), _newMessages.end(), c );
+    if( props.updates == Properties::UpdateType::SEQMAX ) {
+        for( size_t i = 0; i < nrVars(); ++i )
+            bforeach( const Neighbor &I, nbV(i) )
                 updateResidual( i, I.iter, 0.0 );
-        }
     }
+    initFreezing();
+    initAcceleration();
     _iters = 0;
 }
 
 
+size_t BP::indexBytes() const {
+    size_t bytes = 0;
+    for( size_t e = 0; e < _indices.size(); ++e )
+        bytes += _indices[e].bytes();
+    return bytes;
+}
+
+
 void BP::findMaxResidual( size_t &i, size_t &_I ) {
-    DAI_ASSERT( !_lut.empty() );
-    LutType::const_iterator largestEl = _lut.end();
-    --largestEl;
-    i  = largestEl->second.first;
-    _I = largestEl->second.second;
+    DAI_ASSERT( !_residualQueue.empty() );
+    const Edge &e = _edgeList[_residualQueue.top()];
+    i  = e.first;
+    _I = e.second;
 }
 
 
+namespace {
+
+
+/// Kernel for ContractionPlan::run() that multiplies (or, in the log domain, adds) the product of the messages into a variable into a factor product
+/** The plan should loop over the factor, using the factor as index set A and the variable as index set B.
+ */
+template<bool logdomain> struct ProductKernel {
+    /// Factor product
+    Real *prod;
+    /// Product of the messages into the variable
+    const Real *prod_j;
+
+    /// Processes one run of the innermost loop
+    void operator()( size_t i, size_t, size_t b, size_t n, size_t, size_t sb ) {
+        Real *p = prod + i;
+        const Real *m = prod_j + b;
+        if( sb == 0 ) {
+            const Real y = *m;
+            for( size_t k = 0; k < n; k++ )
+                p[k] = logdomain ? p[k] + y : p[k] * y;
+        } else
+            for( size_t k = 0; k < n; k++ )
+                p[k] = logdomain ? p[k] + m[k * sb] : p[k] * m[k * sb];
+    }
+};
+
+
+/// Kernel for ContractionPlan::run() that sums (or maximizes) a factor product onto a variable
+/** The plan should loop over the factor, using the factor as index set A and the variable as index set B.
+ */
+template<bool sumprod> struct MarginalKernel {
+    /// Marginal
+    Real *marg;
+    /// Factor product
+    const Real *prod;
+
+    /// Processes one run of the innermost loop
+    void operator()( size_t i, size_t, size_t b, size_t n, size_t, size_t sb ) {
+        const Real *p = prod + i;
+        Real *m = marg + b;
+        if( sb == 0 ) {
+            Real x = *m;
+            for( size_t k = 0; k < n; k++ )
+                if( sumprod )
+                    x += p[k];
+                else if( p[k] > x )
+                    x = p[k];
+            *m = x;
+        } else
+            for( size_t k = 0; k < n; k++ )
+                if( sumprod )
+                    m[k * sb] += p[k];
+                else if( p[k] > m[k * sb] )
+                    m[k * sb] = p[k];
+    }
+};
+
+
+/// Kernel for ContractionPlan::run() that sums the exponentials of a log-domain factor product onto a variable, relative to the maximum of each state
+struct SumExpKernel {
+    /// Sums
+    Real *sum;
+    /// Maximum for each state of the variable
+    const Real *max;
+    /// Log-domain factor product
+    const Real *prod;
+
+    /// Processes one run of the innermost loop
+    void operator()( size_t i, size_t, size_t b, size_t n, size_t, size_t sb ) {
+        const Real *p = prod + i;
+        for( size_t k = 0; k < n; k++ )
+            if( p[k] != -INFINITY )
+                sum[b + k * sb] += exp( p[k] - max[b + k * sb] );
+    }
+};
+
+
+} // end of anonymous namespace
+
+
 Prob BP::calcIncomingMessageProduct( size_t I, bool without_i, size_t i ) const {
-    Factor Fprod( factor(I) );
+    Factor Fprod( factor(I).vars(), props.logdomain ? _logFactors[I].logp() : factor(I).p() );
     Prob &prod = Fprod.p();
-    if( props.logdomain )
-        prod.takeLog();
 
     // Calculate product of incoming messages and factor I
     bforeach( const Neighbor &j, nbF(I) )
@@ -175,9 +401,9 @@ Prob BP::calcIncomingMessageProduct( size_t I, bool without_i, size_t i ) const
             bforeach( const Neighbor &J, nbV(j) )
                 if( J != I ) { // for all J in nb(j) \ I
                     if( props.logdomain )
-                        prod_j += message( j, J.iter );
+                        simd::add( &(prod_j.p()[0]), messageValues( edge( j, J.iter ) ), prod_j.size() );
                     else
-                        prod_j *= message( j, J.iter );
+                        simd::mul( &(prod_j.p()[0]), messageValues( edge( j, J.iter ) ), prod_j.size() );
                 }
 
             // multiply prod with prod_j
@@ -187,6 +413,16 @@ Prob BP::calcIncomingMessageProduct( size_t I, bool without_i, size_t i ) const
                     Fprod += Factor( var(j), prod_j );
                 else
                     Fprod *= Factor( var(j), prod_j );
+            } else if( _plans[edge(j, j.dual)] ) {
+                // OPTIMIZED VERSION FOR FACTORS WITH FEW VARIABLES (FIXED-DEPTH LOOPS)
+                const ContractionPlan &plan = *_plans[edge(j, j.dual)];
+                if( props.logdomain ) {
+                    ProductKernel<true> kernel = { &(prod.p()[0]), &(prod_j.p()[0]) };
+                    plan.run( kernel );
+                } else {
+                    ProductKernel<false> kernel = { &(prod.p()[0]), &(prod_j.p()[0]) };
+                    plan.run( kernel );
+                }
             } else {
                 // OPTIMIZED VERSION
                 size_t _I = j.dual;
@@ -204,61 +440,773 @@ Prob BP::calcIncomingMessageProduct( size_t I, bool without_i, size_t i ) const
 }
 
 
+namespace {
+
+
+/// Maps the r'th value of a factor product to the state of the variable onto which it is marginalized
+struct DenseTarget {
+    /// Precalculated index of the edge
+    const IndexTable &ind;
+    /// Returns the state corresponding with the \a r 'th value
+    size_t operator()( size_t r ) const { return ind[r]; }
+};
+
+
+/// Maps the k'th nonzero value of a sparse factor product to the state of the variable onto which it is marginalized
+struct SparseTarget {
+    /// Precalculated index of the edge
+    const IndexTable &ind;
+    /// Linear indices of the nonzero values
+    const vector<size_t> &nz;
+    /// Returns the state corresponding with the \a k 'th nonzero value
+    size_t operator()( size_t k ) const { return ind[nz[k]]; }
+};
+
+
+/// Normalizes the log-domain message \a marg in the log domain
+/** \throw NOT_NORMALIZABLE if all values of \a marg are -inf
+ */
+void normalizeLogMessage( Prob &marg ) {
+    Real m = marg.max();
+    if( m == -INFINITY )
+        DAI_THROW(NOT_NORMALIZABLE);
+    Real Z = 0.0;
+    for( size_t s = 0; s < marg.size(); ++s )
+        if( marg[s] != -INFINITY )
+            Z += exp( marg[s] - m );
+    marg -= m + log( Z );
+}
+
+
+/// Normalizes the message with \a states values \a m, in the log domain if \a logdomain is \c true
+/** \throw NOT_NORMALIZABLE if all values of \a m are zero (-inf in the log domain)
+ */
+void normalizeMessageValues( Real *m, size_t states, bool logdomain ) {
+    if( logdomain ) {
+        Real max = *max_element( m, m + states );
+        if( max == -INFINITY )
+            DAI_THROW(NOT_NORMALIZABLE);
+        Real Z = 0.0;
+        for( size_t s = 0; s < states; ++s )
+            if( m[s] != -INFINITY )
+                Z += exp( m[s] - max );
+        Real logZ = max + log( Z );
+        for( size_t s = 0; s < states; ++s )
+            m[s] -= logZ;
+    } else {
+        Real Z = accumulate( m, m + states, (Real)0.0 );
+        if( !(Z > 0.0) )
+            DAI_THROW(NOT_NORMALIZABLE);
+        for( size_t s = 0; s < states; ++s )
+            m[s] /= Z;
+    }
+}
+
+
+/// Marginalizes the log-domain factor product \a prod onto a variable with \a states states and returns the normalized log-domain message
+/** The \a r 'th value of \a prod corresponds with state \a target(r). For sum-product, the values of each state are
+ *  combined with a log-sum-exp relative to their maximum; for max-product, only the maximum is taken.
+ *  \throw NOT_NORMALIZABLE if all values of \a prod are -inf
+ */
+template<class Target>
+Prob logMarginal( const Prob &prod, size_t states, const Target &target, bool sumprod ) {
+    Prob marg( states, -INFINITY );
+    for( size_t r = 0; r < prod.size(); ++r )
+        if( prod[r] > marg[target(r)] )
+            marg.set( target(r), prod[r] );
+    if( sumprod ) {
+        Prob sum( states, 0.0 );
+        for( size_t r = 0; r < prod.size(); ++r )
+            if( prod[r] != -INFINITY )
+                sum.set( target(r), sum[target(r)] + exp( prod[r] - marg[target(r)] ) );
+        for( size_t s = 0; s < states; ++s )
+            if( marg[s] != -INFINITY )
+                marg.set( s, marg[s] + log( sum[s] ) );
+    }
+    normalizeLogMessage( marg );
+    return marg;
+}
+
+
+/// Marginalizes the log-domain factor product \a prod onto a variable with \a states states, looping with \a plan, and returns the normalized log-domain message
+/** Has the same effect as the other logMarginal(), where \a plan loops over the factor, using the factor as
+ *  index set A and the variable as index set B.
+ *  \throw NOT_NORMALIZABLE if all values of \a prod are -inf
+ */
+Prob logMarginal( const Prob &prod, size_t states, const ContractionPlan &plan, bool sumprod ) {
+    Prob marg( states, -INFINITY );
+    MarginalKernel<false> maxKernel = { &(marg.p()[0]), &(prod.p()[0]) };
+    plan.run( maxKernel );
+    if( sumprod ) {
+        Prob sum( states, 0.0 );
+        SumExpKernel sumKernel = { &(sum.p()[0]), &(marg.p()[0]), &(prod.p()[0]) };
+        plan.run( sumKernel );
+        for( size_t s = 0; s < states; ++s )
+            if( marg[s] != -INFINITY )
+                marg.set( s, marg[s] + log( sum[s] ) );
+    }
+    normalizeLogMessage( marg );
+    return marg;
+}
+
+
+} // end of anonymous namespace
+
+
 void BP::calcNewMessage( size_t i, size_t _I ) {
     // calculate updated message I->i
     size_t I = nbV(i,_I);
 
     Prob marg;
     if( factor(I).vars().size() == 1 ) // optimization
-        marg = factor(I).p();
+        marg = props.logdomain ? _logFactors[I].logp() : factor(I).p();
+    else if( usePairwise( I ) )
+        marg = calcNewMessagePairwise( i, _I );
+    else if( _useSparse[I] )
+        marg = calcNewMessageSparse( i, _I );
     else {
         Factor Fprod( factor(I) );
         Prob &prod = Fprod.p();
         prod = calcIncomingMessageProduct( I, true, i );
 
-        if( props.logdomain ) {
-            prod -= prod.max();
-            prod.takeExp();
-        }
-
         // Marginalize onto i
         if( !DAI_BP_FAST ) {
             // UNOPTIMIZED (SIMPLE TO READ, BUT SLOW) VERSION
-            if( props.inference == Properties::InfType::SUMPROD )
+            if( props.logdomain ) {
+                LogFactor Flogprod( Fprod.vars(), prod );
+                if( props.inference == Properties::InfType::SUMPROD )
+                    marg = Flogprod.marginal( var(i) ).logp();
+                else
+                    marg = Flogprod.maxMarginal( var(i) ).logp();
+            } else if( props.inference == Properties::InfType::SUMPROD )
                 marg = Fprod.marginal( var(i) ).p();
             else
                 marg = Fprod.maxMarginal( var(i) ).p();
         } else {
             // OPTIMIZED VERSION 
-            marg = Prob( var(i).states(), 0.0 );
             // ind is the precalculated IndexFor(i,I) i.e. to x_I == k corresponds x_i == ind[k]
-            const ind_t ind = index(i,_I);
-            if( props.inference == Properties::InfType::SUMPROD )
-                for( size_t r = 0; r < prod.size(); ++r )
-                    marg.set( ind[r], marg[ind[r]] + prod[r] );
-            else
-                for( size_t r = 0; r < prod.size(); ++r )
-                    if( prod[r] > marg[ind[r]] )
-                        marg.set( ind[r], prod[r] );
-            marg.normalize();
+            const ind_t &ind = index(i,_I);
+            const ContractionPlan *plan = _plans[edge(i,_I)].get();
+            if( plan ) {
+                // fixed-depth loops for factors with few variables
+                if( props.logdomain )
+                    marg = logMarginal( prod, var(i).states(), *plan, props.inference == Properties::InfType::SUMPROD );
+                else {
+                    marg = Prob( var(i).states(), 0.0 );
+                    if( props.inference == Properties::InfType::SUMPROD ) {
+                        MarginalKernel<true> kernel = { &(marg.p()[0]), &(prod.p()[0]) };
+                        plan->run( kernel );
+                    } else {
+                        MarginalKernel<false> kernel = { &(marg.p()[0]), &(prod.p()[0]) };
+                        plan->run( kernel );
+                    }
+                    marg.normalize();
+                }
+            } else if( props.logdomain ) {
+                DenseTarget target = { ind };
+                marg = logMarginal( prod, var(i).states(), target, props.inference == Properties::InfType::SUMPROD );
+            } else {
+                marg = Prob( var(i).states(), 0.0 );
+                if( props.inference == Properties::InfType::SUMPROD )
+                    for( size_t r = 0; r < prod.size(); ++r )
+                        marg.set( ind[r], marg[ind[r]] + prod[r] );
+                else
+                    for( size_t r = 0; r < prod.size(); ++r )
+                        if( prod[r] > marg[ind[r]] )
+                            marg.set( ind[r], prod[r] );
+                marg.normalize();
+            }
         }
     }
 
-    // Store result
-    if( props.logdomain )
-        newMessage(i,_I) = marg.log();
-    else
-        newMessage(i,_I) = marg;
+    // Store result (in the log domain, marg already contains the logarithm of the message)
+    setNewMessage( i, _I, marg );
 
     // Update the residual if necessary
     if( props.updates == Properties::UpdateType::SEQMAX )
-        updateResidual( i, _I , dist( newMessage( i, _I ), message( i, _I ), DISTLINF ) );
+        updateResidual( i, _I, messageResidual( edge(i,_I) ) );
+}
+
+
+Prob BP::calcNewMessageSparse( size_t i, size_t _I ) const {
+    size_t I = nbV(i,_I);
+    const SparseFactor &f = _sparseFactors[I];
+    const vector<size_t> &nz = f.indices();
+
+    // Calculate product of incoming messages and factor I for the nonzero values of factor I
+    // (this performs the same operations as calcIncomingMessageProduct() for these values)
+    Prob prod( f.values().begin(), f.values().end(), f.nrNonZeros() );
+    if( props.logdomain )
+        for( size_t k = 0; k < nz.size(); ++k )
+            prod.set( k, _logFactors[I][nz[k]] );
+    bforeach( const Neighbor &j, nbF(I) )
+        if( j != i ) {
+            // prod_j will be the product of messages coming into j
+            Prob prod_j( var(j).states(), props.logdomain ? 0.0 : 1.0 );
+            bforeach( const Neighbor &J, nbV(j) )
+                if( J != I ) { // for all J in nb(j) \ I
+                    if( props.logdomain )
+                        simd::add( &(prod_j.p()[0]), messageValues( edge( j, J.iter ) ), prod_j.size() );
+                    else
+                        simd::mul( &(prod_j.p()[0]), messageValues( edge( j, J.iter ) ), prod_j.size() );
+                }
+
+            // multiply prod with prod_j
+            const ind_t &ind = index(j, j.dual);
+            for( size_t k = 0; k < nz.size(); ++k )
+                if( props.logdomain )
+                    prod.set( k, prod[k] + prod_j[ind[nz[k]]] );
+                else
+                    prod.set( k, prod[k] * prod_j[ind[nz[k]]] );
+        }
+
+    // Marginalize onto i (the zero values of factor I do not contribute)
+    const ind_t &ind = index(i,_I);
+    if( props.logdomain ) {
+        SparseTarget target = { ind, nz };
+        return logMarginal( prod, var(i).states(), target, props.inference == Properties::InfType::SUMPROD );
+    }
+    Prob marg( var(i).states(), 0.0 );
+    if( props.inference == Properties::InfType::SUMPROD )
+        for( size_t k = 0; k < nz.size(); ++k )
+            marg.set( ind[nz[k]], marg[ind[nz[k]]] + prod[k] );
+    else
+        for( size_t k = 0; k < nz.size(); ++k )
+            if( prod[k] > marg[ind[nz[k]]] )
+                marg.set( ind[nz[k]], prod[k] );
+    marg.normalize();
+
+    return marg;
+}
+
+
+Prob BP::calcNewMessagePairwise( size_t i, size_t _I ) const {
+    size_t I = nbV(i,_I);
+    const Neighbor &j = nbF(I)[nbF(I)[0] == i ? 1 : 0];
+
+    // prod_j will be the product of messages coming into j, except the message from I
+    Prob prod_j( var(j).states(), props.logdomain ? 0.0 : 1.0 );
+    bforeach( const Neighbor &J, nbV(j) )
+        if( J != I ) {
+            if( props.logdomain )
+                simd::add( &(prod_j.p()[0]), messageValues( edge( j, J.iter ) ), prod_j.size() );
+            else
+                simd::mul( &(prod_j.p()[0]), messageValues( edge( j, J.iter ) ), prod_j.size() );
+        }
+
+    // the parametric forms are symmetric, so the message to i does not depend on the order of i and j
+    Prob marg( var(i).states() );
+    bool sumprod = (props.inference == Properties::InfType::SUMPROD);
+    if( props.logdomain ) {
+        _pairwiseFactors[I].logMessage( &(prod_j.p()[0]), &(marg.p()[0]), sumprod );
+        normalizeLogMessage( marg );
+    } else {
+        _pairwiseFactors[I].message( &(prod_j.p()[0]), &(marg.p()[0]), sumprod );
+        marg.normalize();
+    }
+    return marg;
+}
+
+
+void BP::calcNewMessages( size_t I, bool without_i, size_t i ) {
+    if( !DAI_BP_FAST || _useSparse[I] || nbF(I).size() == 1 || usePairwise( I ) ) {
+        bforeach( const Neighbor &j, nbF(I) )
+            if( !(without_i && (j == i)) )
+                calcNewMessage( j, j.dual );
+        return;
+    }
+
+    const size_t d = nbF(I).size();
+    const Prob &f = props.logdomain ? _logFactors[I].logp() : factor(I).p();
+    const bool sumprod = (props.inference == Properties::InfType::SUMPROD);
+
+    // prods[offsets[k]], prods[offsets[k]+1], ... is the product of the messages coming into
+    // the k'th neighbor j of I, except the message from I
+    vector<size_t, PoolAllocator<size_t> > offsets( d + 1, 0 );
+    vector<const IndexTable *, PoolAllocator<const IndexTable *> > ind( d, (const IndexTable *)0 );
+    vector<bool, PoolAllocator<bool> > skip( d, false );
+    bforeach( const Neighbor &j, nbF(I) ) {
+        offsets[j.iter + 1] = offsets[j.iter] + var(j).states();
+        // ind[k] is the precalculated IndexFor(j,I) i.e. to x_I == r corresponds x_j == (*ind[k])[r]
+        ind[j.iter] = &_indices[edge( j, j.dual )];
+        skip[j.iter] = without_i && (j == i);
+    }
+    vector<Real, PoolAllocator<Real> > prods( offsets[d], props.logdomain ? 0.0 : 1.0 );
+    bforeach( const Neighbor &j, nbF(I) ) {
+        Real *prod_j = &prods[offsets[j.iter]];
+        bforeach( const Neighbor &J, nbV(j) )
+            if( J != I ) { // for all J in nb(j) \ I
+                if( props.logdomain )
+                    simd::add( prod_j, messageValues( edge( j, J.iter ) ), var(j).states() );
+                else
+                    simd::mul( prod_j, messageValues( edge( j, J.iter ) ), var(j).states() );
+            }
+    }
+
+    // For each joint state r of I, vals[k] is the product of f[r] and the messages into all neighbors
+    // except the k'th one, which is calculated from the products a[0] * ... * a[k-1] (prefix) and
+    // suf[k+1] = a[k+1] * ... * a[d-1] (suffix), where a[l] is the message into the l'th neighbor;
+    // it is accumulated into margs, in the first pass by summing (or maximizing), in the second pass
+    // (only for sum-product in the log domain) by summing the exponents relative to the maximum
+    vector<Real, PoolAllocator<Real> > margs( offsets[d], props.logdomain ? -INFINITY : 0.0 );
+    vector<Real, PoolAllocator<Real> > sums;
+    vector<Real, PoolAllocator<Real> > a( d, 0.0 ), suf( d + 1, 0.0 ), vals( d, 0.0 );
+    vector<size_t, PoolAllocator<size_t> > x( d, 0 );
+    size_t nrPasses = (props.logdomain && sumprod) ? 2 : 1;
+    if( nrPasses == 2 )
+        sums.resize( offsets[d], 0.0 );
+    for( size_t pass = 0; pass < nrPasses; ++pass )
+        for( size_t r = 0; r < f.size(); ++r ) {
+            for( size_t k = 0; k < d; ++k ) {
+                x[k] = offsets[k] + (*ind[k])[r];
+                a[k] = prods[x[k]];
+            }
+            suf[d] = props.logdomain ? 0.0 : 1.0;
+            for( size_t k = d - 1; k > 0; --k )
+                suf[k] = props.logdomain ? a[k] + suf[k+1] : a[k] * suf[k+1];
+            Real pre = f[r];
+            for( size_t k = 0; k < d; ++k ) {
+                vals[k] = props.logdomain ? pre + suf[k+1] : pre * suf[k+1];
+                pre = props.logdomain ? pre + a[k] : pre * a[k];
+            }
+            for( size_t k = 0; k < d; ++k )
+                if( !skip[k] ) {
+                    if( pass == 1 ) {
+                        if( vals[k] != -INFINITY )
+                            sums[x[k]] += exp( vals[k] - margs[x[k]] );
+                    } else if( sumprod && !props.logdomain )
+                        margs[x[k]] += vals[k];
+                    else if( vals[k] > margs[x[k]] )
+                        margs[x[k]] = vals[k];
+                }
+        }
+
+    // Normalize and store the results (in the log domain, as logarithms)
+    bforeach( const Neighbor &j, nbF(I) )
+        if( !skip[j.iter] ) {
+            Prob marg( margs.begin() + offsets[j.iter], margs.begin() + offsets[j.iter + 1], var(j).states() );
+            if( props.logdomain ) {
+                if( sumprod )
+                    for( size_t s = 0; s < marg.size(); ++s )
+                        if( marg[s] != -INFINITY )
+                            marg.set( s, marg[s] + log( sums[offsets[j.iter] + s] ) );
+                normalizeLogMessage( marg );
+            } else
+                marg.normalize();
+            setNewMessage( j, j.dual, marg );
+
+            // Update the residual if necessary
+            if( props.updates == Properties::UpdateType::SEQMAX )
+                updateResidual( j, j.dual, messageResidual( edge( j, j.dual ) ) );
+        }
 }
 
 
 // BP::run does not check for NANs for performance reasons
 // Somehow NaNs do not often occur in BP...
+struct BP::ParallelJob : public ThreadPool::Job {
+    /// Phases of an iteration that are executed in parallel
+    enum Phase {CALCMESSAGES, UPDATEMESSAGES, BELIEFS, RELAXEDMAX, SPLASHES};
+
+    /// The BP object
+    BP &bp;
+    /// Phase to execute
+    Phase phase;
+    /// Maximum belief difference found by each thread (only for phase BELIEFS)
+    std::vector<Real> maxDiffs;
+
+    /// Constructor
+    ParallelJob( BP &_bp, Phase _phase ) : bp(_bp), phase(_phase), maxDiffs( _bp._threadPool->nrThreads(), -INFINITY ) {}
+
+    /// Executes the phase for the variables and factors of thread \a t
+    virtual void run( size_t t ) {
+        if( phase == BELIEFS ) {
+            Real maxDiff = -INFINITY;
+            for( size_t i = bp._varParts[t]; i < bp._varParts[t+1]; ++i ) {
+                Factor b( bp.beliefV(i) );
+                maxDiff = std::max( maxDiff, dist( b, bp._oldBeliefsV[i], DISTLINF ) );
+                bp._oldBeliefsV[i] = b;
+            }
+            for( size_t I = bp._factorParts[t]; I < bp._factorParts[t+1]; ++I ) {
+                Factor b( bp.beliefF(I) );
+                maxDiff = std::max( maxDiff, dist( b, bp._oldBeliefsF[I], DISTLINF ) );
+                bp._oldBeliefsF[I] = b;
+            }
+            maxDiffs[t] = maxDiff;
+        } else if( phase == RELAXEDMAX )
+            bp.updateRelaxedMaxResidual( t );
+        else if( phase == SPLASHES )
+            for( size_t s = t; s < bp._splashes.size(); s += bp._threadPool->nrThreads() )
+                bp.updateSplash( bp._splashes[s] );
+        else if( phase == CALCMESSAGES )
+            for( size_t I = bp._factorParts[t]; I < bp._factorParts[t+1]; ++I )
+                bp.calcNewMessages( I, false, 0 );
+        else
+            for( size_t i = bp._varParts[t]; i < bp._varParts[t+1]; ++i )
+                bforeach( const Neighbor &I, bp.nbV(i) )
+                    bp.updateMessage( i, I.iter );
+    }
+};
+
+
+void BP::prepareThreads() {
+    if( props.nthreads <= 1 ) {
+        _threadPool.reset();
+        return;
+    }
+    if( !_threadPool || _threadPool->nrThreads() != props.nthreads ) {
+        _threadPool.reset( new ThreadPool( props.nthreads ) );
+        _varParts.clear();
+    }
+    if( _varParts.size() != props.nthreads + 1 ) {
+        // the work for variable i consists of the messages from its neighboring factors
+        vector<size_t> varWeights( nrVars(), 0 );
+        for( size_t i = 0; i < nrVars(); ++i ) {
+            varWeights[i] = var(i).states();
+            bforeach( const Neighbor &I, nbV(i) )
+                varWeights[i] += factor(I).nrStates();
+        }
+        _varParts = partitionWork( varWeights, props.nthreads );
+
+        // the work for factor I is the calculation of its belief
+        vector<size_t> factorWeights( nrFactors(), 0 );
+        for( size_t I = 0; I < nrFactors(); ++I )
+            factorWeights[I] = factor(I).nrStates() * nbF(I).size();
+        _factorParts = partitionWork( factorWeights, props.nthreads );
+    }
+}
+
+
+namespace {
+
+
+/// Returns the next number of a xorshift random number generator with state \a x
+inline boost::uint64_t xorshift( boost::uint64_t &x ) {
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return x;
+}
+
+
+/// Locks several mutexes of a MutexArray (in increasing order, to avoid deadlocks) during its lifetime
+class ScopedLocks {
+    private:
+        /// The array
+        MutexArray &_mutexes;
+        /// Indices of the locked mutexes (sorted)
+        const std::vector<size_t> &_locked;
+
+    public:
+        /// Locks the mutexes of \a mutexes with indices \a locked, which should be sorted
+        ScopedLocks( MutexArray &mutexes, const std::vector<size_t> &locked ) : _mutexes(mutexes), _locked(locked) {
+            for( size_t k = 0; k < _locked.size(); ++k )
+                _mutexes.lock( _locked[k] );
+        }
+        /// Unlocks the mutexes
+        ~ScopedLocks() {
+            for( size_t k = _locked.size(); k-- > 0; )
+                _mutexes.unlock( _locked[k] );
+        }
+};
+
+
+} // end of anonymous namespace
+
+
+struct BP::ResidualMultiQueue {
+    /// The heaps: edge \a e is item <tt>e / heaps.size()</tt> of heap <tt>e % heaps.size()</tt>
+    std::vector<IndexedHeap<ResidualKey> > heaps;
+    /// Number of residuals that have been set in each heap
+    std::vector<size_t> nrUpdates;
+    /// Protects each heap
+    MutexArray heapLocks;
+    /// Protects the messages into each variable (and the messages they replace)
+    MutexArray varLocks;
+    /// State of the random number generator of each thread
+    std::vector<boost::uint64_t> seeds;
+    /// Buffer of each thread for the variables that it locks
+    std::vector<std::vector<size_t> > lockedVars;
+    /// Buffer of each thread for the residuals that it has calculated
+    std::vector<std::vector<Real> > residuals;
+
+    /// Constructs the heaps for \a nrEdges edges with residual 0 and the mutexes for \a nrVars variables, for use by \a nrThreads threads
+    ResidualMultiQueue( size_t nrEdges, size_t nrVars, size_t nrThreads ) :
+        heaps(), nrUpdates(), heapLocks( nrThreads > 1 ? std::min( 2 * nrThreads, std::max( nrEdges, (size_t)1 ) ) : 1 ), varLocks( nrVars ),
+        seeds( nrThreads ), lockedVars( nrThreads ), residuals( nrThreads )
+    {
+        size_t nrHeaps = heapLocks.size();
+        heaps.resize( nrHeaps );
+        nrUpdates.resize( nrHeaps, 0 );
+        for( size_t q = 0; q < nrHeaps; q++ )
+            heaps[q].assign( nrEdges / nrHeaps + (q < nrEdges % nrHeaps ? 1 : 0), ResidualKey( 0.0, 0 ) );
+        for( size_t t = 0; t < nrThreads; t++ )
+            seeds[t] = 0x9E3779B97F4A7C15ULL * (t + 1);
+    }
+
+    /// Sets the residual of edge \a e to \a r
+    void set( size_t e, Real r ) {
+        size_t q = e % heaps.size();
+        MutexArray::ScopedLock lock( heapLocks, q );
+        heaps[q].set( e / heaps.size(), ResidualKey( r, nrUpdates[q]++ ) );
+    }
+
+    /// Returns an edge with a large residual and marks it as being updated by thread \a t
+    /** The edge has the largest residual of one of two heaps chosen at random (if there is a single heap,
+     *  it has the largest residual). Its residual is set to -1 until it is set again by set().
+     */
+    size_t pop( size_t t ) {
+        size_t nrHeaps = heaps.size();
+        size_t q = 0;
+        if( nrHeaps > 1 ) {
+            size_t q1 = xorshift( seeds[t] ) % nrHeaps;
+            size_t q2 = xorshift( seeds[t] ) % nrHeaps;
+            Real r1, r2;
+            {
+                MutexArray::ScopedLock lock( heapLocks, q1 );
+                r1 = heaps[q1].topKey().first;
+            }
+            {
+                MutexArray::ScopedLock lock( heapLocks, q2 );
+                r2 = heaps[q2].topKey().first;
+            }
+            q = (r2 > r1) ? q2 : q1;
+        }
+        MutexArray::ScopedLock lock( heapLocks, q );
+        size_t item = heaps[q].top();
+        heaps[q].set( item, ResidualKey( -1.0, nrUpdates[q]++ ) );
+        return item * nrHeaps + q;
+    }
+};
+
+
+void BP::initMultiQueue() {
+    size_t nrThreads = (_threadPool && !recordSentMessages) ? _threadPool->nrThreads() : 1;
+    _multiQueue.reset( new ResidualMultiQueue( nrEdges(), nrVars(), nrThreads ) );
+
+    // do the first pass
+    if( _threadPool ) {
+        ParallelJob job( *this, ParallelJob::CALCMESSAGES );
+        _threadPool->run( job );
+    } else
+        for( size_t I = 0; I < nrFactors(); ++I )
+            calcNewMessages( I, false, 0 );
+    // set the residuals in the same order as SEQMAX does
+    for( size_t e = 0; e < _edgeList.size(); ++e )
+        _multiQueue->set( e, messageResidual( e ) );
+}
+
+
+void BP::updateRelaxedMaxResidual( size_t t ) {
+    ResidualMultiQueue &queue = *_multiQueue;
+    size_t nrThreads = queue.seeds.size();
+    size_t nrUpdates = nrEdges() * (t + 1) / nrThreads - nrEdges() * t / nrThreads;
+    vector<size_t> &locked = queue.lockedVars[t];
+    vector<Real> &residuals = queue.residuals[t];
+
+    for( size_t u = 0; u < nrUpdates; ++u ) {
+        // update a message with a large residual
+        size_t e = queue.pop( t );
+        size_t i = _edgeList[e].first, _I = _edgeList[e].second;
+        Real r = 0.0;
+        {
+            MutexArray::ScopedLock lock( queue.varLocks, i );
+            updateMessage( i, _I );
+            if( props.damping != 0.0 )
+                r = messageResidual( e );
+        }
+        queue.set( e, r );
+
+        // I->i has been updated, which means that residuals for all
+        // J->j with J in nb[i]\I and j in nb[J]\i have to be updated
+        bforeach( const Neighbor &J, nbV(i) ) {
+            if( J.iter != _I ) {
+                // the messages J->j depend on the messages into all variables of J;
+                // lock these in a fixed order to avoid deadlocks
+                locked.clear();
+                bforeach( const Neighbor &j, nbF(J) )
+                    locked.push_back( j );
+                sort( locked.begin(), locked.end() );
+                residuals.clear();
+                {
+                    ScopedLocks lock( queue.varLocks, locked );
+                    calcNewMessages( J, true, i );
+                    bforeach( const Neighbor &j, nbF(J) )
+                        if( j != i )
+                            residuals.push_back( messageResidual( edge( j, j.dual ) ) );
+                }
+
+                size_t k = 0;
+                bforeach( const Neighbor &j, nbF(J) )
+                    if( j != i )
+                        queue.set( edge( j, j.dual ), residuals[k++] );
+            }
+        }
+    }
+}
+
+
+Real BP::updateOldBeliefs() {
+    if( _threadPool ) {
+        ParallelJob job( *this, ParallelJob::BELIEFS );
+        _threadPool->run( job );
+        return *max_element( job.maxDiffs.begin(), job.maxDiffs.end() );
+    }
+
+    Real maxDiff = -INFINITY;
+    for( size_t i = 0; i < nrVars(); ++i ) {
+        Factor b( beliefV(i) );
+        maxDiff = std::max( maxDiff, dist( b, _oldBeliefsV[i], DISTLINF ) );
+        _oldBeliefsV[i] = b;
+    }
+    for( size_t I = 0; I < nrFactors(); ++I ) {
+        Factor b( beliefF(I) );
+        maxDiff = std::max( maxDiff, dist( b, _oldBeliefsF[I], DISTLINF ) );
+        _oldBeliefsF[I] = b;
+    }
+    return maxDiff;
+}
+
+
+Real BP::updateMessageChanges() {
+    bool maxResidual = (props.updates == Properties::UpdateType::SEQMAX) || (props.updates == Properties::UpdateType::PARMAX) || (props.updates == Properties::UpdateType::SPLASH);
+    Real maxDiff = -INFINITY;
+    for( size_t e = 0; e < _edgeList.size(); ++e ) {
+        maxDiff = std::max( maxDiff, _changes[e] );
+        // maximum-residual schedules need not update every message in an iteration
+        if( maxResidual )
+            maxDiff = std::max( maxDiff, messageResidual( e ) );
+        _changes[e] = 0.0;
+    }
+    return maxDiff;
+}
+
+
+void BP::initFreezing() {
+    _quietSweeps.clear();
+    _nrActiveEdges.clear();
+    _activeFactors.clear();
+    _factorQueued.clear();
+    _nrDormantEdges = 0;
+    if( freezing() ) {
+        _quietSweeps.assign( _edgeList.size(), 0 );
+        _nrActiveEdges.resize( nrFactors() );
+        _activeFactors.resize( nrFactors() );
+        for( size_t I = 0; I < nrFactors(); ++I ) {
+            _nrActiveEdges[I] = nbF(I).size();
+            _activeFactors[I] = I;
+        }
+        _factorQueued.assign( nrFactors(), true );
+    }
+}
+
+
+void BP::initAcceleration() {
+    _previousMessages.clear();
+    _accelerator = Accelerator( accelerating() ? props.acceleration : Accelerator::Method( Accelerator::Method::NONE ), props.accelwindow, !props.logdomain );
+}
+
+
+void BP::accelerateSweep() {
+    _accelerator.step( _previousMessages, _messages );
+    // the edges are numbered factor by factor; the messages of factors of a single variable are
+    // not normalized by calcNewMessage(), and do not change
+    for( size_t I = 0, e = 0; I < nrFactors(); e += nbF(I).size(), ++I ) {
+        if( nbF(I).size() == 1 )
+            continue;
+        for( size_t k = 0; k < nbF(I).size(); ++k )
+            normalizeMessageValues( messageValues( e + k ), _messageOffsets[e + k + 1] - _messageOffsets[e + k], props.logdomain );
+    }
+    // the beliefs are calculated from the new messages
+    _newMessages = _messages;
+}
+
+
+Real BP::updateActiveEdges() {
+    // the factors that are visited by the next sweep are collected in _activeFactors during this sweep
+    vector<size_t> factors;
+    factors.swap( _activeFactors );
+    for( size_t k = 0; k < factors.size(); ++k )
+        _factorQueued[factors[k]] = false;
+
+    // calculate the new messages of the active edges, factor by factor; SEQFIX updates them right away,
+    // PARALL only after all new messages have been calculated
+    bool parall = (props.updates == Properties::UpdateType::PARALL);
+    vector<size_t> edges;
+    Real maxChange = 0.0;
+    for( size_t k = 0; k < factors.size(); ++k ) {
+        size_t I = factors[k];
+        bool all = (_nrActiveEdges[I] == nbF(I).size());
+        if( all )
+            calcNewMessages( I, false, 0 );
+        bforeach( const Neighbor &i, nbF(I) ) {
+            size_t e = edge( i, i.dual );
+            if( all || _quietSweeps[e] < props.freezesweeps ) {
+                if( !all )
+                    calcNewMessage( i, i.dual );
+                edges.push_back( e );
+            }
+        }
+        if( !parall ) {
+            for( size_t l = 0; l < edges.size(); ++l )
+                maxChange = std::max( maxChange, updateActiveEdge( edges[l] ) );
+            edges.clear();
+            queueFactor( I );
+        }
+    }
+    if( parall ) {
+        for( size_t l = 0; l < edges.size(); ++l )
+            maxChange = std::max( maxChange, updateActiveEdge( edges[l] ) );
+        for( size_t k = 0; k < factors.size(); ++k )
+            queueFactor( factors[k] );
+    }
+
+    // visit the factors in the order of the update sequence
+    sort( _activeFactors.begin(), _activeFactors.end() );
+    return maxChange;
+}
+
+
+Real BP::updateActiveEdge( size_t e ) {
+    size_t i = _edgeList[e].first, _I = _edgeList[e].second;
+    Real residual = messageResidual( e );
+    updateMessage( i, _I );
+    Real change = 0.0;
+    if( !_changes.empty() ) {
+        change = _changes[e];
+        _changes[e] = 0.0;
+    }
+
+    if( residual > props.freezetol ) {
+        _quietSweeps[e] = 0;
+        // the messages from the other factors J of i to their other variables depend on this message
+        bforeach( const Neighbor &J, nbV(i) )
+            if( J.iter != _I )
+                bforeach( const Neighbor &j, nbF(J) )
+                    if( j != i )
+                        wakeEdge( edge( j, j.dual ), J );
+    } else if( ++_quietSweeps[e] == props.freezesweeps ) {
+        --_nrActiveEdges[nbV(i, _I)];
+        ++_nrDormantEdges;
+    }
+    return change;
+}
+
+
+void BP::wakeEdge( size_t e, size_t I ) {
+    if( _quietSweeps[e] >= props.freezesweeps ) {
+        ++_nrActiveEdges[I];
+        --_nrDormantEdges;
+        queueFactor( I );
+    }
+    _quietSweeps[e] = 0;
+}
+
+
 Real BP::run() {
+    // draw the temporary messages and factors from the memory pool of this BP object
+    MemoryPool::Scope scope( memoryPool() );
+
     if( props.verbose >= 1 )
         cerr << "Starting " << identify() << "...";
     if( props.verbose >= 3)
@@ -266,16 +1214,18 @@ Real BP::run() {
 
     double tic = toc();
 
+    prepareThreads();
+
     // do several passes over the network until maximum number of iterations has
     // been reached or until the maximum belief difference is smaller than tolerance
     Real maxDiff = INFINITY;
     for( ; _iters < props.maxiter && maxDiff > props.tol && (toc() - tic) < props.maxtime; _iters++ ) {
+        Real maxChange = 0.0;
         if( props.updates == Properties::UpdateType::SEQMAX ) {
             if( _iters == 0 ) {
                 // do the first pass
-                for( size_t i = 0; i < nrVars(); ++i )
-                  bforeach( const Neighbor &I, nbV(i) )
-                      calcNewMessage( i, I.iter );
+                for( size_t I = 0; I < nrFactors(); ++I )
+                    calcNewMessages( I, false, 0 );
             }
             // Maximum-Residual BP [\ref EMK06]
             for( size_t t = 0; t < _updateSeq.size(); ++t ) {
@@ -286,48 +1236,95 @@ Real BP::run() {
 
                 // I->i has been updated, which means that residuals for all
                 // J->j with J in nb[i]\I and j in nb[J]\i have to be updated
-                bforeach( const Neighbor &J, nbV(i) ) {
-                    if( J.iter != _I ) {
-                        bforeach( const Neighbor &j, nbF(J) ) {
-                            size_t _J = j.dual;
-                            if( j != i )
-                                calcNewMessage( j, _J );
-                        }
-                    }
-                }
+                bforeach( const Neighbor &J, nbV(i) )
+                    if( J.iter != _I )
+                        calcNewMessages( J, true, i );
+            }
+        } else if( props.updates == Properties::UpdateType::PARMAX ) {
+            // Relaxed Maximum-Residual BP
+            if( _iters == 0 || !_multiQueue )
+                initMultiQueue();
+            if( _threadPool && !recordSentMessages ) {
+                ParallelJob job( *this, ParallelJob::RELAXEDMAX );
+                _threadPool->run( job );
+            } else
+                updateRelaxedMaxResidual( 0 );
+        } else if( props.updates == Properties::UpdateType::SPLASH ) {
+            // Splash BP [\ref GLG09]
+            if( _iters == 0 ) {
+                // do the first pass
+                for( size_t I = 0; I < nrFactors(); ++I )
+                    calcNewMessages( I, false, 0 );
+                for( size_t i = 0; i < nrVars(); ++i )
+                    updateVarResidual( i );
             }
+            size_t nrThreads = (_threadPool && !recordSentMessages) ? _threadPool->nrThreads() : 1;
+            for( size_t nrUpdates = 0; nrUpdates < _edgeList.size(); ) {
+                growSplashes( nrThreads );
+                if( _splashes.empty() )
+                    break;
+                if( nrThreads > 1 ) {
+                    ParallelJob job( *this, ParallelJob::SPLASHES );
+                    _threadPool->run( job );
+                } else
+                    updateSplash( _splashes[0] );
+                // all messages into the variables of a splash are updated twice, except those into the root
+                for( size_t s = 0; s < _splashes.size(); ++s )
+                    for( size_t k = 0; k < _splashes[s].size(); ++k )
+                        nrUpdates += (k ? 2 : 1) * nbV(_splashes[s][k]).size();
+                updateSplashResiduals();
+            }
+        } else if( freezing() ) {
+            // Sequential or parallel updates of the edges that are not dormant
+            maxChange = updateActiveEdges();
         } else if( props.updates == Properties::UpdateType::PARALL ) {
             // Parallel updates
-            for( size_t i = 0; i < nrVars(); ++i )
-                bforeach( const Neighbor &I, nbV(i) )
-                    calcNewMessage( i, I.iter );
-
-            for( size_t i = 0; i < nrVars(); ++i )
-                bforeach( const Neighbor &I, nbV(i) )
-                    updateMessage( i, I.iter );
-        } else {
-            // Sequential updates
-            if( props.updates == Properties::UpdateType::SEQRND )
-                random_shuffle( _updateSeq.begin(), _updateSeq.end(), rnd );
+            if( accelerating() )
+                _previousMessages = _messages;
+            if( _threadPool ) {
+                ParallelJob job( *this, ParallelJob::CALCMESSAGES );
+                _threadPool->run( job );
+            } else
+                for( size_t I = 0; I < nrFactors(); ++I )
+                    calcNewMessages( I, false, 0 );
+
+            // the order of _sentMessages is only preserved by a single thread
+            if( _threadPool && !recordSentMessages ) {
+                ParallelJob job( *this, ParallelJob::UPDATEMESSAGES );
+                _threadPool->run( job );
+            } else
+                for( size_t i = 0; i < nrVars(); ++i )
+                    bforeach( const Neighbor &I, nbV(i) )
+                        updateMessage( i, I.iter );
+        } else if( props.updates == Properties::UpdateType::SEQRND ) {
+            // Sequential updates using a random sequence
+            random_shuffle( _updateSeq.begin(), _updateSeq.end(), rnd );
 
             bforeach( const Edge &e, _updateSeq ) {
                 calcNewMessage( e.first, e.second );
                 updateMessage( e.first, e.second );
             }
+        } else {
+            // Sequential updates using a fixed sequence (which is _edgeList, i.e., factor by factor);
+            // the messages from a factor do not depend on each other, so they can be calculated together
+            if( accelerating() )
+                _previousMessages = _messages;
+            for( size_t I = 0; I < nrFactors(); ++I ) {
+                calcNewMessages( I, false, 0 );
+                bforeach( const Neighbor &i, nbF(I) )
+                    updateMessage( i, i.dual );
+            }
         }
 
-        // calculate new beliefs and compare with old ones
-        maxDiff = -INFINITY;
-        for( size_t i = 0; i < nrVars(); ++i ) {
-            Factor b( beliefV(i) );
-            maxDiff = std::max( maxDiff, dist( b, _oldBeliefsV[i], DISTLINF ) );
-            _oldBeliefsV[i] = b;
-        }
-        for( size_t I = 0; I < nrFactors(); ++I ) {
-            Factor b( beliefF(I) );
-            maxDiff = std::max( maxDiff, dist( b, _oldBeliefsF[I], DISTLINF ) );
-            _oldBeliefsF[I] = b;
-        }
+        // the changes of the plain updates are compared with the tolerance
+        if( accelerating() )
+            accelerateSweep();
+
+        // calculate new beliefs and compare with old ones, or use the changes of the messages
+        if( props.convergence == Properties::ConvergenceType::RESIDUALS )
+            maxDiff = freezing() ? maxChange : updateMessageChanges();
+        else
+            maxDiff = updateOldBeliefs();
 
         if( props.verbose >= 3 )
             cerr << name() << "::run:  maxdiff " << maxDiff << " after " << _iters+1 << " passes" << endl;
@@ -356,9 +1353,9 @@ void BP::calcBeliefV( size_t i, Prob &p ) const {
     p = Prob( var(i).states(), props.logdomain ? 0.0 : 1.0 );
     bforeach( const Neighbor &I, nbV(i) )
         if( props.logdomain )
-            p += newMessage( i, I.iter );
+            simd::add( &(p.p()[0]), newMessageValues( edge( i, I.iter ) ), p.size() );
         else
-            p *= newMessage( i, I.iter );
+            simd::mul( &(p.p()[0]), newMessageValues( edge( i, I.iter ) ), p.size() );
 }
 
 
@@ -432,12 +1429,15 @@ void BP::init( const VarSet &ns ) {
         size_t ni = findVar( *n );
         bforeach( const Neighbor &I, nbV( ni ) ) {
             Real val = props.logdomain ? 0.0 : 1.0;
-            message( ni, I.iter ).fill( val );
-            newMessage( ni, I.iter ).fill( val );
+            size_t e = edge( ni, I.iter );
+            fill( messageValues(e), messageValues(e) + var(ni).states(), val );
+            fill( newMessageValues(e), newMessageValues(e) + var(ni).states(), val );
             if( props.updates == Properties::UpdateType::SEQMAX )
                 updateResidual( ni, I.iter, 0.0 );
         }
     }
+    initFreezing();
+    initAcceleration();
     _iters = 0;
 }
 
@@ -445,28 +1445,278 @@ void BP::init( const VarSet &ns ) {
 void BP::updateMessage( size_t i, size_t _I ) {
     if( recordSentMessages )
         _sentMessages.push_back(make_pair(i,_I));
+    size_t e = edge( i, _I );
     if( props.damping == 0.0 ) {
-        message(i,_I) = newMessage(i,_I);
+        if( !_changes.empty() )
+            _changes[e] = std::max( _changes[e], messageResidual( e ) );
+        copy( newMessageValues(e), newMessageValues(e) + var(i).states(), messageValues(e) );
         if( props.updates == Properties::UpdateType::SEQMAX )
             updateResidual( i, _I, 0.0 );
     } else {
+        Prob m;
         if( props.logdomain )
-            message(i,_I) = (message(i,_I) * props.damping) + (newMessage(i,_I) * (1.0 - props.damping));
+            m = (message(i,_I) * props.damping) + (newMessage(i,_I) * (1.0 - props.damping));
         else
-            message(i,_I) = (message(i,_I) ^ props.damping) * (newMessage(i,_I) ^ (1.0 - props.damping));
+            m = (message(i,_I) ^ props.damping) * (newMessage(i,_I) ^ (1.0 - props.damping));
+        if( !_changes.empty() )
+            _changes[e] = std::max( _changes[e], dist( m, message(i,_I), DISTLINF ) );
+        setMessage( i, _I, m );
         if( props.updates == Properties::UpdateType::SEQMAX )
-            updateResidual( i, _I, dist( newMessage(i,_I), message(i,_I), DISTLINF ) );
+            updateResidual( i, _I, messageResidual( e ) );
     }
 }
 
 
 void BP::updateResidual( size_t i, size_t _I, Real r ) {
-    EdgeProp* pEdge = &_edges[i][_I];
-    pEdge->residual = r;
+    size_t e = edge( i, _I );
+    _residuals[e] = r;
+
+    // move the edge to its new position in the queue
+    _residualQueue.set( e, ResidualKey( r, _nrResidualUpdates++ ) );
+}
+
+
+Real BP::messageResidual( size_t e ) const {
+    // same as dist( newMessage, message, DISTLINF ), without copying the messages
+    const Real *p = newMessageValues( e ), *q = messageValues( e );
+    size_t states = _messageOffsets[e + 1] - _messageOffsets[e];
+    Real r = 0.0;
+    for( size_t s = 0; s < states; ++s ) {
+        Real d = dai::abs( p[s] - q[s] );
+        r = (r > d) ? r : d;
+    }
+    return r;
+}
+
+
+void BP::updateVarResidual( size_t i ) {
+    Real r = 0.0;
+    bforeach( const Neighbor &I, nbV(i) )
+        r = std::max( r, messageResidual( edge( i, I.iter ) ) );
+    _residualQueue.set( i, ResidualKey( r, _nrResidualUpdates++ ) );
+}
+
+
+bool BP::splashAvailable( size_t j, size_t first, size_t s ) const {
+    // another splash of the batch reads the messages into j
+    if( _splashReads[j] >= first && _splashReads[j] != s )
+        return false;
+    // another splash of the batch updates messages that are needed for updating the messages into j
+    bforeach( const Neighbor &I, nbV(j) )
+        bforeach( const Neighbor &k, nbF(I) )
+            if( _splashVars[k] >= first && _splashVars[k] != s )
+                return false;
+    return true;
+}
+
+
+void BP::growSplashes( size_t nr ) {
+    if( _splashVars.size() != nrVars() ) {
+        _splashVars.assign( nrVars(), 0 );
+        _splashReads.assign( nrVars(), 0 );
+        _nrSplashes = 0;
+    }
+    for( size_t s = 0; s < _splashes.size(); ++s )
+        _splashes[s].clear();
+    size_t nrGrown = 0;
+
+    // the splashes of this batch are numbered from first on
+    size_t first = _nrSplashes + 1;
+    // roots near the splashes that have been grown already are skipped, so try a few more
+    for( size_t tries = 0; nrGrown < nr && tries < 2 * nr && _residualQueue.topKey().first >= 0.0; ++tries ) {
+        size_t root = _residualQueue.top();
+        // the residual of the root is recalculated by updateSplashResiduals(), also if it is skipped,
+        // because its neighboring factors send messages to (or read messages from) a splash
+        _residualQueue.set( root, ResidualKey( -1.0, _nrResidualUpdates++ ) );
+        size_t s = ++_nrSplashes;
+        if( !splashAvailable( root, first, s ) )
+            continue;
+
+        // breadth-first search from the root
+        if( _splashes.size() <= nrGrown )
+            _splashes.resize( nrGrown + 1 );
+        vector<size_t> &splash = _splashes[nrGrown++];
+        splash.push_back( root );
+        _splashVars[root] = s;
+        for( size_t k = 0; k < splash.size(); ++k )
+            bforeach( const Neighbor &I, nbV(splash[k]) )
+                bforeach( const Neighbor &j, nbF(I) ) {
+                    if( _splashReads[j] < first )
+                        _splashReads[j] = s;
+                    // variables of which the messages have (almost) converged are left out
+                    if( splash.size() < props.splashsize && _splashVars[j] != s && _residualQueue.key( j ).first > props.tol && splashAvailable( j, first, s ) ) {
+                        splash.push_back( j );
+                        _splashVars[j] = s;
+                    }
+                }
+    }
+    _splashes.resize( nrGrown );
+}
+
+
+void BP::updateSplash( const std::vector<size_t> &splash ) {
+    // from the leaves towards the root
+    for( size_t k = splash.size(); k-- > 0; )
+        bforeach( const Neighbor &I, nbV(splash[k]) ) {
+            calcNewMessage( splash[k], I.iter );
+            updateMessage( splash[k], I.iter );
+        }
+    // from the root towards the leaves
+    for( size_t k = 1; k < splash.size(); ++k )
+        bforeach( const Neighbor &I, nbV(splash[k]) ) {
+            calcNewMessage( splash[k], I.iter );
+            updateMessage( splash[k], I.iter );
+        }
+}
+
+
+void BP::updateSplashResiduals() {
+    // the factors neighboring the splashes send new messages
+    vector<size_t, PoolAllocator<size_t> > factors, vars;
+    for( size_t s = 0; s < _splashes.size(); ++s )
+        for( size_t k = 0; k < _splashes[s].size(); ++k )
+            bforeach( const Neighbor &I, nbV(_splashes[s][k]) )
+                factors.push_back( I );
+    sort( factors.begin(), factors.end() );
+    factors.erase( unique( factors.begin(), factors.end() ), factors.end() );
+    for( size_t f = 0; f < factors.size(); ++f ) {
+        calcNewMessages( factors[f], false, 0 );
+        bforeach( const Neighbor &j, nbF(factors[f]) )
+            vars.push_back( j );
+    }
+    sort( vars.begin(), vars.end() );
+    vars.erase( unique( vars.begin(), vars.end() ), vars.end() );
+    for( size_t v = 0; v < vars.size(); ++v )
+        updateVarResidual( vars[v] );
+}
+
+
+BPMessages BP::exportMessages() const {
+    BPMessages msgs;
+    for( size_t e = 0; e < _edgeList.size(); ++e ) {
+        size_t i = _edgeList[e].first, _I = _edgeList[e].second;
+        Prob m = message( i, _I );
+        if( props.logdomain )
+            m.takeExp();
+        m.normalize();
+        msgs.set( var(i), factor( nbV(i)[_I] ).vars(), m );
+    }
+    return msgs;
+}
+
+
+size_t BP::importMessages( const BPMessages &msgs ) {
+    size_t nrSet = 0;
+    for( size_t e = 0; e < _edgeList.size(); ++e ) {
+        size_t i = _edgeList[e].first, _I = _edgeList[e].second;
+        const Prob *p = msgs.get( var(i), factor( nbV(i)[_I] ).vars() );
+        if( p != NULL && p->size() == var(i).states() ) {
+            Prob m( *p );
+            if( props.logdomain )
+                m.takeLog();
+            setMessage( i, _I, m );
+            setNewMessage( i, _I, m );
+            nrSet++;
+        }
+    }
+    // the first iteration should compare the beliefs with those of the imported messages
+    if( !_oldBeliefsV.empty() )
+        updateOldBeliefs();
+    initFreezing();
+    initAcceleration();
+    return nrSet;
+}
+
+
+BPMessages::Key BPMessages::key( const Var &v, const VarSet &factorVars ) {
+    Key k( v.label(), std::vector<size_t>() );
+    k.second.reserve( factorVars.size() );
+    for( VarSet::const_iterator n = factorVars.begin(); n != factorVars.end(); ++n )
+        k.second.push_back( n->label() );
+    return k;
+}
+
+
+const Prob* BPMessages::get( const Var &v, const VarSet &factorVars ) const {
+    std::map<Key, Prob>::const_iterator it = _messages.find( key( v, factorVars ) );
+    if( it == _messages.end() )
+        return NULL;
+    else
+        return &(it->second);
+}
+
+
+std::ostream& operator<< ( std::ostream& os, const BPMessages& msgs ) {
+    os << msgs._messages.size() << endl;
+    for( std::map<BPMessages::Key, Prob>::const_iterator it = msgs._messages.begin(); it != msgs._messages.end(); ++it ) {
+        os << it->first.first << " " << it->first.second.size();
+        for( size_t n = 0; n < it->first.second.size(); ++n )
+            os << " " << it->first.second[n];
+        os << " " << it->second.size();
+        for( size_t s = 0; s < it->second.size(); ++s )
+            os << " " << it->second[s];
+        os << endl;
+    }
+    return os;
+}
+
+
+std::istream& operator>> ( std::istream& is, BPMessages& msgs ) {
+    string line;
+    while( is.peek() == '#' )
+        getline( is, line );
+
+    size_t nrMessages;
+    is >> nrMessages;
+    if( is.fail() )
+        DAI_THROWE(INVALID_MESSAGES_FILE,"Cannot read number of messages");
+
+    msgs.clear();
+    for( size_t m = 0; m < nrMessages; ++m ) {
+        BPMessages::Key k;
+        size_t nrVars = 0, nrValues = 0;
+        is >> k.first >> nrVars;
+        k.second.resize( nrVars );
+        for( size_t n = 0; n < nrVars; ++n )
+            is >> k.second[n];
+        is >> nrValues;
+        if( is.fail() )
+            DAI_THROWE(INVALID_MESSAGES_FILE,"Cannot read labels of message " + toString( m ));
+        Prob p( nrValues );
+        for( size_t s = 0; s < nrValues; ++s ) {
+            Real x;
+            is >> x;
+            p.set( s, x );
+        }
+        if( is.fail() )
+            DAI_THROWE(INVALID_MESSAGES_FILE,"Cannot read values of message " + toString( m ));
+        sort( k.second.begin(), k.second.end() );
+        msgs._messages[k] = p;
+    }
+    return is;
+}
+
+
+void BPMessages::ReadFromFile( const char *filename ) {
+    ifstream infile;
+    infile.open( filename );
+    if( infile.is_open() ) {
+        infile >> *this;
+        infile.close();
+    } else
+        DAI_THROWE(CANNOT_READ_FILE,"Cannot read from file " + std::string(filename));
+}
+
 
-    // rearrange look-up table (delete and reinsert new key)
-    _lut.erase( _edge2lut[i][_I] );
-    _edge2lut[i][_I] = _lut.insert( make_pair( r, make_pair(i, _I) ) );
+void BPMessages::WriteToFile( const char *filename, size_t precision ) const {
+    ofstream outfile;
+    outfile.open( filename );
+    if( outfile.is_open() ) {
+        outfile.precision( precision );
+        outfile << *this;
+        outfile.close();
+    } else
+        DAI_THROWE(CANNOT_WRITE_FILE,"Cannot write to file " + std::string(filename));
 }
 
 
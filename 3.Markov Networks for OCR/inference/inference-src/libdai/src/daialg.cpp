@@ -29,7 +29,7 @@ Factor calcMarginal( const InfAlg &obj, const VarSet &vs, bool reInit ) {
         varindices[*n] = obj.fg().findVar( *n );
 
     Real logZ0 = -INFINITY;
-    for( State s(vs); s.valid(); s++ ) {
+    for( FlatState s(vs); s.valid(); s++ ) {
         // save unclamped factors connected to vs
         clamped->backupFactors( vs );
 
@@ -238,9 +238,9 @@ std::vector<size_t> findMaximum( const InfAlg& obj ) {
         // The allowed configuration is restrained according to the variables assigned so far:
         // pick the argmax amongst the allowed states
         Real maxProb = -numeric_limits<Real>::max();
-        State maxState( obj.fg().factor(I).vars() );
+        FlatState maxState( obj.fg().factor(I).vars() );
         size_t maxcount = 0;
-        for( State s( obj.fg().factor(I).vars() ); s.valid(); ++s ) {
+        for( FlatState s( obj.fg().factor(I).vars() ); s.valid(); ++s ) {
             // First, calculate whether this state is consistent with variables that
             // have been assigned already
             bool allowedState = true;
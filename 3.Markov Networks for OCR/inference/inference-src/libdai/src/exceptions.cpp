@@ -31,9 +31,11 @@ namespace dai {
         "Invalid FactorGraph file",
         "Invalid Evidence file",
         "Invalid Expectation-Maximization file",
+        "Invalid BP messages file",
         "Quantity not normalizable",
         "Multiple undo levels unsupported",
         "FactorGraph is not connected",
+        "Factor graphs do not have the same structure",
         "Internal error",
         "Runtime error",
         "Out of memory"
@@ -52,6 +52,30 @@ Factor createFactorPotts( const Var &n1, const Var &n2, Real J ) {
 }
 
 
+Factor createFactorTruncatedLinear( const Var &n1, const Var &n2, Real lambda, Real tau ) {
+    Factor fac( VarSet( n1, n2 ) );
+    DAI_ASSERT( n1.states() == n2.states() );
+    size_t k = n1.states();
+    for( size_t s1 = 0; s1 < k; s1++ )
+        for( size_t s2 = 0; s2 < k; s2++ )
+            fac.set( s1 + k * s2, std::exp( -std::min( lambda * (s1 > s2 ? s1 - s2 : s2 - s1), tau ) ) );
+    return fac;
+}
+
+
+Factor createFactorTruncatedQuadratic( const Var &n1, const Var &n2, Real lambda, Real tau ) {
+    Factor fac( VarSet( n1, n2 ) );
+    DAI_ASSERT( n1.states() == n2.states() );
+    size_t k = n1.states();
+    for( size_t s1 = 0; s1 < k; s1++ )
+        for( size_t s2 = 0; s2 < k; s2++ ) {
+            Real d = (Real)s1 - (Real)s2;
+            fac.set( s1 + k * s2, std::exp( -std::min( lambda * d * d, tau ) ) );
+        }
+    return fac;
+}
+
+
 Factor createFactorDelta( const Var &v, size_t state ) {
     Factor fac( v, 0.0 );
     DAI_ASSERT( state < v.states() );
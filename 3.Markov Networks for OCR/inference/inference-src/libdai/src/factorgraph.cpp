@@ -496,6 +496,21 @@ FactorGraph FactorGraph::clamped( size_t i, size_t state ) const {
 }
 
 
+FactorGraph FactorGraph::reordered( const std::vector<size_t>& varOrder, const std::vector<size_t>& facOrder ) const {
+    DAI_ASSERT( varOrder.size() == nrVars() );
+    DAI_ASSERT( facOrder.size() == nrFactors() );
+    vector<Var> vars;
+    vars.reserve( nrVars() );
+    for( size_t k = 0; k < varOrder.size(); k++ )
+        vars.push_back( var( varOrder[k] ) );
+    vector<Factor> facs;
+    facs.reserve( nrFactors() );
+    for( size_t k = 0; k < facOrder.size(); k++ )
+        facs.push_back( factor( facOrder[k] ) );
+    return FactorGraph( facs.begin(), facs.end(), vars.begin(), vars.end(), facs.size(), vars.size() );
+}
+
+
 FactorGraph FactorGraph::maximalFactors() const {
     vector<size_t> maxfac( nrFactors() );
     map<size_t,size_t> newindex;
@@ -40,11 +40,10 @@ Real FBP::logZ() const {
 Prob FBP::calcIncomingMessageProduct( size_t I, bool without_i, size_t i ) const {
     Real c_I = Weight(I); // FBP: c_I
 
-    Factor Fprod( factor(I) );
+    Factor Fprod( factor(I).vars(), props.logdomain ? _logFactors[I].logp() : factor(I).p() );
     Prob &prod = Fprod.p();
 
     if( props.logdomain ) {
-        prod.takeLog();
         prod /= c_I; // FBP
     } else
         prod ^= (1.0 / c_I); // FBP
@@ -58,9 +57,9 @@ Prob FBP::calcIncomingMessageProduct( size_t I, bool without_i, size_t i ) const
             bforeach( const Neighbor &J, nbV(j) )
                 if( J != I ) { // for all J in nb(j) \ I
                     if( props.logdomain )
-                        prod_j += message( j, J.iter );
+                        simd::add( &(prod_j.p()[0]), messageValues( edge( j, J.iter ) ), prod_j.size() );
                     else
-                        prod_j *= message( j, J.iter );
+                        simd::mul( &(prod_j.p()[0]), messageValues( edge( j, J.iter ) ), prod_j.size() );
                 } else if( c_I != 1.0 ) {
                     // FBP: multiply by m_Ij^(1-1/c_I)
                     if( props.logdomain )
@@ -121,7 +120,7 @@ void FBP::calcNewMessage( size_t i, size_t _I ) {
         // OPTIMIZED VERSION
         marg = Prob( var(i).states(), 0.0 );
         // ind is the precalculated IndexFor(i,I) i.e. to x_I == k corresponds x_i == ind[k]
-        const ind_t ind = index(i,_I);
+        const ind_t &ind = index(i,_I);
         if( props.inference == Properties::InfType::SUMPROD )
             for( size_t r = 0; r < prod.size(); ++r )
                 marg.set( ind[r], marg[ind[r]] + prod[r] );
@@ -137,13 +136,13 @@ void FBP::calcNewMessage( size_t i, size_t _I ) {
 
     // Store result
     if( props.logdomain )
-        newMessage(i,_I) = marg.log();
+        setNewMessage( i, _I, marg.log() );
     else
-        newMessage(i,_I) = marg;
+        setNewMessage( i, _I, marg );
 
     // Update the residual if necessary
     if( props.updates == Properties::UpdateType::SEQMAX )
-        updateResidual( i, _I , dist( newMessage( i, _I ), message( i, _I ), DISTLINF ) );
+        updateResidual( i, _I, messageResidual( edge(i,_I) ) );
 }
 
 
@@ -70,6 +70,10 @@ void HAK::setProperties( const PropertySet &opts ) {
         props.init = opts.getStringAs<Properties::InitType>("init");
     else
         props.init = Properties::InitType::UNIFORM;
+    if( opts.hasKey("logdomain") )
+        props.logdomain = opts.getStringAs<bool>("logdomain");
+    else
+        props.logdomain = false;
 }
 
 
@@ -84,6 +88,7 @@ PropertySet HAK::getProperties() const {
     opts.set( "init", props.init );
     opts.set( "loopdepth", props.loopdepth );
     opts.set( "damping", props.damping );
+    opts.set( "logdomain", props.logdomain );
     return opts;
 }
 
@@ -99,7 +104,8 @@ string HAK::printProperties() const {
     s << "clusters=" << props.clusters << ",";
     s << "init=" << props.init << ",";
     s << "loopdepth=" << props.loopdepth << ",";
-    s << "damping=" << props.damping << "]";
+    s << "damping=" << props.damping << ",";
+    s << "logdomain=" << props.logdomain << "]";
     return s.str();
 }
 
@@ -324,6 +330,80 @@ void HAK::init() {
 }
 
 
+template<class F, class ORVec>
+bool HAK::updateInnerRegion( size_t beta, vector<F> &Qa, vector<F> &Qb, vector<vector<F> > &mab, vector<vector<F> > &mba, const ORVec &ors ) {
+    bforeach( const Neighbor &alpha, nbIR(beta) ) {
+        size_t _beta = alpha.dual;
+        mab[alpha][_beta] = Qa[alpha].marginal(IR(beta)) / mba[alpha][_beta];
+        /* TODO: INVESTIGATE THIS PROBLEM
+         *
+         * In some cases, the muab's can have very large entries because the muba's have very
+         * small entries. This may cause NANs later on (e.g., multiplying large quantities may
+         * result in +inf; normalization then tries to calculate inf / inf which is NAN).
+         * A fix of this problem would consist in normalizing the messages muab.
+         * However, it is not obvious whether this is a real solution, because it has a
+         * negative performance impact and the NAN's seem to be a symptom of a fundamental
+         * numerical unstability.
+         */
+         mab[alpha][_beta].normalize();
+    }
+
+    F Qb_new;
+    bforeach( const Neighbor &alpha, nbIR(beta) ) {
+        size_t _beta = alpha.dual;
+        Qb_new *= mab[alpha][_beta] ^ (1 / (nbIR(beta).size() + IR(beta).c()));
+    }
+
+    Qb_new.normalize();
+    if( Qb_new.hasNaNs() ) {
+        // TODO: WHAT TO DO IN THIS CASE?
+        cerr << name() << "::doGBP:  Qb_new has NaNs!" << endl;
+        return false;
+    }
+    /* TODO: WHAT IS THE PURPOSE OF THE FOLLOWING CODE?
+     *
+     *   _Qb[beta] = Qb_new.makeZero(1e-100);
+     */
+
+    if( props.doubleloop || props.damping == 0.0 )
+        Qb[beta] = Qb_new; // no damping for double loop
+    else
+        Qb[beta] = (Qb_new^(1.0 - props.damping)) * (Qb[beta]^props.damping);
+
+    bforeach( const Neighbor &alpha, nbIR(beta) ) {
+        size_t _beta = alpha.dual;
+        mba[alpha][_beta] = Qb[beta] / mab[alpha][_beta];
+
+        /* TODO: INVESTIGATE WHETHER THIS HACK (INVENTED BY KEES) TO PREVENT NANS MAKES SENSE
+         *
+         *   muba(beta,*alpha).makePositive(1e-100);
+         *
+         */
+
+        F Qa_new = ors[alpha];
+        bforeach( const Neighbor &gamma, nbOR(alpha) )
+            Qa_new *= mba[alpha][gamma.iter];
+        Qa_new ^= (1.0 / OR(alpha).c());
+        Qa_new.normalize();
+        if( Qa_new.hasNaNs() ) {
+            cerr << name() << "::doGBP:  Qa_new has NaNs!" << endl;
+            return false;
+        }
+        /* TODO: WHAT IS THE PURPOSE OF THE FOLLOWING CODE?
+         *
+         *   _Qb[beta] = Qb_new.makeZero(1e-100);
+         */
+
+        if( props.doubleloop || props.damping == 0.0 )
+            Qa[alpha] = Qa_new; // no damping for double loop
+        else
+            // FIXME: GEOMETRIC DAMPING IS SLOW!
+            Qa[alpha] = (Qa_new^(1.0 - props.damping)) * (Qa[alpha]^props.damping);
+    }
+    return true;
+}
+
+
 Real HAK::doGBP() {
     if( props.verbose >= 1 )
         cerr << "Starting " << identify() << "...";
@@ -346,79 +426,45 @@ Real HAK::doGBP() {
     for( size_t I = 0; I < nrFactors(); I++ )
         oldBeliefsF.push_back( beliefF(I) );
 
+    // In the logarithmic domain, work on logarithmic copies of the beliefs, messages and outer region factors
+    vector<LogFactor> logQa, logQb, logORs;
+    vector<vector<LogFactor> > logmuab, logmuba;
+    if( props.logdomain ) {
+        logQa.reserve( nrORs() );
+        logORs.reserve( nrORs() );
+        logmuab.resize( nrORs() );
+        logmuba.resize( nrORs() );
+        for( size_t alpha = 0; alpha < nrORs(); alpha++ ) {
+            logQa.push_back( LogFactor( _Qa[alpha] ) );
+            logORs.push_back( LogFactor( OR(alpha) ) );
+            bforeach( const Neighbor &beta, nbOR(alpha) ) {
+                logmuab[alpha].push_back( LogFactor( muab( alpha, beta.iter ) ) );
+                logmuba[alpha].push_back( LogFactor( muba( alpha, beta.iter ) ) );
+            }
+        }
+        logQb.reserve( nrIRs() );
+        for( size_t beta = 0; beta < nrIRs(); beta++ )
+            logQb.push_back( LogFactor( _Qb[beta] ) );
+    }
+
     // do several passes over the network until maximum number of iterations has
     // been reached or until the maximum belief difference is smaller than tolerance
     Real maxDiff = INFINITY;
     for( _iters = 0; _iters < props.maxiter && maxDiff > props.tol; _iters++ ) {
         for( size_t beta = 0; beta < nrIRs(); beta++ ) {
-            bforeach( const Neighbor &alpha, nbIR(beta) ) {
-                size_t _beta = alpha.dual;
-                muab( alpha, _beta ) = _Qa[alpha].marginal(IR(beta)) / muba(alpha,_beta);
-                /* TODO: INVESTIGATE THIS PROBLEM
-                 *
-                 * In some cases, the muab's can have very large entries because the muba's have very
-                 * small entries. This may cause NANs later on (e.g., multiplying large quantities may
-                 * result in +inf; normalization then tries to calculate inf / inf which is NAN).
-                 * A fix of this problem would consist in normalizing the messages muab.
-                 * However, it is not obvious whether this is a real solution, because it has a
-                 * negative performance impact and the NAN's seem to be a symptom of a fundamental
-                 * numerical unstability.
-                 */
-                 muab(alpha,_beta).normalize();
-            }
-
-            Factor Qb_new;
-            bforeach( const Neighbor &alpha, nbIR(beta) ) {
-                size_t _beta = alpha.dual;
-                Qb_new *= muab(alpha,_beta) ^ (1 / (nbIR(beta).size() + IR(beta).c()));
-            }
-
-            Qb_new.normalize();
-            if( Qb_new.hasNaNs() ) {
-                // TODO: WHAT TO DO IN THIS CASE?
-                cerr << name() << "::doGBP:  Qb_new has NaNs!" << endl;
-                return 1.0;
-            }
-            /* TODO: WHAT IS THE PURPOSE OF THE FOLLOWING CODE?
-             *
-             *   _Qb[beta] = Qb_new.makeZero(1e-100);
-             */
-
-            if( props.doubleloop || props.damping == 0.0 )
-                _Qb[beta] = Qb_new; // no damping for double loop
+            bool ok;
+            if( props.logdomain )
+                ok = updateInnerRegion( beta, logQa, logQb, logmuab, logmuba, logORs );
             else
-                _Qb[beta] = (Qb_new^(1.0 - props.damping)) * (_Qb[beta]^props.damping);
-
-            bforeach( const Neighbor &alpha, nbIR(beta) ) {
-                size_t _beta = alpha.dual;
-                muba(alpha,_beta) = _Qb[beta] / muab(alpha,_beta);
-
-                /* TODO: INVESTIGATE WHETHER THIS HACK (INVENTED BY KEES) TO PREVENT NANS MAKES SENSE
-                 *
-                 *   muba(beta,*alpha).makePositive(1e-100);
-                 *
-                 */
-
-                Factor Qa_new = OR(alpha);
-                bforeach( const Neighbor &gamma, nbOR(alpha) )
-                    Qa_new *= muba(alpha,gamma.iter);
-                Qa_new ^= (1.0 / OR(alpha).c());
-                Qa_new.normalize();
-                if( Qa_new.hasNaNs() ) {
-                    cerr << name() << "::doGBP:  Qa_new has NaNs!" << endl;
-                    return 1.0;
-                }
-                /* TODO: WHAT IS THE PURPOSE OF THE FOLLOWING CODE?
-                 *
-                 *   _Qb[beta] = Qb_new.makeZero(1e-100);
-                 */
-
-                if( props.doubleloop || props.damping == 0.0 )
-                    _Qa[alpha] = Qa_new; // no damping for double loop
-                else
-                    // FIXME: GEOMETRIC DAMPING IS SLOW!
-                _Qa[alpha] = (Qa_new^(1.0 - props.damping)) * (_Qa[alpha]^props.damping);
-            }
+                ok = updateInnerRegion( beta, _Qa, _Qb, _muab, _muba, _ORs );
+            if( !ok )
+                return 1.0;
+        }
+        if( props.logdomain ) {
+            for( size_t alpha = 0; alpha < nrORs(); alpha++ )
+                _Qa[alpha] = logQa[alpha].toFactor();
+            for( size_t beta = 0; beta < nrIRs(); beta++ )
+                _Qb[beta] = logQb[beta].toFactor();
         }
 
         // Calculate new single variable beliefs and compare with old ones
@@ -438,6 +484,14 @@ Real HAK::doGBP() {
             cerr << name() << "::doGBP:  maxdiff " << maxDiff << " after " << _iters+1 << " passes" << endl;
     }
 
+    if( props.logdomain ) {
+        for( size_t alpha = 0; alpha < nrORs(); alpha++ )
+            bforeach( const Neighbor &beta, nbOR(alpha) ) {
+                muab( alpha, beta.iter ) = logmuab[alpha][beta.iter].toFactor();
+                muba( alpha, beta.iter ) = logmuba[alpha][beta.iter].toFactor();
+            }
+    }
+
     if( maxDiff > _maxdiff )
         _maxdiff = maxDiff;
 
@@ -562,6 +616,7 @@ Real HAK::doDoubleLoop() {
 
 
 Real HAK::run() {
+    MemoryPool::Scope scope( memoryPool() );
     if( props.doubleloop )
         return doDoubleLoop();
     else
@@ -0,0 +1,262 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+#include <list>
+#include <dai/index.h>
+#include <dai/util.h>
+#ifdef DAI_WITH_THREADS
+#include <boost/thread/mutex.hpp>
+#endif
+
+
+namespace dai {
+
+
+using namespace std;
+
+
+ContractionPlan::ContractionPlan( const VarSet &forVars, const VarSet &indexVarsA, const VarSet &indexVarsB ) : _dims(), _size(1) {
+    VarSet::const_iterator a = indexVarsA.begin();
+    VarSet::const_iterator b = indexVarsB.begin();
+    size_t strideA = 1;
+    size_t strideB = 1;
+    for( VarSet::const_iterator v = forVars.begin(); v != forVars.end(); ++v ) {
+        // find the strides of *v in both index sets
+        for( ; a != indexVarsA.end() && *a < *v; ++a )
+            strideA *= a->states();
+        for( ; b != indexVarsB.end() && *b < *v; ++b )
+            strideB *= b->states();
+        Dim dim;
+        dim.range = v->states();
+        dim.strideA = (a != indexVarsA.end() && *a == *v) ? strideA : 0;
+        dim.strideB = (b != indexVarsB.end() && *b == *v) ? strideB : 0;
+        _size *= dim.range;
+
+        if( dim.range == 1 )
+            continue;
+        if( !_dims.empty() ) {
+            // merge with the previous dimension if the strides are compatible
+            Dim &prev = _dims.back();
+            if( dim.strideA == prev.strideA * prev.range && dim.strideB == prev.strideB * prev.range ) {
+                prev.range *= dim.range;
+                continue;
+            }
+        }
+        _dims.push_back( dim );
+    }
+}
+
+
+MultiContractionPlan::MultiContractionPlan( const VarSet &forVars, const IndexSets &indexVars ) : _ranges(), _strides(), _nrIndexSets(indexVars.size()), _size(1) {
+    vector<VarSet::const_iterator, PoolAllocator<VarSet::const_iterator> > its;
+    its.reserve( _nrIndexSets );
+    for( size_t k = 0; k < _nrIndexSets; k++ )
+        its.push_back( indexVars[k].begin() );
+    Indices stride( _nrIndexSets, 1 );
+    Indices dimStrides( _nrIndexSets );
+    for( VarSet::const_iterator v = forVars.begin(); v != forVars.end(); ++v ) {
+        size_t range = v->states();
+        _size *= range;
+        // find the strides of *v in all index sets
+        for( size_t k = 0; k < _nrIndexSets; k++ ) {
+            VarSet::const_iterator &it = its[k];
+            for( ; it != indexVars[k].end() && *it < *v; ++it )
+                stride[k] *= it->states();
+            dimStrides[k] = (it != indexVars[k].end() && *it == *v) ? stride[k] : 0;
+        }
+
+        if( range == 1 )
+            continue;
+        if( !_ranges.empty() ) {
+            // merge with the previous dimension if the strides are compatible
+            size_t &prevRange = _ranges.back();
+            const size_t *prevStrides = &(_strides[_strides.size() - _nrIndexSets]);
+            bool compatible = true;
+            for( size_t k = 0; k < _nrIndexSets && compatible; k++ )
+                if( dimStrides[k] != prevStrides[k] * prevRange )
+                    compatible = false;
+            if( compatible ) {
+                prevRange *= range;
+                continue;
+            }
+        }
+        _ranges.push_back( range );
+        _strides.insert( _strides.end(), dimStrides.begin(), dimStrides.end() );
+    }
+}
+
+
+IndexMap::IndexMap( const VarSet &from, const VarSet &to ) : _ranges(), _strides() {
+    VarSet::const_iterator t = to.begin();
+    size_t stride = 1;
+    size_t used = 0;
+    for( VarSet::const_iterator v = from.begin(); v != from.end(); ++v ) {
+        // find the stride of *v in to
+        for( ; t != to.end() && *t < *v; ++t )
+            stride *= t->states();
+        _ranges.push_back( v->states() );
+        if( t != to.end() && *t == *v ) {
+            _strides.push_back( stride );
+            used = _ranges.size();
+        } else
+            _strides.push_back( 0 );
+    }
+    // trailing variables that are not in to do not contribute
+    _ranges.resize( used );
+    _strides.resize( used );
+}
+
+
+IndexTable::IndexTable( const Var &v, const VarSet &vs, Type type ) : _size( BigInt_size_t( vs.nrStates() ) ), _states(1), _stride(1), _entries8(), _entries16(), _entries32(), _entries() {
+    for( VarSet::const_iterator w = vs.begin(); w != vs.end() && *w < v; ++w )
+        _stride *= w->states();
+    if( vs.contains( v ) )
+        _states = v.states();
+
+    if( type == Type::STRIDED )
+        return;
+    if( type == Type::COMPACT && _states - 1 <= 0xFFUL ) {
+        _entries8.reserve( _size );
+        for( size_t r = 0; r < _size; r++ )
+            _entries8.push_back( (boost::uint8_t)((r / _stride) % _states) );
+    } else if( type == Type::COMPACT && _states - 1 <= 0xFFFFUL ) {
+        _entries16.reserve( _size );
+        for( size_t r = 0; r < _size; r++ )
+            _entries16.push_back( (boost::uint16_t)((r / _stride) % _states) );
+    } else if( type == Type::COMPACT && _states - 1 <= 0xFFFFFFFFUL ) {
+        _entries32.reserve( _size );
+        for( size_t r = 0; r < _size; r++ )
+            _entries32.push_back( (boost::uint32_t)((r / _stride) % _states) );
+    } else {
+        _entries.reserve( _size );
+        for( size_t r = 0; r < _size; r++ )
+            _entries.push_back( (r / _stride) % _states );
+    }
+}
+
+
+namespace {
+
+
+/// Type of the keys of the plan cache (labels and numbers of states of all three VarSets)
+typedef vector<size_t> PlanKey;
+
+/// Type of the list of cached plans, ordered from most recently to least recently used
+typedef list<pair<PlanKey, boost::shared_ptr<const ContractionPlan> > > PlanList;
+
+/// Least-recently-used cache of contraction plans
+struct PlanCache {
+    /// Cached plans, ordered from most recently to least recently used
+    PlanList plans;
+    /// Maps keys to entries of \a plans
+    hash_map<PlanKey, PlanList::iterator> lookup;
+    /// Maximum number of cached plans
+    size_t maxPlans;
+    /// Key of the plan that is looked up (kept to reuse its memory)
+    PlanKey key;
+#ifdef DAI_WITH_THREADS
+    /// Protects the cache against simultaneous use by several threads
+    boost::mutex mutex;
+#endif
+
+    /// Default constructor
+    PlanCache() : plans(), lookup(), maxPlans(1024), key() {}
+
+    /// Removes least recently used plans until at most \a maxPlans remain
+    void shrink() {
+        while( lookup.size() > maxPlans ) {
+            lookup.erase( plans.back().first );
+            plans.pop_back();
+        }
+    }
+};
+
+
+/// Returns the global plan cache
+PlanCache& planCache() {
+    static PlanCache cache;
+    return cache;
+}
+
+
+/// Locks the plan cache during its lifetime (only if libDAI is built with DAI_WITH_THREADS)
+struct PlanCacheLock {
+#ifdef DAI_WITH_THREADS
+    /// The lock on the mutex of the cache
+    boost::mutex::scoped_lock lock;
+
+    /// Locks \a cache
+    PlanCacheLock( PlanCache &cache ) : lock( cache.mutex ) {}
+#else
+    /// Does nothing
+    PlanCacheLock( PlanCache & ) {}
+#endif
+};
+
+
+/// Appends the labels and numbers of states of the variables in \a vs to \a key
+void appendToKey( PlanKey &key, const VarSet &vs ) {
+    key.push_back( vs.size() );
+    for( VarSet::const_iterator v = vs.begin(); v != vs.end(); ++v ) {
+        key.push_back( v->label() );
+        key.push_back( v->states() );
+    }
+}
+
+
+} // end of anonymous namespace
+
+
+boost::shared_ptr<const ContractionPlan> ContractionPlan::get( const VarSet &forVars, const VarSet &indexVarsA, const VarSet &indexVarsB ) {
+    PlanCache &cache = planCache();
+    PlanCacheLock lock( cache );
+    if( cache.maxPlans == 0 )
+        return boost::shared_ptr<const ContractionPlan>( new ContractionPlan( forVars, indexVarsA, indexVarsB ) );
+
+    PlanKey &key = cache.key;
+    key.clear();
+    appendToKey( key, forVars );
+    appendToKey( key, indexVarsA );
+    appendToKey( key, indexVarsB );
+
+    hash_map<PlanKey, PlanList::iterator>::iterator found = cache.lookup.find( key );
+    if( found != cache.lookup.end() ) {
+        // move to the front of the list
+        cache.plans.splice( cache.plans.begin(), cache.plans, found->second );
+        return found->second->second;
+    } else {
+        boost::shared_ptr<const ContractionPlan> plan( new ContractionPlan( forVars, indexVarsA, indexVarsB ) );
+        cache.plans.push_front( make_pair( key, plan ) );
+        cache.lookup[key] = cache.plans.begin();
+        cache.shrink();
+        return plan;
+    }
+}
+
+
+void ContractionPlan::setCacheSize( size_t maxPlans ) {
+    PlanCache &cache = planCache();
+    PlanCacheLock lock( cache );
+    cache.maxPlans = maxPlans;
+    cache.shrink();
+}
+
+
+size_t ContractionPlan::cacheSize() {
+    return planCache().maxPlans;
+}
+
+
+size_t ContractionPlan::nrCached() {
+    PlanCache &cache = planCache();
+    PlanCacheLock lock( cache );
+    return cache.lookup.size();
+}
+
+
+} // end of namespace dai
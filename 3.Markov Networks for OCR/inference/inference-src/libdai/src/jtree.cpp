@@ -37,6 +37,14 @@ void JTree::setProperties( const PropertySet &opts ) {
         props.maxmem = opts.getStringAs<size_t>("maxmem");
     else
         props.maxmem = 0;
+    if( opts.hasKey("maxdensity") )
+        props.maxdensity = opts.getStringAs<Real>("maxdensity");
+    else
+        props.maxdensity = 0.0;
+    if( opts.hasKey("logdomain") )
+        props.logdomain = opts.getStringAs<bool>("logdomain");
+    else
+        props.logdomain = false;
 }
 
 
@@ -47,6 +55,8 @@ PropertySet JTree::getProperties() const {
     opts.set( "inference", props.inference );
     opts.set( "heuristic", props.heuristic );
     opts.set( "maxmem", props.maxmem );
+    opts.set( "maxdensity", props.maxdensity );
+    opts.set( "logdomain", props.logdomain );
     return opts;
 }
 
@@ -58,12 +68,14 @@ string JTree::printProperties() const {
     s << "updates=" << props.updates << ",";
     s << "heuristic=" << props.heuristic << ",";
     s << "inference=" << props.inference << ",";
-    s << "maxmem=" << props.maxmem << "]";
+    s << "maxmem=" << props.maxmem << ",";
+    s << "maxdensity=" << props.maxdensity << ",";
+    s << "logdomain=" << props.logdomain << "]";
     return s.str();
 }
 
 
-JTree::JTree( const FactorGraph &fg, const PropertySet &opts, bool automatic ) : DAIAlgRG(), _mes(), _logZ(), RTree(), Qa(), Qb(), props() {
+JTree::JTree( const FactorGraph &fg, const PropertySet &opts, bool automatic ) : DAIAlgRG(), _mes(), _logZ(), _sparseQa(), _useSparse(), _msgs(), _logQa(), _logQb(), _logMes(), RTree(), Qa(), Qb(), props() {
     setProperties( opts );
 
     if( automatic ) {
@@ -98,7 +110,7 @@ JTree::JTree( const FactorGraph &fg, const PropertySet &opts, bool automatic ) :
         // Estimate memory needed (rough upper bound)
         BigInt memneeded = 0;
         bforeach( const VarSet& cl, ElimVec )
-            memneeded += cl.nrStates();
+            memneeded += cl.nrStates().get();
         memneeded *= sizeof(Real) * fudge;
         if( props.verbose >= 1 ) {
             cerr << "Estimate of needed memory: " << memneeded / 1024 << "kB" << endl;
@@ -258,9 +270,72 @@ vector<Factor> JTree::beliefs() const {
 }
 
 
+void JTree::initQa() {
+    _useSparse.clear();
+    _useSparse.resize( nrORs(), false );
+    _sparseQa.clear();
+    if( props.maxdensity > 0.0 ) {
+        _sparseQa.resize( nrORs() );
+        for( size_t alpha = 0; alpha < nrORs(); alpha++ ) {
+            SparseFactor sparseOR( OR(alpha) );
+            if( sparseOR.density() <= props.maxdensity ) {
+                _sparseQa[alpha] = sparseOR;
+                _useSparse[alpha] = true;
+                // the dense belief is only needed after running
+                Qa[alpha] = Factor();
+            }
+        }
+    }
+}
+
+
+void JTree::finishQa() {
+    for( size_t alpha = 0; alpha < nrORs(); alpha++ )
+        if( _useSparse[alpha] )
+            Qa[alpha] = _sparseQa[alpha].toFactor();
+    _sparseQa.clear();
+    _useSparse.clear();
+}
+
+
+Factor JTree::marginalQa( size_t alpha, const VarSet &vs, bool normed ) const {
+    if( _useSparse[alpha] ) {
+        if( props.inference == Properties::InfType::SUMPROD )
+            return _sparseQa[alpha].marginal( vs, normed ).toFactor();
+        else
+            return _sparseQa[alpha].maxMarginal( vs, normed ).toFactor();
+    } else {
+        if( props.inference == Properties::InfType::SUMPROD )
+            return Qa[alpha].marginal( vs, normed );
+        else
+            return Qa[alpha].maxMarginal( vs, normed );
+    }
+}
+
+
+Factor JTree::productMarginalOR( size_t alpha, const vector<const Factor*> &msgs, const VarSet &vs, bool normed ) const {
+    if( _useSparse[alpha] ) {
+        SparseFactor prod( _sparseQa[alpha] );
+        for( size_t k = 0; k < msgs.size(); k++ )
+            prod *= *msgs[k];
+        if( props.inference == Properties::InfType::SUMPROD )
+            return prod.marginal( vs, normed ).toFactor();
+        else
+            return prod.maxMarginal( vs, normed ).toFactor();
+    } else {
+        if( props.inference == Properties::InfType::SUMPROD )
+            return OR(alpha).productMarginal( msgs, vs, normed );
+        else
+            return OR(alpha).productMaxMarginal( msgs, vs, normed );
+    }
+}
+
+
 void JTree::runHUGIN() {
+    initQa();
     for( size_t alpha = 0; alpha < nrORs(); alpha++ )
-        Qa[alpha] = OR(alpha);
+        if( !_useSparse[alpha] )
+            Qa[alpha] = OR(alpha);
 
     for( size_t beta = 0; beta < nrIRs(); beta++ )
         Qb[beta].fill( 1.0 );
@@ -270,42 +345,47 @@ void JTree::runHUGIN() {
     for( size_t i = RTree.size(); (i--) != 0; ) {
 //      Make outer region RTree[i].first consistent with outer region RTree[i].second
 //      IR(i) = seperator OR(RTree[i].first) && OR(RTree[i].second)
-        Factor new_Qb;
-        if( props.inference == Properties::InfType::SUMPROD )
-            new_Qb = Qa[RTree[i].second].marginal( IR( i ), false );
-        else
-            new_Qb = Qa[RTree[i].second].maxMarginal( IR( i ), false );
+        Factor new_Qb = marginalQa( RTree[i].second, IR( i ), false );
 
         _logZ += log(new_Qb.normalize());
-        Qa[RTree[i].first] *= new_Qb / Qb[i];
+        if( _useSparse[RTree[i].first] )
+            _sparseQa[RTree[i].first] *= new_Qb / Qb[i];
+        else
+            Qa[RTree[i].first] *= new_Qb / Qb[i];
         Qb[i] = new_Qb;
     }
-    if( RTree.empty() )
-        _logZ += log(Qa[0].normalize() );
+    size_t root = RTree.empty() ? 0 : RTree[0].first;
+    if( _useSparse[root] )
+        _logZ += log(_sparseQa[root].normalize());
     else
-        _logZ += log(Qa[RTree[0].first].normalize());
+        _logZ += log(Qa[root].normalize());
 
     // DistributeEvidence
     for( size_t i = 0; i < RTree.size(); i++ ) {
 //      Make outer region RTree[i].second consistent with outer region RTree[i].first
 //      IR(i) = seperator OR(RTree[i].first) && OR(RTree[i].second)
-        Factor new_Qb;
-        if( props.inference == Properties::InfType::SUMPROD )
-            new_Qb = Qa[RTree[i].first].marginal( IR( i ) );
-        else
-            new_Qb = Qa[RTree[i].first].maxMarginal( IR( i ) );
+        Factor new_Qb = marginalQa( RTree[i].first, IR( i ), true );
 
-        Qa[RTree[i].second] *= new_Qb / Qb[i];
+        if( _useSparse[RTree[i].second] )
+            _sparseQa[RTree[i].second] *= new_Qb / Qb[i];
+        else
+            Qa[RTree[i].second] *= new_Qb / Qb[i];
         Qb[i] = new_Qb;
     }
 
     // Normalize
     for( size_t alpha = 0; alpha < nrORs(); alpha++ )
-        Qa[alpha].normalize();
+        if( _useSparse[alpha] )
+            _sparseQa[alpha].normalize();
+        else
+            Qa[alpha].normalize();
+    finishQa();
 }
 
 
 void JTree::runShaferShenoy() {
+    initQa();
+
     // First pass
     _logZ = 0.0;
     for( size_t e = nrIRs(); (e--) != 0; ) {
@@ -316,14 +396,12 @@ void JTree::runShaferShenoy() {
         size_t j = nbIR(e)[0].node; // = RTree[e].first
         size_t _e = nbIR(e)[0].dual;
 
-        Factor msg = OR(i);
+        // multiply OR(i) with incoming messages and marginalize, without storing the product
+        _msgs.clear();
         bforeach( const Neighbor &k, nbOR(i) )
             if( k != e )
-                msg *= message( i, k.iter );
-        if( props.inference == Properties::InfType::SUMPROD )
-            message( j, _e ) = msg.marginal( IR(e), false );
-        else
-            message( j, _e ) = msg.maxMarginal( IR(e), false );
+                _msgs.push_back( &message( i, k.iter ) );
+        message( j, _e ) = productMarginalOR( i, _msgs, IR(e), false );
         _logZ += log( message(j,_e).normalize() );
     }
 
@@ -333,46 +411,165 @@ void JTree::runShaferShenoy() {
         size_t j = nbIR(e)[1].node; // = RTree[e].second
         size_t _e = nbIR(e)[1].dual;
 
-        Factor msg = OR(i);
+        // multiply OR(i) with incoming messages and marginalize, without storing the product
+        _msgs.clear();
         bforeach( const Neighbor &k, nbOR(i) )
             if( k != e )
-                msg *= message( i, k.iter );
-        if( props.inference == Properties::InfType::SUMPROD )
-            message( j, _e ) = msg.marginal( IR(e) );
-        else
-            message( j, _e ) = msg.maxMarginal( IR(e) );
+                _msgs.push_back( &message( i, k.iter ) );
+        message( j, _e ) = productMarginalOR( i, _msgs, IR(e), true );
     }
 
     // Calculate beliefs
     for( size_t alpha = 0; alpha < nrORs(); alpha++ ) {
-        Factor piet = OR(alpha);
-        bforeach( const Neighbor &k, nbOR(alpha) )
-            piet *= message( alpha, k.iter );
-        if( nrIRs() == 0 ) {
-            _logZ += log( piet.normalize() );
-            Qa[alpha] = piet;
-        } else if( alpha == nbIR(0)[0].node /*RTree[0].first*/ ) {
-            _logZ += log( piet.normalize() );
-            Qa[alpha] = piet;
-        } else
-            Qa[alpha] = piet.normalized();
+        bool isRoot = (nrIRs() == 0) || (alpha == nbIR(0)[0].node /*RTree[0].first*/);
+        if( _useSparse[alpha] ) {
+            SparseFactor &piet = _sparseQa[alpha];
+            bforeach( const Neighbor &k, nbOR(alpha) )
+                piet *= message( alpha, k.iter );
+            if( isRoot )
+                _logZ += log( piet.normalize() );
+            else
+                piet.normalize();
+        } else {
+            Factor piet = OR(alpha);
+            bforeach( const Neighbor &k, nbOR(alpha) )
+                piet *= message( alpha, k.iter );
+            if( isRoot ) {
+                _logZ += log( piet.normalize() );
+                Qa[alpha] = piet;
+            } else
+                Qa[alpha] = piet.normalized();
+        }
     }
 
     // Only for logZ (and for belief)...
-    for( size_t beta = 0; beta < nrIRs(); beta++ ) {
-        if( props.inference == Properties::InfType::SUMPROD )
-            Qb[beta] = Qa[nbIR(beta)[0].node].marginal( IR(beta) );
+    for( size_t beta = 0; beta < nrIRs(); beta++ )
+        Qb[beta] = marginalQa( nbIR(beta)[0].node, IR(beta), true );
+    finishQa();
+}
+
+
+LogFactor JTree::marginalLog( const LogFactor &f, const VarSet &vs, bool normed ) const {
+    if( props.inference == Properties::InfType::SUMPROD )
+        return f.marginal( vs, normed );
+    else
+        return f.maxMarginal( vs, normed );
+}
+
+
+void JTree::runHUGINLog() {
+    vector<LogFactor> &logQa = _logQa;
+    logQa.resize( nrORs() );
+    for( size_t alpha = 0; alpha < nrORs(); alpha++ )
+        logQa[alpha] = LogFactor( OR(alpha) );
+    vector<LogFactor> &logQb = _logQb;
+    logQb.resize( nrIRs() );
+    for( size_t beta = 0; beta < nrIRs(); beta++ )
+        logQb[beta] = LogFactor( IR(beta) );
+
+    // CollectEvidence
+    _logZ = 0.0;
+    for( size_t i = RTree.size(); (i--) != 0; ) {
+        LogFactor new_Qb = marginalLog( logQa[RTree[i].second], IR( i ), false );
+        _logZ += new_Qb.normalize();
+        logQa[RTree[i].first] *= new_Qb / logQb[i];
+        logQb[i] = new_Qb;
+    }
+    size_t root = RTree.empty() ? 0 : RTree[0].first;
+    _logZ += logQa[root].normalize();
+
+    // DistributeEvidence
+    for( size_t i = 0; i < RTree.size(); i++ ) {
+        LogFactor new_Qb = marginalLog( logQa[RTree[i].first], IR( i ), true );
+        logQa[RTree[i].second] *= new_Qb / logQb[i];
+        logQb[i] = new_Qb;
+    }
+
+    // Normalize
+    for( size_t alpha = 0; alpha < nrORs(); alpha++ ) {
+        logQa[alpha].normalize();
+        Qa[alpha] = logQa[alpha].toFactor();
+    }
+    for( size_t beta = 0; beta < nrIRs(); beta++ )
+        Qb[beta] = logQb[beta].toFactor();
+}
+
+
+void JTree::runShaferShenoyLog() {
+    vector<LogFactor> &logQa = _logQa;
+    logQa.resize( nrORs() );
+    for( size_t alpha = 0; alpha < nrORs(); alpha++ )
+        logQa[alpha] = LogFactor( OR(alpha) );
+    vector<vector<LogFactor> > &logmes = _logMes;
+    logmes.resize( nrORs() );
+    for( size_t alpha = 0; alpha < nrORs(); alpha++ ) {
+        logmes[alpha].resize( nbOR(alpha).size() );
+        bforeach( const Neighbor &beta, nbOR(alpha) )
+            logmes[alpha][beta.iter] = LogFactor( IR(beta) );
+    }
+
+    // First pass
+    _logZ = 0.0;
+    for( size_t e = nrIRs(); (e--) != 0; ) {
+        // send a message from RTree[e].second to RTree[e].first
+        size_t i = nbIR(e)[1].node; // = RTree[e].second
+        size_t j = nbIR(e)[0].node; // = RTree[e].first
+        size_t _e = nbIR(e)[0].dual;
+
+        LogFactor piet = logQa[i];
+        bforeach( const Neighbor &k, nbOR(i) )
+            if( k != e )
+                piet *= logmes[i][k.iter];
+        logmes[j][_e] = marginalLog( piet, IR(e), false );
+        _logZ += logmes[j][_e].normalize();
+    }
+
+    // Second pass
+    for( size_t e = 0; e < nrIRs(); e++ ) {
+        size_t i = nbIR(e)[0].node; // = RTree[e].first
+        size_t j = nbIR(e)[1].node; // = RTree[e].second
+        size_t _e = nbIR(e)[1].dual;
+
+        LogFactor piet = logQa[i];
+        bforeach( const Neighbor &k, nbOR(i) )
+            if( k != e )
+                piet *= logmes[i][k.iter];
+        logmes[j][_e] = marginalLog( piet, IR(e), true );
+    }
+
+    // Calculate beliefs
+    for( size_t alpha = 0; alpha < nrORs(); alpha++ ) {
+        bool isRoot = (nrIRs() == 0) || (alpha == nbIR(0)[0].node /*RTree[0].first*/);
+        bforeach( const Neighbor &k, nbOR(alpha) )
+            logQa[alpha] *= logmes[alpha][k.iter];
+        if( isRoot )
+            _logZ += logQa[alpha].normalize();
         else
-            Qb[beta] = Qa[nbIR(beta)[0].node].maxMarginal( IR(beta) );
+            logQa[alpha].normalize();
+        Qa[alpha] = logQa[alpha].toFactor();
+        bforeach( const Neighbor &k, nbOR(alpha) )
+            message( alpha, k.iter ) = logmes[alpha][k.iter].toFactor();
     }
+
+    // Only for logZ (and for belief)...
+    for( size_t beta = 0; beta < nrIRs(); beta++ )
+        Qb[beta] = marginalLog( logQa[nbIR(beta)[0].node], IR(beta), true ).toFactor();
 }
 
 
 Real JTree::run() {
-    if( props.updates == Properties::UpdateType::HUGIN )
-        runHUGIN();
-    else if( props.updates == Properties::UpdateType::SHSH )
-        runShaferShenoy();
+    MemoryPool::Scope scope( memoryPool() );
+    if( props.updates == Properties::UpdateType::HUGIN ) {
+        if( props.logdomain )
+            runHUGINLog();
+        else
+            runHUGIN();
+    } else if( props.updates == Properties::UpdateType::SHSH ) {
+        if( props.logdomain )
+            runShaferShenoyLog();
+        else
+            runShaferShenoy();
+    }
     return 0.0;
 }
 
@@ -393,10 +590,10 @@ Real JTree::logZ() const {
 
 size_t JTree::findEfficientTree( const VarSet& vs, RootedTree &Tree, size_t PreviousRoot ) const {
     // find new root clique (the one with maximal statespace overlap with vs)
-    BigInt maxval = 0;
+    FastBigInt maxval = 0;
     size_t maxalpha = 0;
     for( size_t alpha = 0; alpha < nrORs(); alpha++ ) {
-        BigInt val = VarSet(vs & OR(alpha).vars()).nrStates();
+        FastBigInt val = VarSet(vs & OR(alpha).vars()).nrStates();
         if( val > maxval ) {
             maxval = val;
             maxalpha = alpha;
@@ -511,7 +708,7 @@ Factor JTree::calcMarginal( const VarSet& vs ) {
             }
 
             // For all states of vsrem
-            for( State s(vsrem); s.valid(); s++ ) {
+            for( FlatState s(vsrem); s.valid(); s++ ) {
                 // CollectEvidence
                 Real logZ = 0.0;
                 for( size_t i = Tsize; (i--) != 0; ) {
@@ -597,9 +794,9 @@ std::vector<size_t> JTree::findMaximum() const {
         // The allowed configuration is restrained according to the variables assigned so far:
         // pick the argmax amongst the allowed states
         Real maxProb = -numeric_limits<Real>::max();
-        State maxState( OR(alpha).vars() );
+        FlatState maxState( OR(alpha).vars() );
         size_t maxcount = 0;
-        for( State s( OR(alpha).vars() ); s.valid(); ++s ) {
+        for( FlatState s( OR(alpha).vars() ); s.valid(); ++s ) {
             // First, calculate whether this state is consistent with variables that
             // have been assigned already
             bool allowedState = true;
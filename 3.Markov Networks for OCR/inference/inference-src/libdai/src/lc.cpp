@@ -220,10 +220,15 @@ Factor LC::NewPancake (size_t i, size_t _I, bool & hasNaNs) {
     Factor A_I;
     for( VarSet::const_iterator k = Ivars.begin(); k != Ivars.end(); k++ )
         if( var(i) != *k )
-            A_I *= (_pancakes[findVar(*k)] * factor(I).inverse()).marginal( Ivars / var(i), false );
+            A_I *= _pancakes[findVar(*k)].productMarginal( factor(I).inverse(), Ivars / var(i), false );
     if( Ivars.size() > 1 )
         A_I ^= (1.0 / (Ivars.size() - 1));
-    Factor A_Ii = (_pancakes[i] * factor(I).inverse() * _phis[i][_I].inverse()).marginal( Ivars / var(i), false );
+    Factor I_inv = factor(I).inverse();
+    Factor phi_inv = _phis[i][_I].inverse();
+    vector<const Factor*> A_Ii_factors;
+    A_Ii_factors.push_back( &I_inv );
+    A_Ii_factors.push_back( &phi_inv );
+    Factor A_Ii = _pancakes[i].productMarginal( A_Ii_factors, Ivars / var(i), false );
     Factor quot = A_I / A_Ii;
     if( props.damping != 0.0 )
         quot = (quot^(1.0 - props.damping)) * (_phis[i][_I]^props.damping);
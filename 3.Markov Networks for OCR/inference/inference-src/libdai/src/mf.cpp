@@ -20,6 +20,20 @@ namespace dai {
 using namespace std;
 
 
+namespace {
+
+
+/// Stores the values of \a beliefs contiguously in \a values
+void stackBeliefs( const vector<Factor> &beliefs, vector<Real> &values ) {
+    values.clear();
+    for( size_t i = 0; i < beliefs.size(); ++i )
+        values.insert( values.end(), beliefs[i].p().begin(), beliefs[i].p().end() );
+}
+
+
+} // end of anonymous namespace
+
+
 void MF::setProperties( const PropertySet &opts ) {
     DAI_ASSERT( opts.hasKey("tol") );
     DAI_ASSERT( opts.hasKey("maxiter") );
@@ -42,6 +56,16 @@ void MF::setProperties( const PropertySet &opts ) {
         props.updates = opts.getStringAs<Properties::UpdateType>("updates");
     else
         props.updates = Properties::UpdateType::NAIVE;
+    if( opts.hasKey("acceleration") )
+        props.acceleration = opts.getStringAs<Accelerator::Method>("acceleration");
+    else
+        props.acceleration = Accelerator::Method::NONE;
+    if( opts.hasKey("accelwindow") )
+        props.accelwindow = opts.getStringAs<size_t>("accelwindow");
+    else
+        props.accelwindow = 5;
+    if( props.accelwindow == 0 )
+        DAI_THROWE(MALFORMED_PROPERTY,"MF: accelwindow should be at least 1");
 }
 
 
@@ -53,6 +77,8 @@ PropertySet MF::getProperties() const {
     opts.set( "damping", props.damping );
     opts.set( "init", props.init );
     opts.set( "updates", props.updates );
+    opts.set( "acceleration", props.acceleration );
+    opts.set( "accelwindow", props.accelwindow );
     return opts;
 }
 
@@ -65,7 +91,9 @@ string MF::printProperties() const {
     s << "verbose=" << props.verbose << ",";
     s << "init=" << props.init << ",";
     s << "updates=" << props.updates << ",";
-    s << "damping=" << props.damping << "]";
+    s << "damping=" << props.damping << ",";
+    s << "acceleration=" << props.acceleration << ",";
+    s << "accelwindow=" << props.accelwindow << "]";
     return s.str();
 }
 
@@ -99,7 +127,7 @@ Factor MF::calcNewBelief( size_t i ) {
         Factor f_I = factor(I);
         if( props.updates == Properties::UpdateType::NAIVE )
             f_I.takeLog(true);
-        Factor msg_I_i = (belief_I_minus_i * f_I).marginal( var(i), false );
+        Factor msg_I_i = belief_I_minus_i.productMarginal( f_I, var(i), false );
         if( props.updates == Properties::UpdateType::NAIVE )
             result *= msg_I_i.exp();
         else
@@ -123,9 +151,14 @@ Real MF::run() {
 
     // do several passes over the network until maximum number of iterations has
     // been reached or until the maximum belief difference is smaller than tolerance
+    Accelerator accelerator( props.acceleration, props.accelwindow, true );
+    vector<Real> before, after;
+
     Real maxDiff = INFINITY;
     for( _iters = 0; _iters < props.maxiter && maxDiff > props.tol; _iters++ ) {
         random_shuffle( update_seq.begin(), update_seq.end(), rnd );
+        if( props.acceleration != Accelerator::Method::NONE )
+            stackBeliefs( _beliefs, before );
 
         maxDiff = -INFINITY;
         bforeach( const size_t &i, update_seq ) {
@@ -143,6 +176,17 @@ Real MF::run() {
             _beliefs[i] = nb;
         }
 
+        // replace the beliefs by the accelerated ones
+        if( props.acceleration != Accelerator::Method::NONE ) {
+            stackBeliefs( _beliefs, after );
+            accelerator.step( before, after );
+            for( size_t i = 0, k = 0; i < nrVars(); ++i ) {
+                for( size_t s = 0; s < _beliefs[i].nrStates(); ++s )
+                    _beliefs[i].set( s, after[k++] );
+                _beliefs[i].normalize();
+            }
+        }
+
         if( props.verbose >= 3 )
             cerr << name() << "::run:  maxdiff " << maxDiff << " after " << _iters+1 << " passes" << endl;
     }
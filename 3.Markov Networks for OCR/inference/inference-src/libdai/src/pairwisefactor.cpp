@@ -0,0 +1,278 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+#include <cmath>
+#include <algorithm>
+#include <dai/pairwisefactor.h>
+#include <dai/util.h>
+
+
+namespace dai {
+
+
+using namespace std;
+
+
+PairwiseFactor::PairwiseFactor( const Factor &f, Real tol ) : _kind(Kind::DENSE), _states(0), _offDiagonal(0.0), _diagonal(), _logScale(0.0), _slope(0.0), _truncation(0.0) {
+    if( f.vars().size() != 2 || f.vars().front().states() != f.vars().back().states() || f.vars().front().states() < 2 )
+        return;
+    const size_t k = f.vars().front().states();
+
+    // constant off the diagonal?
+    bool diagonal = true;
+    Real c = f[1];
+    for( size_t x2 = 0; x2 < k && diagonal; ++x2 )
+        for( size_t x1 = 0; x1 < k; ++x1 )
+            if( x1 != x2 && f[x1 + k * x2] != c ) {
+                diagonal = false;
+                break;
+            }
+    if( diagonal ) {
+        _kind = Kind::DIAGONAL;
+        _states = k;
+        _offDiagonal = c;
+        _diagonal.resize( k );
+        for( size_t x = 0; x < k; ++x )
+            _diagonal[x] = f[x * (k + 1)];
+        return;
+    }
+
+    // positive and only dependent on the distance to the diagonal?
+    // (the value at distance d is f(d,0), which has linear index d)
+    for( size_t d = 0; d < k; ++d )
+        if( f[d] <= 0.0 )
+            return;
+    for( size_t x2 = 0; x2 < k; ++x2 )
+        for( size_t x1 = 0; x1 < k; ++x1 )
+            if( f[x1 + k * x2] != f[x1 > x2 ? x1 - x2 : x2 - x1] )
+                return;
+    vector<Real> g( k );
+    for( size_t d = 0; d < k; ++d )
+        g[d] = std::log( f[d] );
+    Real a = g[0];
+    Real lambda = a - g[1];
+    Real tau = a - *min_element( g.begin(), g.end() );
+    if( !(lambda > 0.0) )
+        return;
+
+    // fit the truncated linear and the truncated quadratic form
+    bool linear = true, quadratic = true;
+    for( size_t d = 0; d < k; ++d ) {
+        Real eps = tol * (1.0 + dai::abs( g[d] ));
+        if( dai::abs( g[d] - (a - std::min( lambda * d, tau )) ) > eps )
+            linear = false;
+        if( dai::abs( g[d] - (a - std::min( lambda * d * d, tau )) ) > eps )
+            quadratic = false;
+    }
+    if( linear || quadratic ) {
+        _kind = linear ? Kind::TRUNCLINEAR : Kind::TRUNCQUADRATIC;
+        _states = k;
+        _logScale = a;
+        _slope = lambda;
+        _truncation = tau;
+    }
+}
+
+
+PairwiseFactor::PairwiseFactor( Kind kind, size_t states, Real logScale, Real slope, Real truncation ) : _kind(kind), _states(states), _offDiagonal(0.0), _diagonal(), _logScale(logScale), _slope(slope), _truncation(truncation) {
+    DAI_ASSERT( kind == Kind::TRUNCLINEAR || kind == Kind::TRUNCQUADRATIC );
+    DAI_ASSERT( slope > 0.0 && truncation >= 0.0 );
+}
+
+
+Real PairwiseFactor::operator()( size_t x1, size_t x2 ) const {
+    DAI_ASSERT( _kind != Kind::DENSE );
+    DAI_DEBASSERT( x1 < _states && x2 < _states );
+    if( _kind == Kind::DIAGONAL )
+        return (x1 == x2) ? _diagonal[x1] : _offDiagonal;
+    Real d = (Real)(x1 > x2 ? x1 - x2 : x2 - x1);
+    if( _kind == Kind::TRUNCQUADRATIC )
+        d *= d;
+    return std::exp( _logScale - std::min( _slope * d, _truncation ) );
+}
+
+
+Factor PairwiseFactor::toFactor( const VarSet &vs ) const {
+    DAI_ASSERT( vs.size() == 2 && vs.front().states() == _states && vs.back().states() == _states );
+    Factor f( vs );
+    for( size_t x2 = 0; x2 < _states; ++x2 )
+        for( size_t x1 = 0; x1 < _states; ++x1 )
+            f.set( x1 + _states * x2, (*this)( x1, x2 ) );
+    return f;
+}
+
+
+void PairwiseFactor::message( const Real *h, Real *m, bool sumprod ) const {
+    DAI_ASSERT( fast( sumprod ) );
+    const size_t k = _states;
+    if( _kind == Kind::DIAGONAL ) {
+        if( sumprod ) {
+            Real sum = 0.0;
+            for( size_t y = 0; y < k; ++y )
+                sum += h[y];
+            for( size_t x = 0; x < k; ++x ) {
+                Real v = _offDiagonal * (sum - h[x]) + _diagonal[x] * h[x];
+                m[x] = (v > 0.0) ? v : 0.0;
+            }
+        } else {
+            // off the diagonal, the maximum is attained at the largest value of h,
+            // or at the second largest value for the state of the largest one
+            size_t arg = 0;
+            for( size_t y = 1; y < k; ++y )
+                if( h[y] > h[arg] )
+                    arg = y;
+            Real second = 0.0;
+            for( size_t y = 0; y < k; ++y )
+                if( y != arg && h[y] > second )
+                    second = h[y];
+            for( size_t x = 0; x < k; ++x ) {
+                Real v = _offDiagonal * ((x == arg) ? second : h[arg]);
+                Real w = _diagonal[x] * h[x];
+                m[x] = (w > v) ? w : v;
+            }
+        }
+    } else if( _kind == Kind::TRUNCLINEAR ) {
+        // two-pass distance transform with factor exp(-slope) per step
+        Real r = std::exp( -_slope );
+        Real t = *max_element( h, h + k ) * std::exp( -_truncation );
+        Real s = std::exp( _logScale );
+        copy( h, h + k, m );
+        for( size_t x = 1; x < k; ++x )
+            if( m[x - 1] * r > m[x] )
+                m[x] = m[x - 1] * r;
+        for( size_t x = k - 1; x > 0; --x )
+            if( m[x] * r > m[x - 1] )
+                m[x - 1] = m[x] * r;
+        for( size_t x = 0; x < k; ++x )
+            m[x] = s * ((m[x] > t) ? m[x] : t);
+    } else {
+        vector<Real> lh( k ), lm( k );
+        for( size_t y = 0; y < k; ++y )
+            lh[y] = (h[y] > 0.0) ? std::log( h[y] ) : -INFINITY;
+        logMaxMessageTruncated( &(lh[0]), &(lm[0]) );
+        for( size_t x = 0; x < k; ++x )
+            m[x] = std::exp( lm[x] );
+    }
+}
+
+
+void PairwiseFactor::logMessage( const Real *lh, Real *lm, bool sumprod ) const {
+    DAI_ASSERT( fast( sumprod ) );
+    const size_t k = _states;
+    if( _kind != Kind::DIAGONAL )
+        logMaxMessageTruncated( lh, lm );
+    else if( sumprod ) {
+        // the same as message(), relative to the maximum of lh
+        Real M = *max_element( lh, lh + k );
+        if( M == -INFINITY ) {
+            fill( lm, lm + k, -INFINITY );
+            return;
+        }
+        Real sum = 0.0;
+        for( size_t y = 0; y < k; ++y )
+            if( lh[y] != -INFINITY )
+                sum += std::exp( lh[y] - M );
+        for( size_t x = 0; x < k; ++x ) {
+            Real e = (lh[x] == -INFINITY) ? 0.0 : std::exp( lh[x] - M );
+            Real v = _offDiagonal * (sum - e) + _diagonal[x] * e;
+            lm[x] = (v > 0.0) ? M + std::log( v ) : -INFINITY;
+        }
+    } else {
+        size_t arg = 0;
+        for( size_t y = 1; y < k; ++y )
+            if( lh[y] > lh[arg] )
+                arg = y;
+        Real second = -INFINITY;
+        for( size_t y = 0; y < k; ++y )
+            if( y != arg && lh[y] > second )
+                second = lh[y];
+        Real logc = std::log( _offDiagonal );
+        for( size_t x = 0; x < k; ++x ) {
+            Real v = logc + ((x == arg) ? second : lh[arg]);
+            Real w = std::log( _diagonal[x] ) + lh[x];
+            lm[x] = (w > v) ? w : v;
+        }
+    }
+}
+
+
+void PairwiseFactor::logMaxMessageTruncated( const Real *lh, Real *lm ) const {
+    const size_t k = _states;
+    Real M = *max_element( lh, lh + k );
+    if( _kind == Kind::TRUNCLINEAR ) {
+        // two passes: lm(x) = max_y lh(y) - slope * |x - y|
+        copy( lh, lh + k, lm );
+        for( size_t x = 1; x < k; ++x )
+            if( lm[x - 1] - _slope > lm[x] )
+                lm[x] = lm[x - 1] - _slope;
+        for( size_t x = k - 1; x > 0; --x )
+            if( lm[x] - _slope > lm[x - 1] )
+                lm[x - 1] = lm[x] - _slope;
+    } else {
+        // lower envelope of the parabolas slope * (x - y)^2 - lh(y) of the states y with lh(y) > -inf;
+        // v[0..j] are their vertices and the j'th parabola is the lowest one between z[j] and z[j+1]
+        vector<size_t> v( k );
+        vector<Real> z( k + 1 );
+        size_t n = 0;
+        for( size_t q = 0; q < k; ++q ) {
+            if( lh[q] == -INFINITY )
+                continue;
+            Real fq = -lh[q] + _slope * q * q;
+            while( true ) {
+                if( n == 0 ) {
+                    v[0] = q;
+                    z[0] = -INFINITY;
+                    z[1] = INFINITY;
+                    n = 1;
+                    break;
+                }
+                size_t p = v[n - 1];
+                Real s = (fq - (-lh[p] + _slope * p * p)) / (2.0 * _slope * ((Real)q - (Real)p));
+                if( s <= z[n - 1] )
+                    --n;
+                else {
+                    v[n] = q;
+                    z[n] = s;
+                    z[n + 1] = INFINITY;
+                    ++n;
+                    break;
+                }
+            }
+        }
+        if( n == 0 )
+            fill( lm, lm + k, -INFINITY );
+        else
+            for( size_t x = 0, j = 0; x < k; ++x ) {
+                while( z[j + 1] < (Real)x )
+                    ++j;
+                Real d = (Real)x - (Real)v[j];
+                lm[x] = lh[v[j]] - _slope * d * d;
+            }
+    }
+
+    // truncation
+    for( size_t x = 0; x < k; ++x )
+        lm[x] = _logScale + std::max( lm[x], M - _truncation );
+}
+
+
+std::ostream& operator<< ( std::ostream& os, const PairwiseFactor& f ) {
+    os << "(" << f.kind() << ", states=" << f.states();
+    if( f.kind() == PairwiseFactor::Kind::DIAGONAL ) {
+        os << ", offdiagonal=" << f.offDiagonal() << ", diagonal=(";
+        for( size_t x = 0; x < f.diagonal().size(); ++x )
+            os << (x ? ", " : "") << f.diagonal()[x];
+        os << ")";
+    } else if( f.kind() != PairwiseFactor::Kind::DENSE )
+        os << ", logscale=" << f.logScale() << ", slope=" << f.slope() << ", truncation=" << f.truncation();
+    os << ")";
+    return os;
+}
+
+
+} // end of namespace dai
@@ -0,0 +1,178 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+#include <new>
+#include <dai/pool.h>
+
+
+#if __cplusplus >= 201103L
+    #define DAI_THREAD_LOCAL thread_local
+#elif defined(_MSC_VER)
+    #define DAI_THREAD_LOCAL __declspec(thread)
+#else
+    #define DAI_THREAD_LOCAL __thread
+#endif
+
+
+namespace dai {
+
+
+using namespace std;
+
+
+namespace {
+
+
+/// Number of size classes (block sizes 2^0, 2^1, ..., 2^(nrSizeClasses-1) bytes)
+const size_t nrSizeClasses = 8 * sizeof(size_t);
+
+/// Smallest size class (a free block stores the pointer to the next free block)
+const size_t minSizeClass = 4;
+
+/// The current pool of this thread
+DAI_THREAD_LOCAL MemoryPool *currentPool = NULL;
+
+
+/// Returns the smallest size class whose blocks can hold \a bytes bytes
+size_t sizeClass( size_t bytes ) {
+    size_t c = minSizeClass;
+    while( ((size_t)1 << c) < bytes )
+        c++;
+    return c;
+}
+
+
+} // end of anonymous namespace
+
+
+struct MemoryPool::Block {
+    /// Pool that owns this block (NULL if the block was allocated directly on the heap)
+    State *owner;
+    /// Size class of this block
+    size_t sizeClass;
+};
+
+
+struct MemoryPool::State {
+    /// For each size class, the first free block (the memory of a free block points to the next free block)
+    Block *free[nrSizeClasses];
+    /// Number of free blocks
+    size_t nrCached;
+    /// Number of blocks in use
+    size_t nrUsed;
+    /// Whether the pool that owns this state has been destroyed
+    bool orphaned;
+
+    /// Constructs the state of an empty pool
+    State() : nrCached(0), nrUsed(0), orphaned(false) {
+        for( size_t c = 0; c < nrSizeClasses; c++ )
+            free[c] = NULL;
+    }
+};
+
+
+MemoryPool::MemoryPool() : _state( new State() ) {}
+
+
+MemoryPool::MemoryPool( const MemoryPool & ) : _state( new State() ) {}
+
+
+MemoryPool::~MemoryPool() {
+    release();
+    if( _state->nrUsed == 0 )
+        delete _state;
+    else
+        _state->orphaned = true;
+}
+
+
+void* MemoryPool::allocate( size_t bytes ) {
+    size_t c = sizeClass( bytes );
+    Block *b = _state->free[c];
+    if( b ) {
+        _state->free[c] = *reinterpret_cast<Block **>( b + 1 );
+        _state->nrCached--;
+    } else {
+        b = static_cast<Block *>( ::operator new( sizeof(Block) + ((size_t)1 << c) ) );
+        b->owner = _state;
+        b->sizeClass = c;
+    }
+    _state->nrUsed++;
+    return b + 1;
+}
+
+
+void* MemoryPool::allocateCurrent( size_t bytes ) {
+    if( currentPool )
+        return currentPool->allocate( bytes );
+    Block *b = static_cast<Block *>( ::operator new( sizeof(Block) + bytes ) );
+    b->owner = NULL;
+    b->sizeClass = 0;
+    return b + 1;
+}
+
+
+void MemoryPool::deallocate( void *p ) {
+    if( p == NULL )
+        return;
+    Block *b = static_cast<Block *>( p ) - 1;
+    State *s = b->owner;
+    if( s == NULL )
+        ::operator delete( b );
+    else {
+        s->nrUsed--;
+        if( s->orphaned ) {
+            ::operator delete( b );
+            if( s->nrUsed == 0 )
+                delete s;
+        } else {
+            *reinterpret_cast<Block **>( p ) = s->free[b->sizeClass];
+            s->free[b->sizeClass] = b;
+            s->nrCached++;
+        }
+    }
+}
+
+
+void MemoryPool::release() {
+    for( size_t c = 0; c < nrSizeClasses; c++ )
+        while( _state->free[c] ) {
+            Block *b = _state->free[c];
+            _state->free[c] = *reinterpret_cast<Block **>( b + 1 );
+            ::operator delete( b );
+        }
+    _state->nrCached = 0;
+}
+
+
+size_t MemoryPool::nrCached() const {
+    return _state->nrCached;
+}
+
+
+size_t MemoryPool::nrUsed() const {
+    return _state->nrUsed;
+}
+
+
+MemoryPool* MemoryPool::current() {
+    return currentPool;
+}
+
+
+MemoryPool::Scope::Scope( MemoryPool &pool ) : _previous( currentPool ) {
+    currentPool = &pool;
+}
+
+
+MemoryPool::Scope::~Scope() {
+    currentPool = _previous;
+}
+
+
+} // end of namespace dai
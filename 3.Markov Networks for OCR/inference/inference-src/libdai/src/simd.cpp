@@ -0,0 +1,412 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+#include <cstring>
+#include <dai/simd.h>
+
+
+// Runtime dispatch relies on the GCC/clang vector extensions, the target attribute and __builtin_cpu_supports()
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    #define DAI_SIMD_X86
+    #define DAI_SIMD_INLINE inline __attribute__((always_inline))
+#else
+    #define DAI_SIMD_INLINE inline
+#endif
+
+
+namespace dai {
+
+
+namespace simd {
+
+
+namespace {
+
+
+/// Arrays shorter than this are handled by scalar loops, which avoids the overhead of dispatching
+const size_t minVectorLength = 8;
+
+
+/// Table of kernels for values of type \a T
+template<typename T> struct KernelTable {
+    void (*add)( T*, const T*, size_t );
+    void (*mul)( T*, const T*, size_t );
+    void (*div0)( T*, const T*, size_t );
+    void (*pwMax)( T*, const T*, size_t );
+    void (*scale)( T*, T, size_t );
+    void (*divide)( T*, T, size_t );
+    T (*sum)( const T*, size_t );
+    T (*max)( const T*, size_t );
+    T (*min)( const T*, size_t );
+};
+
+
+/// Scalar kernels
+template<typename T> KernelTable<T> scalarKernels() {
+    KernelTable<T> k;
+    k.add = &simd::add<T>;
+    k.mul = &simd::mul<T>;
+    k.div0 = &simd::div0<T>;
+    k.pwMax = &simd::pwMax<T>;
+    k.scale = &simd::scale<T>;
+    k.divide = &simd::divide<T>;
+    k.sum = &simd::sum<T>;
+    k.max = &simd::max<T>;
+    k.min = &simd::min<T>;
+    return k;
+}
+
+
+#ifdef DAI_SIMD_X86
+
+// The kernels below are written once in terms of a GCC vector type V holding
+// sizeof(V)/sizeof(T) values of type T. They are force-inlined into wrappers that
+// carry the target attribute of the corresponding instruction set, so that each
+// wrapper is compiled to the vector width of its own instruction set.
+// Unaligned loads and stores are expressed by memcpy().
+
+template<typename T, typename V> DAI_SIMD_INLINE void addKernel( T *x, const T *y, size_t n ) {
+    const size_t W = sizeof(V) / sizeof(T);
+    size_t i = 0;
+    for( ; i + W <= n; i += W ) {
+        V a, b;
+        memcpy( &a, x + i, sizeof(V) );
+        memcpy( &b, y + i, sizeof(V) );
+        a += b;
+        memcpy( x + i, &a, sizeof(V) );
+    }
+    for( ; i < n; i++ )
+        x[i] += y[i];
+}
+
+template<typename T, typename V> DAI_SIMD_INLINE void mulKernel( T *x, const T *y, size_t n ) {
+    const size_t W = sizeof(V) / sizeof(T);
+    size_t i = 0;
+    for( ; i + W <= n; i += W ) {
+        V a, b;
+        memcpy( &a, x + i, sizeof(V) );
+        memcpy( &b, y + i, sizeof(V) );
+        a *= b;
+        memcpy( x + i, &a, sizeof(V) );
+    }
+    for( ; i < n; i++ )
+        x[i] *= y[i];
+}
+
+template<typename T, typename V> DAI_SIMD_INLINE void div0Kernel( T *x, const T *y, size_t n ) {
+    const size_t W = sizeof(V) / sizeof(T);
+    const V zero = V() + (T)0;
+    size_t i = 0;
+    for( ; i + W <= n; i += W ) {
+        V a, b;
+        memcpy( &a, x + i, sizeof(V) );
+        memcpy( &b, y + i, sizeof(V) );
+        a = (b == zero) ? zero : (a / b);
+        memcpy( x + i, &a, sizeof(V) );
+    }
+    for( ; i < n; i++ )
+        x[i] = (y[i] == (T)0) ? (T)0 : (x[i] / y[i]);
+}
+
+template<typename T, typename V> DAI_SIMD_INLINE void pwMaxKernel( T *x, const T *y, size_t n ) {
+    const size_t W = sizeof(V) / sizeof(T);
+    size_t i = 0;
+    for( ; i + W <= n; i += W ) {
+        V a, b;
+        memcpy( &a, x + i, sizeof(V) );
+        memcpy( &b, y + i, sizeof(V) );
+        a = (a > b) ? a : b;
+        memcpy( x + i, &a, sizeof(V) );
+    }
+    for( ; i < n; i++ )
+        x[i] = (x[i] > y[i]) ? x[i] : y[i];
+}
+
+template<typename T, typename V> DAI_SIMD_INLINE void scaleKernel( T *x, T c, size_t n ) {
+    const size_t W = sizeof(V) / sizeof(T);
+    const V cv = V() + c;
+    size_t i = 0;
+    for( ; i + W <= n; i += W ) {
+        V a;
+        memcpy( &a, x + i, sizeof(V) );
+        a *= cv;
+        memcpy( x + i, &a, sizeof(V) );
+    }
+    for( ; i < n; i++ )
+        x[i] *= c;
+}
+
+template<typename T, typename V> DAI_SIMD_INLINE void divideKernel( T *x, T c, size_t n ) {
+    const size_t W = sizeof(V) / sizeof(T);
+    const V cv = V() + c;
+    size_t i = 0;
+    for( ; i + W <= n; i += W ) {
+        V a;
+        memcpy( &a, x + i, sizeof(V) );
+        a /= cv;
+        memcpy( x + i, &a, sizeof(V) );
+    }
+    for( ; i < n; i++ )
+        x[i] /= c;
+}
+
+template<typename T, typename V> DAI_SIMD_INLINE T sumKernel( const T *x, size_t n ) {
+    const size_t W = sizeof(V) / sizeof(T);
+    V acc = V() + (T)0;
+    size_t i = 0;
+    for( ; i + W <= n; i += W ) {
+        V a;
+        memcpy( &a, x + i, sizeof(V) );
+        acc += a;
+    }
+    T lanes[sizeof(V) / sizeof(T)];
+    memcpy( lanes, &acc, sizeof(V) );
+    T s = 0;
+    for( size_t k = 0; k < W; k++ )
+        s += lanes[k];
+    for( ; i < n; i++ )
+        s += x[i];
+    return s;
+}
+
+template<typename T, typename V> DAI_SIMD_INLINE T maxKernel( const T *x, size_t n ) {
+    const size_t W = sizeof(V) / sizeof(T);
+    V acc = V() + (T)(-INFINITY);
+    size_t i = 0;
+    for( ; i + W <= n; i += W ) {
+        V a;
+        memcpy( &a, x + i, sizeof(V) );
+        acc = (acc < a) ? a : acc;
+    }
+    T lanes[sizeof(V) / sizeof(T)];
+    memcpy( lanes, &acc, sizeof(V) );
+    T m = (T)(-INFINITY);
+    for( size_t k = 0; k < W; k++ )
+        if( m < lanes[k] )
+            m = lanes[k];
+    for( ; i < n; i++ )
+        if( m < x[i] )
+            m = x[i];
+    return m;
+}
+
+template<typename T, typename V> DAI_SIMD_INLINE T minKernel( const T *x, size_t n ) {
+    const size_t W = sizeof(V) / sizeof(T);
+    V acc = V() + (T)INFINITY;
+    size_t i = 0;
+    for( ; i + W <= n; i += W ) {
+        V a;
+        memcpy( &a, x + i, sizeof(V) );
+        acc = (a < acc) ? a : acc;
+    }
+    T lanes[sizeof(V) / sizeof(T)];
+    memcpy( lanes, &acc, sizeof(V) );
+    T m = (T)INFINITY;
+    for( size_t k = 0; k < W; k++ )
+        if( lanes[k] < m )
+            m = lanes[k];
+    for( ; i < n; i++ )
+        if( x[i] < m )
+            m = x[i];
+    return m;
+}
+
+
+/// Defines the kernel wrappers for one instruction set in namespace \a NS
+/** \param NS Namespace in which the wrappers are defined
+ *  \param TARGET Argument of the target attribute
+ *  \param BYTES Vector width in bytes
+ */
+#define DAI_SIMD_DEFINE_KERNELS(NS,TARGET,BYTES) \
+namespace NS { \
+    typedef double vd __attribute__((vector_size(BYTES))); \
+    typedef float vf __attribute__((vector_size(BYTES))); \
+    __attribute__((target(TARGET))) void add_d( double *x, const double *y, size_t n ) { addKernel<double,vd>( x, y, n ); } \
+    __attribute__((target(TARGET))) void mul_d( double *x, const double *y, size_t n ) { mulKernel<double,vd>( x, y, n ); } \
+    __attribute__((target(TARGET))) void div0_d( double *x, const double *y, size_t n ) { div0Kernel<double,vd>( x, y, n ); } \
+    __attribute__((target(TARGET))) void pwMax_d( double *x, const double *y, size_t n ) { pwMaxKernel<double,vd>( x, y, n ); } \
+    __attribute__((target(TARGET))) void scale_d( double *x, double c, size_t n ) { scaleKernel<double,vd>( x, c, n ); } \
+    __attribute__((target(TARGET))) void divide_d( double *x, double c, size_t n ) { divideKernel<double,vd>( x, c, n ); } \
+    __attribute__((target(TARGET))) double sum_d( const double *x, size_t n ) { return sumKernel<double,vd>( x, n ); } \
+    __attribute__((target(TARGET))) double max_d( const double *x, size_t n ) { return maxKernel<double,vd>( x, n ); } \
+    __attribute__((target(TARGET))) double min_d( const double *x, size_t n ) { return minKernel<double,vd>( x, n ); } \
+    __attribute__((target(TARGET))) void add_f( float *x, const float *y, size_t n ) { addKernel<float,vf>( x, y, n ); } \
+    __attribute__((target(TARGET))) void mul_f( float *x, const float *y, size_t n ) { mulKernel<float,vf>( x, y, n ); } \
+    __attribute__((target(TARGET))) void div0_f( float *x, const float *y, size_t n ) { div0Kernel<float,vf>( x, y, n ); } \
+    __attribute__((target(TARGET))) void pwMax_f( float *x, const float *y, size_t n ) { pwMaxKernel<float,vf>( x, y, n ); } \
+    __attribute__((target(TARGET))) void scale_f( float *x, float c, size_t n ) { scaleKernel<float,vf>( x, c, n ); } \
+    __attribute__((target(TARGET))) void divide_f( float *x, float c, size_t n ) { divideKernel<float,vf>( x, c, n ); } \
+    __attribute__((target(TARGET))) float sum_f( const float *x, size_t n ) { return sumKernel<float,vf>( x, n ); } \
+    __attribute__((target(TARGET))) float max_f( const float *x, size_t n ) { return maxKernel<float,vf>( x, n ); } \
+    __attribute__((target(TARGET))) float min_f( const float *x, size_t n ) { return minKernel<float,vf>( x, n ); } \
+    KernelTable<double> kernels_d() { \
+        KernelTable<double> k = { add_d, mul_d, div0_d, pwMax_d, scale_d, divide_d, sum_d, max_d, min_d }; \
+        return k; \
+    } \
+    KernelTable<float> kernels_f() { \
+        KernelTable<float> k = { add_f, mul_f, div0_f, pwMax_f, scale_f, divide_f, sum_f, max_f, min_f }; \
+        return k; \
+    } \
+}
+
+DAI_SIMD_DEFINE_KERNELS(sse2,"sse2",16)
+DAI_SIMD_DEFINE_KERNELS(avx2,"avx2",32)
+DAI_SIMD_DEFINE_KERNELS(avx512,"avx512f",64)
+
+#undef DAI_SIMD_DEFINE_KERNELS
+
+#endif
+
+
+/// Currently selected instruction set
+InstructionSet _current = SCALAR;
+/// Whether the instruction set has been selected already
+bool _initialized = false;
+/// Currently selected kernels for double
+KernelTable<double> _kernels_d = scalarKernels<double>();
+/// Currently selected kernels for float
+KernelTable<float> _kernels_f = scalarKernels<float>();
+
+
+/// Returns whether instruction set \a is is supported
+bool supported( InstructionSet is ) {
+#ifdef DAI_SIMD_X86
+    __builtin_cpu_init();
+    switch( is ) {
+        case SCALAR:
+            return true;
+        case SSE2:
+            return __builtin_cpu_supports( "sse2" );
+        case AVX2:
+            return __builtin_cpu_supports( "avx2" );
+        case AVX512:
+            return __builtin_cpu_supports( "avx512f" );
+    }
+    return false;
+#else
+    return is == SCALAR;
+#endif
+}
+
+
+/// Makes sure that an instruction set has been selected
+inline void initialize() {
+    if( !_initialized )
+        setInstructionSet( detectInstructionSet() );
+}
+
+
+} // end of anonymous namespace
+
+
+InstructionSet detectInstructionSet() {
+    if( supported( AVX512 ) )
+        return AVX512;
+    else if( supported( AVX2 ) )
+        return AVX2;
+    else if( supported( SSE2 ) )
+        return SSE2;
+    else
+        return SCALAR;
+}
+
+
+InstructionSet instructionSet() {
+    initialize();
+    return _current;
+}
+
+
+InstructionSet setInstructionSet( InstructionSet is ) {
+    while( is != SCALAR && !supported( is ) )
+        is = (InstructionSet)(is - 1);
+
+    _kernels_d = scalarKernels<double>();
+    _kernels_f = scalarKernels<float>();
+#ifdef DAI_SIMD_X86
+    if( is == SSE2 ) {
+        _kernels_d = sse2::kernels_d();
+        _kernels_f = sse2::kernels_f();
+    } else if( is == AVX2 ) {
+        _kernels_d = avx2::kernels_d();
+        _kernels_f = avx2::kernels_f();
+    } else if( is == AVX512 ) {
+        _kernels_d = avx512::kernels_d();
+        _kernels_f = avx512::kernels_f();
+    }
+#endif
+    _current = is;
+    _initialized = true;
+    return is;
+}
+
+
+const char* instructionSetName( InstructionSet is ) {
+    switch( is ) {
+        case SCALAR:
+            return "SCALAR";
+        case SSE2:
+            return "SSE2";
+        case AVX2:
+            return "AVX2";
+        case AVX512:
+            return "AVX512";
+    }
+    return "UNKNOWN";
+}
+
+
+/// Defines the dispatching kernels for type \a T, using the kernel table \a TABLE
+#define DAI_SIMD_DEFINE_DISPATCH(T,TABLE) \
+void add( T *x, const T *y, size_t n ) { \
+    if( n < minVectorLength ) { add<T>( x, y, n ); return; } \
+    initialize(); TABLE.add( x, y, n ); \
+} \
+void mul( T *x, const T *y, size_t n ) { \
+    if( n < minVectorLength ) { mul<T>( x, y, n ); return; } \
+    initialize(); TABLE.mul( x, y, n ); \
+} \
+void div0( T *x, const T *y, size_t n ) { \
+    if( n < minVectorLength ) { div0<T>( x, y, n ); return; } \
+    initialize(); TABLE.div0( x, y, n ); \
+} \
+void pwMax( T *x, const T *y, size_t n ) { \
+    if( n < minVectorLength ) { pwMax<T>( x, y, n ); return; } \
+    initialize(); TABLE.pwMax( x, y, n ); \
+} \
+void scale( T *x, T c, size_t n ) { \
+    if( n < minVectorLength ) { scale<T>( x, c, n ); return; } \
+    initialize(); TABLE.scale( x, c, n ); \
+} \
+void divide( T *x, T c, size_t n ) { \
+    if( n < minVectorLength ) { divide<T>( x, c, n ); return; } \
+    initialize(); TABLE.divide( x, c, n ); \
+} \
+T sum( const T *x, size_t n ) { \
+    if( n < minVectorLength ) return sum<T>( x, n ); \
+    initialize(); return TABLE.sum( x, n ); \
+} \
+T max( const T *x, size_t n ) { \
+    if( n < minVectorLength ) return max<T>( x, n ); \
+    initialize(); return TABLE.max( x, n ); \
+} \
+T min( const T *x, size_t n ) { \
+    if( n < minVectorLength ) return min<T>( x, n ); \
+    initialize(); return TABLE.min( x, n ); \
+}
+
+DAI_SIMD_DEFINE_DISPATCH(double,_kernels_d)
+DAI_SIMD_DEFINE_DISPATCH(float,_kernels_f)
+
+#undef DAI_SIMD_DEFINE_DISPATCH
+
+
+} // end of namespace simd
+
+
+} // end of namespace dai
@@ -0,0 +1,272 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+#include <string>
+#include <exception>
+#include <dai/threadpool.h>
+#include <dai/pool.h>
+#include <dai/exceptions.h>
+#ifdef DAI_WITH_THREADS
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_array.hpp>
+#endif
+
+
+namespace dai {
+
+
+using namespace std;
+
+
+namespace {
+
+
+/// Executes the part of \a job of thread \a thread, and stores the exception it throws (if any) in \a error
+void runPart( ThreadPool::Job &job, size_t thread, Exception *&error ) {
+    try {
+        job.run( thread );
+    } catch( Exception &e ) {
+        error = new Exception( e );
+    } catch( std::exception &e ) {
+        error = new Exception( Exception::RUNTIME_ERROR, __FILE__, __PRETTY_FUNCTION__, DAI_TOSTRING(__LINE__), e.what() );
+    }
+}
+
+
+/// Rethrows the first exception of \a errors (if any), after deleting all of them
+void rethrowFirst( vector<Exception *> &errors ) {
+    Exception *first = NULL;
+    for( size_t t = 0; t < errors.size(); t++ ) {
+        if( errors[t] ) {
+            if( first )
+                delete errors[t];
+            else
+                first = errors[t];
+        }
+        errors[t] = NULL;
+    }
+    if( first ) {
+        Exception e( *first );
+        delete first;
+        throw e;
+    }
+}
+
+
+} // end of anonymous namespace
+
+
+#ifdef DAI_WITH_THREADS
+
+
+struct ThreadPool::Impl {
+    /// Protects all other members
+    boost::mutex mutex;
+    /// Signals the workers that a new job is available (or that they should stop)
+    boost::condition_variable jobAvailable;
+    /// Signals the calling thread that a worker has finished its part of the job
+    boost::condition_variable jobFinished;
+    /// The worker threads
+    vector<boost::shared_ptr<boost::thread> > threads;
+    /// The memory pools of the worker threads
+    vector<MemoryPool> pools;
+    /// The exception thrown by each thread during the current job (or NULL)
+    vector<Exception *> errors;
+    /// Current job
+    Job *job;
+    /// Number of jobs that have been started (used by the workers to detect new jobs)
+    size_t generation;
+    /// Number of workers that have not yet finished the current job
+    size_t nrBusy;
+    /// Whether the workers should stop
+    bool stop;
+
+    /// Main loop of worker thread \a thread
+    void work( size_t thread ) {
+        MemoryPool::Scope scope( pools[thread] );
+        size_t seen = 0;
+        while( true ) {
+            Job *current;
+            {
+                boost::unique_lock<boost::mutex> lock( mutex );
+                while( !stop && generation == seen )
+                    jobAvailable.wait( lock );
+                if( stop )
+                    return;
+                seen = generation;
+                current = job;
+            }
+            runPart( *current, thread, errors[thread] );
+            {
+                boost::unique_lock<boost::mutex> lock( mutex );
+                if( --nrBusy == 0 )
+                    jobFinished.notify_one();
+            }
+        }
+    }
+};
+
+
+ThreadPool::ThreadPool( size_t nrThreads ) : _nrThreads( nrThreads ? nrThreads : 1 ), _impl( NULL ) {
+    if( _nrThreads > 1 ) {
+        _impl = new Impl();
+        _impl->pools.resize( _nrThreads );
+        _impl->errors.resize( _nrThreads, NULL );
+        _impl->job = NULL;
+        _impl->generation = 0;
+        _impl->nrBusy = 0;
+        _impl->stop = false;
+        for( size_t t = 1; t < _nrThreads; t++ )
+            _impl->threads.push_back( boost::shared_ptr<boost::thread>( new boost::thread( &Impl::work, _impl, t ) ) );
+    }
+}
+
+
+ThreadPool::~ThreadPool() {
+    if( _impl ) {
+        {
+            boost::unique_lock<boost::mutex> lock( _impl->mutex );
+            _impl->stop = true;
+        }
+        _impl->jobAvailable.notify_all();
+        for( size_t t = 0; t < _impl->threads.size(); t++ )
+            _impl->threads[t]->join();
+        delete _impl;
+    }
+}
+
+
+bool ThreadPool::multithreaded() {
+    return true;
+}
+
+
+void ThreadPool::run( Job &job ) {
+    if( !_impl ) {
+        vector<Exception *> errors( 1, (Exception *)NULL );
+        runPart( job, 0, errors[0] );
+        rethrowFirst( errors );
+        return;
+    }
+    {
+        boost::unique_lock<boost::mutex> lock( _impl->mutex );
+        _impl->job = &job;
+        _impl->nrBusy = _nrThreads - 1;
+        _impl->generation++;
+    }
+    _impl->jobAvailable.notify_all();
+    runPart( job, 0, _impl->errors[0] );
+    {
+        boost::unique_lock<boost::mutex> lock( _impl->mutex );
+        while( _impl->nrBusy > 0 )
+            _impl->jobFinished.wait( lock );
+        _impl->job = NULL;
+    }
+    rethrowFirst( _impl->errors );
+}
+
+
+struct MutexArray::Impl {
+    /// The mutexes
+    boost::scoped_array<boost::mutex> mutexes;
+
+    /// Constructs \a size mutexes
+    Impl( size_t size ) : mutexes( new boost::mutex[size] ) {}
+};
+
+
+MutexArray::MutexArray( size_t size ) : _size( size ), _impl( size ? new Impl( size ) : NULL ) {}
+
+
+MutexArray::~MutexArray() {
+    delete _impl;
+}
+
+
+void MutexArray::lock( size_t k ) {
+    DAI_DEBASSERT( k < _size );
+    _impl->mutexes[k].lock();
+}
+
+
+void MutexArray::unlock( size_t k ) {
+    DAI_DEBASSERT( k < _size );
+    _impl->mutexes[k].unlock();
+}
+
+
+#else
+
+
+struct ThreadPool::Impl {};
+
+
+ThreadPool::ThreadPool( size_t nrThreads ) : _nrThreads( nrThreads ? nrThreads : 1 ), _impl( NULL ) {}
+
+
+ThreadPool::~ThreadPool() {}
+
+
+bool ThreadPool::multithreaded() {
+    return false;
+}
+
+
+void ThreadPool::run( Job &job ) {
+    vector<Exception *> errors( _nrThreads, (Exception *)NULL );
+    for( size_t t = 0; t < _nrThreads; t++ ) {
+        runPart( job, t, errors[t] );
+        if( errors[t] )
+            break;
+    }
+    rethrowFirst( errors );
+}
+
+
+struct MutexArray::Impl {};
+
+
+MutexArray::MutexArray( size_t size ) : _size( size ), _impl( NULL ) {}
+
+
+MutexArray::~MutexArray() {}
+
+
+void MutexArray::lock( size_t ) {}
+
+
+void MutexArray::unlock( size_t ) {}
+
+
+#endif
+
+
+vector<size_t> partitionWork( const vector<size_t> &weights, size_t nrParts ) {
+    DAI_ASSERT( nrParts > 0 );
+    size_t total = 0;
+    for( size_t k = 0; k < weights.size(); k++ )
+        total += weights[k];
+
+    // part t ends at the first item at which the cumulative weight reaches (t+1)/nrParts of the total
+    vector<size_t> bounds( nrParts + 1, weights.size() );
+    bounds[0] = 0;
+    size_t k = 0, cumulative = 0;
+    for( size_t t = 1; t < nrParts; t++ ) {
+        double target = (double)total * t / nrParts;
+        while( k < weights.size() && cumulative + weights[k] / 2.0 < target )
+            cumulative += weights[k++];
+        bounds[t] = k;
+    }
+    return bounds;
+}
+
+
+} // end of namespace dai
@@ -184,6 +184,8 @@ void TreeEP::init() {
 
 
 Real TreeEP::run() {
+    MemoryPool::Scope scope( memoryPool() );
+
     if( props.verbose >= 1 )
         cerr << "Starting " << identify() << "...";
     if( props.verbose >= 3 )
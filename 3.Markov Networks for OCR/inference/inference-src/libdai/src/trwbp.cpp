@@ -20,6 +20,11 @@ using namespace std;
 
 void TRWBP::setProperties( const PropertySet &opts ) {
     BP::setProperties( opts );
+    // the sparse and parametric message updates of BP do not take the weights into account,
+    // and the messages of a factor also depend on the messages it sends itself, which freezing does not track
+    props.maxdensity = 0.0;
+    props.parametric = false;
+    props.freezetol = 0.0;
 
     if( opts.hasKey("nrtrees") )
         nrtrees = opts.getStringAs<size_t>("nrtrees");
@@ -67,10 +72,9 @@ Real TRWBP::logZ() const {
 Prob TRWBP::calcIncomingMessageProduct( size_t I, bool without_i, size_t i ) const {
     Real c_I = Weight(I); // TRWBP: c_I
 
-    Factor Fprod( factor(I) );
+    Factor Fprod( factor(I).vars(), props.logdomain ? _logFactors[I].logp() : factor(I).p() );
     Prob &prod = Fprod.p();
     if( props.logdomain ) {
-        prod.takeLog();
         prod /= c_I; // TRWBP
     } else
         prod ^= (1.0 / c_I); // TRWBP
@@ -32,6 +32,72 @@ double log1p( double x ) {
 
 namespace dai {
 
+
+namespace {
+
+
+/// Converts a 64-bit integer into a BigInt (mpz_class cannot be constructed from 64-bit integers on all platforms)
+BigInt toBigInt( FastBigInt::small_type x ) {
+    BigInt result = (unsigned long)(x >> 32);
+    result <<= 32;
+    result += (unsigned long)(x & 0xffffffffUL);
+    return result;
+}
+
+
+} // end of anonymous namespace
+
+
+FastBigInt::FastBigInt( const BigInt &x ) : _small(0), _big(new BigInt( x )) {
+    DAI_ASSERT( x >= 0 );
+    makeSmall();
+}
+
+
+void FastBigInt::makeBig() {
+    if( !_big )
+        _big = new BigInt( toBigInt( _small ) );
+}
+
+
+void FastBigInt::makeSmall() {
+    if( _big && mpz_sizeinbase( _big->get_mpz_t(), 2 ) <= 64 ) {
+        BigInt high = *_big >> 32;
+        BigInt low = *_big - (high << 32);
+        _small = ((small_type)high.get_ui() << 32) | (small_type)low.get_ui();
+        delete _big;
+        _big = NULL;
+    }
+}
+
+
+BigInt FastBigInt::get() const {
+    return _big ? *_big : toBigInt( _small );
+}
+
+
+int FastBigInt::compareBig( const FastBigInt &x ) const {
+    int c = cmp( get(), x.get() );
+    return c < 0 ? -1 : (c > 0 ? 1 : 0);
+}
+
+
+FastBigInt& FastBigInt::operator+=( const BigInt &x ) {
+    makeBig();
+    *_big += x;
+    makeSmall();
+    return *this;
+}
+
+
+FastBigInt& FastBigInt::operator*=( const BigInt &x ) {
+    makeBig();
+    *_big *= x;
+    makeSmall();
+    return *this;
+}
+
+
 #if defined CYGWIN
 bool isnan( Real x ) {
     return __isnand( x );  // isnan() is a macro in Cygwin (as required by C99)
@@ -0,0 +1,134 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <cstdlib>
+#include <new>
+#include <dai/alldai.h>
+
+
+using namespace dai;
+using namespace std;
+
+
+/// Number of heap allocations so far
+size_t nrAllocs = 0;
+
+
+// Exception specifications of the replaced allocation functions
+#if __cplusplus >= 201103L
+#define BAD_ALLOC_SPEC
+#define NOTHROW_SPEC noexcept
+#else
+#define BAD_ALLOC_SPEC throw( std::bad_alloc )
+#define NOTHROW_SPEC throw()
+#endif
+
+
+// Count all heap allocations of the program
+void* operator new( size_t size ) BAD_ALLOC_SPEC {
+    nrAllocs++;
+    void *p = malloc( size ? size : 1 );
+    if( !p )
+        throw std::bad_alloc();
+    return p;
+}
+void* operator new[]( size_t size ) BAD_ALLOC_SPEC {
+    nrAllocs++;
+    void *p = malloc( size ? size : 1 );
+    if( !p )
+        throw std::bad_alloc();
+    return p;
+}
+void operator delete( void *p ) NOTHROW_SPEC { free( p ); }
+void operator delete[]( void *p ) NOTHROW_SPEC { free( p ); }
+#ifdef __cpp_sized_deallocation
+void operator delete( void *p, size_t ) NOTHROW_SPEC { free( p ); }
+void operator delete[]( void *p, size_t ) NOTHROW_SPEC { free( p ); }
+#endif
+
+
+/// Returns a grid-shaped factor graph with \a rows x \a cols variables with \a states states each, with random singleton and pairwise factors
+FactorGraph createGrid( size_t rows, size_t cols, size_t states ) {
+    vector<Var> vars;
+    for( size_t i = 0; i < rows * cols; i++ )
+        vars.push_back( Var( i, states ) );
+    vector<Factor> factors;
+    for( size_t i = 0; i < rows * cols; i++ ) {
+        Factor f( vars[i] );
+        f.randomize();
+        factors.push_back( f );
+    }
+    for( size_t r = 0; r < rows; r++ )
+        for( size_t c = 0; c < cols; c++ ) {
+            if( c + 1 < cols ) {
+                Factor f( VarSet( vars[r * cols + c], vars[r * cols + c + 1] ) );
+                f.randomize();
+                factors.push_back( f );
+            }
+            if( r + 1 < rows ) {
+                Factor f( VarSet( vars[r * cols + c], vars[(r + 1) * cols + c] ) );
+                f.randomize();
+                factors.push_back( f );
+            }
+        }
+    return FactorGraph( factors );
+}
+
+
+/// Runs BP with properties \a opts on \a fg and prints the number of heap allocations per iteration
+void benchmark( const string &name, const FactorGraph &fg, PropertySet opts ) {
+    const size_t iters = 200;
+    opts.set( "maxiter", (size_t)1 );
+    BP bp( fg, opts );
+    bp.init();
+    // warm up (the first iteration of SEQMAX is different)
+    bp.run();
+    size_t start = bp.Iterations();
+    bp.setMaxIter( start + iters );
+
+    size_t allocs = nrAllocs;
+    double tic = toc();
+    bp.run();
+    double elapsed = toc() - tic;
+    allocs = nrAllocs - allocs;
+
+    size_t n = bp.Iterations() - start;
+    cout << setw(16) << name << setw(12) << n;
+    cout << setw(16) << setprecision(1) << fixed << (double)allocs / n;
+    cout << setw(16) << setprecision(1) << (double)allocs / (n * fg.nrEdges());
+    cout << setw(12) << setprecision(3) << elapsed * 1e3 / n << endl;
+}
+
+
+int main() {
+    rnd_seed( 1 );
+    FactorGraph fg = createGrid( 5, 5, 26 );
+
+    cout << "# Heap allocations per BP iteration on a 5x5 grid of variables with 26 states (as in OCR)" << endl;
+    cout << "# TProb<> stores up to " << DAI_PROB_INLINE_SIZE << " entries inline";
+    cout << " (rebuild with PROBINLINE=0 to compare with storing all entries on the heap)" << endl;
+    cout << setw(16) << "# method" << setw(12) << "iterations" << setw(16) << "allocs/iter";
+    cout << setw(16) << "allocs/edge" << setw(12) << "ms/iter" << endl;
+
+    PropertySet opts;
+    opts.set( "tol", (Real)0.0 );
+    opts.set( "verbose", (size_t)0 );
+    const char* updates[] = { "SEQFIX", "SEQRND", "SEQMAX", "PARALL" };
+    for( size_t u = 0; u < sizeof(updates) / sizeof(updates[0]); u++ ) {
+        opts.set( "updates", string( updates[u] ) );
+        opts.set( "logdomain", false );
+        benchmark( string( "BP_" ) + updates[u], fg, opts );
+        opts.set( "logdomain", true );
+        benchmark( string( "BP_" ) + updates[u] + "_LOG", fg, opts );
+    }
+
+    return 0;
+}
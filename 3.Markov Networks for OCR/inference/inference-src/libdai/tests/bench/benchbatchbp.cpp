@@ -0,0 +1,109 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <dai/alldai.h>
+
+
+using namespace dai;
+using namespace std;
+
+
+/// Number of states of the characters
+const size_t nrChars = 26;
+
+
+/// Returns a random factor on \a vs with values between 1 and 1 + \a strength
+Factor randomFactor( const VarSet &vs, Real strength ) {
+    Factor f( vs );
+    for( size_t s = 0; s < f.nrStates(); s++ )
+        f.set( s, 1.0 + strength * rnd_uniform() );
+    return f;
+}
+
+
+/// Returns a word graph as in OCR: a chain of \a length characters with random image factors, the
+/// pairwise factors \a pair between consecutive characters and \a skip between the characters at distance two
+FactorGraph createWord( size_t length, const Factor &pair, const Factor &skip ) {
+    vector<Var> vars;
+    for( size_t i = 0; i < length; i++ )
+        vars.push_back( Var( i, nrChars ) );
+    vector<Factor> factors;
+    for( size_t i = 0; i < length; i++ ) {
+        factors.push_back( randomFactor( vars[i], 4.0 ) );
+        if( i + 1 < length )
+            factors.push_back( Factor( VarSet( vars[i], vars[i + 1] ), pair.p() ) );
+        if( i + 2 < length )
+            factors.push_back( Factor( VarSet( vars[i], vars[i + 2] ), skip.p() ) );
+    }
+    return FactorGraph( factors );
+}
+
+
+int main() {
+    const size_t nrWords = 500;
+    const size_t length = 6;
+
+    rnd_seed( 1 );
+    Factor pair = randomFactor( VarSet( Var( 0, nrChars ), Var( 1, nrChars ) ), 1.0 );
+    Factor skip = randomFactor( VarSet( Var( 0, nrChars ), Var( 2, nrChars ) ), 0.5 );
+    vector<FactorGraph> words;
+    for( size_t w = 0; w < nrWords; w++ )
+        words.push_back( createWord( length, pair, skip ) );
+
+    cout << "# BP on " << nrWords << " OCR-like word graphs of " << length << " characters with " << nrChars << " states," << endl;
+    cout << "# one BP object per word or one BatchBP object for all words" << endl;
+    cout << setw(10) << "# updates" << setw(12) << "BP ms" << setw(12) << "BatchBP ms" << setw(10) << "speedup";
+    cout << setw(14) << "max dist" << setw(12) << "iters" << endl;
+
+    PropertySet opts;
+    opts.set( "tol", (Real)1e-9 );
+    opts.set( "maxiter", (size_t)1000 );
+    opts.set( "verbose", (size_t)0 );
+    const char* updates[] = { "SEQFIX", "PARALL" };
+    for( size_t u = 0; u < sizeof(updates) / sizeof(updates[0]); u++ ) {
+        opts.set( "updates", string( updates[u] ) );
+
+        BatchBP batch( words, opts );
+        double tic = toc();
+        batch.init();
+        batch.run();
+        double batchTime = toc() - tic;
+
+        PropertySet bpOpts = opts;
+        bpOpts.set( "logdomain", false );
+        bpOpts.set( "convergence", string( "RESIDUALS" ) );
+        vector<BP> bps;
+        bps.reserve( nrWords );
+        for( size_t w = 0; w < nrWords; w++ )
+            bps.push_back( BP( words[w], bpOpts ) );
+        tic = toc();
+        for( size_t w = 0; w < nrWords; w++ ) {
+            bps[w].init();
+            bps[w].run();
+        }
+        double bpTime = toc() - tic;
+
+        Real maxDist = 0.0;
+        size_t iters = 0;
+        for( size_t w = 0; w < nrWords; w++ ) {
+            for( size_t i = 0; i < length; i++ )
+                maxDist = std::max( maxDist, dist( batch.beliefV( w, i ), bps[w].beliefV( i ), DISTLINF ) );
+            iters += batch.Iterations( w );
+        }
+
+        cout << setw(10) << updates[u] << setw(12) << setprecision(1) << fixed << bpTime * 1e3;
+        cout << setw(12) << batchTime * 1e3 << setw(9) << setprecision(2) << bpTime / batchTime << "x";
+        cout << setw(14) << setprecision(1) << scientific << maxDist << setw(12) << iters << endl;
+        cout.unsetf( ios_base::floatfield );
+    }
+
+    return 0;
+}
@@ -0,0 +1,97 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <dai/alldai.h>
+
+
+using namespace dai;
+using namespace std;
+
+
+/// Returns a \a n x \a n grid of variables with \a states states, with random single-variable factors
+/// and pairwise factors of kind \a kind (0: Potts, 1: truncated linear, 2: truncated quadratic)
+FactorGraph createGrid( size_t n, size_t states, size_t kind ) {
+    vector<Var> vars;
+    for( size_t i = 0; i < n * n; i++ )
+        vars.push_back( Var( i, states ) );
+    vector<Factor> factors;
+    for( size_t i = 0; i < n * n; i++ ) {
+        Factor f( vars[i] );
+        f.randomize();
+        factors.push_back( f );
+        for( size_t k = 0; k < 2; k++ ) {
+            size_t j = k ? i + n : i + 1;
+            if( (k ? j >= n * n : j % n == 0) )
+                continue;
+            if( kind == 0 )
+                factors.push_back( createFactorPotts( vars[i], vars[j], 0.5 ) );
+            else if( kind == 1 )
+                factors.push_back( createFactorTruncatedLinear( vars[i], vars[j], 0.2, 2.0 ) );
+            else
+                factors.push_back( createFactorTruncatedQuadratic( vars[i], vars[j], 0.02, 2.0 ) );
+        }
+    }
+    return FactorGraph( factors );
+}
+
+
+int main() {
+    const size_t n = 10;
+    const char* kinds[] = { "POTTS", "TRUNCLINEAR", "TRUNCQUADRATIC" };
+
+    cout << "# BP (SEQFIX, linear domain, convergence=RESIDUALS, 20 iterations) on a " << n << " x " << n << " grid with pairwise factors," << endl;
+    cout << "# using the dense factor tables (parametric=0) or the parametric forms (parametric=1)" << endl;
+    cout << setw(16) << "# factors" << setw(10) << "inference" << setw(8) << "states";
+    cout << setw(12) << "dense ms" << setw(12) << "param ms" << setw(10) << "speedup" << setw(12) << "max dist" << endl;
+
+    PropertySet opts;
+    opts.set( "tol", (Real)0.0 );
+    opts.set( "maxiter", (size_t)20 );
+    opts.set( "verbose", (size_t)0 );
+    opts.set( "updates", string( "SEQFIX" ) );
+    opts.set( "logdomain", false );
+    // testing convergence on the beliefs would calculate the factor beliefs, which costs O(states^2)
+    opts.set( "convergence", string( "RESIDUALS" ) );
+    size_t states[] = { 16, 64, 256 };
+    for( size_t kind = 0; kind < 3; kind++ )
+        for( size_t inf = (kind == 0 ? 0 : 1); inf < 2; inf++ )
+            for( size_t s = 0; s < 3; s++ ) {
+                rnd_seed( 1 );
+                FactorGraph fg = createGrid( n, states[s], kind );
+                opts.set( "inference", string( inf ? "MAXPROD" : "SUMPROD" ) );
+
+                opts.set( "parametric", false );
+                BP dense( fg, opts );
+                double tic = toc();
+                dense.init();
+                dense.run();
+                double denseTime = toc() - tic;
+
+                opts.set( "parametric", true );
+                BP parametric( fg, opts );
+                tic = toc();
+                parametric.init();
+                parametric.run();
+                double parametricTime = toc() - tic;
+
+                Real maxDist = 0.0;
+                for( size_t i = 0; i < fg.nrVars(); i++ )
+                    maxDist = std::max( maxDist, dist( dense.beliefV( i ), parametric.beliefV( i ), DISTLINF ) );
+
+                cout << setw(16) << kinds[kind] << setw(10) << (inf ? "MAXPROD" : "SUMPROD") << setw(8) << states[s];
+                cout << setw(12) << setprecision(1) << fixed << denseTime * 1e3 << setw(12) << parametricTime * 1e3;
+                cout << setw(9) << setprecision(1) << denseTime / parametricTime << "x";
+                cout << setw(12) << setprecision(1) << scientific << maxDist << endl;
+                cout.unsetf( ios_base::floatfield );
+            }
+
+    return 0;
+}
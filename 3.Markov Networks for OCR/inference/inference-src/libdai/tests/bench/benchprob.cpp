@@ -0,0 +1,97 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <dai/prob.h>
+#include <dai/simd.h>
+
+
+using namespace dai;
+using namespace std;
+
+
+/// Number of entries processed per timing (determines the number of repetitions)
+const size_t workload = 50000000;
+
+/// Sink that prevents the compiler from optimizing the benchmarked operations away
+double sink = 0.0;
+
+
+/// Times operation \a op on vectors of length \a n, returning the number of nanoseconds per entry
+template<typename T> double timeOp( const string &op, size_t n ) {
+    TProb<T> x( n ), y( n );
+    x.randomize();
+    y.randomize();
+    x += (T)0.5;
+    y += (T)0.5;
+    size_t reps = workload / n + 1;
+
+    double tic = toc();
+    for( size_t r = 0; r < reps; r++ ) {
+        if( op == "multiply" )
+            x *= y;
+        else if( op == "divide" )
+            x /= y;
+        else if( op == "add" )
+            x += y;
+        else if( op == "max" )
+            x = max( x, y );
+        else if( op == "sum" )
+            sink += x.sum();
+        else if( op == "maxentry" )
+            sink += x.max();
+        else if( op == "normalize" )
+            x.normalize();
+        else if( op == "log" )
+            x.takeLog();
+        else if( op == "exp" )
+            x.takeExp();
+        // keep the values in a sensible range
+        if( r % 16 == 15 )
+            x.fill( (T)1 );
+    }
+    double elapsed = toc() - tic;
+    sink += x[0];
+    return elapsed * 1e9 / (reps * n);
+}
+
+
+/// Prints a row of the benchmark table for value type \a T
+template<typename T> void benchmark( const string &type, const string &op, size_t n, simd::InstructionSet best ) {
+    simd::setInstructionSet( simd::SCALAR );
+    double t_scalar = timeOp<T>( op, n );
+    simd::setInstructionSet( best );
+    double t_simd = timeOp<T>( op, n );
+    cout << setw(8) << type << setw(12) << op << setw(8) << n;
+    cout << setw(12) << setprecision(3) << fixed << t_scalar << setw(12) << t_simd;
+    cout << setw(10) << setprecision(2) << t_scalar / t_simd << "x" << endl;
+}
+
+
+int main() {
+    simd::InstructionSet best = simd::detectInstructionSet();
+    cout << "# Benchmark of TProb<> kernels: SCALAR versus " << simd::instructionSetName( best ) << endl;
+    cout << "# Sizes correspond to OCR singleton (26), pairwise (676) and triplet (17576) factors" << endl;
+    cout << "# Timings are in nanoseconds per entry" << endl;
+    cout << setw(8) << "# type" << setw(12) << "operation" << setw(8) << "size";
+    cout << setw(12) << "SCALAR" << setw(12) << simd::instructionSetName( best ) << setw(11) << "speedup" << endl;
+
+    const char* ops[] = { "multiply", "divide", "add", "max", "sum", "maxentry", "normalize", "log", "exp" };
+    const size_t sizes[] = { 26, 676, 17576 };
+    for( size_t o = 0; o < sizeof(ops) / sizeof(ops[0]); o++ )
+        for( size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++ ) {
+            benchmark<double>( "double", ops[o], sizes[s], best );
+            benchmark<float>( "float", ops[o], sizes[s], best );
+        }
+
+    if( sink == 42.0 )
+        cout << endl;
+    return 0;
+}
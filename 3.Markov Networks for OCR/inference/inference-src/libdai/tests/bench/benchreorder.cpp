@@ -0,0 +1,128 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <dai/alldai.h>
+
+
+using namespace dai;
+using namespace std;
+
+
+/// Returns a \a n x \a n grid with EXPGAUSS factors, as created by "createfg --type GRID --factors EXPGAUSS"
+FactorGraph createGrid( size_t n, size_t states, Real beta ) {
+    GraphAL G = createGraphGrid( n, n, false );
+    vector<Var> vars;
+    for( size_t i = 0; i < G.nrNodes(); i++ )
+        vars.push_back( Var( i, states ) );
+    vector<Factor> factors;
+    for( size_t i = 0; i < G.nrNodes(); i++ )
+        bforeach( const Neighbor &j, G.nb(i) )
+            if( i < j )
+                factors.push_back( createFactorExpGauss( VarSet( vars[i], vars[j] ), beta ) );
+    return FactorGraph( factors.begin(), factors.end(), vars.begin(), vars.end(), factors.size(), vars.size() );
+}
+
+
+/// Returns a random permutation of 0, 1, ..., \a n - 1
+vector<size_t> randomOrder( size_t n ) {
+    vector<size_t> order( n );
+    for( size_t k = 0; k < n; k++ )
+        order[k] = k;
+    for( size_t k = n - 1; k > 0; k-- )
+        std::swap( order[k], order[rnd( k + 1 )] );
+    return order;
+}
+
+
+/// Returns the mean distance between the indices of the variables of a factor
+Real meanSpan( const FactorGraph &fg ) {
+    Real sum = 0.0;
+    for( size_t I = 0; I < fg.nrFactors(); I++ ) {
+        size_t lo = fg.nrVars(), hi = 0;
+        bforeach( const Neighbor &i, fg.nbF(I) ) {
+            lo = std::min( lo, (size_t)i );
+            hi = std::max( hi, (size_t)i );
+        }
+        sum += hi - lo;
+    }
+    return sum / fg.nrFactors();
+}
+
+
+int main() {
+    const size_t n = 300;
+    const size_t states = 4;
+    const size_t iters = 10;
+
+    rnd_seed( 1 );
+    FactorGraph original = createGrid( n, states, 1.0 );
+    FactorGraph shuffled = original.reordered( randomOrder( original.nrVars() ), randomOrder( original.nrFactors() ) );
+    vector<size_t> order1, order2;
+    double tic = toc();
+    shuffled.bipGraph().orderRCM( order1, order2 );
+    FactorGraph rcm = shuffled.reordered( order1, order2 );
+    double rcmTime = toc() - tic;
+    tic = toc();
+    shuffled.bipGraph().orderBisection( order1, order2 );
+    FactorGraph bisection = shuffled.reordered( order1, order2 );
+    double bisectionTime = toc() - tic;
+
+    cout << "# BP (linear domain, convergence=RESIDUALS, " << iters << " iterations) on a " << n << " x " << n << " grid with " << states << " states" << endl;
+    cout << "# and EXPGAUSS factors, in the order of createfg, with shuffled variables and factors, and reordered" << endl;
+    cout << "# (span: mean distance between the indices of the variables of a factor; max dist: to the beliefs in createfg order," << endl;
+    cout << "# which differ for SEQFIX because the order of the factors is also the order of the updates)" << endl;
+    cout << setw(12) << "# order" << setw(12) << "order ms" << setw(12) << "span" << setw(10) << "updates";
+    cout << setw(12) << "BP ms" << setw(10) << "speedup" << setw(12) << "max dist" << endl;
+
+    PropertySet opts;
+    opts.set( "tol", (Real)0.0 );
+    opts.set( "maxiter", iters );
+    opts.set( "verbose", (size_t)0 );
+    opts.set( "logdomain", false );
+    opts.set( "convergence", string( "RESIDUALS" ) );
+    const char* names[] = { "CREATEFG", "SHUFFLED", "RCM", "BISECTION" };
+    const FactorGraph* graphs[] = { &original, &shuffled, &rcm, &bisection };
+    double orderTimes[] = { 0.0, 0.0, rcmTime, bisectionTime };
+    const char* updates[] = { "SEQFIX", "PARALL" };
+    for( size_t u = 0; u < 2; u++ ) {
+        opts.set( "updates", string( updates[u] ) );
+        BP reference( original, opts );
+        reference.init();
+        reference.run();
+        double shuffledTime = 0.0;
+        for( size_t g = 0; g < 4; g++ ) {
+            const FactorGraph &fg = *graphs[g];
+            BP bp( fg, opts );
+            tic = toc();
+            bp.init();
+            bp.run();
+            double bpTime = toc() - tic;
+            if( g == 1 )
+                shuffledTime = bpTime;
+
+            Real maxDist = 0.0;
+            for( size_t i = 0; i < fg.nrVars(); i++ )
+                // in createfg order, the variable with label l is the l'th variable
+                maxDist = std::max( maxDist, dist( bp.beliefV( i ), reference.beliefV( fg.var( i ).label() ), DISTLINF ) );
+
+            cout << setw(12) << names[g] << setw(12) << setprecision(1) << fixed << orderTimes[g] * 1e3;
+            cout << setw(12) << meanSpan( fg ) << setw(10) << updates[u] << setw(12) << bpTime * 1e3;
+            if( g == 0 )
+                cout << setw(10) << "";
+            else
+                cout << setw(9) << setprecision(2) << shuffledTime / bpTime << "x";
+            cout << setw(12) << setprecision(1) << scientific << maxDist << endl;
+            cout.unsetf( ios_base::floatfield );
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,124 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <dai/alldai.h>
+
+
+using namespace dai;
+using namespace std;
+
+
+/// Number of states of the characters
+const size_t nrChars = 26;
+
+
+/// Returns a random factor on \a vs with values between 1 and 1 + \a strength
+Factor randomFactor( const VarSet &vs, Real strength ) {
+    Factor f( vs );
+    for( size_t s = 0; s < f.nrStates(); s++ )
+        f.set( s, 1.0 + strength * rnd_uniform() );
+    return f;
+}
+
+
+/// Returns a word graph as in OCR: a chain of \a length characters with image factors, the pairwise factors
+/// \a pair between consecutive characters and \a skip between the characters at distance two
+/** The image factors of all words are the same, up to a random perturbation of relative size \a noise.
+ */
+FactorGraph createWord( size_t length, const vector<Factor> &images, const Factor &pair, const Factor &skip, Real noise ) {
+    vector<Var> vars;
+    for( size_t i = 0; i < length; i++ )
+        vars.push_back( Var( i, nrChars ) );
+    vector<Factor> factors;
+    for( size_t i = 0; i < length; i++ ) {
+        Factor f( vars[i], images[i].p() );
+        for( size_t s = 0; s < f.nrStates(); s++ )
+            f.set( s, f[s] * (1.0 + noise * (rnd_uniform() - 0.5)) );
+        factors.push_back( f );
+        if( i + 1 < length )
+            factors.push_back( Factor( VarSet( vars[i], vars[i + 1] ), pair.p() ) );
+        if( i + 2 < length )
+            factors.push_back( Factor( VarSet( vars[i], vars[i + 2] ), skip.p() ) );
+    }
+    return FactorGraph( factors );
+}
+
+
+int main() {
+    const size_t nrWords = 200;
+    const size_t maxLength = 8;
+
+    rnd_seed( 1 );
+    vector<Factor> images;
+    for( size_t i = 0; i < maxLength; i++ )
+        images.push_back( randomFactor( Var( i, nrChars ), 4.0 ) );
+    Factor pair = randomFactor( VarSet( Var( 0, nrChars ), Var( 1, nrChars ) ), 1.0 );
+    Factor skip = randomFactor( VarSet( Var( 0, nrChars ), Var( 2, nrChars ) ), 0.5 );
+
+    vector<FactorGraph> words;
+    for( size_t w = 0; w < nrWords; w++ )
+        words.push_back( createWord( maxLength - 2 + rnd( 3 ), images, pair, skip, 0.1 ) );
+
+    cout << "# BP iterations for " << nrWords << " OCR-like word graphs of 6 to 8 characters with " << nrChars << " states," << endl;
+    cout << "# starting from uniform messages (cold) or from the messages of the previous word (warm)," << endl;
+    cout << "# which are passed on in serialized form" << endl;
+    cout << setw(16) << "# method" << setw(14) << "cold iters" << setw(14) << "warm iters";
+    cout << setw(14) << "imported" << setw(12) << "cold ms" << setw(12) << "warm ms" << endl;
+
+    PropertySet opts;
+    opts.set( "tol", (Real)1e-9 );
+    opts.set( "maxiter", (size_t)1000 );
+    opts.set( "verbose", (size_t)0 );
+    const char* updates[] = { "SEQFIX", "SEQMAX", "PARALL" };
+    for( size_t u = 0; u < sizeof(updates) / sizeof(updates[0]); u++ ) {
+        opts.set( "updates", string( updates[u] ) );
+        opts.set( "logdomain", true );
+
+        size_t coldIters = 0;
+        double tic = toc();
+        for( size_t w = 0; w < nrWords; w++ ) {
+            BP bp( words[w], opts );
+            bp.init();
+            bp.run();
+            coldIters += bp.Iterations();
+        }
+        double cold = toc() - tic;
+
+        size_t warmIters = 0, imported = 0, edges = 0;
+        string state;
+        tic = toc();
+        for( size_t w = 0; w < nrWords; w++ ) {
+            BP bp( words[w], opts );
+            bp.init();
+            if( w > 0 ) {
+                istringstream is( state );
+                BPMessages msgs;
+                is >> msgs;
+                imported += bp.importMessages( msgs );
+            }
+            bp.run();
+            warmIters += bp.Iterations();
+            edges += words[w].nrEdges();
+            ostringstream os;
+            os.precision( 17 );
+            os << bp.exportMessages();
+            state = os.str();
+        }
+        double warm = toc() - tic;
+
+        cout << setw(16) << (string( "BP_" ) + updates[u] + "_LOG") << setw(14) << coldIters << setw(14) << warmIters;
+        cout << setw(13) << setprecision(1) << fixed << 100.0 * imported / edges << "%";
+        cout << setw(12) << setprecision(1) << cold * 1e3 << setw(12) << warm * 1e3 << endl;
+    }
+
+    return 0;
+}
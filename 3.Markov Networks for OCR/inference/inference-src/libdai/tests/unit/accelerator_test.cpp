@@ -0,0 +1,149 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+#include <dai/accelerator.h>
+#include <vector>
+
+
+using namespace dai;
+
+
+#ifdef DAI_SINGLE
+const Real tol = 1e-3;
+#else
+const Real tol = 1e-8;
+#endif
+
+
+#define BOOST_TEST_MODULE AcceleratorTest
+
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+
+/// Returns G(x) for the linear contraction G(x)_i = 0.5 x_i + 0.225 (x_{i-1} + x_{i+1}) + 0.1 i, of which the eigenvalues are between 0.05 and 0.95
+std::vector<Real> contraction( const std::vector<Real> &x ) {
+    const size_t n = x.size();
+    std::vector<Real> g( n );
+    for( size_t i = 0; i < n; i++ )
+        g[i] = 0.5 * x[i] + 0.225 * ((i > 0 ? x[i-1] : 0.0) + (i + 1 < n ? x[i+1] : 0.0)) + 0.1 * i;
+    return g;
+}
+
+
+/// Returns the number of iterations needed by \a acc to solve the fixed-point equation of contraction() up to \a eps, and the solution in \a x
+size_t iterate( Accelerator &acc, std::vector<Real> &x, Real eps ) {
+    x.assign( 20, 0.0 );
+    for( size_t iter = 1; iter <= 10000; iter++ ) {
+        std::vector<Real> g = contraction( x );
+        Real diff = 0.0;
+        for( size_t i = 0; i < x.size(); i++ )
+            diff = std::max( diff, dai::abs( g[i] - x[i] ) );
+        if( diff <= eps )
+            return iter;
+        acc.step( x, g );
+        x = g;
+    }
+    return 10000;
+}
+
+
+BOOST_AUTO_TEST_CASE( ConstructorsTest ) {
+    Accelerator a;
+    BOOST_CHECK_EQUAL( a.method(), Accelerator::Method::NONE );
+    BOOST_CHECK_EQUAL( a.window(), 5 );
+    BOOST_CHECK_EQUAL( a.nrRestarts(), 0 );
+
+    Accelerator b( Accelerator::Method::ANDERSON, 3, true );
+    BOOST_CHECK_EQUAL( b.method(), Accelerator::Method::ANDERSON );
+    BOOST_CHECK_EQUAL( b.window(), 3 );
+
+    // without acceleration, the next iterate is the plain update
+    std::vector<Real> x( 2, 0.0 ), g( 2, 1.0 );
+    a.step( x, g );
+    BOOST_CHECK_EQUAL( g[0], 1.0 );
+    BOOST_CHECK_EQUAL( g[1], 1.0 );
+}
+
+
+BOOST_AUTO_TEST_CASE( ConvergenceTest ) {
+    std::vector<Real> plain, x;
+    Accelerator none;
+    size_t plainIters = iterate( none, plain, 1e-10 );
+    BOOST_CHECK( plainIters > 100 && plainIters < 10000 );
+
+    size_t windows[] = { 1, 5, 10 };
+    for( size_t w = 0; w < 3; w++ ) {
+        Accelerator acc( Accelerator::Method::ANDERSON, windows[w] );
+        size_t iters = iterate( acc, x, 1e-10 );
+        // the same fixed point, in fewer iterations
+        BOOST_CHECK( iters < plainIters );
+        if( windows[w] > 1 )
+            BOOST_CHECK( 3 * iters < plainIters );
+        // both are within 20 times the tolerance of the fixed point, because the largest eigenvalue is 0.95
+        for( size_t i = 0; i < x.size(); i++ )
+            BOOST_CHECK( dai::abs( x[i] - plain[i] ) < 4e-9 );
+
+        // after a reset, the iteration is repeated exactly
+        acc.reset();
+        BOOST_CHECK_EQUAL( iterate( acc, x, 1e-10 ), iters );
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE( SafeguardTest ) {
+    // if the residual grows, the next iterate is the damped update
+    Accelerator acc( Accelerator::Method::ANDERSON );
+    std::vector<Real> x( 1, 0.0 ), g( 1, 1.0 );
+    acc.step( x, g );
+    BOOST_CHECK_EQUAL( g[0], 1.0 );
+    g[0] = 10.0;
+    acc.step( x, g );
+    BOOST_CHECK_EQUAL( g[0], 5.0 );
+    BOOST_CHECK_EQUAL( acc.nrRestarts(), 1 );
+
+    // the secant step of G(x) = 0.9 x - 0.4 jumps to the fixed point -4, which is rejected for nonnegative iterates
+    for( size_t nonnegative = 0; nonnegative < 2; nonnegative++ ) {
+        Accelerator acc( Accelerator::Method::ANDERSON, 5, nonnegative );
+        std::vector<Real> x( 1, 1.0 ), g( 1, 0.5 );
+        acc.step( x, g );
+        BOOST_CHECK_EQUAL( g[0], 0.5 );
+        x[0] = 0.5;
+        g[0] = 0.05;
+        acc.step( x, g );
+        if( nonnegative ) {
+            BOOST_CHECK_EQUAL( g[0], 0.05 );
+            BOOST_CHECK_EQUAL( acc.nrRestarts(), 1 );
+        } else {
+            BOOST_CHECK( dai::abs( g[0] + 4.0 ) < 1e-8 );
+            BOOST_CHECK_EQUAL( acc.nrRestarts(), 0 );
+        }
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE( InfiniteTest ) {
+    // entries that are not finite are taken from the plain update, the others are mixed
+    // (for G(x) = x / 2, the secant step jumps to the fixed point 0)
+    Accelerator acc( Accelerator::Method::ANDERSON );
+    std::vector<Real> x( 2 ), g( 2 );
+    for( size_t iter = 0; iter < 5; iter++ ) {
+        x[0] = -INFINITY;
+        x[1] = 1.0 / (iter + 1);
+        g[0] = -INFINITY;
+        g[1] = 0.5 * x[1];
+        acc.step( x, g );
+        BOOST_CHECK_EQUAL( g[0], -INFINITY );
+        if( iter == 0 )
+            BOOST_CHECK_EQUAL( g[1], 0.5 );
+        else
+            BOOST_CHECK( dai::abs( g[1] ) < tol );
+    }
+    BOOST_CHECK_EQUAL( acc.nrRestarts(), 0 );
+}
@@ -0,0 +1,143 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+#include <dai/batchbp.h>
+#include <dai/bp.h>
+#include <dai/exceptions.h>
+#include <vector>
+#include <string>
+
+
+using namespace dai;
+
+
+#define BOOST_TEST_MODULE BatchBPTest
+
+
+#include <boost/test/unit_test.hpp>
+
+
+/// Returns a factor graph with a loop of four variables with 2 to 4 states, a factor of three variables
+/// and single-variable factors, with random values
+FactorGraph createInstance() {
+    std::vector<Var> vars;
+    for( size_t i = 0; i < 5; i++ )
+        vars.push_back( Var( i, 2 + i % 3 ) );
+    std::vector<Factor> factors;
+    for( size_t i = 0; i < 4; i++ )
+        factors.push_back( Factor( VarSet( vars[i], vars[(i + 1) % 4] ) ) );
+    VarSet triplet( vars[1], vars[3] );
+    triplet |= vars[4];
+    factors.push_back( Factor( triplet ) );
+    for( size_t i = 0; i < 5; i += 2 )
+        factors.push_back( Factor( vars[i] ) );
+    for( size_t I = 0; I < factors.size(); I++ )
+        factors[I].randomize();
+    return FactorGraph( factors );
+}
+
+
+BOOST_AUTO_TEST_CASE( CompareWithBPTest ) {
+    // for each instance, BatchBP should do the same as BP in the linear domain with
+    // convergence=RESIDUALS, although the instances converge after different numbers of iterations
+    rnd_seed( 1 );
+    std::vector<FactorGraph> fgs;
+    for( size_t n = 0; n < 7; n++ )
+        fgs.push_back( createInstance() );
+
+    const char* updates[] = { "SEQFIX", "PARALL" };
+    const char* inference[] = { "SUMPROD", "MAXPROD" };
+    Real damping[] = { 0.0, 0.2 };
+    for( size_t u = 0; u < 2; u++ )
+        for( size_t inf = 0; inf < 2; inf++ )
+            for( size_t d = 0; d < 2; d++ ) {
+                PropertySet opts;
+                opts.set( "tol", (Real)1e-9 );
+                opts.set( "maxiter", (size_t)100 );
+                opts.set( "verbose", (size_t)0 );
+                opts.set( "updates", std::string( updates[u] ) );
+                opts.set( "inference", std::string( inference[inf] ) );
+                opts.set( "damping", damping[d] );
+
+                BatchBP batch( fgs, opts );
+                batch.init();
+                Real maxDiff = batch.run();
+                BOOST_CHECK_EQUAL( batch.nrInstances(), fgs.size() );
+
+                opts.set( "logdomain", false );
+                opts.set( "convergence", std::string( "RESIDUALS" ) );
+                Real bpMaxDiff = 0.0;
+                for( size_t n = 0; n < fgs.size(); n++ ) {
+                    BP bp( fgs[n], opts );
+                    bp.init();
+                    bpMaxDiff = std::max( bpMaxDiff, bp.run() );
+                    BOOST_CHECK_EQUAL( batch.Iterations( n ), bp.Iterations() );
+                    BOOST_CHECK( dai::abs( batch.maxDiff( n ) - bp.maxDiff() ) < 1e-12 );
+                    for( size_t i = 0; i < fgs[n].nrVars(); i++ )
+                        BOOST_CHECK( dist( batch.beliefV( n, i ), bp.beliefV( i ), DISTLINF ) < 1e-12 );
+                    for( size_t I = 0; I < fgs[n].nrFactors(); I++ ) {
+                        BOOST_CHECK( batch.factor( n, I ) == fgs[n].factor( I ) );
+                        BOOST_CHECK( dist( batch.beliefF( n, I ), bp.beliefF( I ), DISTLINF ) < 1e-12 );
+                    }
+                    if( inf == 0 )
+                        BOOST_CHECK_CLOSE( batch.logZ( n ), bp.logZ(), 1e-8 );
+                }
+                BOOST_CHECK( dai::abs( maxDiff - bpMaxDiff ) < 1e-12 );
+            }
+}
+
+
+BOOST_AUTO_TEST_CASE( MaxIterTest ) {
+    rnd_seed( 1 );
+    std::vector<FactorGraph> fgs;
+    for( size_t n = 0; n < 3; n++ )
+        fgs.push_back( createInstance() );
+
+    PropertySet opts;
+    opts.set( "tol", (Real)1e-9 );
+    opts.set( "maxiter", (size_t)2 );
+    opts.set( "updates", std::string( "PARALL" ) );
+    BatchBP batch( fgs, opts );
+    batch.init();
+    BOOST_CHECK( batch.run() > 1e-9 );
+    BOOST_CHECK_EQUAL( batch.nrActive(), 0 );
+    for( size_t n = 0; n < fgs.size(); n++ )
+        BOOST_CHECK_EQUAL( batch.Iterations( n ), 2 );
+
+    // init() restarts all instances
+    batch.init();
+    BOOST_CHECK_EQUAL( batch.nrActive(), fgs.size() );
+    BOOST_CHECK_EQUAL( batch.Iterations( 0 ), 0 );
+}
+
+
+BOOST_AUTO_TEST_CASE( IncompatibleTest ) {
+    rnd_seed( 1 );
+    std::vector<FactorGraph> fgs;
+    fgs.push_back( createInstance() );
+    fgs.push_back( createInstance() );
+    PropertySet opts;
+    opts.set( "tol", (Real)1e-9 );
+    opts.set( "updates", std::string( "SEQFIX" ) );
+    BOOST_CHECK_NO_THROW( BatchBP( fgs, opts ) );
+
+    // different number of factors
+    std::vector<Factor> factors = fgs[1].factors();
+    factors.pop_back();
+    fgs[1] = FactorGraph( factors );
+    BOOST_CHECK_THROW( BatchBP( fgs, opts ), Exception );
+
+    // different number of states of variable 4, which only occurs in factors 4 and 7
+    factors = fgs[0].factors();
+    VarSet triplet( Var( 1, 3 ), Var( 3, 2 ) );
+    triplet |= Var( 4, 2 );
+    factors[4] = Factor( triplet );
+    factors[7] = Factor( Var( 4, 2 ) );
+    fgs[1] = FactorGraph( factors );
+    BOOST_CHECK_THROW( BatchBP( fgs, opts ), Exception );
+}
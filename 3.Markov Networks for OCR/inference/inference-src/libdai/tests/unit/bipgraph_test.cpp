@@ -376,6 +376,94 @@ BOOST_AUTO_TEST_CASE( QueriesTest ) {
 }
 
 
+/// Returns the sum over the nodes of type 2 of the largest distance between the positions of their neighbors in \a order1
+size_t span( const BipartiteGraph &G, const std::vector<size_t> &order1 ) {
+    std::vector<size_t> pos1( order1.size() );
+    for( size_t k = 0; k < order1.size(); k++ )
+        pos1[order1[k]] = k;
+    size_t result = 0;
+    for( size_t n2 = 0; n2 < G.nrNodes2(); n2++ ) {
+        size_t lo = G.nrNodes1(), hi = 0;
+        bforeach( const Neighbor &n1, G.nb2(n2) ) {
+            lo = std::min( lo, pos1[n1] );
+            hi = std::max( hi, pos1[n1] );
+        }
+        if( hi > lo )
+            result += hi - lo;
+    }
+    return result;
+}
+
+
+/// Checks that \a order contains each of the numbers 0, 1, ..., \a n - 1 once
+void checkPermutation( const std::vector<size_t> &order, size_t n ) {
+    BOOST_CHECK_EQUAL( order.size(), n );
+    std::vector<bool> seen( n, false );
+    for( size_t k = 0; k < order.size(); k++ ) {
+        BOOST_CHECK( order[k] < n );
+        BOOST_CHECK( !seen[order[k]] );
+        seen[order[k]] = true;
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE( OrderTest ) {
+    // a 20 x 20 grid with randomly numbered nodes of type 1 and a node of type 2 for each edge,
+    // together with two isolated nodes and a separate chain
+    rnd_seed( 1 );
+    const size_t n = 20;
+    const size_t N1 = n * n + 2 + 10;
+    std::vector<size_t> label( N1 );
+    for( size_t k = 0; k < N1; k++ )
+        label[k] = k;
+    for( size_t k = N1 - 1; k > 0; k-- )
+        std::swap( label[k], label[rnd( k + 1 )] );
+    std::vector<Edge> edges;
+    size_t N2 = 0;
+    for( size_t i = 0; i < n * n; i++ ) {
+        if( i % n + 1 < n ) {
+            edges.push_back( Edge( label[i], N2 ) );
+            edges.push_back( Edge( label[i + 1], N2++ ) );
+        }
+        if( i + n < n * n ) {
+            edges.push_back( Edge( label[i], N2 ) );
+            edges.push_back( Edge( label[i + n], N2++ ) );
+        }
+    }
+    for( size_t i = n * n + 2; i + 1 < N1; i++ ) {
+        edges.push_back( Edge( label[i], N2 ) );
+        edges.push_back( Edge( label[i + 1], N2++ ) );
+    }
+    BipartiteGraph G( N1, N2, edges.begin(), edges.end() );
+    size_t original = span( G, std::vector<size_t>( label.begin(), label.end() ) );
+    std::vector<size_t> identity( N1 );
+    for( size_t k = 0; k < N1; k++ )
+        identity[k] = k;
+    size_t shuffled = span( G, identity );
+    BOOST_CHECK( shuffled > 10 * original );
+
+    std::vector<size_t> order1, order2;
+    G.orderRCM( order1, order2 );
+    checkPermutation( order1, N1 );
+    checkPermutation( order2, N2 );
+    BOOST_CHECK( span( G, order1 ) <= 2 * original );
+
+    for( size_t leafSize = 1; leafSize <= 64; leafSize *= 8 ) {
+        G.orderBisection( order1, order2, leafSize );
+        checkPermutation( order1, N1 );
+        checkPermutation( order2, N2 );
+        BOOST_CHECK( span( G, order1 ) * 4 < shuffled );
+    }
+
+    // trivial graphs
+    BipartiteGraph E;
+    E.orderRCM( order1, order2 );
+    BOOST_CHECK( order1.empty() && order2.empty() );
+    E.orderBisection( order1, order2 );
+    BOOST_CHECK( order1.empty() && order2.empty() );
+}
+
+
 BOOST_AUTO_TEST_CASE( StreamTest ) {
     // check printDot
     std::vector<Edge> edges;
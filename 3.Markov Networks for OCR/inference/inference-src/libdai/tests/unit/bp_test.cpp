@@ -0,0 +1,395 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+#include <dai/bp.h>
+#include <dai/trwbp.h>
+#include <dai/exactinf.h>
+#include <dai/jtree.h>
+#include <vector>
+#include <string>
+#include <sstream>
+
+
+using namespace dai;
+
+
+#define BOOST_TEST_MODULE BPTest
+
+
+#include <boost/test/unit_test.hpp>
+
+
+/// Returns a tree-shaped factor graph with random factors of one to four variables, some of which have zeros
+FactorGraph createTree() {
+    std::vector<Var> vars;
+    for( size_t i = 0; i < 9; i++ )
+        vars.push_back( Var( i, 2 + i % 3 ) );
+    std::vector<Factor> factors;
+    VarSet triplet( vars[0], vars[1] );
+    triplet |= vars[2];
+    factors.push_back( Factor( triplet ) );
+    VarSet quadruplet( vars[2], vars[3] );
+    quadruplet |= vars[4];
+    quadruplet |= vars[5];
+    factors.push_back( Factor( quadruplet ) );
+    factors.push_back( Factor( VarSet( vars[5], vars[6] ) ) );
+    factors.push_back( Factor( VarSet( vars[1], vars[7] ) ) );
+    factors.push_back( Factor( VarSet( vars[4], vars[8] ) ) );
+    for( size_t i = 0; i < 9; i += 2 )
+        factors.push_back( Factor( vars[i] ) );
+    for( size_t I = 0; I < factors.size(); I++ ) {
+        factors[I].randomize();
+        if( factors[I].nrStates() > 4 ) {
+            factors[I].set( 1, 0.0 );
+            factors[I].set( 3, 0.0 );
+        }
+    }
+    return FactorGraph( factors );
+}
+
+
+/// Returns a binary Ising model on a \a n x \a n grid with random couplings and fields
+FactorGraph createGrid( size_t n ) {
+    std::vector<Var> vars;
+    for( size_t i = 0; i < n * n; i++ )
+        vars.push_back( Var( i, 2 ) );
+    std::vector<Factor> factors;
+    for( size_t i = 0; i < n * n; i++ ) {
+        factors.push_back( createFactorIsing( vars[i], rnd_uniform() - 0.5 ) );
+        if( i % n + 1 < n )
+            factors.push_back( createFactorIsing( vars[i], vars[i + 1], rnd_uniform() - 0.5 ) );
+        if( i + n < n * n )
+            factors.push_back( createFactorIsing( vars[i], vars[i + n], rnd_uniform() - 0.5 ) );
+    }
+    return FactorGraph( factors );
+}
+
+
+BOOST_AUTO_TEST_CASE( HigherOrderFactorsTest ) {
+    // BP is exact on trees; the messages of factors with several variables are calculated together
+    // by calcNewMessages(), except for updates=SEQRND, which calculates them one by one
+    rnd_seed( 1 );
+    FactorGraph fg = createTree();
+    ExactInf ei( fg, PropertySet()("verbose",(size_t)0) );
+    ei.init();
+    ei.run();
+
+    const char* updates[] = { "SEQFIX", "SEQRND", "SEQMAX", "PARALL", "PARMAX", "SPLASH" };
+    for( size_t u = 0; u < 6; u++ )
+        for( size_t logdomain = 0; logdomain < 2; logdomain++ ) {
+            PropertySet opts;
+            opts.set( "tol", (Real)1e-12 );
+            opts.set( "maxiter", (size_t)100 );
+            opts.set( "updates", std::string( updates[u] ) );
+            opts.set( "logdomain", (bool)logdomain );
+            BP bp( fg, opts );
+            bp.init();
+            bp.run();
+            BOOST_CHECK( bp.maxDiff() <= 1e-12 );
+            for( size_t i = 0; i < fg.nrVars(); i++ )
+                BOOST_CHECK( dist( bp.beliefV( i ), ei.beliefV( i ), DISTLINF ) < 1e-10 );
+            for( size_t I = 0; I < fg.nrFactors(); I++ )
+                BOOST_CHECK( dist( bp.beliefF( I ), ei.beliefF( I ), DISTLINF ) < 1e-10 );
+            BOOST_CHECK( std::abs( bp.logZ() - ei.logZ() ) < 1e-10 );
+        }
+}
+
+
+BOOST_AUTO_TEST_CASE( HigherOrderFactorsMaxProductTest ) {
+    // max-product BP yields the exact max-marginals on trees
+    rnd_seed( 2 );
+    FactorGraph fg = createTree();
+    JTree jt( fg, PropertySet()("verbose",(size_t)0)("updates",std::string("HUGIN"))("inference",std::string("MAXPROD")) );
+    jt.init();
+    jt.run();
+
+    const char* updates[] = { "SEQFIX", "SEQRND", "PARALL", "SPLASH" };
+    for( size_t u = 0; u < 4; u++ )
+        for( size_t logdomain = 0; logdomain < 2; logdomain++ ) {
+            PropertySet opts;
+            opts.set( "tol", (Real)1e-12 );
+            opts.set( "maxiter", (size_t)100 );
+            opts.set( "updates", std::string( updates[u] ) );
+            opts.set( "inference", std::string( "MAXPROD" ) );
+            opts.set( "logdomain", (bool)logdomain );
+            BP bp( fg, opts );
+            bp.init();
+            bp.run();
+            for( size_t i = 0; i < fg.nrVars(); i++ )
+                BOOST_CHECK( dist( bp.beliefV( i ), jt.beliefV( i ), DISTLINF ) < 1e-10 );
+            BOOST_CHECK( bp.findMaximum() == jt.findMaximum() );
+        }
+}
+
+
+BOOST_AUTO_TEST_CASE( ResidualConvergenceTest ) {
+    // testing convergence on the messages (convergence=RESIDUALS) yields the same fixed point
+    // as testing convergence on the beliefs (convergence=BELIEFS)
+    rnd_seed( 3 );
+    FactorGraph fg = createGrid( 4 );
+
+    const char* updates[] = { "SEQFIX", "SEQRND", "SEQMAX", "PARALL", "PARMAX", "SPLASH" };
+    for( size_t u = 0; u < 6; u++ )
+        for( size_t logdomain = 0; logdomain < 2; logdomain++ )
+            for( size_t damped = 0; damped < 2; damped++ ) {
+                PropertySet opts;
+                opts.set( "tol", (Real)1e-9 );
+                opts.set( "maxiter", (size_t)1000 );
+                opts.set( "updates", std::string( updates[u] ) );
+                opts.set( "logdomain", (bool)logdomain );
+                opts.set( "damping", (Real)(damped ? 0.3 : 0.0) );
+                BP bpBeliefs( fg, opts );
+                bpBeliefs.init();
+                bpBeliefs.run();
+                BOOST_CHECK( bpBeliefs.maxDiff() <= 1e-9 );
+
+                opts.set( "convergence", std::string( "RESIDUALS" ) );
+                BP bpResiduals( fg, opts );
+                BOOST_CHECK_EQUAL( bpResiduals.props.convergence, BP::Properties::ConvergenceType::RESIDUALS );
+                bpResiduals.init();
+                bpResiduals.run();
+                BOOST_CHECK( bpResiduals.maxDiff() <= 1e-9 );
+                BOOST_CHECK( bpResiduals.Iterations() < 1000 );
+
+                for( size_t i = 0; i < fg.nrVars(); i++ )
+                    BOOST_CHECK( dist( bpResiduals.beliefV( i ), bpBeliefs.beliefV( i ), DISTLINF ) < 1e-7 );
+                for( size_t I = 0; I < fg.nrFactors(); I++ )
+                    BOOST_CHECK( dist( bpResiduals.beliefF( I ), bpBeliefs.beliefF( I ), DISTLINF ) < 1e-7 );
+                BOOST_CHECK( std::abs( bpResiduals.logZ() - bpBeliefs.logZ() ) < 1e-7 );
+            }
+}
+
+
+BOOST_AUTO_TEST_CASE( WarmStartTest ) {
+    rnd_seed( 4 );
+    FactorGraph fg = createGrid( 4 );
+    PropertySet opts;
+    opts.set( "tol", (Real)1e-9 );
+    opts.set( "maxiter", (size_t)1000 );
+    opts.set( "updates", std::string( "SEQFIX" ) );
+    opts.set( "logdomain", false );
+    BP bp( fg, opts );
+    bp.init();
+    bp.run();
+    BPMessages msgs = bp.exportMessages();
+    BOOST_CHECK_EQUAL( msgs.size(), fg.nrEdges() );
+    for( size_t i = 0; i < fg.nrVars(); i++ )
+        bforeach( const Neighbor &I, fg.nbV(i) ) {
+            const Prob *p = msgs.get( fg.var(i), fg.factor(I).vars() );
+            BOOST_REQUIRE( p != NULL );
+            BOOST_CHECK_EQUAL( p->size(), fg.var(i).states() );
+            BOOST_CHECK_CLOSE( p->sum(), (Real)1.0, 1e-10 );
+        }
+    BOOST_CHECK( msgs.get( Var( 100, 2 ), VarSet( Var( 100, 2 ) ) ) == NULL );
+
+    // write and read the messages
+    std::stringstream ss;
+    ss.precision( 17 );
+    ss << "# messages" << std::endl << msgs;
+    BPMessages msgs2;
+    ss >> msgs2;
+    BOOST_CHECK_EQUAL( msgs2.size(), msgs.size() );
+    for( size_t i = 0; i < fg.nrVars(); i++ )
+        bforeach( const Neighbor &I, fg.nbV(i) )
+            BOOST_CHECK( *msgs2.get( fg.var(i), fg.factor(I).vars() ) == *msgs.get( fg.var(i), fg.factor(I).vars() ) );
+    std::stringstream invalid( "2\n0 1 0 2 0.5 0.5\n1 2 1" );
+    BOOST_CHECK_THROW( invalid >> msgs2, Exception );
+
+    // starting from the converged messages, BP converges immediately, also in the log domain
+    for( size_t logdomain = 0; logdomain < 2; logdomain++ ) {
+        opts.set( "logdomain", (bool)logdomain );
+        BP bp2( fg, opts );
+        bp2.init();
+        BOOST_CHECK_EQUAL( bp2.importMessages( msgs ), fg.nrEdges() );
+        bp2.run();
+        BOOST_CHECK_EQUAL( bp2.Iterations(), (size_t)1 );
+        for( size_t i = 0; i < fg.nrVars(); i++ )
+            BOOST_CHECK( dist( bp2.beliefV( i ), bp.beliefV( i ), DISTLINF ) < 1e-8 );
+    }
+
+    // a slightly different factor graph with an additional variable
+    std::vector<Factor> factors = fg.factors();
+    for( size_t I = 0; I < factors.size(); I++ )
+        if( factors[I].vars().size() == 2 )
+            factors[I] *= createFactorIsing( factors[I].vars().front(), factors[I].vars().back(), 0.05 * (rnd_uniform() - 0.5) );
+    factors.push_back( createFactorIsing( fg.var(15), Var( 16, 2 ), 0.3 ) );
+    FactorGraph fg2( factors );
+    opts.set( "logdomain", false );
+    BP cold( fg2, opts );
+    cold.init();
+    cold.run();
+    BP warm( fg2, opts );
+    warm.init();
+    BOOST_CHECK_EQUAL( warm.importMessages( msgs ), fg.nrEdges() );
+    warm.run();
+    BOOST_CHECK( warm.Iterations() < cold.Iterations() );
+    for( size_t i = 0; i < fg2.nrVars(); i++ )
+        BOOST_CHECK( dist( warm.beliefV( i ), cold.beliefV( i ), DISTLINF ) < 1e-7 );
+}
+
+
+BOOST_AUTO_TEST_CASE( SplashTest ) {
+    rnd_seed( 5 );
+    FactorGraph fg = createGrid( 5 );
+    PropertySet opts;
+    opts.set( "tol", (Real)1e-9 );
+    opts.set( "maxiter", (size_t)1000 );
+    opts.set( "updates", std::string( "SEQMAX" ) );
+    opts.set( "logdomain", false );
+    BP seqmax( fg, opts );
+    seqmax.init();
+    seqmax.run();
+
+    // splashes of a single variable and larger splashes reach the same fixed point as SEQMAX
+    opts.set( "updates", std::string( "SPLASH" ) );
+    size_t sizes[] = { 1, 4, 25 };
+    for( size_t k = 0; k < 3; k++ ) {
+        opts.set( "splashsize", sizes[k] );
+        BP splash( fg, opts );
+        BOOST_CHECK_EQUAL( splash.getProperties().getAs<size_t>( "splashsize" ), sizes[k] );
+        splash.init();
+        splash.run();
+        BOOST_CHECK( splash.maxDiff() <= 1e-9 );
+        BOOST_CHECK( splash.Iterations() < 1000 );
+        for( size_t i = 0; i < fg.nrVars(); i++ )
+            BOOST_CHECK( dist( splash.beliefV( i ), seqmax.beliefV( i ), DISTLINF ) < 1e-7 );
+
+        // continuing a run (e.g., of a copy) uses the residuals of the copy
+        BP copy( splash );
+        copy.setMaxIter( 2000 );
+        copy.run();
+        for( size_t i = 0; i < fg.nrVars(); i++ )
+            BOOST_CHECK( dist( copy.beliefV( i ), seqmax.beliefV( i ), DISTLINF ) < 1e-7 );
+    }
+
+    opts.set( "splashsize", (size_t)0 );
+    BOOST_CHECK_THROW( BP( fg, opts ), Exception );
+}
+
+
+BOOST_AUTO_TEST_CASE( ParametricTest ) {
+    // Potts, truncated linear and truncated quadratic factors on a 4 x 4 grid with 7 states
+    // send the same messages with parametric=1 as with the dense factor tables
+    rnd_seed( 6 );
+    const size_t n = 4;
+    std::vector<Var> vars;
+    for( size_t i = 0; i < n * n; i++ )
+        vars.push_back( Var( i, 7 ) );
+    for( size_t kind = 0; kind < 3; kind++ ) {
+        std::vector<Factor> factors;
+        for( size_t i = 0; i < n * n; i++ ) {
+            Factor f( vars[i] );
+            f.randomize();
+            factors.push_back( f );
+            for( size_t k = 0; k < 2; k++ ) {
+                size_t j = k ? i + n : i + 1;
+                if( (k ? j >= n * n : j % n == 0) )
+                    continue;
+                if( kind == 0 )
+                    factors.push_back( createFactorPotts( vars[i], vars[j], rnd_uniform() ) );
+                else if( kind == 1 )
+                    factors.push_back( createFactorTruncatedLinear( vars[i], vars[j], 0.5 * rnd_uniform(), 1.5 ) );
+                else
+                    factors.push_back( createFactorTruncatedQuadratic( vars[i], vars[j], 0.2 * rnd_uniform(), 2.0 ) );
+            }
+        }
+        FactorGraph fg( factors );
+
+        const char* updates[] = { "SEQFIX", "SEQMAX", "PARALL" };
+        for( size_t u = 0; u < 3; u++ )
+            for( size_t logdomain = 0; logdomain < 2; logdomain++ )
+                for( size_t maxprod = 0; maxprod < 2; maxprod++ ) {
+                    PropertySet opts;
+                    opts.set( "tol", (Real)1e-9 );
+                    opts.set( "maxiter", (size_t)1000 );
+                    opts.set( "updates", std::string( updates[u] ) );
+                    opts.set( "logdomain", (bool)logdomain );
+                    opts.set( "inference", std::string( maxprod ? "MAXPROD" : "SUMPROD" ) );
+                    BP dense( fg, opts );
+                    dense.init();
+                    dense.run();
+
+                    opts.set( "parametric", true );
+                    BP parametric( fg, opts );
+                    BOOST_CHECK( parametric.props.parametric );
+                    parametric.init();
+                    parametric.run();
+                    // (parallel max-product updates of the Potts model do not converge, with either representation)
+                    BOOST_CHECK_EQUAL( parametric.Iterations(), dense.Iterations() );
+                    for( size_t i = 0; i < fg.nrVars(); i++ )
+                        BOOST_CHECK( dist( parametric.beliefV( i ), dense.beliefV( i ), DISTLINF ) < 1e-7 );
+                }
+    }
+
+    // TRWBP does not use the parametric messages
+    PropertySet opts;
+    opts.set( "tol", (Real)1e-9 );
+    opts.set( "updates", std::string( "SEQFIX" ) );
+    opts.set( "logdomain", false );
+    opts.set( "parametric", true );
+    TRWBP trwbp( createGrid( 3 ), opts );
+    BOOST_CHECK( !trwbp.props.parametric );
+}
+
+
+BOOST_AUTO_TEST_CASE( FreezeTest ) {
+    // freezing converged edges reaches the same fixed point with fewer message updates
+    rnd_seed( 7 );
+    FactorGraph fg = createGrid( 6 );
+
+    const char* updates[] = { "SEQFIX", "PARALL" };
+    const char* convergence[] = { "BELIEFS", "RESIDUALS" };
+    for( size_t u = 0; u < 2; u++ )
+        for( size_t c = 0; c < 2; c++ )
+            for( size_t logdomain = 0; logdomain < 2; logdomain++ )
+                for( size_t damped = 0; damped < 2; damped++ ) {
+                    PropertySet opts;
+                    opts.set( "tol", (Real)1e-9 );
+                    opts.set( "maxiter", (size_t)1000 );
+                    opts.set( "updates", std::string( updates[u] ) );
+                    opts.set( "convergence", std::string( convergence[c] ) );
+                    opts.set( "logdomain", (bool)logdomain );
+                    opts.set( "damping", (Real)(damped ? 0.3 : 0.0) );
+                    BP plain( fg, opts );
+                    plain.init();
+                    plain.run();
+                    BOOST_CHECK_EQUAL( plain.nrDormantEdges(), 0 );
+
+                    opts.set( "freezetol", (Real)1e-10 );
+                    opts.set( "freezesweeps", (size_t)2 );
+                    BP frozen( fg, opts );
+                    BOOST_CHECK_EQUAL( frozen.getProperties().getAs<Real>( "freezetol" ), 1e-10 );
+                    BOOST_CHECK_EQUAL( frozen.getProperties().getAs<size_t>( "freezesweeps" ), 2 );
+                    frozen.recordSentMessages = true;
+                    frozen.init();
+                    frozen.run();
+                    BOOST_CHECK( frozen.maxDiff() <= 1e-9 );
+                    BOOST_CHECK( frozen.Iterations() < 1000 );
+                    BOOST_CHECK( frozen.nrDormantEdges() > 0 );
+                    BOOST_CHECK( frozen.getSentMessages().size() < frozen.Iterations() * fg.nrEdges() );
+                    for( size_t i = 0; i < fg.nrVars(); i++ )
+                        BOOST_CHECK( dist( frozen.beliefV( i ), plain.beliefV( i ), DISTLINF ) < 1e-7 );
+
+                    // init() wakes all edges
+                    frozen.init();
+                    BOOST_CHECK_EQUAL( frozen.nrDormantEdges(), 0 );
+                }
+
+    PropertySet opts;
+    opts.set( "tol", (Real)1e-9 );
+    opts.set( "updates", std::string( "SEQFIX" ) );
+    opts.set( "logdomain", false );
+    opts.set( "freezetol", (Real)1e-10 );
+    opts.set( "freezesweeps", (size_t)0 );
+    BOOST_CHECK_THROW( BP( fg, opts ), Exception );
+
+    // TRWBP does not freeze edges
+    opts.set( "freezesweeps", (size_t)3 );
+    TRWBP trwbp( fg, opts );
+    BOOST_CHECK_EQUAL( trwbp.props.freezetol, 0.0 );
+}
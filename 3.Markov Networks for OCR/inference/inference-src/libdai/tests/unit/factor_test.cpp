@@ -13,7 +13,11 @@
 using namespace dai;
 
 
+#ifdef DAI_SINGLE
+const Real tol = 1e-3;
+#else
 const Real tol = 1e-8;
+#endif
 
 
 #define BOOST_TEST_MODULE FactorTest
@@ -791,6 +795,47 @@ BOOST_AUTO_TEST_CASE( MiscOperationsTest ) {
 }
 
 
+BOOST_AUTO_TEST_CASE( ProductMarginalTest ) {
+    std::vector<Var> vars;
+    for( size_t i = 0; i < 5; i++ )
+        vars.push_back( Var( i, i + 1 ) );
+
+    for( size_t repeat = 0; repeat < 1000; repeat++ ) {
+        // random subsets of vars
+        std::vector<Factor> factors( 1 + rnd(4) );
+        VarSet marg_vars;
+        for( size_t i = 0; i < vars.size(); i++ )
+            if( rnd(2) == 0 )
+                marg_vars |= vars[i];
+        for( size_t k = 0; k < factors.size(); k++ ) {
+            VarSet vs;
+            for( size_t i = 0; i < vars.size(); i++ )
+                if( rnd(2) == 0 )
+                    vs |= vars[i];
+            factors[k] = Factor( vs );
+            factors[k].randomize();
+        }
+
+        Factor prod = factors[0];
+        std::vector<const Factor*> others;
+        for( size_t k = 1; k < factors.size(); k++ ) {
+            prod *= factors[k];
+            others.push_back( &factors[k] );
+        }
+
+        // the results should be identical, not just close
+        BOOST_CHECK( factors[0].productMarginal( others, marg_vars, false ) == prod.marginal( marg_vars, false ) );
+        BOOST_CHECK( factors[0].productMaxMarginal( others, marg_vars, false ) == prod.maxMarginal( marg_vars, false ) );
+        BOOST_CHECK( factors[0].productMarginal( others, marg_vars ) == prod.marginal( marg_vars ) );
+        BOOST_CHECK( factors[0].productMaxMarginal( others, marg_vars ) == prod.maxMarginal( marg_vars ) );
+        if( factors.size() == 2 ) {
+            BOOST_CHECK( factors[0].productMarginal( factors[1], marg_vars ) == prod.marginal( marg_vars ) );
+            BOOST_CHECK( factors[0].productMaxMarginal( factors[1], marg_vars ) == prod.maxMarginal( marg_vars ) );
+        }
+    }
+}
+
+
 BOOST_AUTO_TEST_CASE( RelatedFunctionsTest ) {
     Var v( 0, 3 );
     Factor x(v), y(v), z(v);
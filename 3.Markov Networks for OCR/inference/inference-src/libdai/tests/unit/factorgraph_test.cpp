@@ -15,7 +15,11 @@
 using namespace dai;
 
 
+#ifdef DAI_SINGLE
+const double tol = 1e-3;
+#else
 const double tol = 1e-8;
+#endif
 
 
 #define BOOST_TEST_MODULE FactorGraphTest
@@ -532,6 +536,52 @@ BOOST_AUTO_TEST_CASE( TransformationsTest ) {
 }
 
 
+BOOST_AUTO_TEST_CASE( ReorderedTest ) {
+    Var v0( 0, 2 );
+    Var v1( 1, 3 );
+    Var v2( 2, 2 );
+    std::vector<Factor> facs;
+    facs.push_back( Factor( VarSet( v0, v1 ) ).randomize() );
+    facs.push_back( Factor( VarSet( v1, v2 ) ).randomize() );
+    facs.push_back( Factor( v1 ).randomize() );
+    FactorGraph G( facs );
+
+    std::vector<size_t> varOrder, facOrder;
+    varOrder.push_back( 2 );
+    varOrder.push_back( 0 );
+    varOrder.push_back( 1 );
+    facOrder.push_back( 1 );
+    facOrder.push_back( 2 );
+    facOrder.push_back( 0 );
+    FactorGraph H = G.reordered( varOrder, facOrder );
+    BOOST_CHECK_EQUAL( H.nrVars(), 3 );
+    BOOST_CHECK_EQUAL( H.nrFactors(), 3 );
+    BOOST_CHECK_EQUAL( H.nrEdges(), G.nrEdges() );
+    for( size_t k = 0; k < 3; k++ ) {
+        BOOST_CHECK_EQUAL( H.var( k ), G.var( varOrder[k] ) );
+        BOOST_CHECK_EQUAL( H.factor( k ), G.factor( facOrder[k] ) );
+        BOOST_CHECK_EQUAL( H.findVar( G.var( varOrder[k] ) ), k );
+    }
+    for( size_t I = 0; I < 3; I++ )
+        bforeach( const Neighbor &i, H.nbF( I ) )
+            BOOST_CHECK( H.factor( I ).vars().contains( H.var( i ) ) );
+    BOOST_CHECK_EQUAL( H.bipGraph().nrEdges(), G.bipGraph().nrEdges() );
+    for( size_t k = 0; k < 3; k++ ) {
+        BOOST_CHECK_EQUAL( H.nbV( k ).size(), G.nbV( varOrder[k] ).size() );
+        BOOST_CHECK_EQUAL( H.nbF( k ).size(), G.nbF( facOrder[k] ).size() );
+    }
+
+    // renumbering by the orderings of the graph
+    std::vector<size_t> order1, order2;
+    G.bipGraph().orderRCM( order1, order2 );
+    H = G.reordered( order1, order2 );
+    for( size_t i = 0; i < 3; i++ )
+        BOOST_CHECK_EQUAL( H.var( i ), G.var( order1[i] ) );
+    for( size_t I = 0; I < 3; I++ )
+        BOOST_CHECK_EQUAL( H.factor( I ), G.factor( order2[I] ) );
+}
+
+
 BOOST_AUTO_TEST_CASE( OperationsTest ) {
     Var v0( 0, 2 );
     Var v1( 1, 2 );
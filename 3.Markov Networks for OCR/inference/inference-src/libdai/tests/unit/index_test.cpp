@@ -9,6 +9,7 @@
 #include <dai/index.h>
 #include <strstream>
 #include <map>
+#include <algorithm>
 
 
 using namespace dai;
@@ -54,6 +55,177 @@ BOOST_AUTO_TEST_CASE( IndexForTest ) {
 }
 
 
+/// Records the linear indices visited by ContractionPlan::run()
+struct RecordKernel {
+    std::vector<size_t> a;
+    std::vector<size_t> b;
+    size_t count;
+    void operator()( size_t i, size_t ai, size_t bi, size_t n, size_t sa, size_t sb ) {
+        BOOST_CHECK_EQUAL( i, count );
+        for( size_t j = 0; j < n; j++, ai += sa, bi += sb ) {
+            a.push_back( ai );
+            b.push_back( bi );
+        }
+        count += n;
+    }
+};
+
+
+BOOST_AUTO_TEST_CASE( ContractionPlanTest ) {
+    size_t nrVars = 6;
+    std::vector<Var> vars;
+    for( size_t i = 0; i < nrVars; i++ )
+        vars.push_back( Var( i, (i % 3) + 1 ) );
+
+    for( size_t repeat = 0; repeat < 10000; repeat++ ) {
+        VarSet forVars, indexVarsA, indexVarsB;
+        for( size_t i = 0; i < nrVars; i++ ) {
+            if( rnd(2) == 0 )
+                forVars |= vars[i];
+            if( rnd(2) == 0 )
+                indexVarsA |= vars[i];
+            if( rnd(2) == 0 )
+                indexVarsB |= vars[i];
+        }
+        ContractionPlan plan( forVars, indexVarsA, indexVarsB );
+        BOOST_CHECK_EQUAL( plan.size(), BigInt_size_t( forVars.nrStates() ) );
+        RecordKernel kernel;
+        kernel.count = 0;
+        size_t offset = 7;
+        plan.run( kernel, offset, 0 );
+        BOOST_CHECK_EQUAL( kernel.count, plan.size() );
+        IndexFor indA( indexVarsA, forVars ), indB( indexVarsB, forVars );
+        for( size_t i = 0; i < plan.size(); i++, ++indA, ++indB ) {
+            BOOST_CHECK_EQUAL( kernel.a[i], (size_t)indA + offset );
+            BOOST_CHECK_EQUAL( kernel.b[i], (size_t)indB );
+        }
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE( ContractionPlanFixedDepthTest ) {
+    // run() uses fixed-depth loops for plans with at most three dimensions; they should visit
+    // the same linear indices as the generic loops of runNested()
+    size_t nrVars = 5;
+    std::vector<Var> vars;
+    for( size_t i = 0; i < nrVars; i++ )
+        vars.push_back( Var( i, i + 2 ) );
+
+    size_t count[5] = { 0, 0, 0, 0, 0 };
+    for( size_t repeat = 0; repeat < 2000; repeat++ ) {
+        VarSet forVars, indexVarsA, indexVarsB;
+        for( size_t i = 0; i < nrVars; i++ ) {
+            if( rnd(2) == 0 )
+                forVars |= vars[i];
+            if( rnd(2) == 0 )
+                indexVarsA |= vars[i];
+            if( rnd(2) == 0 )
+                indexVarsB |= vars[i];
+        }
+        ContractionPlan plan( forVars, indexVarsA, indexVarsB );
+        count[std::min( plan.dims().size(), (size_t)4 )]++;
+        RecordKernel fixed, nested;
+        fixed.count = 0;
+        nested.count = 0;
+        plan.run( fixed, 3, 5 );
+        plan.runNested( nested, 3, 5 );
+        BOOST_CHECK_EQUAL( fixed.count, plan.size() );
+        BOOST_CHECK_EQUAL( nested.count, plan.size() );
+        BOOST_CHECK( fixed.a == nested.a );
+        BOOST_CHECK( fixed.b == nested.b );
+    }
+    // all specializations have been tested
+    for( size_t d = 0; d < 5; d++ )
+        BOOST_CHECK( count[d] > 0 );
+}
+
+
+BOOST_AUTO_TEST_CASE( ContractionPlanCacheTest ) {
+    Var x0( 0, 2 ), x1( 1, 3 ), x2( 2, 2 ), x1b( 1, 4 );
+    size_t oldSize = ContractionPlan::cacheSize();
+
+    ContractionPlan::setCacheSize( 2 );
+    BOOST_CHECK_EQUAL( ContractionPlan::cacheSize(), 2 );
+    boost::shared_ptr<const ContractionPlan> p1 = ContractionPlan::get( VarSet( x0, x1 ), x0, x1 );
+    BOOST_CHECK_EQUAL( ContractionPlan::nrCached(), 1 );
+    BOOST_CHECK( ContractionPlan::get( VarSet( x0, x1 ), x0, x1 ) == p1 );
+    BOOST_CHECK_EQUAL( ContractionPlan::nrCached(), 1 );
+    // variables with equal labels but different numbers of states yield different plans
+    boost::shared_ptr<const ContractionPlan> p2 = ContractionPlan::get( VarSet( x0, x1b ), x0, x1b );
+    BOOST_CHECK( p2 != p1 );
+    BOOST_CHECK_EQUAL( p2->size(), 8 );
+    BOOST_CHECK_EQUAL( ContractionPlan::nrCached(), 2 );
+    // touch p1, so that p2 is the least recently used plan
+    BOOST_CHECK( ContractionPlan::get( VarSet( x0, x1 ), x0, x1 ) == p1 );
+    ContractionPlan::get( VarSet( x0, x2 ), x0, x2 );
+    BOOST_CHECK_EQUAL( ContractionPlan::nrCached(), 2 );
+    BOOST_CHECK( ContractionPlan::get( VarSet( x0, x1 ), x0, x1 ) == p1 );
+    BOOST_CHECK( ContractionPlan::get( VarSet( x0, x1b ), x0, x1b ) != p2 );
+
+    ContractionPlan::setCacheSize( 0 );
+    BOOST_CHECK_EQUAL( ContractionPlan::nrCached(), 0 );
+    BOOST_CHECK( ContractionPlan::get( VarSet( x0, x1 ), x0, x1 ) != p1 );
+    BOOST_CHECK_EQUAL( ContractionPlan::nrCached(), 0 );
+
+    ContractionPlan::setCacheSize( oldSize );
+}
+
+
+BOOST_AUTO_TEST_CASE( IndexMapTest ) {
+    Var x0( 0, 2 ), x1( 1, 3 ), x2( 2, 2 ), x3( 3, 4 );
+    VarSet from( x0, x1 );
+    from |= x3;
+    VarSet to( x1, x2 );
+    to |= x3;
+
+    IndexMap map( from, to );
+    // compare with IndexFor, which loops over the joint states of from
+    IndexFor ind( to, from );
+    for( size_t i = 0; i < from.nrStates(); i++, ++ind )
+        BOOST_CHECK_EQUAL( map( i ), (size_t)ind );
+
+    IndexMap none( from, VarSet( x2 ) );
+    for( size_t i = 0; i < from.nrStates(); i++ )
+        BOOST_CHECK_EQUAL( none( i ), 0 );
+
+    IndexMap identity( from, from );
+    for( size_t i = 0; i < from.nrStates(); i++ )
+        BOOST_CHECK_EQUAL( identity( i ), i );
+}
+
+
+BOOST_AUTO_TEST_CASE( IndexTableTest ) {
+    Var x0( 0, 2 ), x1( 1, 3 ), x2( 2, 300 ), x3( 3, 4 );
+    VarSet vs( x0, x1 );
+    vs |= x2;
+    vs |= x3;
+    size_t N = BigInt_size_t( vs.nrStates() );
+
+    IndexTable none;
+    BOOST_CHECK_EQUAL( none.size(), 0 );
+    BOOST_CHECK_EQUAL( none.bytes(), 0 );
+
+    // compare with IndexFor for all variables and representations
+    Var vars[] = { x0, x1, x2, x3, Var( 4, 2 ) };
+    IndexTable::Type types[] = { IndexTable::Type::FULL, IndexTable::Type::COMPACT, IndexTable::Type::STRIDED };
+    for( size_t k = 0; k < 5; k++ )
+        for( size_t t = 0; t < 3; t++ ) {
+            IndexTable table( vars[k], vs, types[t] );
+            BOOST_CHECK_EQUAL( table.size(), N );
+            IndexFor ind( vars[k], vs );
+            for( size_t r = 0; r < N; r++, ++ind )
+                BOOST_CHECK_EQUAL( table[r], (size_t)ind );
+        }
+
+    // memory used by the different representations
+    BOOST_CHECK_EQUAL( IndexTable( x1, vs, IndexTable::Type::FULL ).bytes(), N * sizeof(size_t) );
+    BOOST_CHECK_EQUAL( IndexTable( x1, vs, IndexTable::Type::COMPACT ).bytes(), N );
+    BOOST_CHECK_EQUAL( IndexTable( x2, vs, IndexTable::Type::COMPACT ).bytes(), N * 2 );
+    BOOST_CHECK_EQUAL( IndexTable( x2, vs, IndexTable::Type::STRIDED ).bytes(), 0 );
+    BOOST_CHECK_EQUAL( IndexTable( x2, vs ).bytes(), N * 2 );
+}
+
+
 BOOST_AUTO_TEST_CASE( PermuteTest ) {
     Permute x;
 
@@ -305,3 +477,68 @@ BOOST_AUTO_TEST_CASE( StateTest ) {
         BOOST_CHECK( ci == ind.end() );
     }
 }
+
+
+BOOST_AUTO_TEST_CASE( FlatStateTest ) {
+    FlatState x;
+    BOOST_CHECK( x.valid() );
+
+    for( size_t repeat = 0; repeat < 1000; repeat++ ) {
+        std::vector<Var> vs;
+        for( size_t i = 0; i < 5; i++ )
+            if( rnd(2) == 0 )
+                vs.push_back( Var( i, rnd(3) + 1 ) );
+        VarSet vars( vs.begin(), vs.end() );
+        VarSet sub( Var( 5, 2 ) );
+        for( size_t k = 0; k < vs.size(); k++ )
+            if( rnd(2) == 0 )
+                sub |= vs[k];
+
+        State S( vars );
+        FlatState F( vars );
+        size_t iter = 0;
+        for( ; F.valid(); F++, S++, iter++ ) {
+            BOOST_CHECK( S.valid() );
+            BOOST_CHECK_EQUAL( (size_t)F, iter );
+            BOOST_CHECK_EQUAL( (size_t)F, (size_t)S );
+            for( size_t k = 0; k < vs.size(); k++ ) {
+                BOOST_CHECK_EQUAL( F(vs[k]), S(vs[k]) );
+                BOOST_CHECK_EQUAL( F[k], S(vs[k]) );
+            }
+            BOOST_CHECK_EQUAL( F( Var( 7, 2 ) ), 0 );
+            BOOST_CHECK_EQUAL( F(vars), iter );
+            BOOST_CHECK_EQUAL( F(sub), BigInt_size_t( S(sub) ) );
+            FlatState Fcopy( vars, iter );
+            for( size_t k = 0; k < vs.size(); k++ )
+                BOOST_CHECK_EQUAL( Fcopy[k], F[k] );
+        }
+        BOOST_CHECK( !S.valid() );
+        BOOST_CHECK_EQUAL( iter, BigInt_size_t( vars.nrStates() ) );
+        F.reset();
+        BOOST_CHECK( F.valid() );
+        BOOST_CHECK_EQUAL( (size_t)F, 0 );
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE( LargeStateTest ) {
+    // the linear state of 70 binary variables does not fit in 64 bits
+    std::vector<Var> vs;
+    for( size_t i = 0; i < 70; i++ )
+        vs.push_back( Var( i, 2 ) );
+    VarSet vars( vs.begin(), vs.end() );
+    BigInt linear = 1;
+    linear <<= 69;
+    linear += 5;
+    State S( vars, linear );
+    BOOST_CHECK_EQUAL( S(vs[0]), 1 );
+    BOOST_CHECK_EQUAL( S(vs[1]), 0 );
+    BOOST_CHECK_EQUAL( S(vs[2]), 1 );
+    BOOST_CHECK_EQUAL( S(vs[69]), 1 );
+    BOOST_CHECK( !S(vars).isSmall() );
+    BOOST_CHECK( S(vars).get() == linear );
+    BOOST_CHECK_EQUAL( S( VarSet( vs[0], vs[2] ) ), 3 );
+    S++;
+    BOOST_CHECK( S(vars).get() == linear + 1 );
+    BOOST_CHECK_THROW( (size_t)S, Exception );
+}
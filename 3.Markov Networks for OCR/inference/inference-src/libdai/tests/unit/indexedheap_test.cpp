@@ -0,0 +1,97 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+#include <dai/indexedheap.h>
+#include <dai/util.h>
+#include <vector>
+#include <map>
+#include <functional>
+#include <utility>
+
+
+using namespace dai;
+
+
+#define BOOST_TEST_MODULE IndexedHeapTest
+
+
+#include <boost/test/unit_test.hpp>
+
+
+BOOST_AUTO_TEST_CASE( ConstructorsTest ) {
+    IndexedHeap<int> x;
+    BOOST_CHECK_EQUAL( x.size(), 0 );
+    BOOST_CHECK( x.empty() );
+    BOOST_CHECK( x.isHeap() );
+
+    IndexedHeap<int> y( 5, 3 );
+    BOOST_CHECK_EQUAL( y.size(), 5 );
+    BOOST_CHECK( !y.empty() );
+    BOOST_CHECK( y.isHeap() );
+    for( size_t item = 0; item < 5; item++ )
+        BOOST_CHECK_EQUAL( y.key( item ), 3 );
+    BOOST_CHECK_EQUAL( y.topKey(), 3 );
+
+    y.clear();
+    BOOST_CHECK( y.empty() );
+    y.assign( 2 );
+    BOOST_CHECK_EQUAL( y.size(), 2 );
+    BOOST_CHECK_EQUAL( y.key( 1 ), 0 );
+}
+
+
+BOOST_AUTO_TEST_CASE( SetTest ) {
+    IndexedHeap<int> x( 6 );
+    x.set( 3, 5 );
+    BOOST_CHECK_EQUAL( x.top(), 3 );
+    x.set( 1, 7 );
+    BOOST_CHECK_EQUAL( x.top(), 1 );
+    BOOST_CHECK_EQUAL( x.topKey(), 7 );
+    x.set( 1, -1 );
+    BOOST_CHECK_EQUAL( x.top(), 3 );
+    BOOST_CHECK_EQUAL( x.key( 1 ), -1 );
+    x.set( 3, 5 );
+    BOOST_CHECK_EQUAL( x.top(), 3 );
+    BOOST_CHECK( x.isHeap() );
+
+    // a different ordering yields a min-heap
+    IndexedHeap<int, 2, std::greater<int> > y( 4, 10 );
+    y.set( 2, 1 );
+    y.set( 0, 4 );
+    BOOST_CHECK_EQUAL( y.top(), 2 );
+    y.set( 2, 20 );
+    BOOST_CHECK_EQUAL( y.top(), 0 );
+    BOOST_CHECK( y.isHeap() );
+}
+
+
+BOOST_AUTO_TEST_CASE( RandomTest ) {
+    // compare with a multimap, breaking ties in favor of the most recently set key (like BP with updates=SEQMAX)
+    rnd_seed( 123 );
+    const size_t n = 100;
+    typedef std::pair<double, size_t> Key;
+    IndexedHeap<Key> heap( n );
+    std::multimap<double, size_t> lut;
+    std::vector<std::multimap<double, size_t>::iterator> item2lut;
+    size_t stamp = 0;
+    for( size_t item = 0; item < n; item++ ) {
+        item2lut.push_back( lut.insert( std::make_pair( 0.0, item ) ) );
+        heap.set( item, Key( 0.0, stamp++ ) );
+    }
+    for( size_t t = 0; t < 10000; t++ ) {
+        size_t item = rnd( n );
+        // few different values, so that there are many ties
+        double r = rnd( 8 ) / 4.0;
+        lut.erase( item2lut[item] );
+        item2lut[item] = lut.insert( std::make_pair( r, item ) );
+        heap.set( item, Key( r, stamp++ ) );
+        BOOST_CHECK_EQUAL( heap.top(), (--lut.end())->second );
+        BOOST_CHECK_EQUAL( heap.key( item ).first, r );
+    }
+    BOOST_CHECK( heap.isHeap() );
+}
@@ -0,0 +1,142 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+#include <dai/logfactor.h>
+#include <sstream>
+
+
+using namespace dai;
+
+
+#ifdef DAI_SINGLE
+const Real tol = 1e-3;
+#else
+const Real tol = 1e-8;
+#endif
+
+
+#define BOOST_TEST_MODULE LogFactorTest
+
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+
+/// Returns a random factor on \a vs of which approximately a fraction \a zeros of the values is zero
+Factor randomFactor( const VarSet &vs, Real zeros ) {
+    Factor f( vs );
+    f.randomize();
+    for( size_t i = 0; i < f.nrStates(); i++ )
+        if( rnd_uniform() < zeros )
+            f.set( i, 0.0 );
+    return f;
+}
+
+
+/// Returns a random subset of \a vars
+VarSet randomSubset( const std::vector<Var> &vars ) {
+    VarSet vs;
+    for( size_t i = 0; i < vars.size(); i++ )
+        if( rnd(2) == 0 )
+            vs |= vars[i];
+    return vs;
+}
+
+
+BOOST_AUTO_TEST_CASE( ConstructorsTest ) {
+    LogFactor x1;
+    BOOST_CHECK_EQUAL( x1.nrStates(), 1 );
+    BOOST_CHECK_EQUAL( x1[0], 0.0 );
+    BOOST_CHECK( x1.vars() == VarSet() );
+    BOOST_CHECK( x1.toFactor() == Factor() );
+
+    Var v1( 0, 3 ), v2( 1, 2 );
+    LogFactor x2( VarSet( v1, v2 ), -1.0 );
+    BOOST_CHECK_EQUAL( x2.nrStates(), 6 );
+    for( size_t i = 0; i < x2.nrStates(); i++ )
+        BOOST_CHECK_EQUAL( x2[i], -1.0 );
+
+    Factor f( VarSet( v1, v2 ), 1.0 );
+    f.set( 1, 0.0 );
+    f.set( 4, 2.0 );
+    LogFactor x3( f );
+    BOOST_CHECK( x3.vars() == f.vars() );
+    BOOST_CHECK_EQUAL( x3[0], 0.0 );
+    BOOST_CHECK_EQUAL( x3[1], -INFINITY );
+    BOOST_CHECK_CLOSE( x3[4], std::log( (Real)2.0 ), tol );
+    BOOST_CHECK_SMALL( dist( x3.toFactor().p(), f.p(), DISTLINF ), tol );
+
+    LogFactor x4( f.vars(), x3.logp() );
+    BOOST_CHECK( x4 == x3 );
+    x4.set( 2, 1.0 );
+    BOOST_CHECK_EQUAL( x4.get( 2 ), 1.0 );
+    BOOST_CHECK( !(x4 == x3) );
+}
+
+
+BOOST_AUTO_TEST_CASE( NormalizeTest ) {
+    Var v1( 0, 3 ), v2( 1, 2 );
+    Factor f( VarSet( v1, v2 ), 1.0 );
+    f.set( 3, 0.0 );
+    f.set( 5, 4.0 );
+    LogFactor x( f );
+    BOOST_CHECK_CLOSE( x.logSumExp(), std::log( (Real)8.0 ), tol );
+    BOOST_CHECK_CLOSE( x.normalize(), std::log( (Real)8.0 ), tol );
+    BOOST_CHECK_SMALL( dist( x.toFactor().p(), f.normalized().p(), DISTLINF ), tol );
+    BOOST_CHECK_EQUAL( x[3], -INFINITY );
+
+    // values that would underflow in the normal domain
+    LogFactor y( VarSet( v1 ), -2000.0 );
+    y.set( 0, -1000.0 );
+    BOOST_CHECK_CLOSE( y.logSumExp(), (Real)-1000.0, tol );
+    y.normalize();
+    BOOST_CHECK_SMALL( y[0], tol );
+    BOOST_CHECK_CLOSE( y[1], (Real)-1000.0, tol );
+
+    LogFactor z( VarSet( v1 ), -INFINITY );
+    BOOST_CHECK_EQUAL( z.logSumExp(), -INFINITY );
+    BOOST_CHECK_THROW( z.normalize(), Exception );
+    BOOST_CHECK_THROW( z.normalized(), Exception );
+
+    std::stringstream ss;
+    ss << LogFactor( VarSet( v1 ), 0.0 );
+    BOOST_CHECK_EQUAL( ss.str(), std::string( "({x0}, log (0, 0, 0))" ) );
+}
+
+
+BOOST_AUTO_TEST_CASE( OperationsTest ) {
+    std::vector<Var> vars;
+    for( size_t i = 0; i < 5; i++ )
+        vars.push_back( Var( i, i + 2 ) );
+
+    for( size_t repeat = 0; repeat < 500; repeat++ ) {
+        Factor f = randomFactor( randomSubset( vars ), 0.2 );
+        Factor g = randomFactor( randomSubset( vars ), 0.2 );
+        LogFactor lf( f ), lg( g );
+
+        // products, quotients and powers
+        BOOST_CHECK_SMALL( dist( (lf * lg).toFactor().p(), (f * g).p(), DISTLINF ), tol );
+        BOOST_CHECK_SMALL( dist( (lf / lg).toFactor().p(), (f / g).p(), DISTLINF ), tol );
+        BOOST_CHECK_SMALL( dist( (lf ^ 0.5).toFactor().p(), (f ^ 0.5).p(), DISTLINF ), tol );
+        BOOST_CHECK_SMALL( dist( (lf ^ 0.0).toFactor().p(), (f ^ 0.0).p(), DISTLINF ), tol );
+
+        // marginals
+        VarSet marg_vars = randomSubset( vars );
+        BOOST_CHECK_SMALL( dist( lf.marginal( marg_vars, false ).toFactor().p(), f.marginal( marg_vars, false ).p(), DISTLINF ), tol );
+        BOOST_CHECK_SMALL( dist( lf.maxMarginal( marg_vars, false ).toFactor().p(), f.maxMarginal( marg_vars, false ).p(), DISTLINF ), tol );
+        if( f.sum() != 0.0 ) {
+            BOOST_CHECK_SMALL( dist( lf.marginal( marg_vars ).toFactor().p(), f.marginal( marg_vars ).p(), DISTLINF ), tol );
+            BOOST_CHECK_SMALL( dist( lf.maxMarginal( marg_vars ).toFactor().p(), f.maxMarginal( marg_vars ).p(), DISTLINF ), tol );
+        }
+
+        // slices
+        VarSet slice_vars = marg_vars & f.vars();
+        size_t state = rnd( BigInt_size_t( slice_vars.nrStates() ) );
+        BOOST_CHECK( lf.slice( slice_vars, state ) == LogFactor( f.slice( slice_vars, state ) ) );
+    }
+}
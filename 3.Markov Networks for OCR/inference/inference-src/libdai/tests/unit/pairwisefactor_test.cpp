@@ -0,0 +1,157 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+#include <dai/pairwisefactor.h>
+#include <vector>
+#include <cmath>
+
+
+using namespace dai;
+
+
+#ifdef DAI_SINGLE
+const Real tol = 1e-3;
+#else
+const Real tol = 1e-8;
+#endif
+
+
+#define BOOST_TEST_MODULE PairwiseFactorTest
+
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+
+/// Checks the messages of \a pf against those of the dense factor \a f, for incoming messages with and without zeros
+void checkMessages( const PairwiseFactor &pf, const Factor &f ) {
+    const size_t k = pf.states();
+    for( size_t sumprod = 0; sumprod < 2; sumprod++ ) {
+        if( !pf.fast( sumprod ) )
+            continue;
+        for( size_t zeros = 0; zeros < 2; zeros++ ) {
+            std::vector<Real> h( k ), lh( k ), m( k ), lm( k );
+            for( size_t y = 0; y < k; y++ ) {
+                h[y] = (zeros && y % 3 == 1) ? 0.0 : rnd_uniform();
+                lh[y] = (h[y] > 0.0) ? std::log( h[y] ) : -INFINITY;
+            }
+            pf.message( &(h[0]), &(m[0]), sumprod );
+            pf.logMessage( &(lh[0]), &(lm[0]), sumprod );
+            for( size_t x1 = 0; x1 < k; x1++ ) {
+                // f is symmetric, so it does not matter which variable receives the message
+                Real expected = 0.0;
+                for( size_t x2 = 0; x2 < k; x2++ ) {
+                    Real v = f[x1 + k * x2] * h[x2];
+                    if( sumprod )
+                        expected += v;
+                    else if( v > expected )
+                        expected = v;
+                }
+                BOOST_CHECK_CLOSE( m[x1], expected, tol );
+                if( expected > 0.0 )
+                    BOOST_CHECK_CLOSE( lm[x1], std::log( expected ), tol );
+                else
+                    BOOST_CHECK_EQUAL( lm[x1], -INFINITY );
+            }
+        }
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE( DetectionTest ) {
+    Var v0( 0, 5 ), v1( 1, 5 ), w( 2, 4 ), b0( 3, 2 ), b1( 4, 2 );
+
+    PairwiseFactor x;
+    BOOST_CHECK_EQUAL( x.kind(), PairwiseFactor::Kind::DENSE );
+    BOOST_CHECK( !x.fast( true ) );
+    BOOST_CHECK( !x.fast( false ) );
+
+    PairwiseFactor potts( createFactorPotts( v0, v1, 1.5 ) );
+    BOOST_CHECK_EQUAL( potts.kind(), PairwiseFactor::Kind::DIAGONAL );
+    BOOST_CHECK_EQUAL( potts.states(), 5 );
+    BOOST_CHECK_EQUAL( potts.offDiagonal(), 1.0 );
+    for( size_t s = 0; s < 5; s++ )
+        BOOST_CHECK_EQUAL( potts.diagonal()[s], std::exp( 1.5 ) );
+    BOOST_CHECK( potts.fast( true ) );
+    BOOST_CHECK( potts.fast( false ) );
+    BOOST_CHECK( potts.toFactor( VarSet( v0, v1 ) ) == createFactorPotts( v0, v1, 1.5 ) );
+
+    PairwiseFactor ising( createFactorIsing( b0, b1, -0.5 ) );
+    BOOST_CHECK_EQUAL( ising.kind(), PairwiseFactor::Kind::DIAGONAL );
+    BOOST_CHECK_EQUAL( ising.offDiagonal(), std::exp( 0.5 ) );
+
+    PairwiseFactor linear( createFactorTruncatedLinear( v0, v1, 0.5, 1.2 ) );
+    BOOST_CHECK_EQUAL( linear.kind(), PairwiseFactor::Kind::TRUNCLINEAR );
+    BOOST_CHECK_CLOSE( linear.slope(), 0.5, tol );
+    BOOST_CHECK_CLOSE( linear.truncation(), 1.2, tol );
+    BOOST_CHECK( dai::abs( linear.logScale() ) < tol );
+    BOOST_CHECK( !linear.fast( true ) );
+    BOOST_CHECK( linear.fast( false ) );
+
+    PairwiseFactor quadratic( createFactorTruncatedQuadratic( v0, v1, 0.3, 2.0 ) );
+    BOOST_CHECK_EQUAL( quadratic.kind(), PairwiseFactor::Kind::TRUNCQUADRATIC );
+    BOOST_CHECK_CLOSE( quadratic.slope(), 0.3, tol );
+    BOOST_CHECK_CLOSE( quadratic.truncation(), 2.0, tol );
+    BOOST_CHECK( dist( quadratic.toFactor( VarSet( v0, v1 ) ), createFactorTruncatedQuadratic( v0, v1, 0.3, 2.0 ), DISTLINF ) < tol );
+
+    // a truncated linear factor that is truncated at distance one is a Potts factor
+    BOOST_CHECK_EQUAL( PairwiseFactor( createFactorTruncatedLinear( v0, v1, 2.0, 1.0 ) ).kind(), PairwiseFactor::Kind::DIAGONAL );
+
+    // random factors and factors on variables with different numbers of states are dense
+    Factor r( VarSet( v0, v1 ) );
+    r.randomize();
+    BOOST_CHECK_EQUAL( PairwiseFactor( r ).kind(), PairwiseFactor::Kind::DENSE );
+    BOOST_CHECK_EQUAL( PairwiseFactor( Factor( VarSet( v0, w ), 1.0 ) ).kind(), PairwiseFactor::Kind::DENSE );
+    BOOST_CHECK_EQUAL( PairwiseFactor( Factor( v0, 1.0 ) ).kind(), PairwiseFactor::Kind::DENSE );
+
+    // a factor that only depends on the distance, but is not truncated linear or quadratic, is dense
+    Factor cubic( VarSet( v0, v1 ) );
+    for( size_t x2 = 0; x2 < 5; x2++ )
+        for( size_t x1 = 0; x1 < 5; x1++ ) {
+            Real d = (Real)x1 - (Real)x2;
+            cubic.set( x1 + 5 * x2, std::exp( -0.1 * dai::abs( d * d * d ) ) );
+        }
+    BOOST_CHECK_EQUAL( PairwiseFactor( cubic ).kind(), PairwiseFactor::Kind::DENSE );
+}
+
+
+BOOST_AUTO_TEST_CASE( MessagesTest ) {
+    rnd_seed( 1 );
+    Var v0( 0, 12 ), v1( 1, 12 );
+    VarSet vs( v0, v1 );
+
+    // constant off the diagonal, random on the diagonal, also with zeros
+    std::vector<Real> diagonal( 12 );
+    for( size_t x = 0; x < 12; x++ )
+        diagonal[x] = (x % 4 == 0) ? 0.0 : 2.0 * rnd_uniform();
+    Real offDiagonal[] = { 0.0, 0.3, 1.0 };
+    for( size_t c = 0; c < 3; c++ ) {
+        PairwiseFactor pf( offDiagonal[c], diagonal );
+        checkMessages( pf, pf.toFactor( vs ) );
+    }
+
+    Factor potts = createFactorPotts( v0, v1, -0.7 );
+    checkMessages( PairwiseFactor( potts ), potts );
+
+    Real params[][2] = { {0.2, 0.8}, {0.5, 100.0}, {1.5, 4.0}, {0.05, 3.0} };
+    for( size_t p = 0; p < 4; p++ ) {
+        Factor linear = createFactorTruncatedLinear( v0, v1, params[p][0], params[p][1] );
+        PairwiseFactor pl( linear );
+        BOOST_CHECK_EQUAL( pl.kind(), PairwiseFactor::Kind::TRUNCLINEAR );
+        checkMessages( pl, linear );
+
+        Factor quadratic = createFactorTruncatedQuadratic( v0, v1, params[p][0], params[p][1] );
+        PairwiseFactor pq( quadratic );
+        BOOST_CHECK_EQUAL( pq.kind(), PairwiseFactor::Kind::TRUNCQUADRATIC );
+        checkMessages( pq, quadratic );
+
+        // with a scale
+        PairwiseFactor scaled( PairwiseFactor::Kind::TRUNCQUADRATIC, 12, 0.4, params[p][0], params[p][1] );
+        checkMessages( scaled, scaled.toFactor( vs ) );
+    }
+}
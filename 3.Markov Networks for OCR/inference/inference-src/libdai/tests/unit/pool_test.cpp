@@ -0,0 +1,203 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+#include <dai/pool.h>
+#include <dai/alldai.h>
+#include <cstdlib>
+#include <new>
+
+
+using namespace dai;
+
+
+#define BOOST_TEST_MODULE MemoryPoolTest
+
+
+#include <boost/test/unit_test.hpp>
+
+
+/// Number of heap allocations so far
+size_t nrAllocs = 0;
+
+
+// Exception specifications of the replaced allocation functions
+#if __cplusplus >= 201103L
+#define BAD_ALLOC_SPEC
+#define NOTHROW_SPEC noexcept
+#else
+#define BAD_ALLOC_SPEC throw( std::bad_alloc )
+#define NOTHROW_SPEC throw()
+#endif
+
+
+// Count all heap allocations of the program
+void* operator new( size_t size ) BAD_ALLOC_SPEC {
+    nrAllocs++;
+    void *p = malloc( size ? size : 1 );
+    if( !p )
+        throw std::bad_alloc();
+    return p;
+}
+void* operator new[]( size_t size ) BAD_ALLOC_SPEC {
+    nrAllocs++;
+    void *p = malloc( size ? size : 1 );
+    if( !p )
+        throw std::bad_alloc();
+    return p;
+}
+void operator delete( void *p ) NOTHROW_SPEC { free( p ); }
+void operator delete[]( void *p ) NOTHROW_SPEC { free( p ); }
+#ifdef __cpp_sized_deallocation
+void operator delete( void *p, size_t ) NOTHROW_SPEC { free( p ); }
+void operator delete[]( void *p, size_t ) NOTHROW_SPEC { free( p ); }
+#endif
+
+
+/// Returns a grid-shaped factor graph with \a n x \a n variables with \a states states each, with random factors
+FactorGraph createGrid( size_t n, size_t states ) {
+    std::vector<Var> vars;
+    for( size_t i = 0; i < n * n; i++ )
+        vars.push_back( Var( i, states ) );
+    std::vector<Factor> factors;
+    for( size_t i = 0; i < n * n; i++ ) {
+        factors.push_back( Factor( vars[i] ) );
+        factors.back().randomize();
+        if( i % n + 1 < n ) {
+            factors.push_back( Factor( VarSet( vars[i], vars[i + 1] ) ) );
+            factors.back().randomize();
+        }
+        if( i + n < n * n ) {
+            factors.push_back( Factor( VarSet( vars[i], vars[i + n] ) ) );
+            factors.back().randomize();
+        }
+    }
+    return FactorGraph( factors );
+}
+
+
+/// Returns the number of heap allocations done by \a alg.run()
+size_t allocsPerRun( InfAlg &alg ) {
+    size_t allocs = nrAllocs;
+    alg.run();
+    return nrAllocs - allocs;
+}
+
+
+BOOST_AUTO_TEST_CASE( AllocateTest ) {
+    MemoryPool pool;
+    BOOST_CHECK_EQUAL( pool.nrUsed(), 0 );
+    BOOST_CHECK_EQUAL( pool.nrCached(), 0 );
+
+    void *p = pool.allocate( 100 );
+    void *q = pool.allocate( 1000 );
+    BOOST_CHECK_EQUAL( pool.nrUsed(), 2 );
+    MemoryPool::deallocate( p );
+    BOOST_CHECK_EQUAL( pool.nrUsed(), 1 );
+    BOOST_CHECK_EQUAL( pool.nrCached(), 1 );
+
+    // blocks are recycled per size class
+    size_t allocs = nrAllocs;
+    void *r = pool.allocate( 120 );
+    BOOST_CHECK_EQUAL( nrAllocs, allocs );
+    BOOST_CHECK_EQUAL( r, p );
+    BOOST_CHECK_EQUAL( pool.nrCached(), 0 );
+    void *s = pool.allocate( 60 );
+    BOOST_CHECK_EQUAL( nrAllocs, allocs + 1 );
+    MemoryPool::deallocate( r );
+    MemoryPool::deallocate( s );
+    BOOST_CHECK_EQUAL( pool.nrCached(), 2 );
+    pool.release();
+    BOOST_CHECK_EQUAL( pool.nrCached(), 0 );
+
+    // copies are new, empty pools
+    MemoryPool pool2( pool );
+    BOOST_CHECK_EQUAL( pool2.nrUsed(), 0 );
+    void *t = pool2.allocate( 1000 );
+    BOOST_CHECK( t != q );
+    MemoryPool::deallocate( q );
+    BOOST_CHECK_EQUAL( pool.nrCached(), 1 );
+    BOOST_CHECK_EQUAL( pool2.nrCached(), 0 );
+    MemoryPool::deallocate( t );
+    MemoryPool::deallocate( NULL );
+
+    // memory can outlive its pool
+    MemoryPool *pool3 = new MemoryPool();
+    void *u = pool3->allocate( 10 );
+    delete pool3;
+    MemoryPool::deallocate( u );
+}
+
+
+BOOST_AUTO_TEST_CASE( ScopeTest ) {
+    MemoryPool pool1, pool2;
+    BOOST_CHECK( MemoryPool::current() == NULL );
+    void *p = MemoryPool::allocateCurrent( 100 );
+    {
+        MemoryPool::Scope scope1( pool1 );
+        BOOST_CHECK( MemoryPool::current() == &pool1 );
+        {
+            MemoryPool::Scope scope2( pool2 );
+            BOOST_CHECK( MemoryPool::current() == &pool2 );
+            SmallVector<double, 4> x( 10, 1.0 );
+            BOOST_CHECK_EQUAL( pool2.nrUsed(), 1 );
+        }
+        BOOST_CHECK_EQUAL( pool2.nrUsed(), 0 );
+        BOOST_CHECK_EQUAL( pool2.nrCached(), 1 );
+        BOOST_CHECK( MemoryPool::current() == &pool1 );
+
+        // memory is returned to where it was drawn from
+        MemoryPool::deallocate( p );
+        BOOST_CHECK_EQUAL( pool1.nrCached(), 0 );
+        Prob q( 100 );
+        BOOST_CHECK_EQUAL( pool1.nrUsed(), 1 );
+    }
+    BOOST_CHECK( MemoryPool::current() == NULL );
+    BOOST_CHECK_EQUAL( pool1.nrUsed(), 0 );
+    BOOST_CHECK_EQUAL( pool1.nrCached(), 1 );
+}
+
+
+#ifdef DAI_WITH_BP
+BOOST_AUTO_TEST_CASE( BPAllocationsTest ) {
+    FactorGraph fg = createGrid( 4, 10 );
+    const char* updates[] = { "SEQFIX", "SEQRND", "SEQMAX", "PARALL" };
+    for( size_t u = 0; u < 4; u++ )
+        for( size_t logdomain = 0; logdomain < 2; logdomain++ ) {
+            PropertySet opts;
+            opts.set( "tol", (Real)0.0 );
+            opts.set( "maxiter", (size_t)2 );
+            opts.set( "updates", std::string( updates[u] ) );
+            opts.set( "logdomain", (bool)logdomain );
+            BP bp( fg, opts );
+            bp.init();
+            bp.run();
+            bp.setMaxIter( 10 );
+            BOOST_CHECK_EQUAL( allocsPerRun( bp ), 0 );
+            BOOST_CHECK_EQUAL( bp.Iterations(), 10 );
+        }
+}
+#endif
+
+
+#ifdef DAI_WITH_JTREE
+BOOST_AUTO_TEST_CASE( JTreeAllocationsTest ) {
+    FactorGraph fg = createGrid( 3, 4 );
+    const char* updates[] = { "HUGIN", "SHSH" };
+    for( size_t u = 0; u < 2; u++ )
+        for( size_t logdomain = 0; logdomain < 2; logdomain++ ) {
+            PropertySet opts;
+            opts.set( "updates", std::string( updates[u] ) );
+            opts.set( "logdomain", (bool)logdomain );
+            JTree jt( fg, opts );
+            jt.init();
+            jt.run();
+            jt.init();
+            BOOST_CHECK_EQUAL( allocsPerRun( jt ), 0 );
+        }
+}
+#endif
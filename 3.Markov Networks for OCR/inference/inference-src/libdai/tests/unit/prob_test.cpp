@@ -14,7 +14,11 @@
 using namespace dai;
 
 
+#ifdef DAI_SINGLE
+const Real tol = 1e-3;
+#else
 const Real tol = 1e-8;
+#endif
 
 
 #define BOOST_TEST_MODULE ProbTest
@@ -61,6 +61,11 @@ BOOST_AUTO_TEST_CASE( PropertyTest ) {
     str7 >> s;
     BOOST_CHECK_EQUAL( s, "key=[prop1=hi,prop2=5]" );
 
+    p.second = 0.5f;
+    str8 << p;
+    str8 >> s;
+    BOOST_CHECK_EQUAL( s, "key=0.5" );
+
     p.second = std::vector<int>();
     BOOST_CHECK_THROW( str7 << p, Exception );
 }
@@ -148,6 +153,11 @@ BOOST_AUTO_TEST_CASE( ConstructorsTest ) {
     BOOST_CHECK_EQUAL( key3val.getStringAs<double>( "key3b" ), 7.0 );
     BOOST_CHECK_THROW( z.getAs<size_t>( "key2" ), Exception );
     BOOST_CHECK_THROW( z.getStringAs<size_t>( "key4" ), Exception );
+    // floating point values are converted between float and double
+    BOOST_CHECK_EQUAL( z.getStringAs<float>( "key4" ), 1.0f );
+    BOOST_CHECK_EQUAL( z.getStringAs<Real>( "key4" ), (Real)1.0 );
+    BOOST_CHECK_EQUAL( PropertySet()( "tol", 0.5f ).getStringAs<double>( "tol" ), 0.5 );
+    BOOST_CHECK_THROW( PropertySet()( "tol", 0.5f ).getAs<double>( "tol" ), Exception );
 }
 
 
@@ -0,0 +1,108 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+#include <dai/util.h>
+#include <dai/simd.h>
+#include <vector>
+
+
+using namespace dai;
+
+
+#define BOOST_TEST_MODULE SimdTest
+
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+
+/// Checks all kernels for value type \a T against the generic scalar kernels, for all instruction sets and many lengths
+template<typename T> void checkKernels( T tol ) {
+    simd::InstructionSet best = simd::detectInstructionSet();
+    for( size_t is = simd::SCALAR; is <= (size_t)best; is++ ) {
+        BOOST_CHECK_EQUAL( simd::setInstructionSet( (simd::InstructionSet)is ), (simd::InstructionSet)is );
+        BOOST_CHECK_EQUAL( simd::instructionSet(), (simd::InstructionSet)is );
+        for( size_t n = 0; n < 150; n++ ) {
+            std::vector<T> x( n + 1 ), y( n + 1 );
+            for( size_t i = 0; i < n; i++ ) {
+                x[i] = (T)rnd_stdnormal();
+                y[i] = (i % 7 == 3) ? (T)0 : (T)rnd_stdnormal();
+            }
+
+            std::vector<T> a( x ), b( x );
+            simd::add( &a[0], &y[0], n );
+            simd::add<T>( &b[0], &y[0], n );
+            BOOST_CHECK( a == b );
+
+            a = x; b = x;
+            simd::mul( &a[0], &y[0], n );
+            simd::mul<T>( &b[0], &y[0], n );
+            BOOST_CHECK( a == b );
+
+            a = x; b = x;
+            simd::div0( &a[0], &y[0], n );
+            simd::div0<T>( &b[0], &y[0], n );
+            BOOST_CHECK( a == b );
+            for( size_t i = 0; i < n; i++ )
+                if( y[i] == (T)0 )
+                    BOOST_CHECK_EQUAL( a[i], (T)0 );
+
+            a = x; b = x;
+            simd::pwMax( &a[0], &y[0], n );
+            simd::pwMax<T>( &b[0], &y[0], n );
+            BOOST_CHECK( a == b );
+
+            a = x; b = x;
+            simd::scale( &a[0], (T)0.3, n );
+            simd::scale<T>( &b[0], (T)0.3, n );
+            BOOST_CHECK( a == b );
+
+            a = x; b = x;
+            simd::divide( &a[0], (T)0.3, n );
+            simd::divide<T>( &b[0], (T)0.3, n );
+            BOOST_CHECK( a == b );
+
+            BOOST_CHECK_EQUAL( simd::max( &x[0], n ), simd::max<T>( &x[0], n ) );
+            BOOST_CHECK_EQUAL( simd::min( &x[0], n ), simd::min<T>( &x[0], n ) );
+            T s = simd::sum( &x[0], n );
+            T s_ref = simd::sum<T>( &x[0], n );
+            BOOST_CHECK_SMALL( s - s_ref, tol * (n + 1) );
+            // the element beyond the end should not have been touched
+            BOOST_CHECK_EQUAL( a[n], (T)0 );
+        }
+    }
+    simd::setInstructionSet( best );
+}
+
+
+BOOST_AUTO_TEST_CASE( InstructionSetTest ) {
+    simd::InstructionSet best = simd::detectInstructionSet();
+    BOOST_CHECK_EQUAL( simd::setInstructionSet( simd::SCALAR ), simd::SCALAR );
+    BOOST_CHECK_EQUAL( simd::instructionSet(), simd::SCALAR );
+    BOOST_CHECK_EQUAL( simd::setInstructionSet( simd::AVX512 ), best );
+    BOOST_CHECK_EQUAL( simd::instructionSet(), best );
+    BOOST_CHECK_EQUAL( std::string( simd::instructionSetName( simd::SCALAR ) ), std::string( "SCALAR" ) );
+    BOOST_CHECK_EQUAL( std::string( simd::instructionSetName( simd::AVX2 ) ), std::string( "AVX2" ) );
+}
+
+
+BOOST_AUTO_TEST_CASE( DoubleKernelsTest ) {
+    checkKernels<double>( 1e-12 );
+}
+
+
+BOOST_AUTO_TEST_CASE( FloatKernelsTest ) {
+    checkKernels<float>( 1e-4f );
+}
+
+
+BOOST_AUTO_TEST_CASE( EmptyTest ) {
+    BOOST_CHECK_EQUAL( simd::sum( (double*)0, 0 ), 0.0 );
+    BOOST_CHECK_EQUAL( simd::max( (double*)0, 0 ), -INFINITY );
+    BOOST_CHECK_EQUAL( simd::min( (float*)0, 0 ), (float)INFINITY );
+}
@@ -174,7 +174,7 @@ BOOST_AUTO_TEST_CASE( QueriesTest ) {
     
     x.elements()[0] = 3;
     x.elements()[1] = 4;
-    std::vector<int> v;
+    SmallSet<int>::container_type v;
     v.push_back( 3 );
     v.push_back( 4 );
     BOOST_CHECK( x.elements() == v );
@@ -0,0 +1,142 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+#include <dai/smallvector.h>
+#include <vector>
+#include <stdexcept>
+
+
+using namespace dai;
+
+
+#define BOOST_TEST_MODULE SmallVectorTest
+
+
+#include <boost/test/unit_test.hpp>
+
+
+BOOST_AUTO_TEST_CASE( ConstructorsTest ) {
+    SmallVector<double, 4> x;
+    BOOST_CHECK( x.empty() );
+    BOOST_CHECK_EQUAL( x.size(), 0 );
+    BOOST_CHECK_EQUAL( x.capacity(), 4 );
+    BOOST_CHECK( !x.onHeap() );
+
+    SmallVector<double, 4> y( 3, 2.0 );
+    BOOST_CHECK_EQUAL( y.size(), 3 );
+    BOOST_CHECK( !y.onHeap() );
+    for( size_t i = 0; i < y.size(); i++ )
+        BOOST_CHECK_EQUAL( y[i], 2.0 );
+
+    SmallVector<double, 4> z( 6, 1.0 );
+    BOOST_CHECK_EQUAL( z.size(), 6 );
+    BOOST_CHECK( z.onHeap() );
+    for( size_t i = 0; i < z.size(); i++ )
+        BOOST_CHECK_EQUAL( z[i], 1.0 );
+
+    SmallVector<double, 4> y2( y );
+    BOOST_CHECK( y2 == y );
+    BOOST_CHECK( !y2.onHeap() );
+    SmallVector<double, 4> z2( z );
+    BOOST_CHECK( z2 == z );
+    BOOST_CHECK( z2.onHeap() );
+
+    // assignment keeps the allocated memory
+    z2 = y;
+    BOOST_CHECK( z2 == y );
+    BOOST_CHECK( z2.onHeap() );
+    y2 = z;
+    BOOST_CHECK( y2 == z );
+    BOOST_CHECK( y2.onHeap() );
+    y2 = y2;
+    BOOST_CHECK( y2 == z );
+
+    SmallVector<int, 0> w( 2, 5 );
+    BOOST_CHECK_EQUAL( w.size(), 2 );
+    BOOST_CHECK( w.onHeap() );
+    BOOST_CHECK_EQUAL( w[1], 5 );
+}
+
+
+BOOST_AUTO_TEST_CASE( ModifiersTest ) {
+    SmallVector<int, 4> x;
+    for( int i = 0; i < 10; i++ ) {
+        x.push_back( i );
+        BOOST_CHECK_EQUAL( x.size(), (size_t)(i + 1) );
+        BOOST_CHECK_EQUAL( x.back(), i );
+        BOOST_CHECK_EQUAL( x.onHeap(), i >= 4 );
+    }
+    BOOST_CHECK_EQUAL( x.front(), 0 );
+    x.pop_back();
+    BOOST_CHECK_EQUAL( x.size(), 9 );
+    BOOST_CHECK_EQUAL( x.at( 8 ), 8 );
+    BOOST_CHECK_THROW( x.at( 9 ), std::out_of_range );
+
+    x.resize( 2 );
+    BOOST_CHECK_EQUAL( x.size(), 2 );
+    x.resize( 5, 7 );
+    BOOST_CHECK_EQUAL( x.size(), 5 );
+    BOOST_CHECK_EQUAL( x[1], 1 );
+    BOOST_CHECK_EQUAL( x[2], 7 );
+    BOOST_CHECK_EQUAL( x[4], 7 );
+    x.resize( 6 );
+    BOOST_CHECK_EQUAL( x[5], 0 );
+
+    std::vector<int> a;
+    a.push_back( 10 );
+    a.push_back( 11 );
+    SmallVector<int, 4> y( 2, 1 );
+    y.insert( y.begin() + 1, a.begin(), a.end() );
+    BOOST_CHECK_EQUAL( y.size(), 4 );
+    BOOST_CHECK_EQUAL( y[0], 1 );
+    BOOST_CHECK_EQUAL( y[1], 10 );
+    BOOST_CHECK_EQUAL( y[2], 11 );
+    BOOST_CHECK_EQUAL( y[3], 1 );
+    y.insert( y.end(), a.begin(), a.end() );
+    BOOST_CHECK_EQUAL( y.size(), 6 );
+    BOOST_CHECK_EQUAL( y[5], 11 );
+    y.assign( a.begin(), a.end() );
+    BOOST_CHECK_EQUAL( y.size(), 2 );
+    BOOST_CHECK_EQUAL( y[0], 10 );
+
+    SmallVector<int, 4> z( 1, 3 );
+    z.swap( y );
+    BOOST_CHECK_EQUAL( z.size(), 2 );
+    BOOST_CHECK_EQUAL( y.size(), 1 );
+    BOOST_CHECK_EQUAL( y[0], 3 );
+
+    z.clear();
+    BOOST_CHECK( z.empty() );
+}
+
+
+BOOST_AUTO_TEST_CASE( IteratorTest ) {
+    SmallVector<int, 4> x;
+    for( int i = 0; i < 6; i++ )
+        x.push_back( i );
+
+    int i = 0;
+    for( SmallVector<int, 4>::const_iterator it = x.begin(); it != x.end(); it++, i++ )
+        BOOST_CHECK_EQUAL( *it, i );
+    for( SmallVector<int, 4>::reverse_iterator it = x.rbegin(); it != x.rend(); it++ )
+        BOOST_CHECK_EQUAL( *it, --i );
+    for( SmallVector<int, 4>::iterator it = x.begin(); it != x.end(); it++ )
+        *it *= 2;
+    BOOST_CHECK_EQUAL( x[5], 10 );
+
+    SmallVector<int, 4> y( x );
+    BOOST_CHECK( x == y );
+    BOOST_CHECK( !(x != y) );
+    BOOST_CHECK( !(x < y) );
+    y[5] = 11;
+    BOOST_CHECK( x != y );
+    BOOST_CHECK( x < y );
+    BOOST_CHECK( !(y < x) );
+    y.pop_back();
+    BOOST_CHECK( y < x );
+}
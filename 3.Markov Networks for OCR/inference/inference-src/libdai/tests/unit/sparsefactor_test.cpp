@@ -0,0 +1,178 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+#include <dai/sparsefactor.h>
+#include <sstream>
+
+
+using namespace dai;
+
+
+#ifdef DAI_SINGLE
+const Real tol = 1e-3;
+#else
+const Real tol = 1e-8;
+#endif
+
+
+#define BOOST_TEST_MODULE SparseFactorTest
+
+
+#include <boost/test/unit_test.hpp>
+#include <boost/test/floating_point_comparison.hpp>
+
+
+/// Returns a random factor on \a vs of which approximately a fraction \a density of the values is nonzero
+Factor randomSparseFactor( const VarSet &vs, Real density ) {
+    Factor f( vs );
+    f.randomize();
+    for( size_t i = 0; i < f.nrStates(); i++ )
+        if( rnd_uniform() >= density )
+            f.set( i, 0.0 );
+    return f;
+}
+
+
+/// Returns a random subset of \a vars
+VarSet randomSubset( const std::vector<Var> &vars ) {
+    VarSet vs;
+    for( size_t i = 0; i < vars.size(); i++ )
+        if( rnd(2) == 0 )
+            vs |= vars[i];
+    return vs;
+}
+
+
+BOOST_AUTO_TEST_CASE( ConstructorsTest ) {
+    SparseFactor x1;
+    BOOST_CHECK_EQUAL( x1.nrStates(), 1 );
+    BOOST_CHECK_EQUAL( x1.nrNonZeros(), 1 );
+    BOOST_CHECK_EQUAL( x1[0], 1.0 );
+    BOOST_CHECK( x1.vars() == VarSet() );
+
+    SparseFactor x2( 0.0 );
+    BOOST_CHECK_EQUAL( x2.nrStates(), 1 );
+    BOOST_CHECK_EQUAL( x2.nrNonZeros(), 0 );
+    BOOST_CHECK_EQUAL( x2[0], 0.0 );
+
+    Var v1( 0, 3 ), v2( 1, 2 );
+    SparseFactor x3( VarSet( v1, v2 ) );
+    BOOST_CHECK_EQUAL( x3.nrStates(), 6 );
+    BOOST_CHECK_EQUAL( x3.nrNonZeros(), 0 );
+    BOOST_CHECK_EQUAL( x3.density(), 0.0 );
+    BOOST_CHECK( x3.toFactor() == Factor( VarSet( v1, v2 ), 0.0 ) );
+
+    Factor f( VarSet( v1, v2 ), 0.0 );
+    f.set( 1, 2.0 );
+    f.set( 4, 3.0 );
+    SparseFactor x4( f );
+    BOOST_CHECK( x4.vars() == VarSet( v1, v2 ) );
+    BOOST_CHECK_EQUAL( x4.nrStates(), 6 );
+    BOOST_CHECK_EQUAL( x4.nrNonZeros(), 2 );
+    BOOST_CHECK_CLOSE( x4.density(), (Real)(1.0 / 3.0), tol );
+    BOOST_CHECK_EQUAL( x4.indices()[0], 1 );
+    BOOST_CHECK_EQUAL( x4.indices()[1], 4 );
+    BOOST_CHECK_EQUAL( x4.values()[0], 2.0 );
+    BOOST_CHECK_EQUAL( x4.values()[1], 3.0 );
+    BOOST_CHECK( x4.toFactor() == f );
+
+    std::vector<size_t> idx;
+    idx.push_back( 1 );
+    idx.push_back( 3 );
+    idx.push_back( 4 );
+    std::vector<Real> val;
+    val.push_back( 2.0 );
+    val.push_back( 0.0 );
+    val.push_back( 3.0 );
+    SparseFactor x5( VarSet( v1, v2 ), idx, val );
+    BOOST_CHECK_EQUAL( x5.nrNonZeros(), 2 );
+    BOOST_CHECK( x5 == x4 );
+
+    SparseFactor x6( x4 );
+    BOOST_CHECK( x6 == x4 );
+}
+
+
+BOOST_AUTO_TEST_CASE( EntriesTest ) {
+    Var v1( 0, 3 ), v2( 1, 2 );
+    SparseFactor x( VarSet( v1, v2 ) );
+    x.set( 4, 1.0 );
+    x.set( 2, 2.0 );
+    x.set( 5, 3.0 );
+    BOOST_CHECK_EQUAL( x.nrNonZeros(), 3 );
+    BOOST_CHECK_EQUAL( x.indices()[0], 2 );
+    BOOST_CHECK_EQUAL( x.indices()[1], 4 );
+    BOOST_CHECK_EQUAL( x.indices()[2], 5 );
+    BOOST_CHECK_EQUAL( x[0], 0.0 );
+    BOOST_CHECK_EQUAL( x[2], 2.0 );
+    BOOST_CHECK_EQUAL( x.get( 4 ), 1.0 );
+    BOOST_CHECK_EQUAL( x[5], 3.0 );
+    x.set( 4, 5.0 );
+    BOOST_CHECK_EQUAL( x[4], 5.0 );
+    BOOST_CHECK_EQUAL( x.nrNonZeros(), 3 );
+    x.set( 2, 0.0 );
+    BOOST_CHECK_EQUAL( x[2], 0.0 );
+    BOOST_CHECK_EQUAL( x.nrNonZeros(), 2 );
+    x.set( 0, 0.0 );
+    BOOST_CHECK_EQUAL( x.nrNonZeros(), 2 );
+
+    BOOST_CHECK_EQUAL( x.sum(), 8.0 );
+    BOOST_CHECK_EQUAL( x.max(), 5.0 );
+    BOOST_CHECK_EQUAL( x.normalize(), 8.0 );
+    BOOST_CHECK_CLOSE( x[4], (Real)(5.0 / 8.0), tol );
+    BOOST_CHECK_CLOSE( x[5], (Real)(3.0 / 8.0), tol );
+    x *= 2.0;
+    BOOST_CHECK_CLOSE( x.sum(), (Real)2.0, tol );
+    x /= 4.0;
+    BOOST_CHECK_CLOSE( x.sum(), (Real)0.5, tol );
+    x *= 0.0;
+    BOOST_CHECK_EQUAL( x.nrNonZeros(), 0 );
+    BOOST_CHECK_THROW( x.normalize(), Exception );
+    BOOST_CHECK_THROW( x.normalized(), Exception );
+
+    std::stringstream ss;
+    x.set( 3, 1.0 );
+    ss << x;
+    BOOST_CHECK_EQUAL( ss.str(), std::string( "({x0, x1}, {3:1})" ) );
+}
+
+
+BOOST_AUTO_TEST_CASE( OperationsTest ) {
+    std::vector<Var> vars;
+    for( size_t i = 0; i < 5; i++ )
+        vars.push_back( Var( i, i + 2 ) );
+
+    for( size_t repeat = 0; repeat < 500; repeat++ ) {
+        Factor f = randomSparseFactor( randomSubset( vars ), 0.3 );
+        Factor g = randomSparseFactor( randomSubset( vars ), 0.5 );
+        SparseFactor sf( f ), sg( g );
+        BOOST_CHECK( sf.toFactor() == f );
+
+        // products consist of a single multiplication per value, so they should be identical
+        BOOST_CHECK( (sf * sg).toFactor() == f * g );
+        BOOST_CHECK( (sf * g).toFactor() == f * g );
+        BOOST_CHECK( (sf * f).toFactor() == f * f );
+        Factor h = randomSparseFactor( f.vars() / VarSet( vars[0] ), 0.5 );
+        BOOST_CHECK( (sf * h).toFactor() == f * h );
+        BOOST_CHECK( (sf * SparseFactor( h )).toFactor() == f * h );
+
+        // marginals are summed in the same order, so they should be identical before normalization
+        VarSet marg_vars = randomSubset( vars );
+        BOOST_CHECK( sf.marginal( marg_vars, false ).toFactor() == f.marginal( marg_vars, false ) );
+        BOOST_CHECK( sf.maxMarginal( marg_vars, false ).toFactor() == f.maxMarginal( marg_vars, false ) );
+        if( sf.nrNonZeros() ) {
+            BOOST_CHECK_SMALL( dist( sf.marginal( marg_vars ).toFactor().p(), f.marginal( marg_vars ).p(), DISTL1 ), tol );
+            BOOST_CHECK_SMALL( dist( sf.maxMarginal( marg_vars ).toFactor().p(), f.maxMarginal( marg_vars ).p(), DISTL1 ), tol );
+        }
+
+        // slices
+        VarSet slice_vars = marg_vars & f.vars();
+        size_t state = rnd( BigInt_size_t( slice_vars.nrStates() ) );
+        BOOST_CHECK( sf.slice( slice_vars, state ).toFactor() == f.slice( slice_vars, state ) );
+    }
+}
@@ -0,0 +1,237 @@
+/*  This file is part of libDAI - http://www.libdai.org/
+ *
+ *  Copyright (c) 2006-2011, The libDAI authors. All rights reserved.
+ *
+ *  Use of this source code is governed by a BSD-style license that can be found in the LICENSE file.
+ */
+
+
+#include <dai/threadpool.h>
+#include <dai/alldai.h>
+#include <dai/exceptions.h>
+#include <vector>
+
+
+using namespace dai;
+
+
+#define BOOST_TEST_MODULE ThreadPoolTest
+
+
+#include <boost/test/unit_test.hpp>
+
+
+/// Job that records which threads have executed it, and optionally throws in some threads
+struct RecordJob : public ThreadPool::Job {
+    std::vector<size_t> counts;
+    std::vector<bool> throws;
+
+    RecordJob( size_t nrThreads ) : counts( nrThreads, 0 ), throws( nrThreads, false ) {}
+
+    virtual void run( size_t thread ) {
+        counts[thread]++;
+        if( throws[thread] )
+            DAI_THROWE(RUNTIME_ERROR,"thread " + toString( thread ));
+    }
+};
+
+
+/// Returns a grid-shaped factor graph with \a n x \a n variables with \a states states each, with random factors
+FactorGraph createGrid( size_t n, size_t states ) {
+    std::vector<Var> vars;
+    for( size_t i = 0; i < n * n; i++ )
+        vars.push_back( Var( i, states ) );
+    std::vector<Factor> factors;
+    for( size_t i = 0; i < n * n; i++ ) {
+        factors.push_back( Factor( vars[i] ) );
+        factors.back().randomize();
+        if( i % n + 1 < n ) {
+            factors.push_back( Factor( VarSet( vars[i], vars[i + 1] ) ) );
+            factors.back().randomize();
+        }
+        if( i + n < n * n ) {
+            factors.push_back( Factor( VarSet( vars[i], vars[i + n] ) ) );
+            factors.back().randomize();
+        }
+    }
+    return FactorGraph( factors );
+}
+
+
+BOOST_AUTO_TEST_CASE( RunTest ) {
+    for( size_t n = 1; n <= 4; n++ ) {
+        ThreadPool pool( n );
+        BOOST_CHECK_EQUAL( pool.nrThreads(), n );
+        RecordJob job( n );
+        for( size_t rep = 0; rep < 3; rep++ )
+            pool.run( job );
+        for( size_t t = 0; t < n; t++ )
+            BOOST_CHECK_EQUAL( job.counts[t], 3 );
+    }
+    BOOST_CHECK_EQUAL( ThreadPool( 0 ).nrThreads(), 1 );
+}
+
+
+BOOST_AUTO_TEST_CASE( ExceptionTest ) {
+    ThreadPool pool( 4 );
+    RecordJob job( 4 );
+    job.throws[1] = true;
+    job.throws[3] = true;
+    try {
+        pool.run( job );
+        BOOST_FAIL( "no exception thrown" );
+    } catch( Exception &e ) {
+        BOOST_CHECK( e.getCode() == Exception::RUNTIME_ERROR );
+        BOOST_CHECK( std::string( e.what() ).find( "thread 1" ) != std::string::npos );
+    }
+
+    // the pool can be used again after an exception
+    job.throws[1] = false;
+    job.throws[3] = false;
+    pool.run( job );
+    if( ThreadPool::multithreaded() )
+        BOOST_CHECK_EQUAL( job.counts[3], 2 );
+    BOOST_CHECK_EQUAL( job.counts[0], 2 );
+}
+
+
+BOOST_AUTO_TEST_CASE( PartitionWorkTest ) {
+    std::vector<size_t> w( 8, 1 );
+    std::vector<size_t> parts = partitionWork( w, 4 );
+    BOOST_CHECK_EQUAL( parts.size(), 5 );
+    for( size_t t = 0; t <= 4; t++ )
+        BOOST_CHECK_EQUAL( parts[t], 2 * t );
+
+    // heavy items get parts of their own
+    w[0] = 100;
+    w[7] = 100;
+    parts = partitionWork( w, 3 );
+    BOOST_CHECK_EQUAL( parts[0], 0 );
+    BOOST_CHECK_EQUAL( parts[1], 1 );
+    BOOST_CHECK_EQUAL( parts[2], 7 );
+    BOOST_CHECK_EQUAL( parts[3], 8 );
+
+    // more parts than items
+    parts = partitionWork( std::vector<size_t>( 2, 1 ), 4 );
+    BOOST_CHECK_EQUAL( parts.size(), 5 );
+    BOOST_CHECK_EQUAL( parts[0], 0 );
+    BOOST_CHECK_EQUAL( parts[4], 2 );
+    for( size_t t = 0; t < 4; t++ )
+        BOOST_CHECK( parts[t] <= parts[t+1] );
+
+    parts = partitionWork( std::vector<size_t>(), 2 );
+    BOOST_CHECK_EQUAL( parts.size(), 3 );
+    BOOST_CHECK_EQUAL( parts[2], 0 );
+}
+
+
+#ifdef DAI_WITH_BP
+BOOST_AUTO_TEST_CASE( BPThreadsTest ) {
+    FactorGraph fg = createGrid( 6, 3 );
+    const char* updates[] = { "PARALL", "SEQFIX" };
+    const char* inference[] = { "SUMPROD", "MAXPROD" };
+    for( size_t u = 0; u < 2; u++ )
+        for( size_t inf = 0; inf < 2; inf++ )
+            for( size_t logdomain = 0; logdomain < 2; logdomain++ ) {
+                PropertySet opts;
+                opts.set( "tol", (Real)1e-9 );
+                opts.set( "maxiter", (size_t)100 );
+                opts.set( "damping", (Real)0.2 );
+                opts.set( "updates", std::string( updates[u] ) );
+                opts.set( "inference", std::string( inference[inf] ) );
+                opts.set( "logdomain", (bool)logdomain );
+                BP bp1( fg, opts );
+                bp1.init();
+                bp1.run();
+
+                opts.set( "nthreads", (size_t)4 );
+                BP bp4( fg, opts );
+                bp4.init();
+                bp4.run();
+
+                // the results do not depend on the number of threads
+                BOOST_CHECK_EQUAL( bp4.Iterations(), bp1.Iterations() );
+                BOOST_CHECK_EQUAL( bp4.maxDiff(), bp1.maxDiff() );
+                for( size_t i = 0; i < fg.nrVars(); i++ )
+                    BOOST_CHECK( bp4.beliefV( i ) == bp1.beliefV( i ) );
+                for( size_t I = 0; I < fg.nrFactors(); I++ )
+                    BOOST_CHECK( bp4.beliefF( I ) == bp1.beliefF( I ) );
+                BOOST_CHECK_EQUAL( bp4.getProperties().getAs<size_t>( "nthreads" ), 4 );
+            }
+}
+
+
+BOOST_AUTO_TEST_CASE( BPRelaxedMaxResidualTest ) {
+    FactorGraph fg = createGrid( 6, 3 );
+    for( size_t logdomain = 0; logdomain < 2; logdomain++ )
+        for( size_t damped = 0; damped < 2; damped++ ) {
+            PropertySet opts;
+            opts.set( "tol", (Real)1e-9 );
+            opts.set( "maxiter", (size_t)1000 );
+            opts.set( "damping", (Real)(damped ? 0.1 : 0.0) );
+            opts.set( "logdomain", (bool)logdomain );
+            opts.set( "updates", std::string( "SEQMAX" ) );
+            BP seqmax( fg, opts );
+            seqmax.init();
+            seqmax.run();
+
+            // with a single thread, the updates are the same as those of SEQMAX
+            opts.set( "updates", std::string( "PARMAX" ) );
+            BP parmax1( fg, opts );
+            parmax1.init();
+            parmax1.run();
+            BOOST_CHECK_EQUAL( parmax1.Iterations(), seqmax.Iterations() );
+            for( size_t i = 0; i < fg.nrVars(); i++ )
+                BOOST_CHECK( parmax1.beliefV( i ) == seqmax.beliefV( i ) );
+
+            // with several threads, the order of the updates differs, but the fixed point is the same
+            opts.set( "nthreads", (size_t)4 );
+            BP parmax4( fg, opts );
+            parmax4.init();
+            parmax4.run();
+            BOOST_CHECK( parmax4.maxDiff() <= 1e-9 );
+            for( size_t i = 0; i < fg.nrVars(); i++ )
+                BOOST_CHECK( dist( parmax4.beliefV( i ), seqmax.beliefV( i ), DISTLINF ) < 1e-7 );
+
+            // continuing a run (e.g., of a copy) recalculates the residuals
+            BP copy( parmax4 );
+            copy.setMaxIter( 2000 );
+            copy.run();
+            for( size_t i = 0; i < fg.nrVars(); i++ )
+                BOOST_CHECK( dist( copy.beliefV( i ), seqmax.beliefV( i ), DISTLINF ) < 1e-7 );
+        }
+}
+
+
+BOOST_AUTO_TEST_CASE( BPSplashTest ) {
+    FactorGraph fg = createGrid( 6, 3 );
+    for( size_t logdomain = 0; logdomain < 2; logdomain++ ) {
+        PropertySet opts;
+        opts.set( "tol", (Real)1e-9 );
+        opts.set( "maxiter", (size_t)1000 );
+        opts.set( "logdomain", (bool)logdomain );
+        opts.set( "updates", std::string( "SEQMAX" ) );
+        BP seqmax( fg, opts );
+        seqmax.init();
+        seqmax.run();
+
+        // several threads update non-overlapping splashes; the results do not depend on the timing
+        opts.set( "updates", std::string( "SPLASH" ) );
+        opts.set( "splashsize", (size_t)3 );
+        opts.set( "nthreads", (size_t)4 );
+        BP splash4( fg, opts );
+        splash4.init();
+        splash4.run();
+        BOOST_CHECK( splash4.maxDiff() <= 1e-9 );
+        for( size_t i = 0; i < fg.nrVars(); i++ )
+            BOOST_CHECK( dist( splash4.beliefV( i ), seqmax.beliefV( i ), DISTLINF ) < 1e-7 );
+
+        BP again( fg, opts );
+        again.init();
+        again.run();
+        BOOST_CHECK_EQUAL( again.Iterations(), splash4.Iterations() );
+        for( size_t i = 0; i < fg.nrVars(); i++ )
+            BOOST_CHECK( again.beliefV( i ) == splash4.beliefV( i ) );
+    }
+}
+#endif
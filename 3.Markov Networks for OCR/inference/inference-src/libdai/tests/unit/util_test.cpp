@@ -8,6 +8,7 @@
 
 #include <dai/util.h>
 #include <strstream>
+#include <sstream>
 #include <string>
 #include <vector>
 #include <map>
@@ -30,6 +31,59 @@ BOOST_AUTO_TEST_CASE( IsNanTest ) {
 }
 
 
+BOOST_AUTO_TEST_CASE( FastBigIntTest ) {
+    FastBigInt x;
+    BOOST_CHECK( x.isSmall() );
+    BOOST_CHECK_EQUAL( x, 0 );
+    FastBigInt y = 12345;
+    BOOST_CHECK( y.get() == 12345 );
+    BOOST_CHECK_EQUAL( BigInt_size_t( y ), 12345 );
+    BOOST_CHECK( x < y );
+    BOOST_CHECK( y > x );
+    BOOST_CHECK( x != y );
+
+    // 64-bit arithmetic is used as long as the value fits
+    FastBigInt::small_type max = std::numeric_limits<FastBigInt::small_type>::max();
+    FastBigInt z = max;
+    BOOST_CHECK( z.isSmall() );
+    BigInt bigMax = z.get();
+    BOOST_CHECK( bigMax > 0 );
+    ++z;
+    BOOST_CHECK( !z.isSmall() );
+    BOOST_CHECK( z.get() == bigMax + 1 );
+    BOOST_CHECK( z > max );
+    BOOST_CHECK( FastBigInt( max ) < z );
+    BOOST_CHECK_EQUAL( z % 3, (FastBigInt::small_type)(BigInt( (bigMax + 1) % 3 ).get_ui()) );
+    BOOST_CHECK_THROW( BigInt_size_t( z ), Exception );
+    z /= 2;
+    BOOST_CHECK( z.isSmall() );
+    BOOST_CHECK_EQUAL( z, max / 2 + 1 );
+
+    // products of numbers of states
+    FastBigInt p = 1;
+    BigInt q = 1;
+    for( size_t i = 0; i < 40; i++ ) {
+        p *= 7;
+        q *= 7;
+        BOOST_CHECK( p.get() == q );
+        BOOST_CHECK_EQUAL( p.isSmall(), i < 22 );
+    }
+    FastBigInt r( q );
+    BOOST_CHECK( r == p );
+    FastBigInt s = r;
+    s += p;
+    BOOST_CHECK( s.get() == 2 * q );
+    s = y;
+    BOOST_CHECK( s.isSmall() );
+    BOOST_CHECK_EQUAL( s, 12345 );
+    BOOST_CHECK( FastBigInt( BigInt( 42 ) ).isSmall() );
+
+    std::stringstream ss;
+    ss << y << " " << r;
+    BOOST_CHECK_EQUAL( ss.str(), std::string( "12345 " ) + q.get_str() );
+}
+
+
 BOOST_AUTO_TEST_CASE( RndTest ) {
     rnd_seed( 123 );
     Real a1 = rnd_uniform();
@@ -162,6 +162,16 @@ BOOST_AUTO_TEST_CASE( QueriesTest ) {
     BOOST_CHECK_EQUAL( x.nrStates(), 4 );
     BOOST_CHECK_EQUAL( y.nrStates(), 4 );
     BOOST_CHECK_EQUAL( z.nrStates(), 4 );
+    BOOST_CHECK( z.nrStates().isSmall() );
+
+    // the number of states of 70 binary variables does not fit in 64 bits
+    VarSet big;
+    for( size_t i = 0; i < 70; i++ )
+        big |= Var( i, 2 );
+    BigInt bigStates = 1;
+    bigStates <<= 70;
+    BOOST_CHECK( !big.nrStates().isSmall() );
+    BOOST_CHECK( big.nrStates().get() == bigStates );
 
     BOOST_CHECK( x.intersects( y ) );
     BOOST_CHECK( !x.intersects( z ) );
@@ -189,7 +199,7 @@ BOOST_AUTO_TEST_CASE( QueriesTest ) {
     
     x.elements()[0] = v3;
     x.elements()[1] = v4;
-    std::vector<Var> v;
+    VarSet::container_type v;
     v.push_back( v3 );
     v.push_back( v4 );
     BOOST_CHECK( x.elements() == v );
@@ -162,7 +162,7 @@ int main( int argc, char *argv[] ) {
             BigInt Ds = fg.Delta(i).nrStates();
             if( Ds > max_Delta_size )
                 max_Delta_size = Ds;
-            cavsum_lcbp += di.nrStates();
+            cavsum_lcbp += di.nrStates().get();
             for( VarSet::const_iterator j = di.begin(); j != di.end(); j++ )
                 cavsum_lcbp2 += j->states();
         }